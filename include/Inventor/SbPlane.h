@@ -50,6 +50,7 @@ public:
   void offset(const float d);
   SbBool intersect(const SbLine& l, SbVec3f& intersection) const;
   void transform(const SbMatrix& matrix);
+  static void transform(const SbMatrix & matrix, SbPlane * planes, const int num);
   SbBool isInHalfSpace(const SbVec3f& point) const;
   float getDistance(const SbVec3f &point) const;
   const SbVec3f& getNormal(void) const;
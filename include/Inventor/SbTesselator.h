@@ -48,6 +48,7 @@ public:
   void beginPolygon(SbBool keepVertices = FALSE,
                     const SbVec3f & normal = SbVec3f(0.0f, 0.0f, 0.0f));
   void addVertex(const SbVec3f &v, void * data);
+  void nextContour(void);
   void endPolygon(void);
   void setCallback(SbTesselatorCB * func, void * data);
 
@@ -62,6 +62,7 @@ public:
   virtual FILE * getFilePointer(void) const;
   virtual SbBool openFile(const char * const fileName);
   virtual void closeFile(void);
+  void flushFile(void);
 
   SbBool setCompression(const SbName & compmethod,
                         const float level = 0.5f);
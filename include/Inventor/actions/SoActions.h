@@ -34,6 +34,7 @@
 \**************************************************************************/
 
 #include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoFlattenAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoBoxHighlightRenderAction.h>
 #include <Inventor/actions/SoLineHighlightRenderAction.h>
@@ -49,6 +50,8 @@
 #include <Inventor/actions/SoAudioRenderAction.h>
 #include <Inventor/collision/SoIntersectionDetectionAction.h>
 #include <Inventor/actions/SoSimplifyAction.h>
+#include <Inventor/actions/SoShapeSimplifyAction.h>
+#include <Inventor/actions/SoGlobalSimplifyAction.h>
 #include <Inventor/actions/SoReorganizeAction.h>
 #include <Inventor/actions/SoToVRMLAction.h>
 #include <Inventor/actions/SoToVRML2Action.h>
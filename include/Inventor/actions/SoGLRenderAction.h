@@ -84,6 +84,21 @@ public:
     CUSTOM_CALLBACK
   };
 
+  enum Statistic {
+    SHAPES_RENDERED,
+    DRAW_CALLS,
+    DISPLAY_LIST_CALLS,
+    SEPARATORS_CULLED,
+    RENDER_CACHE_HITS,
+    RENDER_CACHE_MISSES,
+    RENDER_CACHES_CREATED,
+    VBOS_CREATED,
+    VBO_UPLOADS,
+    VBO_UPLOADED_BYTES,
+    TEXTURE_UPLOADS,
+    NUM_STATISTICS
+  };
+
   typedef AbortCode SoGLRenderAbortCB(void * userdata);
 
   void setViewportRegion(const SbViewportRegion & newregion);
@@ -135,6 +150,18 @@ public:
   SbBool isRenderingTranspPaths(void) const;
   SbBool isRenderingTranspBackfaces(void) const;
 
+  void setCollectStatistics(const SbBool onoff);
+  SbBool isCollectingStatistics(void) const;
+  uint32_t getStatistic(const Statistic statistic) const;
+  static const char * getStatisticName(const Statistic statistic);
+
+  void setLODTriangleBudget(const uint32_t numtriangles);
+  uint32_t getLODTriangleBudget(void) const;
+  void setLODTimeBudget(const float seconds);
+  float getLODTimeBudget(void) const;
+  void setLODHysteresis(const float fraction);
+  float getLODHysteresis(void) const;
+
 protected:
   friend class SoGLRenderActionP; // calls beginTraversal
   virtual void beginTraversal(SoNode * node);
@@ -61,6 +61,8 @@ public:
   SbBool areVPNodesGenerated(void); 
   void matchIndexArrays(SbBool onoff);
   SbBool areIndexArraysMatched(void) const;
+  void mergeShapes(SbBool onoff);
+  SbBool areShapesMerged(void) const;
   SoSimplifier * getSimplifier(void) const;
 
   virtual void apply(SoNode * root);
@@ -75,6 +75,9 @@ public:
   SbBool isFound(void) const;
   void addPath(SoPath * const path);
 
+  static void setIndexed(SoNode * root, const SbBool onoff);
+  static SbBool isIndexed(SoNode * root);
+
   // Obsoleted global flag, only present for compatibility reasons
   // with old SGI / TGS Inventor application code.
   static SbBool duringSearchAll;
@@ -33,10 +33,6 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
-// FIXME: this class has not yet been implemented in Coin. this is a
-// placeholder / stub / skeleton code, not yet built (nor installed,
-// obviously).  --mortene.
-
 #include <Inventor/actions/SoSimplifyAction.h>
 #include <Inventor/tools/SbLazyPimplPtr.h>
 
@@ -53,6 +49,10 @@ public:
   SoShapeSimplifyAction(void);
   virtual ~SoShapeSimplifyAction(void);
 
+  virtual void apply(SoNode * root);
+  virtual void apply(SoPath * path);
+  virtual void apply(const SoPathList & pathlist, SbBool obeysrules = FALSE);
+
 protected:
   virtual void beginTraversal(SoNode * node);
 
@@ -53,6 +53,20 @@ public:
   virtual void apply(SoPath * path);
   virtual void apply(const SoPathList & pathlist, SbBool obeysrules = FALSE);
 
+  void setSimplificationLevels(const int num, const float levels[]);
+  int getNumSimplificationLevels(void) const;
+  const float * getSimplificationLevels(void) const;
+
+  void setRanges(const int num, const float ranges[]);
+  int getNumRanges(void) const;
+  const float * getRanges(void) const;
+
+  void setMinTriangles(const int num);
+  int getMinTriangles(void) const;
+
+  void setScreenSpaceError(const float pixels);
+  float getScreenSpaceError(void) const;
+
 protected:
   virtual void beginTraversal(SoNode * node);
 
@@ -38,6 +38,7 @@
 #include <Inventor/fields/SoSFNode.h>
 #include <Inventor/fields/SoSFFloat.h>
 #include <Inventor/fields/SoSFVec3f.h>
+#include <Inventor/fields/SoSFInt32.h>
 
 class COIN_DLL_API SoShadowDirectionalLight : public SoDirectionalLight {
   typedef SoDirectionalLight inherited;
@@ -54,6 +55,7 @@ public:
   SoSFFloat maxShadowDistance;
   SoSFVec3f bboxCenter;
   SoSFVec3f bboxSize;
+  SoSFInt32 numCascades;
 
 protected:
   virtual ~SoShadowDirectionalLight();
@@ -45,6 +45,11 @@ public:
   static SbBool isOverlayActive(void);
   static SbBool isConsoleActive(void);
 
+  static void enableTracing(SbBool enable = TRUE);
+  static SbBool isTracingEnabled(void);
+  static void clearTrace(void);
+  static SbBool writeTrace(const char * filename);
+
 }; // SoProfiler
 
 #endif // !COIN_SOPROFILER_H
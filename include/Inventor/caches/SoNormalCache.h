@@ -103,6 +103,9 @@ public:
                           const int vPerColumn,
                           const SbBool ccw);
 
+  void setPreviousCache(SoNormalCache * prevcache,
+                        const SbUniqueId coordnodeid);
+
 private:
   SoNormalCacheP * pimpl;
   void clearGenerator(void);
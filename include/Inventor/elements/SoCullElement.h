@@ -57,6 +57,8 @@ public:
   static void addPlane(SoState * state, const SbPlane & newplane);
   static SbBool cullBox(SoState * state, const SbBox3f & box, const SbBool transform = TRUE);
   static SbBool cullTest(SoState * state, const SbBox3f & box, const SbBool transform = TRUE);
+  static void cullTestBoxes(SoState * state, const SbBox3f * boxes, const int numboxes,
+                            SbBool * outside, const SbBool transform = TRUE);
   static SbBool completelyInside(SoState * state);
 
   virtual SbBool matches(const SoElement * elt) const;
@@ -74,7 +74,11 @@ public:
   void setNormal(const int32_t index, const SbVec3f &normal);
 
 private:
-  SbBSPTree bsp;
+  // takes the place of the former SbBSPTree member, to keep the size
+  // and the layout of the class unchanged
+  class SoNormalGeneratorP * pimpl;
+  char reserved[sizeof(SbBSPTree) - sizeof(class SoNormalGeneratorP *)];
+
   SbList <int> vertexList;
   SbList <int> vertexFace;
   SbList <SbVec3f> faceNormals;
@@ -84,7 +88,7 @@ private:
   SbBool perVertex;
   int currFaceStart;
 
-  SbVec3f calcFaceNormal();
+  void calcFaceNormals(void);
 };
 
 #endif // !COIN_SONORMALGENERATOR_H
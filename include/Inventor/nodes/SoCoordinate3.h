@@ -56,6 +56,8 @@ public:
   virtual void pick(SoPickAction * action);
   virtual void getPrimitiveCount(SoGetPrimitiveCountAction * action);
 
+  virtual void notify(SoNotList * l);
+
  protected:
   virtual ~SoCoordinate3();
 
@@ -88,6 +88,8 @@ protected:
   virtual SbBool readInstance(SoInput * in, unsigned short flags);
 
 private:
+  friend class SoChildCuller;
+
   void commonConstructor(void);
   SbBool cullTestNoPush(SoState * state);
 
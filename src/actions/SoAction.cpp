@@ -230,6 +230,7 @@
 #include "misc/SoCompactPathList.h"
 
 #include "profiler/SoNodeProfiling.h"
+#include "profiler/SoProfilerTrace.h"
 
 // define this to debug path traversal
 // #define DEBUG_PATH_TRAVERSAL
@@ -424,7 +425,10 @@ SoAction::initClasses(void)
   SoIntersectionDetectionAction::initClass();
 
   SoSimplifyAction::initClass();
+  SoShapeSimplifyAction::initClass();
+  SoGlobalSimplifyAction::initClass();
   SoReorganizeAction::initClass();
+  SoFlattenAction::initClass();
   SoToVRMLAction::initClass();
 #ifdef HAVE_VRML97
   SoToVRML2Action::initClass();
@@ -562,9 +566,14 @@ SoAction::apply(SoNode * root)
       data.setActionStartTime(SbTime::getTimeOfDay());
     }
 
+    const SbBool traced = SoProfilerTrace::isActive();
+    if (traced) SoProfilerTrace::beginAction(this);
+
     this->beginTraversal(root);
     this->endTraversal(root);
 
+    if (traced) SoProfilerTrace::end();
+
     if (SoProfiler::isEnabled() &&
         state->isElementEnabled(SoProfilerElement::getClassStackIndex())) {
       SoProfilerElement * elt = SoProfilerElement::get(state);
@@ -652,8 +661,11 @@ SoAction::apply(SoPath * path)
   if (path->getLength() && path->getNode(0)) {
     SoNode * node = path->getNode(0);
     this->currentpath.setHead(node);
+    const SbBool traced = SoProfilerTrace::isActive();
+    if (traced) SoProfilerTrace::beginAction(this);
     this->beginTraversal(node);
     this->endTraversal(node);
+    if (traced) SoProfilerTrace::end();
   }
 
   path->unrefNoDelete();
@@ -707,6 +719,9 @@ SoAction::apply(const SoPathList & pathlist, SbBool obeysrules)
   this->currentpathcode = pathlist[0]->getFullLength() > 1 ?
     SoAction::IN_PATH : SoAction::BELOW_PATH;
 
+  const SbBool traced = SoProfilerTrace::isActive();
+  if (traced) SoProfilerTrace::beginAction(this);
+
   if (obeysrules) {
     // GoGoGo
     if (this->shouldCompactPathList()) {
@@ -775,6 +790,8 @@ SoAction::apply(const SoPathList & pathlist, SbBool obeysrules)
       }
     }
   }
+  if (traced) SoProfilerTrace::end();
+
   PRIVATE(this)->appliedcode = storedcode;
   PRIVATE(this)->applieddata = storeddata;
   this->currentpathcode = storedcurr;
@@ -0,0 +1,1302 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoFlattenAction SoFlattenAction.h Inventor/actions/SoFlattenAction.h
+  \brief The SoFlattenAction class flattens the static parts of a scene graph.
+
+  \ingroup coin_actions
+
+  Large scene graphs are often built from thousands of small shapes,
+  each below its own separator with its own transformation and
+  material. Rendering such a scene graph is usually limited by the
+  per-node and per-shape overhead, and not by the amount of geometry.
+
+  This action traverses the scene graph, transforms the geometry of
+  every shape into world space, and merges all the primitives that
+  are rendered with the same material, texture and drawing state into
+  one large indexed shape with an SoVertexProperty node. The
+  diffuse color and transparency of each vertex is stored in the
+  vertex property, so shapes that differ only in diffuse color are
+  merged too. Identical vertices are welded.
+
+  Parts of the scene graph that can change are kept as they are:
+  a separator is not flattened if it contains a node with a connected
+  field (e.g. from an engine), an animation node like SoRotor, a
+  dragger, a manipulator, or a level of detail node, and such
+  subgraphs are instead added to the flattened scene graph with a
+  snapshot of the inherited transformation and material state. The
+  original nodes are shared, so connections and draggers keep
+  working. The same is done for shapes that are rendered in screen
+  space (SoText2, SoImage and SoMarkerSet), and for SoCallback nodes.
+
+  Cameras and light sources are added first in the flattened scene
+  graph, with their transformation. Note that this makes all light
+  sources global. Other state that is not part of the merge criteria,
+  like clip planes, environment settings and texture units other
+  than the first, is not preserved for the flattened geometry.
+
+  Since the original shapes are gone from the flattened scene graph,
+  each original shape is kept as a \e part, identified by a copy of
+  the path to the shape. Use findPart() to find the original shape
+  for a picked point on the flattened scene graph:
+
+  \code
+  SoFlattenAction flatten;
+  flatten.apply(root);
+  SoSeparator * flat = flatten.getFlattenedSceneGraph();
+
+  // ...
+
+  const SoPickedPoint * pp = rpaction.getPickedPoint();
+  int part = flatten.findPart(pp);
+  if (part >= 0) {
+    SoPath * original = flatten.getPartPath(part);
+    // ...
+  }
+  \endcode
+
+  \since Coin 4.1
+*/
+
+#include <Inventor/actions/SoFlattenAction.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cstring>
+#include <cassert>
+
+#include <Inventor/SbName.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/details/SoFaceDetail.h>
+#include <Inventor/details/SoLineDetail.h>
+#include <Inventor/details/SoPointDetail.h>
+#include <Inventor/elements/SoMultiTextureEnabledElement.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoBlinker.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoFont.h>
+#include <Inventor/nodes/SoImage.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoIndexedLineSet.h>
+#include <Inventor/nodes/SoLOD.h>
+#include <Inventor/nodes/SoLevelOfDetail.h>
+#include <Inventor/nodes/SoLight.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoMarkerSet.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoMatrixTransform.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoPendulum.h>
+#include <Inventor/nodes/SoPickStyle.h>
+#include <Inventor/nodes/SoPointSet.h>
+#include <Inventor/nodes/SoRotor.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoShuttle.h>
+#include <Inventor/nodes/SoText2.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTransformSeparator.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+
+#ifdef HAVE_VRML97
+#include <Inventor/VRMLnodes/SoVRMLBillboard.h>
+#include <Inventor/VRMLnodes/SoVRMLLOD.h>
+#endif // HAVE_VRML97
+
+#ifdef HAVE_DRAGGERS
+#include <Inventor/draggers/SoDragger.h>
+#endif // HAVE_DRAGGERS
+
+#ifdef HAVE_MANIPULATORS
+#include <Inventor/manips/SoTransformManip.h>
+#endif // HAVE_MANIPULATORS
+
+#include "actions/SoSubActionP.h"
+#include "misc/SbFNVHash.h"
+#include "misc/SbHash.h"
+
+// *************************************************************************
+
+class SoFlattenActionP {
+public:
+  SoFlattenActionP(void)
+    : master(NULL),
+      cbaction(SbViewportRegion(640, 480)),
+      result(NULL),
+      globals(NULL),
+      kept(NULL),
+      curshape(NULL),
+      curpart(-1),
+      curmodel(SbMatrix::identity()),
+      curnormal(SbMatrix::identity()),
+      numinputnodes(0),
+      numinputshapes(0),
+      numoutputnodes(0),
+      numoutputshapes(0)
+  {
+    for (int i = 0; i < 3; i++) this->curbatch[i] = NULL;
+    this->cbaction.addPreCallback(SoNode::getClassTypeId(), pre_node_cb, this);
+    this->cbaction.addPostCallback(SoShape::getClassTypeId(), post_shape_cb, this);
+    this->cbaction.addTriangleCallback(SoShape::getClassTypeId(), triangle_cb, this);
+    this->cbaction.addLineSegmentCallback(SoShape::getClassTypeId(), line_segment_cb, this);
+    this->cbaction.addPointCallback(SoShape::getClassTypeId(), point_cb, this);
+  }
+  ~SoFlattenActionP() {
+    this->reset();
+  }
+
+  enum PrimitiveType {
+    TRIANGLES,
+    LINES,
+    POINTS
+  };
+
+  // The state that must be equal for primitives to be merged into
+  // the same shape. The diffuse color and transparency is stored per
+  // vertex, and is not part of the state.
+  class State {
+  public:
+    int operator==(const State & s) const;
+
+    PrimitiveType type;
+    SbBool lighting;
+    SbColor ambient;
+    SbColor specular;
+    SbColor emissive;
+    float shininess;
+    SbBool ordered;
+    SbBool solid;
+    SoDrawStyle::Style drawstyle;
+    float linewidth;
+    float pointsize;
+    unsigned short linepattern;
+    SoPickStyle::Style pickstyle;
+    const unsigned char * texture;
+    SbVec2s texsize;
+    int texcomponents;
+    SoTexture2::Wrap wraps;
+    SoTexture2::Wrap wrapt;
+    SoTexture2::Model texmodel;
+    SbColor blendcolor;
+  };
+
+  class Vertex {
+  public:
+    SbVec3f vertex;
+    SbVec3f normal;
+    SbVec2f texcoord;
+    uint32_t rgba;
+
+    // needed for SbHash
+    operator unsigned long(void) const;
+    int operator==(const Vertex & v) const;
+  };
+
+  // One merged output shape. The parts are stored as the index of
+  // the first primitive of each consecutive run of primitives from
+  // the same original shape.
+  class Batch {
+  public:
+    Batch(const State & s) : state(s), numprimitives(0), shape(NULL), texture(NULL) { }
+
+    State state;
+    SbList<SbVec3f> vertices;
+    SbList<SbVec3f> normals;
+    SbList<SbVec2f> texcoords;
+    SbList<uint32_t> colors;
+    SbList<int32_t> indices;
+    SbHash<Vertex, int32_t> vertexhash;
+    int numprimitives;
+    SbList<int> partstart;
+    SbList<int> partid;
+    SoShape * shape;
+    SoTexture2 * texture;
+  };
+
+  SoFlattenAction * master;
+  SoCallbackAction cbaction;
+
+  SoSeparator * result;
+  SoSeparator * globals;
+  SoSeparator * kept;
+  SbList<SoPath *> parts;
+  SbList<Batch *> batches;
+  SbList<const SoNode *> tops;
+  SbHash<const SoNode *, SbBool> dynamichash;
+
+  const SoShape * curshape;
+  int curpart;
+  Batch * curbatch[3];
+  SbMatrix curmodel;
+  SbMatrix curnormal;
+
+  int numinputnodes;
+  int numinputshapes;
+  int numoutputnodes;
+  int numoutputshapes;
+
+  void reset(void);
+  void begin(void);
+  void finish(void);
+
+  static SbBool isDynamic(const SoNode * node);
+  SbBool hasDynamic(const SoNode * node);
+  static SbBool isBoundary(const SoNode * node);
+  static void countNodes(const SoNode * node, int & numnodes, int & numshapes);
+
+  SoNode * createTransformed(SoCallbackAction * action, SoGroup * group, SoNode * node);
+  void keepNode(SoCallbackAction * action, SoNode * node);
+  void getState(SoCallbackAction * action, const PrimitiveType type, State & state);
+  Batch * getBatch(SoCallbackAction * action, const PrimitiveType type);
+  void addPart(SoCallbackAction * action, Batch * batch);
+  int32_t addVertex(SoCallbackAction * action, Batch * batch,
+                    const SoPrimitiveVertex * v, const SbBool weld);
+  void createShape(Batch * batch);
+
+  static SoCallbackAction::Response pre_node_cb(void * closure,
+                                                SoCallbackAction * action,
+                                                const SoNode * node);
+  static SoCallbackAction::Response post_shape_cb(void * closure,
+                                                  SoCallbackAction * action,
+                                                  const SoNode * node);
+  static void triangle_cb(void * userdata, SoCallbackAction * action,
+                          const SoPrimitiveVertex * v1,
+                          const SoPrimitiveVertex * v2,
+                          const SoPrimitiveVertex * v3);
+  static void line_segment_cb(void * userdata, SoCallbackAction * action,
+                              const SoPrimitiveVertex * v1,
+                              const SoPrimitiveVertex * v2);
+  static void point_cb(void * userdata, SoCallbackAction * action,
+                       const SoPrimitiveVertex * v);
+};
+
+#define PRIVATE(obj) obj->pimpl
+
+SO_ACTION_SOURCE(SoFlattenAction);
+
+/*!
+  \copydetails SoAction::initClass(void)
+*/
+void
+SoFlattenAction::initClass(void)
+{
+  SO_ACTION_INTERNAL_INIT_CLASS(SoFlattenAction, SoAction);
+}
+
+/*!
+  A constructor.
+*/
+
+SoFlattenAction::SoFlattenAction(void)
+{
+  PRIVATE(this)->master = this;
+  SO_ACTION_CONSTRUCTOR(SoFlattenAction);
+}
+
+/*!
+  The destructor.
+*/
+
+SoFlattenAction::~SoFlattenAction(void)
+{
+}
+
+/*!
+  Flattens the scene graph below \a root.
+*/
+void
+SoFlattenAction::apply(SoNode * root)
+{
+  PRIVATE(this)->begin();
+  PRIVATE(this)->tops.append(root);
+  PRIVATE(this)->cbaction.apply(root);
+  PRIVATE(this)->finish();
+}
+
+/*!
+  Flattens the scene graph below the tail of \a path. The state set
+  by the nodes along the path is baked into the flattened scene
+  graph.
+*/
+void
+SoFlattenAction::apply(SoPath * path)
+{
+  PRIVATE(this)->begin();
+  PRIVATE(this)->tops.append(path->getTail());
+  PRIVATE(this)->cbaction.apply(path);
+  PRIVATE(this)->finish();
+}
+
+/*!
+  Flattens the scene graphs below the tails of the paths in \a
+  pathlist into one flattened scene graph.
+*/
+void
+SoFlattenAction::apply(const SoPathList & pathlist, SbBool obeysrules)
+{
+  PRIVATE(this)->begin();
+  for (int i = 0; i < pathlist.getLength(); i++) {
+    PRIVATE(this)->tops.append(pathlist[i]->getTail());
+  }
+  PRIVATE(this)->cbaction.apply(pathlist, obeysrules);
+  PRIVATE(this)->finish();
+}
+
+/*!
+  Returns the flattened scene graph from the last time the action was
+  applied, or \c NULL if the action has not been applied. The scene
+  graph is owned by the action, so ref() it if you want to keep it
+  after the action is applied again or destructed.
+*/
+SoSeparator *
+SoFlattenAction::getFlattenedSceneGraph(void) const
+{
+  return PRIVATE(this)->result;
+}
+
+/*!
+  Returns the number of original shapes that were merged into the
+  flattened scene graph.
+*/
+int
+SoFlattenAction::getNumParts(void) const
+{
+  return PRIVATE(this)->parts.getLength();
+}
+
+/*!
+  Returns the path to the original shape for \a part. The path is
+  owned by the action.
+*/
+SoPath *
+SoFlattenAction::getPartPath(const int part) const
+{
+  assert(part >= 0 && part < PRIVATE(this)->parts.getLength());
+  return PRIVATE(this)->parts[part];
+}
+
+/*!
+  Returns the part for the primitive identified by \a detail in the
+  merged \a shape, or -1 if \a shape is not a merged shape from the
+  flattened scene graph. \a detail should be an SoFaceDetail, an
+  SoLineDetail or an SoPointDetail, as returned when picking the
+  flattened scene graph.
+*/
+int
+SoFlattenAction::findPart(const SoNode * shape, const SoDetail * detail) const
+{
+  if (shape == NULL || detail == NULL) return -1;
+
+  const SoFlattenActionP::Batch * batch = NULL;
+  for (int i = 0; i < PRIVATE(this)->batches.getLength(); i++) {
+    if (PRIVATE(this)->batches[i]->shape == shape) {
+      batch = PRIVATE(this)->batches[i];
+      break;
+    }
+  }
+  if (batch == NULL || batch->partstart.getLength() == 0) return -1;
+
+  int primitive = -1;
+  if (detail->isOfType(SoFaceDetail::getClassTypeId())) {
+    primitive = static_cast<const SoFaceDetail *>(detail)->getFaceIndex();
+  }
+  else if (detail->isOfType(SoLineDetail::getClassTypeId())) {
+    primitive = static_cast<const SoLineDetail *>(detail)->getLineIndex();
+  }
+  else if (detail->isOfType(SoPointDetail::getClassTypeId())) {
+    primitive = static_cast<const SoPointDetail *>(detail)->getCoordinateIndex();
+  }
+  if (primitive < 0 || primitive >= batch->numprimitives) return -1;
+
+  // binary search for the last run starting at or before primitive
+  int lo = 0;
+  int hi = batch->partstart.getLength() - 1;
+  while (lo < hi) {
+    const int mid = (lo + hi + 1) / 2;
+    if (batch->partstart[mid] <= primitive) lo = mid;
+    else hi = mid - 1;
+  }
+  return batch->partid[lo];
+}
+
+/*!
+  \overload
+
+  Returns the part for the picked point \a pp on the flattened scene
+  graph, or -1 if the picked point is not on a merged shape.
+*/
+int
+SoFlattenAction::findPart(const SoPickedPoint * pp) const
+{
+  if (pp == NULL) return -1;
+  const SoFullPath * path = static_cast<const SoFullPath *>(pp->getPath());
+  const SoNode * tail = path->getTail();
+  return this->findPart(tail, pp->getDetail(tail));
+}
+
+/*!
+  Returns the number of nodes in the scene graph the action was last
+  applied to. Nodes that are used several times are counted once for
+  each time they are used.
+*/
+int
+SoFlattenAction::getNumInputNodes(void) const
+{
+  return PRIVATE(this)->numinputnodes;
+}
+
+/*!
+  Returns the number of shapes in the scene graph the action was last
+  applied to.
+*/
+int
+SoFlattenAction::getNumInputShapes(void) const
+{
+  return PRIVATE(this)->numinputshapes;
+}
+
+/*!
+  Returns the number of nodes in the flattened scene graph, including
+  the nodes in subgraphs that were kept.
+*/
+int
+SoFlattenAction::getNumOutputNodes(void) const
+{
+  return PRIVATE(this)->numoutputnodes;
+}
+
+/*!
+  Returns the number of shapes in the flattened scene graph, including
+  the shapes in subgraphs that were kept. This is a good estimate for
+  the number of draw calls needed to render the flattened scene graph.
+*/
+int
+SoFlattenAction::getNumOutputShapes(void) const
+{
+  return PRIVATE(this)->numoutputshapes;
+}
+
+// Documented in superclass.
+void
+SoFlattenAction::beginTraversal(SoNode * /* node */)
+{
+  assert(0 && "should never get here");
+}
+
+// *************************************************************************
+
+int
+SoFlattenActionP::State::operator==(const State & s) const
+{
+  return
+    (this->type == s.type) &&
+    (this->lighting == s.lighting) &&
+    (this->ambient == s.ambient) &&
+    (this->specular == s.specular) &&
+    (this->emissive == s.emissive) &&
+    (this->shininess == s.shininess) &&
+    (this->ordered == s.ordered) &&
+    (this->solid == s.solid) &&
+    (this->drawstyle == s.drawstyle) &&
+    (this->linewidth == s.linewidth) &&
+    (this->pointsize == s.pointsize) &&
+    (this->linepattern == s.linepattern) &&
+    (this->pickstyle == s.pickstyle) &&
+    (this->texture == s.texture) &&
+    (this->texture == NULL ||
+     ((this->texsize == s.texsize) &&
+      (this->texcomponents == s.texcomponents) &&
+      (this->wraps == s.wraps) &&
+      (this->wrapt == s.wrapt) &&
+      (this->texmodel == s.texmodel) &&
+      (this->blendcolor == s.blendcolor)));
+}
+
+SoFlattenActionP::Vertex::operator unsigned long(void) const
+{
+  SbFNVHash hash;
+  hash.add(this->vertex.getValue(), 3);
+  hash.add(this->normal.getValue(), 3);
+  hash.add(this->texcoord.getValue(), 2);
+  hash.add(this->rgba);
+  return hash.getValue();
+}
+
+int
+SoFlattenActionP::Vertex::operator==(const Vertex & v) const
+{
+  return
+    (this->vertex == v.vertex) &&
+    (this->normal == v.normal) &&
+    (this->texcoord == v.texcoord) &&
+    (this->rgba == v.rgba);
+}
+
+void
+SoFlattenActionP::reset(void)
+{
+  if (this->result) {
+    this->result->unref();
+    this->result = NULL;
+  }
+  if (this->globals) {
+    this->globals->unref();
+    this->globals = NULL;
+  }
+  if (this->kept) {
+    this->kept->unref();
+    this->kept = NULL;
+  }
+  int i;
+  for (i = 0; i < this->parts.getLength(); i++) {
+    this->parts[i]->unref();
+  }
+  this->parts.truncate(0);
+  for (i = 0; i < this->batches.getLength(); i++) {
+    delete this->batches[i];
+  }
+  this->batches.truncate(0);
+  this->tops.truncate(0);
+  this->dynamichash.clear();
+  this->curshape = NULL;
+  this->curpart = -1;
+  this->curmodel = SbMatrix::identity();
+  this->curnormal = SbMatrix::identity();
+  this->numinputnodes = 0;
+  this->numinputshapes = 0;
+  this->numoutputnodes = 0;
+  this->numoutputshapes = 0;
+}
+
+void
+SoFlattenActionP::begin(void)
+{
+  this->reset();
+  this->globals = new SoSeparator;
+  this->globals->ref();
+  this->kept = new SoSeparator;
+  this->kept->ref();
+}
+
+void
+SoFlattenActionP::finish(void)
+{
+  int i;
+  for (i = 0; i < this->tops.getLength(); i++) {
+    countNodes(this->tops[i], this->numinputnodes, this->numinputshapes);
+  }
+
+  this->result = new SoSeparator;
+  this->result->ref();
+
+  // cameras and lights must come before the shapes they affect
+  for (i = 0; i < this->globals->getNumChildren(); i++) {
+    this->result->addChild(this->globals->getChild(i));
+  }
+  for (i = 0; i < this->batches.getLength(); i++) {
+    this->createShape(this->batches[i]);
+  }
+  for (i = 0; i < this->kept->getNumChildren(); i++) {
+    this->result->addChild(this->kept->getChild(i));
+  }
+  this->globals->unref();
+  this->globals = NULL;
+  this->kept->unref();
+  this->kept = NULL;
+
+  // the vertex hashes are not needed after the shapes are created
+  for (i = 0; i < this->batches.getLength(); i++) {
+    this->batches[i]->vertexhash.clear();
+  }
+  this->dynamichash.clear();
+  this->tops.truncate(0);
+
+  countNodes(this->result, this->numoutputnodes, this->numoutputshapes);
+}
+
+// Returns TRUE if the node itself can change the rendering without
+// the scene graph being modified.
+SbBool
+SoFlattenActionP::isDynamic(const SoNode * node)
+{
+  const SoType type = node->getTypeId();
+  if (type.isDerivedFrom(SoLOD::getClassTypeId()) ||
+      type.isDerivedFrom(SoLevelOfDetail::getClassTypeId()) ||
+      type.isDerivedFrom(SoBlinker::getClassTypeId()) ||
+      type.isDerivedFrom(SoRotor::getClassTypeId()) ||
+      type.isDerivedFrom(SoPendulum::getClassTypeId()) ||
+      type.isDerivedFrom(SoShuttle::getClassTypeId())) return TRUE;
+#ifdef HAVE_VRML97
+  if (type.isDerivedFrom(SoVRMLLOD::getClassTypeId()) ||
+      type.isDerivedFrom(SoVRMLBillboard::getClassTypeId())) return TRUE;
+#endif // HAVE_VRML97
+#ifdef HAVE_DRAGGERS
+  if (type.isDerivedFrom(SoDragger::getClassTypeId())) return TRUE;
+#endif // HAVE_DRAGGERS
+#ifdef HAVE_MANIPULATORS
+  if (type.isDerivedFrom(SoTransformManip::getClassTypeId())) return TRUE;
+#endif // HAVE_MANIPULATORS
+
+  SoFieldList fields;
+  const int num = node->getFields(fields);
+  for (int i = 0; i < num; i++) {
+    if (fields[i]->isConnected()) return TRUE;
+  }
+  return FALSE;
+}
+
+// Nodes that keep their state changes to themselves.
+SbBool
+SoFlattenActionP::isBoundary(const SoNode * node)
+{
+#ifdef HAVE_DRAGGERS
+  if (node->isOfType(SoDragger::getClassTypeId())) return TRUE;
+#endif // HAVE_DRAGGERS
+  return node->isOfType(SoSeparator::getClassTypeId());
+}
+
+// Returns TRUE if there is a dynamic node below node that is not
+// below another boundary node.
+SbBool
+SoFlattenActionP::hasDynamic(const SoNode * node)
+{
+  SbBool dynamic;
+  if (this->dynamichash.get(node, dynamic)) return dynamic;
+
+  dynamic = isDynamic(node);
+  const SoChildList * children = node->getChildren();
+  if (!dynamic && children) {
+    for (int i = 0; i < children->getLength(); i++) {
+      const SoNode * child = (*children)[i];
+      if (!isBoundary(child) && this->hasDynamic(child)) {
+        dynamic = TRUE;
+        break;
+      }
+    }
+  }
+  this->dynamichash.put(node, dynamic);
+  return dynamic;
+}
+
+void
+SoFlattenActionP::countNodes(const SoNode * node, int & numnodes, int & numshapes)
+{
+  numnodes++;
+  if (node->isOfType(SoShape::getClassTypeId())) numshapes++;
+  const SoChildList * children = node->getChildren();
+  if (children) {
+    for (int i = 0; i < children->getLength(); i++) {
+      countNodes((*children)[i], numnodes, numshapes);
+    }
+  }
+}
+
+// Adds the current model matrix to group, unless it is the identity
+// matrix, and then node.
+SoNode *
+SoFlattenActionP::createTransformed(SoCallbackAction * action, SoGroup * group, SoNode * node)
+{
+  const SbMatrix & m = action->getModelMatrix();
+  if (m != SbMatrix::identity()) {
+    SoMatrixTransform * mt = new SoMatrixTransform;
+    mt->matrix = m;
+    group->addChild(mt);
+  }
+  group->addChild(node);
+  return group;
+}
+
+// Adds node to the flattened scene graph as it is, below a separator
+// with a snapshot of the current transformation and material state.
+void
+SoFlattenActionP::keepNode(SoCallbackAction * action, SoNode * node)
+{
+  SoSeparator * sep = new SoSeparator;
+
+  SoMaterial * mat = new SoMaterial;
+  SbColor ambient, diffuse, specular, emissive;
+  float shininess, transparency;
+  action->getMaterial(ambient, diffuse, specular, emissive, shininess, transparency);
+  mat->ambientColor = ambient;
+  mat->diffuseColor = diffuse;
+  mat->specularColor = specular;
+  mat->emissiveColor = emissive;
+  mat->shininess = shininess;
+  mat->transparency = transparency;
+  sep->addChild(mat);
+
+  SoMaterialBinding * mb = new SoMaterialBinding;
+  mb->value = static_cast<SoMaterialBinding::Binding>(action->getMaterialBinding());
+  sep->addChild(mb);
+
+  SoLightModel * lm = new SoLightModel;
+  lm->model = action->getLightModel();
+  sep->addChild(lm);
+
+  SoDrawStyle * ds = new SoDrawStyle;
+  ds->style = action->getDrawStyle();
+  ds->lineWidth = action->getLineWidth();
+  ds->pointSize = action->getPointSize();
+  ds->linePattern = action->getLinePattern();
+  sep->addChild(ds);
+
+  SoShapeHints * sh = new SoShapeHints;
+  sh->vertexOrdering = action->getVertexOrdering();
+  sh->shapeType = action->getShapeType();
+  sh->faceType = action->getFaceType();
+  sh->creaseAngle = action->getCreaseAngle();
+  sep->addChild(sh);
+
+  SoFont * font = new SoFont;
+  font->name = action->getFontName();
+  font->size = action->getFontSize();
+  sep->addChild(font);
+
+  SbVec2s size;
+  int numcomponents;
+  const unsigned char * image = action->getTextureImage(size, numcomponents);
+  if (image &&
+      SoMultiTextureEnabledElement::getMode(action->getState(), 0) ==
+      SoMultiTextureEnabledElement::TEXTURE2D) {
+    SoTexture2 * tex = new SoTexture2;
+    tex->image.setValue(size, numcomponents, image);
+    tex->wrapS = action->getTextureWrapS();
+    tex->wrapT = action->getTextureWrapT();
+    tex->model = action->getTextureModel();
+    tex->blendColor = action->getTextureBlendColor();
+    sep->addChild(tex);
+  }
+
+  const int numcoords = action->getNumCoordinates();
+  if (numcoords > 0) {
+    SoCoordinate3 * coords = new SoCoordinate3;
+    coords->point.setNum(numcoords);
+    SbVec3f * dst = coords->point.startEditing();
+    for (int i = 0; i < numcoords; i++) dst[i] = action->getCoordinate3(i);
+    coords->point.finishEditing();
+    sep->addChild(coords);
+  }
+
+  const int numnormals = static_cast<int>(action->getNumNormals());
+  if (numnormals > 0) {
+    SoNormal * normals = new SoNormal;
+    normals->vector.setNum(numnormals);
+    SbVec3f * dst = normals->vector.startEditing();
+    for (int i = 0; i < numnormals; i++) dst[i] = action->getNormal(i);
+    normals->vector.finishEditing();
+    sep->addChild(normals);
+  }
+
+  SoNormalBinding * nb = new SoNormalBinding;
+  nb->value = static_cast<SoNormalBinding::Binding>(action->getNormalBinding());
+  sep->addChild(nb);
+
+  this->kept->addChild(this->createTransformed(action, sep, node));
+}
+
+void
+SoFlattenActionP::getState(SoCallbackAction * action, const PrimitiveType type, State & state)
+{
+  state.type = type;
+  state.lighting = action->getLightModel() != SoLightModel::BASE_COLOR;
+
+  SbColor diffuse;
+  float transparency;
+  action->getMaterial(state.ambient, diffuse, state.specular, state.emissive,
+                      state.shininess, transparency);
+  if (!state.lighting) {
+    // only the diffuse color is used without lighting
+    state.ambient.setValue(0.0f, 0.0f, 0.0f);
+    state.specular.setValue(0.0f, 0.0f, 0.0f);
+    state.emissive.setValue(0.0f, 0.0f, 0.0f);
+    state.shininess = 0.0f;
+  }
+
+  state.ordered = type == TRIANGLES &&
+    action->getVertexOrdering() != SoShapeHints::UNKNOWN_ORDERING;
+  state.solid = state.ordered && action->getShapeType() == SoShapeHints::SOLID;
+  state.drawstyle = action->getDrawStyle();
+  state.linewidth = action->getLineWidth();
+  state.pointsize = action->getPointSize();
+  state.linepattern = action->getLinePattern();
+  state.pickstyle = action->getPickStyle();
+
+  state.texture = NULL;
+  if (SoMultiTextureEnabledElement::getMode(action->getState(), 0) ==
+      SoMultiTextureEnabledElement::TEXTURE2D) {
+    state.texture = action->getTextureImage(state.texsize, state.texcomponents);
+  }
+  if (state.texture) {
+    state.wraps = action->getTextureWrapS();
+    state.wrapt = action->getTextureWrapT();
+    state.texmodel = action->getTextureModel();
+    state.blendcolor = action->getTextureBlendColor();
+  }
+}
+
+SoFlattenActionP::Batch *
+SoFlattenActionP::getBatch(SoCallbackAction * action, const PrimitiveType type)
+{
+  // the state does not change while a shape generates primitives
+  if (this->curbatch[type]) return this->curbatch[type];
+
+  State state;
+  this->getState(action, type, state);
+  // the number of distinct states is usually small
+  for (int i = 0; i < this->batches.getLength(); i++) {
+    if (this->batches[i]->state == state) {
+      this->curbatch[type] = this->batches[i];
+      return this->batches[i];
+    }
+  }
+  Batch * batch = new Batch(state);
+  this->batches.append(batch);
+  this->curbatch[type] = batch;
+  return batch;
+}
+
+// Starts a new run of primitives for the current part in batch if
+// needed. The part is created on the first primitive, so shapes
+// without primitives can be kept instead.
+void
+SoFlattenActionP::addPart(SoCallbackAction * action, Batch * batch)
+{
+  if (this->curpart < 0) {
+    SoPath * path = action->getCurPath()->copy();
+    path->ref();
+    this->curpart = this->parts.getLength();
+    this->parts.append(path);
+  }
+  const int num = batch->partid.getLength();
+  if (num == 0 || batch->partid[num-1] != this->curpart) {
+    batch->partstart.append(batch->numprimitives);
+    batch->partid.append(this->curpart);
+  }
+  batch->numprimitives++;
+}
+
+int32_t
+SoFlattenActionP::addVertex(SoCallbackAction * action, Batch * batch,
+                            const SoPrimitiveVertex * v, const SbBool weld)
+{
+  const SbMatrix & m = action->getModelMatrix();
+
+  Vertex vertex;
+  m.multVecMatrix(v->getPoint(), vertex.vertex);
+  if (batch->state.lighting) {
+    this->curnormal.multDirMatrix(v->getNormal(), vertex.normal);
+    vertex.normal.normalize();
+  }
+  else {
+    vertex.normal.setValue(0.0f, 0.0f, 0.0f);
+  }
+  if (batch->state.texture) {
+    SbVec4f tc;
+    action->getTextureMatrix().multVecMatrix(v->getTextureCoords(), tc);
+    if (tc[3] != 0.0f && tc[3] != 1.0f) {
+      tc[0] /= tc[3];
+      tc[1] /= tc[3];
+    }
+    vertex.texcoord.setValue(tc[0], tc[1]);
+  }
+  else {
+    vertex.texcoord.setValue(0.0f, 0.0f);
+  }
+  SbColor ambient, diffuse, specular, emissive;
+  float shininess, transparency;
+  action->getMaterial(ambient, diffuse, specular, emissive, shininess, transparency,
+                      v->getMaterialIndex());
+  vertex.rgba = diffuse.getPackedValue(transparency);
+
+  int32_t idx;
+  if (weld && batch->vertexhash.get(vertex, idx)) return idx;
+
+  idx = batch->vertices.getLength();
+  batch->vertices.append(vertex.vertex);
+  batch->normals.append(vertex.normal);
+  batch->texcoords.append(vertex.texcoord);
+  batch->colors.append(vertex.rgba);
+  if (weld) batch->vertexhash.put(vertex, idx);
+  return idx;
+}
+
+void
+SoFlattenActionP::createShape(Batch * batch)
+{
+  const State & state = batch->state;
+  SoSeparator * sep = new SoSeparator;
+
+  if (state.type == TRIANGLES) {
+    SoShapeHints * sh = new SoShapeHints;
+    sh->vertexOrdering = state.ordered ?
+      SoShapeHints::COUNTERCLOCKWISE : SoShapeHints::UNKNOWN_ORDERING;
+    sh->shapeType = state.solid ?
+      SoShapeHints::SOLID : SoShapeHints::UNKNOWN_SHAPE_TYPE;
+    sh->faceType = SoShapeHints::CONVEX;
+    sep->addChild(sh);
+  }
+  if (state.drawstyle != SoDrawStyle::FILLED ||
+      state.linewidth != 0.0f ||
+      state.pointsize != 0.0f ||
+      state.linepattern != 0xffff) {
+    SoDrawStyle * ds = new SoDrawStyle;
+    ds->style = state.drawstyle;
+    ds->lineWidth = state.linewidth;
+    ds->pointSize = state.pointsize;
+    ds->linePattern = state.linepattern;
+    sep->addChild(ds);
+  }
+  if (state.pickstyle != SoPickStyle::SHAPE) {
+    SoPickStyle * ps = new SoPickStyle;
+    ps->style = state.pickstyle;
+    sep->addChild(ps);
+  }
+  if (!state.lighting) {
+    SoLightModel * lm = new SoLightModel;
+    lm->model = SoLightModel::BASE_COLOR;
+    sep->addChild(lm);
+  }
+  else {
+    SoMaterial * mat = new SoMaterial;
+    mat->ambientColor = state.ambient;
+    mat->specularColor = state.specular;
+    mat->emissiveColor = state.emissive;
+    mat->shininess = state.shininess;
+    sep->addChild(mat);
+  }
+
+  SoVertexProperty * vp = new SoVertexProperty;
+  vp->vertex.setValues(0, batch->vertices.getLength(), batch->vertices.getArrayPtr());
+
+  const SbBool indexed = state.type != POINTS;
+  const SoVertexProperty::Binding pervertex = indexed ?
+    SoVertexProperty::PER_VERTEX_INDEXED : SoVertexProperty::PER_VERTEX;
+
+  if (state.lighting) {
+    vp->normal.setValues(0, batch->normals.getLength(), batch->normals.getArrayPtr());
+    vp->normalBinding = pervertex;
+  }
+
+  if (state.texture) {
+    // share the texture node between batches with the same texture
+    for (int i = 0; i < this->batches.getLength() && !batch->texture; i++) {
+      const Batch * other = this->batches[i];
+      if (other->texture &&
+          other->state.texture == state.texture &&
+          other->state.texsize == state.texsize &&
+          other->state.texcomponents == state.texcomponents &&
+          other->state.wraps == state.wraps &&
+          other->state.wrapt == state.wrapt &&
+          other->state.texmodel == state.texmodel &&
+          other->state.blendcolor == state.blendcolor) {
+        batch->texture = other->texture;
+      }
+    }
+    if (!batch->texture) {
+      batch->texture = new SoTexture2;
+      batch->texture->image.setValue(state.texsize, state.texcomponents, state.texture);
+      batch->texture->wrapS = state.wraps;
+      batch->texture->wrapT = state.wrapt;
+      batch->texture->model = state.texmodel;
+      batch->texture->blendColor = state.blendcolor;
+    }
+    sep->addChild(batch->texture);
+    vp->texCoord.setValues(0, batch->texcoords.getLength(), batch->texcoords.getArrayPtr());
+  }
+
+  SbBool overall = TRUE;
+  const int numcolors = batch->colors.getLength();
+  for (int i = 1; i < numcolors && overall; i++) {
+    if (batch->colors[i] != batch->colors[0]) overall = FALSE;
+  }
+  if (overall) {
+    vp->orderedRGBA.setValue(numcolors ? batch->colors[0] : 0xccccccff);
+    vp->materialBinding = SoVertexProperty::OVERALL;
+  }
+  else {
+    vp->orderedRGBA.setValues(0, numcolors, batch->colors.getArrayPtr());
+    vp->materialBinding = pervertex;
+  }
+
+  switch (state.type) {
+  case TRIANGLES:
+    {
+      SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+      ifs->vertexProperty = vp;
+      ifs->coordIndex.setValues(0, batch->indices.getLength(), batch->indices.getArrayPtr());
+      batch->shape = ifs;
+    }
+    break;
+  case LINES:
+    {
+      SoIndexedLineSet * ils = new SoIndexedLineSet;
+      ils->vertexProperty = vp;
+      ils->coordIndex.setValues(0, batch->indices.getLength(), batch->indices.getArrayPtr());
+      batch->shape = ils;
+    }
+    break;
+  case POINTS:
+    {
+      SoPointSet * ps = new SoPointSet;
+      ps->vertexProperty = vp;
+      batch->shape = ps;
+    }
+    break;
+  default:
+    assert(0 && "unknown primitive type");
+    break;
+  }
+  sep->addChild(batch->shape);
+  this->result->addChild(sep);
+
+  // the geometry now lives in the shape
+  batch->vertices.truncate(0, TRUE);
+  batch->normals.truncate(0, TRUE);
+  batch->texcoords.truncate(0, TRUE);
+  batch->colors.truncate(0, TRUE);
+  batch->indices.truncate(0, TRUE);
+}
+
+SoCallbackAction::Response
+SoFlattenActionP::pre_node_cb(void * closure, SoCallbackAction * action, const SoNode * node)
+{
+  SoFlattenActionP * thisp = static_cast<SoFlattenActionP *>(closure);
+  SoNode * nonconst = const_cast<SoNode *>(node);
+
+  // nodes on the path to the flattened subgraph only contribute state
+  const SoAction::PathCode pathcode = action->getCurPathCode();
+  if (pathcode == SoAction::NO_PATH || pathcode == SoAction::BELOW_PATH) {
+    if ((isBoundary(node) || thisp->tops.find(node) >= 0) && thisp->hasDynamic(node)) {
+      thisp->keepNode(action, nonconst);
+      return SoCallbackAction::PRUNE;
+    }
+  }
+
+  if (node->isOfType(SoCamera::getClassTypeId()) ||
+      node->isOfType(SoLight::getClassTypeId())) {
+    // a transform separator keeps the camera and light elements
+    thisp->globals->addChild(thisp->createTransformed(action, new SoTransformSeparator, nonconst));
+    return SoCallbackAction::CONTINUE;
+  }
+
+  if (node->isOfType(SoCallback::getClassTypeId())) {
+    thisp->keepNode(action, nonconst);
+    return SoCallbackAction::CONTINUE;
+  }
+
+  if (node->isOfType(SoShape::getClassTypeId())) {
+    const SoMultiTextureEnabledElement::Mode mode =
+      SoMultiTextureEnabledElement::getMode(action->getState(), 0);
+    if (node->isOfType(SoText2::getClassTypeId()) ||
+        node->isOfType(SoImage::getClassTypeId()) ||
+        node->isOfType(SoMarkerSet::getClassTypeId()) ||
+        (mode != SoMultiTextureEnabledElement::DISABLED &&
+         mode != SoMultiTextureEnabledElement::TEXTURE2D)) {
+      thisp->keepNode(action, nonconst);
+      return SoCallbackAction::PRUNE;
+    }
+    thisp->curshape = static_cast<const SoShape *>(node);
+    thisp->curpart = -1;
+    for (int i = 0; i < 3; i++) thisp->curbatch[i] = NULL;
+    if (action->getModelMatrix() != thisp->curmodel) {
+      // normals are transformed by the inverse transpose
+      thisp->curmodel = action->getModelMatrix();
+      thisp->curnormal = thisp->curmodel.det3() != 0.0f ?
+        thisp->curmodel.inverse().transpose() : SbMatrix::identity();
+    }
+  }
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+SoFlattenActionP::post_shape_cb(void * closure, SoCallbackAction * action, const SoNode * node)
+{
+  SoFlattenActionP * thisp = static_cast<SoFlattenActionP *>(closure);
+  if (thisp->curshape == node) {
+    // shapes that do not generate primitives are kept as they are
+    if (thisp->curpart < 0) thisp->keepNode(action, const_cast<SoNode *>(node));
+    thisp->curshape = NULL;
+    thisp->curpart = -1;
+  }
+  return SoCallbackAction::CONTINUE;
+}
+
+void
+SoFlattenActionP::triangle_cb(void * userdata, SoCallbackAction * action,
+                              const SoPrimitiveVertex * v1,
+                              const SoPrimitiveVertex * v2,
+                              const SoPrimitiveVertex * v3)
+{
+  SoFlattenActionP * thisp = static_cast<SoFlattenActionP *>(userdata);
+  if (thisp->curshape == NULL) return;
+
+  Batch * batch = thisp->getBatch(action, TRIANGLES);
+  thisp->addPart(action, batch);
+
+  // the flattened shapes are counterclockwise, and a mirroring
+  // transformation changes the ordering
+  SbBool flip = FALSE;
+  if (batch->state.ordered) {
+    flip = action->getVertexOrdering() == SoShapeHints::CLOCKWISE;
+    if (action->getModelMatrix().det3() < 0.0f) flip = !flip;
+  }
+  const int32_t i1 = thisp->addVertex(action, batch, v1, TRUE);
+  const int32_t i2 = thisp->addVertex(action, batch, v2, TRUE);
+  const int32_t i3 = thisp->addVertex(action, batch, v3, TRUE);
+  batch->indices.append(i1);
+  batch->indices.append(flip ? i3 : i2);
+  batch->indices.append(flip ? i2 : i3);
+  batch->indices.append(-1);
+}
+
+void
+SoFlattenActionP::line_segment_cb(void * userdata, SoCallbackAction * action,
+                                  const SoPrimitiveVertex * v1,
+                                  const SoPrimitiveVertex * v2)
+{
+  SoFlattenActionP * thisp = static_cast<SoFlattenActionP *>(userdata);
+  if (thisp->curshape == NULL) return;
+
+  Batch * batch = thisp->getBatch(action, LINES);
+  thisp->addPart(action, batch);
+  batch->indices.append(thisp->addVertex(action, batch, v1, TRUE));
+  batch->indices.append(thisp->addVertex(action, batch, v2, TRUE));
+  batch->indices.append(-1);
+}
+
+void
+SoFlattenActionP::point_cb(void * userdata, SoCallbackAction * action,
+                           const SoPrimitiveVertex * v)
+{
+  SoFlattenActionP * thisp = static_cast<SoFlattenActionP *>(userdata);
+  if (thisp->curshape == NULL) return;
+
+  // points are not welded, so the coordinate index identifies the point
+  Batch * batch = thisp->getBatch(action, POINTS);
+  thisp->addPart(action, batch);
+  (void) thisp->addVertex(action, batch, v, FALSE);
+}
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoRotor.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(flattenStatic)
+{
+  const int num = 10;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCube * cube = new SoCube;
+  for (int i = 0; i < num; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation.setValue(float(i) * 4.0f, 0.0f, 0.0f);
+    SoMaterial * mat = new SoMaterial;
+    mat->diffuseColor.setValue(float(i) / float(num), 0.5f, 0.5f);
+    sep->addChild(t);
+    sep->addChild(mat);
+    sep->addChild(cube);
+    root->addChild(sep);
+  }
+  // an animated separator must be kept as it is
+  SoSeparator * animated = new SoSeparator;
+  animated->addChild(new SoRotor);
+  animated->addChild(cube);
+  root->addChild(animated);
+
+  SoFlattenAction fa;
+  fa.apply(root);
+
+  SoSeparator * flat = fa.getFlattenedSceneGraph();
+  BOOST_REQUIRE(flat != NULL);
+  flat->ref();
+
+  BOOST_CHECK_EQUAL(fa.getNumInputShapes(), num + 1);
+  BOOST_CHECK_EQUAL(fa.getNumOutputShapes(), 2);
+  BOOST_CHECK(fa.getNumOutputNodes() < fa.getNumInputNodes());
+  BOOST_CHECK_EQUAL(fa.getNumParts(), num);
+
+  // the kept separator is shared with the input
+  const SoChildList * children = flat->getChildren();
+  SbBool found = FALSE;
+  for (int i = 0; i < children->getLength(); i++) {
+    const SoChildList * c = (*children)[i]->getChildren();
+    if (c && c->find(animated) >= 0) found = TRUE;
+  }
+  BOOST_CHECK_MESSAGE(found, "animated separator should be kept");
+
+  // pick the merged shape, and find the original separator
+  const int expected = 3;
+  SoRayPickAction rpa(SbViewportRegion(100, 100));
+  rpa.setRay(SbVec3f(float(expected) * 4.0f, 0.0f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rpa.apply(flat);
+  const SoPickedPoint * pp = rpa.getPickedPoint();
+  BOOST_REQUIRE(pp != NULL);
+  const int part = fa.findPart(pp);
+  BOOST_REQUIRE(part >= 0);
+  const SoFullPath * path = static_cast<const SoFullPath *>(fa.getPartPath(part));
+  BOOST_CHECK(path->getTail() == cube);
+  BOOST_CHECK(path->getNode(1) == root->getChild(expected));
+
+  flat->unref();
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -100,6 +100,7 @@
 #include <Inventor/elements/SoViewingMatrixElement.h>
 #include <Inventor/elements/SoWindowElement.h>
 #include <Inventor/elements/SoGLDepthBufferElement.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/lists/SoCallbackList.h>
 #include <Inventor/lists/SoEnabledElementsList.h>
@@ -126,9 +127,12 @@
 #include "glue/glp.h"
 #include "glue/simage_wrapper.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLLODBudget.h"
+#include "rendering/SoGLRenderStatistics.h"
 
 #include <Inventor/annex/Profiler/nodes/SoProfilerStats.h>
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerTrace.h"
 
 #ifdef HAVE_NODEKITS
 #include <Inventor/annex/Profiler/nodekits/SoProfilerTopKit.h>
@@ -536,6 +540,82 @@
   second pass.
 */
 
+/*!
+  \enum SoGLRenderAction::Statistic
+
+  Enumerates the statistics which can be collected for each frame.
+
+  \sa setCollectStatistics(), getStatistic()
+  \since Coin 4.1
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::SHAPES_RENDERED
+
+  The number of shapes which were sent to OpenGL.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::DRAW_CALLS
+
+  The number of vertex array draw calls (glDrawArrays(),
+  glDrawElements() and friends) issued.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::DISPLAY_LIST_CALLS
+
+  The number of display lists called.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::SEPARATORS_CULLED
+
+  The number of SoSeparator nodes culled against the view volume.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::RENDER_CACHE_HITS
+
+  The number of times a valid render cache was used.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::RENDER_CACHE_MISSES
+
+  The number of times no valid render cache was found.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::RENDER_CACHES_CREATED
+
+  The number of render caches created.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::VBOS_CREATED
+
+  The number of vertex buffer objects created.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::VBO_UPLOADS
+
+  The number of times vertex buffer object data was uploaded.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::VBO_UPLOADED_BYTES
+
+  The number of bytes uploaded to vertex buffer objects.
+*/
+
+/*!
+  \var SoGLRenderAction::Statistic SoGLRenderAction::TEXTURE_UPLOADS
+
+  The number of texture images uploaded.
+*/
+
 // *************************************************************************
 
 class SoGLRenderActionP {
@@ -563,6 +643,10 @@ public:
   SbList<float> sorttranspobjdistances;
   SoGLRenderAction::TransparentDelayedObjectRenderType transpdelayedrendertype;
   SbBool renderingtranspbackfaces;
+  SbBool collectstatistics;
+  uint32_t statistics[SoGLRenderAction::NUM_STATISTICS];
+  SoGLLODBudget lodbudget;
+  SoGLLODBudget * currentlodbudget;
 
   boost::scoped_ptr<SoGetBoundingBoxAction> bboxaction;
   SbVec2f updateorigin, updatesize;
@@ -610,6 +694,9 @@ public:
   void renderSortedLayersFP(const SoState * state);
 
   void setupBlending(SoState * state, const SoGLRenderAction::TransparencyType newtype);
+  static SoGLLODBudget * getLODBudget(const SoGLRenderAction * action) {
+    return action->pimpl->currentlodbudget;
+  }
   void render(SoNode * node);
   void renderMulti(SoNode * node);
   void renderSingle(SoNode * node);
@@ -663,6 +750,8 @@ SoGLRenderAction::initClass(void)
   else {
     COIN_GLBBOX = 0;
   }
+
+  SoGLRenderStatistics::initClass();
 }
 
 // *************************************************************************
@@ -735,6 +824,9 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
   PRIVATE(this)->transpobjdepthwrite = FALSE;
   PRIVATE(this)->transpdelayedrendertype = ONE_PASS;
   PRIVATE(this)->renderingtranspbackfaces = FALSE;
+  PRIVATE(this)->collectstatistics = FALSE;
+  memset(PRIVATE(this)->statistics, 0, sizeof(PRIVATE(this)->statistics));
+  PRIVATE(this)->currentlodbudget = NULL;
 
   PRIVATE(this)->sortedobjectstrategy = BBOX_CENTER;
   PRIVATE(this)->sortedobjectcb = NULL;
@@ -1119,8 +1211,39 @@ SoGLRenderAction::beginTraversal(SoNode * node)
                               coin_glerror_string(err));
   }
 
+  // the counters are per thread, so that actions rendering in other
+  // threads don't count into this one
+  const SbBool collectstatistics = PRIVATE(this)->collectstatistics;
+  uint32_t * prevcounters = NULL;
+  if (collectstatistics) {
+    memset(PRIVATE(this)->statistics, 0, sizeof(PRIVATE(this)->statistics));
+    prevcounters = SoGLRenderStatistics::setCounters(PRIVATE(this)->statistics);
+  }
+
+  // the budget is looked up through the action by the LOD nodes, so
+  // that actions rendering in other threads don't share it
+  SoGLLODBudget * prevlodbudget = PRIVATE(this)->currentlodbudget;
+  SoGLLODBudget * lodbudget =
+    PRIVATE(this)->lodbudget.isActive() ? &PRIVATE(this)->lodbudget : NULL;
+  PRIVATE(this)->currentlodbudget = lodbudget;
+  const SbTime starttime = lodbudget ? SbTime::getTimeOfDay() : SbTime::zero();
+
   PRIVATE(this)->render(node);
   // GL errors after rendering will be caught in SoNode::GLRenderS().
+
+  PRIVATE(this)->currentlodbudget = prevlodbudget;
+  if (lodbudget) {
+    lodbudget->endFrame((SbTime::getTimeOfDay() - starttime).getValue());
+  }
+  if (collectstatistics) {
+    (void) SoGLRenderStatistics::setCounters(prevcounters);
+  }
+  if (collectstatistics && SoProfilerTrace::isActive()) {
+    for (int i = 0; i < NUM_STATISTICS; i++) {
+      SoProfilerTrace::counter(getStatisticName(static_cast<Statistic>(i)),
+                               PRIVATE(this)->statistics[i]);
+    }
+  }
 }
 
 // Documented in superclass. Overridden from parent class to clean up
@@ -2040,6 +2163,171 @@ SoGLRenderAction::getTransparentDelayedObjectRenderType(void) const
   return PRIVATE(this)->transpdelayedrendertype;
 }
 
+/*!
+  Sets whether render statistics should be collected. When enabled,
+  the counters are reset at the start of each frame, and can be read
+  back with getStatistic() after the action has been applied. If
+  tracing is enabled in the profiler, the counters are also recorded
+  as trace counter events at the end of each frame.
+
+  Default is FALSE.
+
+  \sa getStatistic(), SoProfiler::enableTracing()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setCollectStatistics(const SbBool onoff)
+{
+  PRIVATE(this)->collectstatistics = onoff;
+}
+
+/*!
+  Returns whether render statistics are collected.
+
+  \sa setCollectStatistics()
+  \since Coin 4.1
+*/
+SbBool
+SoGLRenderAction::isCollectingStatistics(void) const
+{
+  return PRIVATE(this)->collectstatistics;
+}
+
+/*!
+  Returns the value of \a statistic for the last frame rendered while
+  collecting statistics.
+
+  \sa setCollectStatistics()
+  \since Coin 4.1
+*/
+uint32_t
+SoGLRenderAction::getStatistic(const Statistic statistic) const
+{
+  assert(statistic >= 0 && statistic < NUM_STATISTICS);
+  return PRIVATE(this)->statistics[statistic];
+}
+
+/*!
+  Returns a human readable name for \a statistic.
+
+  \since Coin 4.1
+*/
+const char *
+SoGLRenderAction::getStatisticName(const Statistic statistic)
+{
+  static const char * names[] = {
+    "shapes rendered",
+    "draw calls",
+    "display list calls",
+    "separators culled",
+    "render cache hits",
+    "render cache misses",
+    "render caches created",
+    "VBOs created",
+    "VBO uploads",
+    "VBO uploaded bytes",
+    "texture uploads"
+  };
+  assert(statistic >= 0 && statistic < NUM_STATISTICS);
+  return names[statistic];
+}
+
+/*!
+  Sets the number of triangles the SoLOD and SoLevelOfDetail nodes
+  may render per frame. 0 means no limit, which is the default.
+
+  With a budget set, the LOD nodes still select a child on their own,
+  but the action keeps track of the triangle count of each child. At
+  the end of each frame, the nodes covering the least screen area per
+  triangle saved are switched to coarser children until the frame
+  fits the budget, and the result is used for the next frame. The
+  nodes are never rendered with more detail than they would choose
+  themselves.
+
+  \sa setLODTimeBudget(), setLODHysteresis()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODTriangleBudget(const uint32_t numtriangles)
+{
+  PRIVATE(this)->lodbudget.trianglebudget = numtriangles;
+}
+
+/*!
+  Returns the LOD triangle budget.
+
+  \sa setLODTriangleBudget()
+  \since Coin 4.1
+*/
+uint32_t
+SoGLRenderAction::getLODTriangleBudget(void) const
+{
+  return PRIVATE(this)->lodbudget.trianglebudget;
+}
+
+/*!
+  Sets the time in seconds the render traversal should take per
+  frame. 0 means no limit, which is the default.
+
+  The triangle budget for the LOD nodes is then adjusted after each
+  frame, by scaling the triangles rendered in the frame with how far
+  off the time budget it was. Since OpenGL executes asynchronously,
+  the time measured is the time spent traversing the scene graph,
+  which does not include all of the time the GPU spends rendering.
+
+  \sa setLODTriangleBudget(), setLODHysteresis()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODTimeBudget(const float seconds)
+{
+  PRIVATE(this)->lodbudget.timebudget = seconds;
+}
+
+/*!
+  Returns the LOD time budget.
+
+  \sa setLODTimeBudget()
+  \since Coin 4.1
+*/
+float
+SoGLRenderAction::getLODTimeBudget(void) const
+{
+  return PRIVATE(this)->lodbudget.timebudget;
+}
+
+/*!
+  Sets the hysteresis used when selecting LOD levels within a budget,
+  as a fraction of the budget. LOD nodes only switch to a more
+  detailed child than in the previous frame while the frame stays
+  this fraction below the budget, and the time budget is only
+  adjusted when the frame time is off by more than this fraction.
+  This keeps the nodes from popping back and forth between levels
+  when the frame is close to the budget.
+
+  Default value is 0.1.
+
+  \sa setLODTriangleBudget(), setLODTimeBudget()
+  \since Coin 4.1
+*/
+void
+SoGLRenderAction::setLODHysteresis(const float fraction)
+{
+  PRIVATE(this)->lodbudget.hysteresis = SbClamp(fraction, 0.0f, 1.0f);
+}
+
+/*!
+  Returns the LOD hysteresis fraction.
+
+  \sa setLODHysteresis()
+  \since Coin 4.1
+*/
+float
+SoGLRenderAction::getLODHysteresis(void) const
+{
+  return PRIVATE(this)->lodbudget.hysteresis;
+}
+
 void
 SoGLRenderActionP::doSortedLayersBlendRendering(const SoState * state, SoNode * node)
 {
@@ -2681,4 +2969,188 @@ SoGLRenderActionP::renderSortedLayersNV(const SoState * state)
 
 // *************************************************************************
 
+// Used by SoGLLODBudget::select() to find the budget of the frame
+// being rendered by action. Returns NULL if no budget is set.
+SoGLLODBudget *
+SoGLRenderAction_getLODBudget(const SoGLRenderAction * action)
+{
+  return SoGLRenderActionP::getLODBudget(action);
+}
+
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoLevelOfDetail.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(statistics)
+{
+  SoGLRenderAction action(SbViewportRegion(100, 100));
+  BOOST_CHECK_MESSAGE(!action.isCollectingStatistics(),
+                      "statistics should not be collected by default");
+  action.setCollectStatistics(TRUE);
+  BOOST_CHECK(action.isCollectingStatistics());
+
+  for (int i = 0; i < SoGLRenderAction::NUM_STATISTICS; i++) {
+    SoGLRenderAction::Statistic statistic =
+      static_cast<SoGLRenderAction::Statistic>(i);
+    BOOST_CHECK_EQUAL(action.getStatistic(statistic), 0u);
+    BOOST_CHECK(SoGLRenderAction::getStatisticName(statistic) != NULL);
+  }
+  BOOST_CHECK_EQUAL(std::string(SoGLRenderAction::getStatisticName(SoGLRenderAction::TEXTURE_UPLOADS)),
+                    std::string("texture uploads"));
+}
+
+BOOST_AUTO_TEST_CASE(statisticsRender)
+{
+  const SbViewportRegion viewport(64, 64);
+  SoOffscreenRenderer renderer(viewport);
+  SoGLRenderAction * action = renderer.getGLRenderAction();
+  action->setCollectStatistics(TRUE);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+
+  // a grid large enough to be rendered with vertex arrays
+  const int size = 32;
+  SoCoordinate3 * coords = new SoCoordinate3;
+  SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+  int x, y;
+  for (y = 0; y < size; y++) {
+    for (x = 0; x < size; x++) {
+      coords->point.set1Value(y * size + x, SbVec3f(float(x), float(y), 0.0f));
+    }
+  }
+  for (y = 0; y < size - 1; y++) {
+    for (x = 0; x < size - 1; x++) {
+      const int32_t idx[] = { y*size+x, y*size+x+1, (y+1)*size+x+1, y*size+x, (y+1)*size+x+1, (y+1)*size+x, -1 };
+      faceset->coordIndex.setValues(faceset->coordIndex.getNum(), 7, idx);
+    }
+  }
+  root->addChild(coords);
+  root->addChild(faceset);
+  camera->viewAll(root, viewport);
+
+  if (renderer.render(root)) {
+    BOOST_CHECK_EQUAL(action->getStatistic(SoGLRenderAction::SHAPES_RENDERED), 1u);
+    BOOST_CHECK_MESSAGE(action->getStatistic(SoGLRenderAction::DRAW_CALLS) > 0,
+                        "no draw calls counted");
+  }
+  else {
+    BOOST_TEST_MESSAGE("no offscreen OpenGL context, statisticsRender not run");
+  }
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(lodBudget)
+{
+  SoGLRenderAction action(SbViewportRegion(100, 100));
+  BOOST_CHECK_EQUAL(action.getLODTriangleBudget(), 0u);
+  BOOST_CHECK_EQUAL(action.getLODTimeBudget(), 0.0f);
+  BOOST_CHECK_EQUAL(action.getLODHysteresis(), 0.1f);
+
+  action.setLODTriangleBudget(100000);
+  action.setLODTimeBudget(1.0f / 60.0f);
+  action.setLODHysteresis(2.0f);
+  BOOST_CHECK_EQUAL(action.getLODTriangleBudget(), 100000u);
+  BOOST_CHECK_EQUAL(action.getLODTimeBudget(), 1.0f / 60.0f);
+  BOOST_CHECK_MESSAGE(action.getLODHysteresis() == 1.0f,
+                      "hysteresis should be clamped to [0, 1]");
+}
+
+static void
+count_lod_renders(void * closure, SoAction * action)
+{
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    (*static_cast<int *>(closure))++;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(lodBudgetRender)
+{
+  const SbViewportRegion viewport(64, 64);
+  SoOffscreenRenderer renderer(viewport);
+  SoGLRenderAction * action = renderer.getGLRenderAction();
+  action->setLODHysteresis(0.1f);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  root->renderCaching = SoSeparator::OFF;
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+
+  // The LOD children get their coordinates from above the LOD nodes:
+  // the fine levels are polygons using all 100 points (98 triangles),
+  // the coarse levels a single triangle.
+  SoCoordinate3 * coords = new SoCoordinate3;
+  for (int i = 0; i < 100; i++) {
+    const float angle = float(i) * 2.0f * float(M_PI) / 100.0f;
+    coords->point.set1Value(i, SbVec3f(float(cos(angle)), float(sin(angle)), 0.0f));
+  }
+  root->addChild(coords);
+
+  int finerenders = 0;
+  for (int i = 0; i < 3; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation = SbVec3f(float(i - 1) * 2.5f, 0.0f, 0.0f);
+    sep->addChild(translation);
+    SoLevelOfDetail * lod = new SoLevelOfDetail;
+    lod->screenArea = 0.0f;
+    SoGroup * fine = new SoGroup;
+    SoCallback * callback = new SoCallback;
+    callback->setCallback(count_lod_renders, &finerenders);
+    fine->addChild(callback);
+    fine->addChild(new SoFaceSet);
+    SoFaceSet * coarse = new SoFaceSet;
+    coarse->numVertices = 3;
+    lod->addChild(fine);
+    lod->addChild(coarse);
+    sep->addChild(lod);
+    root->addChild(sep);
+  }
+  camera->viewAll(root, viewport);
+
+  // the levels chosen in a frame are used for the next one
+  action->setLODTriangleBudget(200);
+  if (!renderer.render(root)) {
+    BOOST_TEST_MESSAGE("no offscreen OpenGL context, lodBudgetRender not run");
+    root->unref();
+    return;
+  }
+  finerenders = 0;
+  renderer.render(root);
+  BOOST_CHECK_MESSAGE(finerenders == 2, "one LOD node should be coarsened to fit the budget");
+
+  // all the fine levels fit in this budget, but not below it by the
+  // hysteresis fraction, so the coarsened node stays coarse
+  action->setLODTriangleBudget(300);
+  renderer.render(root);
+  finerenders = 0;
+  renderer.render(root);
+  BOOST_CHECK_MESSAGE(finerenders == 2, "hysteresis should keep the coarsened level");
+
+  action->setLODTriangleBudget(400);
+  renderer.render(root);
+  finerenders = 0;
+  renderer.render(root);
+  BOOST_CHECK_MESSAGE(finerenders == 3, "all LOD nodes should be refined within the budget");
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
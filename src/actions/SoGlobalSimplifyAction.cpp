@@ -30,20 +30,57 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
-// FIXME: this class has not yet been implemented in Coin. this is a
-// placeholder / stub / skeleton code, not yet built (nor installed,
-// obviously).  --mortene.
-
 /*!
   \class SoGlobalSimplifyAction SoGlobalSimplifyAction.h Inventor/actions/SoGlobalSimplifyAction.h
   \brief The SoGlobalSimplifyAction class is for globally simplifying the
   geometry of a scene graph, globally.
+
+  \ingroup coin_actions
+
+  The action first flattens the static parts of the scene graph with
+  SoFlattenAction, so the geometry is merged into a few large shapes
+  in world space, and then simplifies each of the merged shapes into
+  a level of detail node, like SoShapeSimplifyAction. Simplifying
+  the merged geometry gives better results than simplifying many
+  small shapes, since the small shapes often cannot be simplified
+  much on their own.
+
+  The scene graph the action is applied to is not changed. Use
+  getSimplifiedSceneGraph() to get the result.
+
+  \sa SoFlattenAction, SoShapeSimplifyAction
+  \since Coin 4.1
 */
 
-#include <Inventor/SbName.h>
 #include <Inventor/actions/SoGlobalSimplifyAction.h>
-#include <coindefs.h> // COIN_STUB()
 
+#include <cassert>
+
+#include <Inventor/SbName.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoFlattenAction.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoShapeHints.h>
+
+#include "actions/SoSubActionP.h"
+#include "actions/SoSimplifyMesh.h"
+
+class SoGlobalSimplifyActionP {
+public:
+  SoGlobalSimplifyActionP(void) : result(NULL) { }
+  ~SoGlobalSimplifyActionP() {
+    if (this->result) this->result->unref();
+  }
+
+  void simplify(SoGlobalSimplifyAction * action);
+
+  SoFlattenAction flatten;
+  SoSeparator * result;
+};
+
+#define PRIVATE(obj) obj->pimpl
 
 SO_ACTION_SOURCE(SoGlobalSimplifyAction);
 
@@ -63,7 +100,7 @@ SoGlobalSimplifyAction::initClass(void)
 
 SoGlobalSimplifyAction::SoGlobalSimplifyAction(void)
 {
-  COIN_STUB();
+  SO_ACTION_CONSTRUCTOR(SoGlobalSimplifyAction);
 }
 
 /*!
@@ -72,12 +109,150 @@ SoGlobalSimplifyAction::SoGlobalSimplifyAction(void)
 
 SoGlobalSimplifyAction::~SoGlobalSimplifyAction(void)
 {
-  COIN_STUB();
+}
+
+/*!
+  Simplifies the scene graph below \a root.
+*/
+void
+SoGlobalSimplifyAction::apply(SoNode * root)
+{
+  PRIVATE(this)->flatten.apply(root);
+  PRIVATE(this)->simplify(this);
+}
+
+/*!
+  Simplifies the scene graph below the tail of \a path.
+*/
+void
+SoGlobalSimplifyAction::apply(SoPath * path)
+{
+  PRIVATE(this)->flatten.apply(path);
+  PRIVATE(this)->simplify(this);
+}
+
+/*!
+  Simplifies the scene graphs below the tails of the paths in \a
+  pathlist into one simplified scene graph.
+*/
+void
+SoGlobalSimplifyAction::apply(const SoPathList & pathlist, SbBool obeysrules)
+{
+  PRIVATE(this)->flatten.apply(pathlist, obeysrules);
+  PRIVATE(this)->simplify(this);
+}
+
+/*!
+  Returns the simplified scene graph from the last time the action
+  was applied, or \c NULL if the action has not been applied. The
+  scene graph is owned by the action, so ref() it if you want to keep
+  it after the action is applied again or destructed.
+*/
+SoSeparator *
+SoGlobalSimplifyAction::getSimplifiedSceneGraph(void) const
+{
+  return PRIVATE(this)->result;
 }
 
 // Documented in superclass.
 void
 SoGlobalSimplifyAction::beginTraversal(SoNode * /* node */)
 {
-  COIN_STUB();
+  assert(0 && "should never get here");
+}
+
+// *************************************************************************
+
+void
+SoGlobalSimplifyActionP::simplify(SoGlobalSimplifyAction * action)
+{
+  if (this->result) this->result->unref();
+  this->result = this->flatten.getFlattenedSceneGraph();
+  this->result->ref();
+
+  // the merged shapes are the last child of the separators directly
+  // below the root of the flattened scene graph. The merged shapes
+  // often have flat shaded normals, which would make every vertex a
+  // seam, so the simplified shapes generate smooth normals instead.
+  // The crease angle does not affect the merged shape, since it has
+  // explicit normals.
+  SoPathList paths;
+  for (int i = 0; i < this->result->getNumChildren(); i++) {
+    SoNode * child = this->result->getChild(i);
+    if (!child->isOfType(SoSeparator::getClassTypeId())) continue;
+    SoSeparator * sep = static_cast<SoSeparator *>(child);
+    const int last = sep->getNumChildren() - 1;
+    if (last < 0 ||
+        !sep->getChild(last)->isOfType(SoIndexedFaceSet::getClassTypeId())) continue;
+    for (int j = 0; j < last; j++) {
+      if (sep->getChild(j)->isOfType(SoShapeHints::getClassTypeId())) {
+        static_cast<SoShapeHints *>(sep->getChild(j))->creaseAngle = 0.5f;
+      }
+    }
+    SoPath * path = new SoPath(this->result);
+    path->append(i);
+    path->append(last);
+    paths.append(path);
+  }
+  SoSimplifyMesh::simplifyShapes(action, paths, TRUE, FALSE);
 }
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoLevelOfDetail.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(simplifySpheres)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 1.0f;
+  root->addChild(complexity);
+  SoSphere * sphere = new SoSphere;
+  for (int i = 0; i < 4; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation.setValue(float(i) * 3.0f, 0.0f, 0.0f);
+    sep->addChild(t);
+    sep->addChild(sphere);
+    root->addChild(sep);
+  }
+
+  SoGlobalSimplifyAction sa;
+  sa.apply(root);
+  SoSeparator * result = sa.getSimplifiedSceneGraph();
+  BOOST_REQUIRE(result != NULL);
+
+  // the spheres are merged into one shape, which is simplified
+  SoLevelOfDetail * lod = NULL;
+  for (int i = 0; i < result->getNumChildren(); i++) {
+    SoNode * child = result->getChild(i);
+    if (child->isOfType(SoSeparator::getClassTypeId())) {
+      SoSeparator * sep = static_cast<SoSeparator *>(child);
+      SoNode * last = sep->getChild(sep->getNumChildren() - 1);
+      if (last->isOfType(SoLevelOfDetail::getClassTypeId())) {
+        BOOST_CHECK(lod == NULL);
+        lod = static_cast<SoLevelOfDetail *>(last);
+      }
+    }
+  }
+  BOOST_REQUIRE(lod != NULL);
+  BOOST_REQUIRE_EQUAL(lod->getNumChildren(), 3);
+  const int num0 = static_cast<SoIndexedFaceSet *>(lod->getChild(0))->coordIndex.getNum();
+  const int num2 = static_cast<SoIndexedFaceSet *>(lod->getChild(2))->coordIndex.getNum();
+  BOOST_CHECK(num2 * 5 < num0);
+
+  // the input is not changed
+  BOOST_CHECK(static_cast<SoSeparator *>(root->getChild(1))->getChild(1) == sphere);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
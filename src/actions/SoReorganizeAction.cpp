@@ -244,6 +244,11 @@
 
   \endcode
 
+  The geometry of all the shapes is collected before any of the
+  shapes are replaced, and identical vertices are welded and the
+  index arrays optimized for all the shapes in parallel. Use
+  mergeShapes() to also merge adjacent shapes into a single shape.
+
   \since Coin 2.5
 
 */
@@ -270,6 +275,7 @@
 #include <Inventor/nodes/SoVertexProperty.h>
 #include <Inventor/nodes/SoTextureCoordinate2.h>
 #include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/SoPrimitiveVertex.h>
 #include <Inventor/SbViewportRegion.h>
 #include <Inventor/elements/SoMultiTextureEnabledElement.h>
@@ -277,8 +283,7 @@
 #include <Inventor/elements/SoShapeStyleElement.h>
 #include <Inventor/elements/SoLightModelElement.h>
 #include <Inventor/elements/SoNormalElement.h>
-#include <Inventor/caches/SoPrimitiveVertexCache.h>
-#include <Inventor/SbColor4f.h>
+#include <Inventor/lists/SoPathList.h>
 
 #ifdef HAVE_VRML97
 #include <Inventor/VRMLnodes/SoVRMLCoordinate.h>
@@ -294,6 +299,10 @@
 #include "coindefs.h" // COIN_STUB()
 #include "SbBasicP.h"
 #include "actions/SoSubActionP.h"
+#include "misc/SbFNVHash.h"
+#include "misc/SbHash.h"
+#include "rendering/SoVertexArrayIndexer.h"
+#include "threads/parallelp.h"
 
 class SoReorganizeActionP {
  public:
@@ -304,8 +313,10 @@ class SoReorganizeActionP {
       gentristrips(FALSE),
       genvp(FALSE),
       matchidx(TRUE),
+      mergeshapes(FALSE),
       cbaction(SbViewportRegion(640, 480)),
-      pvcache(NULL)
+      currentpath(NULL),
+      shape(NULL)
   {
     cbaction.addTriangleCallback(SoVertexShape::getClassTypeId(), triangle_cb, this);
     cbaction.addLineSegmentCallback(SoVertexShape::getClassTypeId(), line_segment_cb, this);
@@ -334,28 +345,63 @@ class SoReorganizeActionP {
 #endif // HAVE_VRML97
 
   }
+
+  class Vertex {
+  public:
+    SbVec3f vertex;
+    SbVec3f normal;
+    SbVec4f texcoord;
+    uint32_t rgba;
+
+    // needed for SbHash
+    operator unsigned long(void) const;
+    int operator==(const Vertex & v) const;
+  };
+
+  // The geometry and state collected for one shape. The primitives
+  // are stored as unshared corners while traversing, and converted
+  // to a vertex and an index array by processShape().
+  class ShapeData {
+  public:
+    SoFullPath * path;
+    SoNode * node;
+    SbBool isvrml;
+    SbBool hastexture;
+    SbBool lighting;
+    SbBool normalsonstate;
+    SbBool colorpervertex;
+    uint32_t firstcolor;
+    SbBool merged;
+    SbList <Vertex> triangles;
+    SbList <Vertex> lines;
+
+    SbList <Vertex> vertices;
+    SbList <int32_t> indices;
+    SbBool islines;
+  };
+
   SoReorganizeAction * master;
   SbBool gennormals;
   SbBool gentexcoords;
   SbBool gentristrips;
   SbBool genvp;
   SbBool matchidx;
+  SbBool mergeshapes;
   SbList <SbBool> needtexcoords;
-  int lastneeded;
-  int numtriangles;
-  int numlines;
-  int numpoints;
   SbBool isvrml;
-
   SbBool didinit;
-  SbBool hastexture;
-  SbColor4f diffusecolor;
-  SbBool lighting;
-  SbBool normalsonstate;
+
+  const uint32_t * packedptr;
+  const SbColor * diffuseptr;
+  const float * transpptr;
+  int numdiffuse;
+  int numtransp;
 
   SoCallbackAction cbaction;
   SoSearchAction sa;
-  SoPrimitiveVertexCache * pvcache;
+  SoFullPath * currentpath;
+  ShapeData * shape;
+  SbList <ShapeData *> shapes;
 
   static SoCallbackAction::Response pre_shape_cb(void * userdata, SoCallbackAction * action, const SoNode * node);
   static SoCallbackAction::Response post_shape_cb(void * userdata, SoCallbackAction * action, const SoNode * node);
@@ -368,14 +414,25 @@ class SoReorganizeActionP {
                               const SoPrimitiveVertex * v1,
                               const SoPrimitiveVertex * v2);
 
-  SbBool initShape(SoCallbackAction * action);
-  void replaceNode(SoFullPath * path);
-  void replaceIfs(SoFullPath * path);
-  void replaceVrmlIfs(SoFullPath * path);
-  void replaceIls(SoFullPath * path);
-  void replaceVrmlIls(SoFullPath * path);
+  static void process_shapes_cb(void * closure, int begin, int end);
 
-  SoVertexProperty * createVertexProperty(const SbBool forlines);
+  void reorganize(const SoPathList & pathlist);
+  void searchShapes(SoNode * root, const SoType type, SoPathList & pathlist);
+  SbBool initShape(SoCallbackAction * action);
+  uint32_t getColor(const int materialindex) const;
+  void addVertex(SbList <Vertex> & list, const SoPrimitiveVertex * v);
+  void mergeShapes(void);
+  static SbBool canMerge(const ShapeData * target, const ShapeData * prev,
+                         const ShapeData * next);
+  static void processShape(ShapeData * shape);
+  void replaceNode(ShapeData * shape);
+  void removeNode(ShapeData * shape);
+  void replaceIfs(ShapeData * shape);
+  void replaceVrmlIfs(ShapeData * shape);
+  void replaceIls(ShapeData * shape);
+  void replaceVrmlIls(ShapeData * shape);
+
+  SoVertexProperty * createVertexProperty(const ShapeData * shape, const SbBool forlines);
 };
 
 
@@ -477,6 +534,36 @@ SoReorganizeAction::areIndexArraysMatched(void) const
   return PRIVATE(this)->matchidx;
 }
 
+/*!
+  Sets whether adjacent shapes in the same group should be merged
+  into a single shape. Shapes are only merged if they have identical
+  lighting, texturing and transparency state, and the merged shape
+  will use per vertex colors if the shapes have different diffuse
+  colors. Merging reduces the number of nodes to traverse and the
+  number of draw calls when rendering.
+
+  VRML97 shapes are never merged. Default is FALSE.
+
+  \since Coin 4.1
+*/
+void
+SoReorganizeAction::mergeShapes(SbBool onoff)
+{
+  PRIVATE(this)->mergeshapes = onoff;
+}
+
+/*!
+  Returns whether adjacent shapes are merged.
+
+  \sa mergeShapes()
+  \since Coin 4.1
+*/
+SbBool
+SoReorganizeAction::areShapesMerged(void) const
+{
+  return PRIVATE(this)->mergeshapes;
+}
+
 SoSimplifier *
 SoReorganizeAction::getSimplifier(void) const
 {
@@ -486,54 +573,27 @@ SoReorganizeAction::getSimplifier(void) const
 void
 SoReorganizeAction::apply(SoNode * root)
 {
-  int i;
-  PRIVATE(this)->sa.setType(SoVertexShape::getClassTypeId());
-  PRIVATE(this)->sa.setSearchingAll(TRUE);
-  PRIVATE(this)->sa.setInterest(SoSearchAction::ALL);
-  PRIVATE(this)->sa.apply(root);
-  SoPathList & pl = PRIVATE(this)->sa.getPaths();
-  for (i = 0; i < pl.getLength(); i++) {
-    this->apply(pl[i]);
-  }
-  PRIVATE(this)->sa.reset();
-
+  SoPathList pathlist;
+  PRIVATE(this)->searchShapes(root, SoVertexShape::getClassTypeId(), pathlist);
 #ifdef HAVE_VRML97
-  PRIVATE(this)->sa.setType(SoVRMLIndexedFaceSet::getClassTypeId());
-  PRIVATE(this)->sa.setSearchingAll(TRUE);
-  PRIVATE(this)->sa.setInterest(SoSearchAction::ALL);
-  PRIVATE(this)->sa.apply(root);
-  SoPathList & pl2 = PRIVATE(this)->sa.getPaths();
-
-  for (i = 0; i < pl2.getLength(); i++) {
-    this->apply(pl2[i]);
-  }
-  PRIVATE(this)->sa.reset();
-
-  PRIVATE(this)->sa.setType(SoVRMLIndexedLineSet::getClassTypeId());
-  PRIVATE(this)->sa.setSearchingAll(TRUE);
-  PRIVATE(this)->sa.setInterest(SoSearchAction::ALL);
-  PRIVATE(this)->sa.apply(root);
-  SoPathList & pl3 = PRIVATE(this)->sa.getPaths();
-  for (i = 0; i < pl3.getLength(); i++) {
-    this->apply(pl3[i]);
-  }
-  PRIVATE(this)->sa.reset();
+  PRIVATE(this)->searchShapes(root, SoVRMLIndexedFaceSet::getClassTypeId(), pathlist);
+  PRIVATE(this)->searchShapes(root, SoVRMLIndexedLineSet::getClassTypeId(), pathlist);
 #endif // HAVE_VRML97
+  PRIVATE(this)->reorganize(pathlist);
 }
 
 void
 SoReorganizeAction::apply(SoPath * path)
 {
-  PRIVATE(this)->cbaction.apply(path);
-  PRIVATE(this)->replaceNode(reclassify_cast<SoFullPath *>(path));
+  SoPathList pathlist;
+  pathlist.append(path);
+  PRIVATE(this)->reorganize(pathlist);
 }
 
 void
 SoReorganizeAction::apply(const SoPathList & pathlist, SbBool COIN_UNUSED_ARG(obeysrules))
 {
-  for (int i = 0; i < pathlist.getLength(); i++) {
-    this->apply(pathlist[i]);
-  }
+  PRIVATE(this)->reorganize(pathlist);
 }
 
 void
@@ -556,6 +616,216 @@ SoReorganizeAction::beginTraversal(SoNode * /* node */)
 }
 
 
+// *************************************************************************
+
+SoReorganizeActionP::Vertex::operator unsigned long(void) const
+{
+  SbFNVHash hash;
+  hash.add(this->vertex.getValue(), 3);
+  hash.add(this->normal.getValue(), 3);
+  hash.add(this->texcoord.getValue(), 4);
+  hash.add(this->rgba);
+  return hash.getValue();
+}
+
+int
+SoReorganizeActionP::Vertex::operator==(const Vertex & v) const
+{
+  return
+    (this->vertex == v.vertex) &&
+    (this->normal == v.normal) &&
+    (this->texcoord == v.texcoord) &&
+    (this->rgba == v.rgba);
+}
+
+void
+SoReorganizeActionP::searchShapes(SoNode * root, const SoType type, SoPathList & pathlist)
+{
+  this->sa.setType(type);
+  this->sa.setSearchingAll(TRUE);
+  this->sa.setInterest(SoSearchAction::ALL);
+  this->sa.apply(root);
+  const SoPathList & pl = this->sa.getPaths();
+  for (int i = 0; i < pl.getLength(); i++) {
+    pathlist.append(pl[i]);
+  }
+  this->sa.reset();
+}
+
+//
+// Reorganizes the shapes at the tail of the paths in
+// pathlist. Traversing the scene graph and replacing nodes must be
+// done in the calling thread, but the shapes are collected first so
+// that the expensive part (welding vertices and optimizing the
+// index arrays) can be done for all the shapes in parallel.
+//
+void
+SoReorganizeActionP::reorganize(const SoPathList & pathlist)
+{
+  int i;
+  for (i = 0; i < pathlist.getLength(); i++) {
+    this->currentpath = reclassify_cast<SoFullPath *>(pathlist[i]);
+    this->shape = NULL;
+    this->cbaction.apply(this->currentpath);
+  }
+  this->currentpath = NULL;
+  this->shape = NULL;
+
+  if (this->mergeshapes) this->mergeShapes();
+
+  // initialize the global vertex cache setting before the worker
+  // threads need it
+  (void) SoVertexArrayIndexer::shouldOptimizeVertexCache();
+  cc_parallel_for(this->shapes.getLength(), 1, process_shapes_cb, this);
+
+  for (i = 0; i < this->shapes.getLength(); i++) {
+    ShapeData * data = this->shapes[i];
+    if (!data->merged) this->replaceNode(data);
+  }
+  for (i = 0; i < this->shapes.getLength(); i++) {
+    ShapeData * data = this->shapes[i];
+    if (data->merged) this->removeNode(data);
+    data->node->unref();
+    delete data;
+  }
+  this->shapes.truncate(0);
+}
+
+void
+SoReorganizeActionP::process_shapes_cb(void * closure, int begin, int end)
+{
+  SoReorganizeActionP * thisp = static_cast<SoReorganizeActionP *>(closure);
+  for (int i = begin; i < end; i++) {
+    ShapeData * data = thisp->shapes[i];
+    if (!data->merged) SoReorganizeActionP::processShape(data);
+  }
+}
+
+//
+// Welds identical vertices, and optimizes the order of the
+// primitives and the vertices for rendering. Only touches the shape
+// data, so it can be called from any thread.
+//
+void
+SoReorganizeActionP::processShape(ShapeData * shape)
+{
+  int i, j;
+  shape->islines = shape->triangles.getLength() == 0;
+  SbList <Vertex> & corners = shape->islines ? shape->lines : shape->triangles;
+  const int numcorners = corners.getLength();
+  if (numcorners == 0) return;
+  const int n = shape->islines ? 2 : 3;
+
+  SbList <Vertex> welded(numcorners / 2 + 1);
+  SbHash<Vertex, int32_t> vhash(numcorners / 2 + 1);
+  SoVertexArrayIndexer indexer;
+  int32_t idx[3];
+  for (i = 0; i < numcorners; i += n) {
+    for (j = 0; j < n; j++) {
+      const Vertex & v = corners[i+j];
+      if (!vhash.get(v, idx[j])) {
+        idx[j] = welded.getLength();
+        vhash.put(v, idx[j]);
+        welded.append(v);
+      }
+    }
+    if (shape->islines) indexer.addLine(idx[0], idx[1]);
+    else indexer.addTriangle(idx[0], idx[1], idx[2]);
+  }
+  vhash.clear();
+  shape->triangles.truncate(0, TRUE);
+  shape->lines.truncate(0, TRUE);
+
+  // sorts the primitives, or orders them for the post-transform
+  // vertex cache
+  indexer.close();
+
+  // store the vertices in the order they are first used, so that
+  // the GPU reads the vertex data sequentially
+  const int numv = welded.getLength();
+  const int numidx = indexer.getNumIndices();
+  const GLint * indices = indexer.getIndices();
+  int32_t * oldtonew = new int32_t[numv];
+  for (i = 0; i < numv; i++) oldtonew[i] = -1;
+  shape->vertices.truncate(0);
+  shape->vertices.ensureCapacity(numv);
+  shape->indices.truncate(0);
+  shape->indices.ensureCapacity(numidx);
+  for (i = 0; i < numidx; i++) {
+    const int32_t v = indices[i];
+    if (oldtonew[v] < 0) {
+      oldtonew[v] = shape->vertices.getLength();
+      shape->vertices.append(welded[v]);
+    }
+    shape->indices.append(oldtonew[v]);
+  }
+  delete[] oldtonew;
+}
+
+//
+// Returns TRUE if next can be merged into target, the first shape of
+// the run ending with prev. The geometry of prev may already have been
+// moved into target, so the shapes are compared with target.
+//
+SbBool
+SoReorganizeActionP::canMerge(const ShapeData * target, const ShapeData * prev,
+                              const ShapeData * next)
+{
+  if (prev->isvrml || next->isvrml) return FALSE;
+  if (prev->path->getLength() < 2 || next->path->getLength() < 2) return FALSE;
+
+  // only adjacent children of the same group are rendered with
+  // identical state. Group subclasses (switches, level of detail
+  // nodes, ...) may traverse just some of their children, so merging
+  // is restricted to plain groups and separators.
+  SoNode * parent = prev->path->getNodeFromTail(1);
+  const SoType parenttype = parent->getTypeId();
+  if ((parenttype != SoGroup::getClassTypeId() &&
+       parenttype != SoSeparator::getClassTypeId()) ||
+      next->path->getNodeFromTail(1) != parent ||
+      next->path->getIndexFromTail(0) != prev->path->getIndexFromTail(0) + 1) {
+    return FALSE;
+  }
+  return
+    ((target->triangles.getLength() == 0) == (next->triangles.getLength() == 0)) &&
+    (target->hastexture == next->hastexture) &&
+    (target->lighting == next->lighting) &&
+    (target->normalsonstate == next->normalsonstate) &&
+    ((target->firstcolor & 0xff) == (next->firstcolor & 0xff));
+}
+
+//
+// Moves the geometry of runs of adjacent shapes into the first shape
+// of each run.
+//
+void
+SoReorganizeActionP::mergeShapes(void)
+{
+  ShapeData * target = NULL;
+  ShapeData * prev = NULL;
+  for (int i = 0; i < this->shapes.getLength(); i++) {
+    ShapeData * data = this->shapes[i];
+    if (target && SoReorganizeActionP::canMerge(target, prev, data)) {
+      for (int j = 0; j < data->triangles.getLength(); j++) {
+        target->triangles.append(data->triangles[j]);
+      }
+      for (int k = 0; k < data->lines.getLength(); k++) {
+        target->lines.append(data->lines[k]);
+      }
+      data->triangles.truncate(0, TRUE);
+      data->lines.truncate(0, TRUE);
+      if (data->colorpervertex || data->firstcolor != target->firstcolor) {
+        target->colorpervertex = TRUE;
+      }
+      data->merged = TRUE;
+    }
+    else {
+      target = data;
+    }
+    prev = data;
+  }
+}
+
 SoCallbackAction::Response
 SoReorganizeActionP::pre_shape_cb(void * userdata, SoCallbackAction * COIN_UNUSED_ARG(action), const SoNode * node)
 {
@@ -565,22 +835,19 @@ SoReorganizeActionP::pre_shape_cb(void * userdata, SoCallbackAction * COIN_UNUSE
 #ifdef HAVE_VRML97
   thisp->isvrml = node->isOfType(SoVRMLGeometry::getClassTypeId());
 #endif // HAVE_VRML97
-  thisp->numtriangles = 0;
-  thisp->numpoints = 0;
-  thisp->numlines = 0;
   return SoCallbackAction::CONTINUE;
 }
 
 SoCallbackAction::Response
-SoReorganizeActionP::post_shape_cb(void * COIN_UNUSED_ARG(userdata), SoCallbackAction * COIN_UNUSED_ARG(action), const SoNode * COIN_UNUSED_ARG(node))
+SoReorganizeActionP::post_shape_cb(void * userdata, SoCallbackAction * COIN_UNUSED_ARG(action), const SoNode * COIN_UNUSED_ARG(node))
 {
+  SoReorganizeActionP * thisp = static_cast<SoReorganizeActionP *>(userdata);
 #if 0 // debug
-  SoReorganizeActionP * thisp = (SoReorganizeActionP*) userdata;
-  fprintf(stderr,"shape: %s, numtri: %d, pvcache: %p\n",
+  fprintf(stderr,"shape: %s, numtri: %d\n",
           node->getTypeId().getName().getString(),
-          thisp->numtriangles,
-          thisp->pvcache);
+          thisp->shape ? thisp->shape->triangles.getLength() / 3 : 0);
 #endif // debug
+  thisp->shape = NULL;
   return SoCallbackAction::CONTINUE;
 }
 
@@ -592,17 +859,11 @@ SoReorganizeActionP::triangle_cb(void * userdata, SoCallbackAction * action,
 {
   SoReorganizeActionP * thisp = static_cast<SoReorganizeActionP *>(userdata);
 
-  if (!thisp->didinit) {
-    if (thisp->initShape(action)) {
-      assert(thisp->pvcache == NULL);
-      thisp->pvcache = new SoPrimitiveVertexCache(action->getState());
-      thisp->pvcache->ref();
-    }
-  }
-
-  thisp->numtriangles++;
-  if (thisp->pvcache) {
-    thisp->pvcache->addTriangle(v1, v2, v3);
+  if (!thisp->didinit) (void) thisp->initShape(action);
+  if (thisp->shape) {
+    thisp->addVertex(thisp->shape->triangles, v1);
+    thisp->addVertex(thisp->shape->triangles, v2);
+    thisp->addVertex(thisp->shape->triangles, v3);
   }
 }
 
@@ -613,18 +874,36 @@ SoReorganizeActionP::line_segment_cb(void * userdata, SoCallbackAction * action,
 {
   SoReorganizeActionP * thisp = static_cast<SoReorganizeActionP *>(userdata);
 
-  if (!thisp->didinit) {
-    if (thisp->initShape(action)) {
-      assert(thisp->pvcache == NULL);
-      thisp->pvcache = new SoPrimitiveVertexCache(action->getState());
-      thisp->pvcache->ref();
-    }
+  if (!thisp->didinit) (void) thisp->initShape(action);
+  if (thisp->shape) {
+    thisp->addVertex(thisp->shape->lines, v1);
+    thisp->addVertex(thisp->shape->lines, v2);
   }
+}
 
-  thisp->numlines++;
-  if (thisp->pvcache) {
-    thisp->pvcache->addLine(v1, v2);
+uint32_t
+SoReorganizeActionP::getColor(const int materialindex) const
+{
+  if (this->packedptr) {
+    return this->packedptr[SbClamp(materialindex, 0, this->numdiffuse-1)];
   }
+  SbColor tmpc = this->diffuseptr[SbClamp(materialindex, 0, this->numdiffuse-1)];
+  float tmpt = this->transpptr[SbClamp(materialindex, 0, this->numtransp-1)];
+  return tmpc.getPackedValue(tmpt);
+}
+
+void
+SoReorganizeActionP::addVertex(SbList <Vertex> & list, const SoPrimitiveVertex * pv)
+{
+  Vertex v;
+  v.vertex = pv->getPoint();
+  // ignore data which isn't used, so that more vertices can be welded
+  v.normal = this->shape->lighting ? pv->getNormal() : SbVec3f(0.0f, 0.0f, 0.0f);
+  v.texcoord = this->shape->hastexture ? pv->getTextureCoords() : SbVec4f(0.0f, 0.0f, 0.0f, 1.0f);
+
+  v.rgba = this->getColor(pv->getMaterialIndex());
+  if (v.rgba != this->shape->firstcolor) this->shape->colorpervertex = TRUE;
+  list.append(v);
 }
 
 SbBool
@@ -636,13 +915,10 @@ SoReorganizeActionP::initShape(SoCallbackAction * action)
 
   unsigned int shapeflags = SoShapeStyleElement::get(state)->getFlags();
 
-  this->lighting = SoLightModelElement::get(state) != SoLightModelElement::BASE_COLOR;
-  this->normalsonstate = SoNormalElement::getInstance(state)->getNum() > 0;
-
   SbBool texture0enabled =
     SoMultiTextureEnabledElement::get(state,0) != FALSE;
 
-  this->hastexture = texture0enabled;
+  SbBool hastexture = texture0enabled;
 
   int lastenabled;
   const SbBool * enabledunits =
@@ -690,7 +966,7 @@ SoReorganizeActionP::initShape(SoCallbackAction * action)
         // inserting new nodes though. pederb, 2005-04-28
         canrenderasvertexarray = FALSE;
 
-        this->hastexture = TRUE;
+        hastexture = TRUE;
         switch (melem->getType(i)) {
         case SoMultiTextureCoordinateElement::DEFAULT:
         case SoMultiTextureCoordinateElement::EXPLICIT:
@@ -711,61 +987,94 @@ SoReorganizeActionP::initShape(SoCallbackAction * action)
   }
 
   if (canrenderasvertexarray) {
-    SbColor diffuse = SoLazyElement::getDiffuse(state, 0);
-    float transp = SoLazyElement::getTransparency(state, 0);
-    this->diffusecolor = SbColor4f(diffuse, 1.0f - transp);
+    SoLazyElement * lelem = SoLazyElement::getInstance(state);
+    this->numdiffuse = lelem->getNumDiffuse();
+    this->numtransp = lelem->getNumTransparencies();
+    if (lelem->isPacked()) {
+      this->packedptr = lelem->getPackedPointer();
+      this->diffuseptr = NULL;
+      this->transpptr = NULL;
+    }
+    else {
+      this->packedptr = NULL;
+      this->diffuseptr = lelem->getDiffusePointer();
+      this->transpptr = lelem->getTransparencyPointer();
+    }
+
+    ShapeData * data = new ShapeData;
+    data->path = this->currentpath;
+    data->node = this->currentpath->getTail();
+    data->node->ref();
+    data->isvrml = this->isvrml;
+    data->hastexture = hastexture;
+    data->lighting = SoLightModelElement::get(state) != SoLightModelElement::BASE_COLOR;
+    data->normalsonstate = SoNormalElement::getInstance(state)->getNum() > 0;
+    data->colorpervertex = FALSE;
+    data->firstcolor = this->getColor(0);
+    data->merged = FALSE;
+    data->islines = FALSE;
+    this->shapes.append(data);
+    this->shape = data;
   }
   return canrenderasvertexarray;
 }
 
 void
-SoReorganizeActionP::replaceNode(SoFullPath * path)
+SoReorganizeActionP::replaceNode(ShapeData * shape)
 {
-  if (this->pvcache == NULL) return;
-  this->pvcache->fit(); // needed to do optimize-sort of data
+  // the path is no longer valid if an earlier replacement changed it
+  if (shape->path->getTail() != shape->node) return;
 
-  if (this->pvcache->getNumTriangleIndices()) {
-    if (this->isvrml) {
-      this->replaceVrmlIfs(path);
+  if (shape->indices.getLength() == 0) return;
+  if (!shape->islines) {
+    if (shape->isvrml) {
+      this->replaceVrmlIfs(shape);
     }
     else {
-      this->replaceIfs(path);
+      this->replaceIfs(shape);
     }
   }
-  else if (this->pvcache->getNumLineIndices()) {
-    if (this->isvrml) {
-      this->replaceVrmlIls(path);
+  else {
+    if (shape->isvrml) {
+      this->replaceVrmlIls(shape);
     }
     else {
-      this->replaceIls(path);
+      this->replaceIls(shape);
     }
   }
-  this->pvcache->unref();
-  this->pvcache = NULL;
+}
+
+void
+SoReorganizeActionP::removeNode(ShapeData * shape)
+{
+  SoFullPath * path = shape->path;
+  if (path->getTail() != shape->node || path->getLength() < 2) return;
+  SoGroup * g = coin_assert_cast<SoGroup *>(path->getNodeFromTail(1));
+  g->removeChild(path->getIndexFromTail(0));
 }
 
 SoVertexProperty *
-SoReorganizeActionP::createVertexProperty(const SbBool forlines)
+SoReorganizeActionP::createVertexProperty(const ShapeData * shape, const SbBool forlines)
 {
   SoVertexProperty * vp = new SoVertexProperty;
   vp->ref();
   SoVertexProperty::Binding nbind = SoVertexProperty::PER_VERTEX_INDEXED;
 
-  if (!this->lighting ||
-      (forlines && !this->normalsonstate)) {
+  if (!shape->lighting ||
+      (forlines && !shape->normalsonstate)) {
     nbind = SoVertexProperty::OVERALL;
   }
   vp->normalBinding = nbind;
 
-  int numv = this->pvcache->getNumVertices();
+  int i;
+  const int numv = shape->vertices.getLength();
+  const Vertex * src = shape->vertices.getArrayPtr();
 
-  if (this->hastexture) {
+  if (shape->hastexture) {
     vp->texCoord.setNum(numv);
     SbVec2f * dst = vp->texCoord.startEditing();
-    const SbVec4f * src = this->pvcache->getTexCoordArray();
-
-    for (int i = 0; i < numv; i++) {
-      SbVec4f tmp = src[i];
+    for (i = 0; i < numv; i++) {
+      SbVec4f tmp = src[i].texcoord;
       if (tmp[3] != 0.0f) {
         tmp[0] /= tmp[3];
         tmp[1] /= tmp[3];
@@ -776,25 +1085,26 @@ SoReorganizeActionP::createVertexProperty(const SbBool forlines)
     vp->texCoord.finishEditing();
   }
 
-  vp->vertex.setValues(0, numv,
-                       this->pvcache->getVertexArray());
+  vp->vertex.setNum(numv);
+  SbVec3f * vdst = vp->vertex.startEditing();
+  for (i = 0; i < numv; i++) vdst[i] = src[i].vertex;
+  vp->vertex.finishEditing();
+
   if (nbind == SoVertexProperty::PER_VERTEX_INDEXED) {
-    vp->normal.setValues(0, numv,
-                         this->pvcache->getNormalArray());
+    vp->normal.setNum(numv);
+    SbVec3f * ndst = vp->normal.startEditing();
+    for (i = 0; i < numv; i++) ndst[i] = src[i].normal;
+    vp->normal.finishEditing();
   }
 
   vp->materialBinding = SoVertexProperty::OVERALL;
-  vp->orderedRGBA = this->diffusecolor.getPackedValue();
+  vp->orderedRGBA = shape->firstcolor;
 
-  if (this->pvcache->colorPerVertex()) {
+  if (shape->colorpervertex) {
     vp->materialBinding = SoVertexProperty::PER_VERTEX_INDEXED;
-    uint8_t * src = const_cast<uint8_t *>(this->pvcache->getColorArray());
     vp->orderedRGBA.setNum(numv);
     uint32_t * dst = vp->orderedRGBA.startEditing();
-    for (int i = 0; i < numv; i++) {
-      dst[i] = (src[0]<<24)|(src[1]<<16)|(src[2]<<8)|src[3];
-      src += 4;
-    }
+    for (i = 0; i < numv; i++) dst[i] = src[i].rgba;
     vp->orderedRGBA.finishEditing();
   }
   vp->unrefNoDelete();
@@ -802,14 +1112,15 @@ SoReorganizeActionP::createVertexProperty(const SbBool forlines)
 }
 
 void
-SoReorganizeActionP::replaceIfs(SoFullPath * path)
+SoReorganizeActionP::replaceIfs(ShapeData * shape)
 {
+  SoFullPath * path = shape->path;
   SoNode * parent = path->getNodeFromTail(1);
   if (!parent->isOfType(SoGroup::getClassTypeId())) {
     return;
   }
 
-  SoVertexProperty * vp = this->createVertexProperty(FALSE);
+  SoVertexProperty * vp = this->createVertexProperty(shape, FALSE);
   SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
   ifs->ref();
   ifs->vertexProperty = vp;
@@ -817,16 +1128,15 @@ SoReorganizeActionP::replaceIfs(SoFullPath * path)
   ifs->materialIndex.setNum(0);
   ifs->textureCoordIndex.setNum(0);
 
-  int numtri = this->pvcache->getNumTriangleIndices() / 3;
-  const GLint * indices = this->pvcache->getTriangleIndices();
+  int numtri = shape->indices.getLength() / 3;
+  const int32_t * indices = shape->indices.getArrayPtr();
   ifs->coordIndex.setNum(numtri * 4);
   int32_t * ptr = ifs->coordIndex.startEditing();
 
-
   for (int i = 0; i < numtri; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*3]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+1]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+2]);
+    *ptr++ = indices[i*3];
+    *ptr++ = indices[i*3+1];
+    *ptr++ = indices[i*3+2];
     *ptr++ = -1;
   }
   ifs->coordIndex.finishEditing();
@@ -840,35 +1150,36 @@ SoReorganizeActionP::replaceIfs(SoFullPath * path)
 }
 
 void
-SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
+SoReorganizeActionP::replaceVrmlIfs(ShapeData * shape)
 {
 #ifdef HAVE_VRML97
+  SoFullPath * path = shape->path;
   SoNode * parent = path->getNodeFromTail(1);
   if (!parent->isOfType(SoGroup::getClassTypeId()) &&
       !parent->isOfType(SoVRMLShape::getClassTypeId())) {
     return;
   }
 
+  int i;
   SoVRMLIndexedFaceSet * oldifs = coin_assert_cast<SoVRMLIndexedFaceSet *>(path->getTail());
   assert(oldifs->isOfType(SoVRMLIndexedFaceSet::getClassTypeId()));
   SoVRMLIndexedFaceSet * ifs = new SoVRMLIndexedFaceSet;
   ifs->ref();
-  ifs->normalPerVertex = this->lighting;
-  ifs->colorPerVertex = this->pvcache->colorPerVertex();
+  ifs->normalPerVertex = shape->lighting;
+  ifs->colorPerVertex = shape->colorpervertex;
   ifs->ccw = oldifs->ccw;
   ifs->solid = oldifs->solid;
   ifs->creaseAngle = oldifs->creaseAngle;
 
-  int numv = this->pvcache->getNumVertices();
+  const int numv = shape->vertices.getLength();
+  const Vertex * src = shape->vertices.getArrayPtr();
 
-  if (this->hastexture) {
+  if (shape->hastexture) {
     SoVRMLTextureCoordinate * tc = new SoVRMLTextureCoordinate;
     tc->point.setNum(numv);
     SbVec2f * dst = tc->point.startEditing();
-    const SbVec4f * src = this->pvcache->getTexCoordArray();
-
-    for (int i = 0; i < numv; i++) {
-      SbVec4f tmp = src[i];
+    for (i = 0; i < numv; i++) {
+      SbVec4f tmp = src[i].texcoord;
       if (tmp[3] != 0.0f) {
         tmp[0] /= tmp[3];
         tmp[1] /= tmp[3];
@@ -881,26 +1192,29 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
   }
 
   SoVRMLCoordinate * c = new SoVRMLCoordinate;
-  c->point.setValues(0, numv,
-                     this->pvcache->getVertexArray());
+  c->point.setNum(numv);
+  SbVec3f * vdst = c->point.startEditing();
+  for (i = 0; i < numv; i++) vdst[i] = src[i].vertex;
+  c->point.finishEditing();
   ifs->coord = c;
 
-  if (this->lighting) {
+  if (shape->lighting) {
     SoVRMLNormal * norm = new SoVRMLNormal;
-    norm->vector.setValues(0, numv,
-                           this->pvcache->getNormalArray());
+    norm->vector.setNum(numv);
+    SbVec3f * ndst = norm->vector.startEditing();
+    for (i = 0; i < numv; i++) ndst[i] = src[i].normal;
+    norm->vector.finishEditing();
     ifs->normal = norm;
   }
-  if (this->pvcache->colorPerVertex()) {
+  if (shape->colorpervertex) {
     SoVRMLColor * col = new SoVRMLColor;
     col->color.setNum(numv);
-    uint8_t * src = const_cast<uint8_t *>(this->pvcache->getColorArray());
     SbColor * dst = col->color.startEditing();
-    for (int i = 0; i < numv; i++) {
-      dst[i] = SbColor(src[0]/255.0f,
-                       src[1]/255.0f,
-                       src[2]/255.0f);
-      src += 4;
+    for (i = 0; i < numv; i++) {
+      const uint32_t rgba = src[i].rgba;
+      dst[i] = SbColor((rgba>>24)/255.0f,
+                       ((rgba>>16)&0xff)/255.0f,
+                       ((rgba>>8)&0xff)/255.0f);
     }
     col->color.finishEditing();
     ifs->color = col;
@@ -910,15 +1224,15 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
   ifs->colorIndex.setNum(0);
   ifs->texCoordIndex.setNum(0);
 
-  int numtri = this->pvcache->getNumTriangleIndices() / 3;
-  const GLint * indices = this->pvcache->getTriangleIndices();
+  int numtri = shape->indices.getLength() / 3;
+  const int32_t * indices = shape->indices.getArrayPtr();
   ifs->coordIndex.setNum(numtri * 4);
   int32_t * ptr = ifs->coordIndex.startEditing();
 
-  for (int i = 0; i < numtri; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*3]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+1]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+2]);
+  for (i = 0; i < numtri; i++) {
+    *ptr++ = indices[i*3];
+    *ptr++ = indices[i*3+1];
+    *ptr++ = indices[i*3+2];
     *ptr++ = -1;
   }
   ifs->coordIndex.finishEditing();
@@ -930,8 +1244,8 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
     g->replaceChild(idx, ifs);
   }
   else {
-    SoVRMLShape * shape = coin_assert_cast<SoVRMLShape *>(parent);
-    shape->geometry = ifs;
+    SoVRMLShape * vrmlshape = coin_assert_cast<SoVRMLShape *>(parent);
+    vrmlshape->geometry = ifs;
   }
   path->push(idx);
   ifs->unrefNoDelete();
@@ -939,14 +1253,15 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
 }
 
 void
-SoReorganizeActionP::replaceIls(SoFullPath * path)
+SoReorganizeActionP::replaceIls(ShapeData * shape)
 {
+  SoFullPath * path = shape->path;
   SoNode * parent = path->getNodeFromTail(1);
   if (!parent->isOfType(SoGroup::getClassTypeId())) {
     return;
   }
 
-  SoVertexProperty * vp = this->createVertexProperty(TRUE);
+  SoVertexProperty * vp = this->createVertexProperty(shape, TRUE);
   SoIndexedLineSet * ils = new SoIndexedLineSet;
   ils->ref();
   ils->vertexProperty = vp;
@@ -954,14 +1269,14 @@ SoReorganizeActionP::replaceIls(SoFullPath * path)
   ils->materialIndex.setNum(0);
   ils->textureCoordIndex.setNum(0);
 
-  int numlines = this->pvcache->getNumLineIndices() / 2;
-  const GLint * indices = this->pvcache->getLineIndices();
+  int numlines = shape->indices.getLength() / 2;
+  const int32_t * indices = shape->indices.getArrayPtr();
   ils->coordIndex.setNum(numlines * 3);
   int32_t * ptr = ils->coordIndex.startEditing();
 
   for (int i = 0; i < numlines; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*2]);
-    *ptr++ = static_cast<int32_t>(indices[i*2+1]);
+    *ptr++ = indices[i*2];
+    *ptr++ = indices[i*2+1];
     *ptr++ = -1;
   }
   ils->coordIndex.finishEditing();
@@ -975,47 +1290,51 @@ SoReorganizeActionP::replaceIls(SoFullPath * path)
 }
 
 void
-SoReorganizeActionP::replaceVrmlIls(SoFullPath * path)
+SoReorganizeActionP::replaceVrmlIls(ShapeData * shape)
 {
 #ifdef HAVE_VRML97
+  SoFullPath * path = shape->path;
   SoNode * parent = path->getNodeFromTail(1);
   if (!parent->isOfType(SoGroup::getClassTypeId()) &&
       !parent->isOfType(SoVRMLShape::getClassTypeId())) {
     return;
   }
 
+  int i;
   SoVRMLIndexedLineSet * ils = new SoVRMLIndexedLineSet;
   ils->ref();
 
-  int numv = this->pvcache->getNumVertices();
-  int numlines = this->pvcache->getNumLineIndices() / 2;
-  const GLint * indices = this->pvcache->getLineIndices();
+  const int numv = shape->vertices.getLength();
+  const Vertex * src = shape->vertices.getArrayPtr();
+  int numlines = shape->indices.getLength() / 2;
+  const int32_t * indices = shape->indices.getArrayPtr();
   ils->coordIndex.setNum(numlines * 3);
   int32_t * ptr = ils->coordIndex.startEditing();
 
-  for (int i = 0; i < numlines; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*2]);
-    *ptr++ = static_cast<int32_t>(indices[i*2+1]);
+  for (i = 0; i < numlines; i++) {
+    *ptr++ = indices[i*2];
+    *ptr++ = indices[i*2+1];
     *ptr++ = -1;
   }
   ils->coordIndex.finishEditing();
 
   SoVRMLCoordinate * c = new SoVRMLCoordinate;
-  c->point.setValues(0, numv,
-                     this->pvcache->getVertexArray());
+  c->point.setNum(numv);
+  SbVec3f * vdst = c->point.startEditing();
+  for (i = 0; i < numv; i++) vdst[i] = src[i].vertex;
+  c->point.finishEditing();
   ils->coord = c;
 
-  if (this->pvcache->colorPerVertex()) {
+  if (shape->colorpervertex) {
     ils->colorPerVertex = TRUE;
     SoVRMLColor * col = new SoVRMLColor;
     col->color.setNum(numv);
-    uint8_t * src = const_cast<uint8_t *>(this->pvcache->getColorArray());
     SbColor * dst = col->color.startEditing();
-    for (int i = 0; i < numv; i++) {
-      dst[i] = SbColor(src[0]/255.0f,
-                       src[1]/255.0f,
-                       src[2]/255.0f);
-      src += 4;
+    for (i = 0; i < numv; i++) {
+      const uint32_t rgba = src[i].rgba;
+      dst[i] = SbColor((rgba>>24)/255.0f,
+                       ((rgba>>16)&0xff)/255.0f,
+                       ((rgba>>8)&0xff)/255.0f);
     }
     col->color.finishEditing();
     ils->color = col;
@@ -1029,8 +1348,8 @@ SoReorganizeActionP::replaceVrmlIls(SoFullPath * path)
     g->replaceChild(idx, ils);
   }
   else {
-    SoVRMLShape * shape = coin_assert_cast<SoVRMLShape *>(parent);
-    shape->geometry = ils;
+    SoVRMLShape * vrmlshape = coin_assert_cast<SoVRMLShape *>(parent);
+    vrmlshape->geometry = ils;
   }
   path->push(idx);
   ils->unrefNoDelete();
@@ -1038,3 +1357,173 @@ SoReorganizeActionP::replaceVrmlIls(SoFullPath * path)
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoLOD.h>
+
+BOOST_AUTO_TEST_CASE(reorganizeGrid)
+{
+  const int size = 16;
+  int i, j;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coord = new SoCoordinate3;
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  root->addChild(coord);
+  root->addChild(ifs);
+
+  coord->point.setNum(size * size);
+  SbVec3f * pts = coord->point.startEditing();
+  for (i = 0; i < size; i++) {
+    for (j = 0; j < size; j++) {
+      pts[i*size+j].setValue(float(j), float(i), 0.0f);
+    }
+  }
+  coord->point.finishEditing();
+
+  // quads added in a scattered order
+  int n = 0;
+  ifs->coordIndex.setNum((size-1) * (size-1) * 5);
+  int32_t * idx = ifs->coordIndex.startEditing();
+  for (int cell = 0; cell < (size-1) * (size-1); cell++) {
+    const int c = (cell * 37) % ((size-1) * (size-1));
+    i = c / (size-1);
+    j = c % (size-1);
+    idx[n++] = i*size+j;
+    idx[n++] = i*size+j+1;
+    idx[n++] = (i+1)*size+j+1;
+    idx[n++] = (i+1)*size+j;
+    idx[n++] = -1;
+  }
+  ifs->coordIndex.finishEditing();
+
+  SoReorganizeAction ra;
+  ra.generateTriangleStrips(FALSE);
+  ra.apply(root);
+
+  SoIndexedFaceSet * result = NULL;
+  for (i = 0; i < root->getNumChildren(); i++) {
+    if (root->getChild(i)->isOfType(SoIndexedFaceSet::getClassTypeId())) {
+      result = static_cast<SoIndexedFaceSet *>(root->getChild(i));
+    }
+  }
+  BOOST_REQUIRE(result != NULL);
+  SoVertexProperty * vp = static_cast<SoVertexProperty *>(result->vertexProperty.getValue());
+  BOOST_REQUIRE(vp != NULL);
+
+  const int numidx = result->coordIndex.getNum();
+  const int32_t * cidx = result->coordIndex.getValues(0);
+  const SbVec3f * v = vp->vertex.getValues(0);
+  BOOST_CHECK_MESSAGE(numidx == (size-1) * (size-1) * 2 * 4, "wrong number of triangles");
+
+  float area = 0.0f;
+  int nextnew = 0;
+  SbBool firstuseorder = TRUE;
+  for (i = 0; i + 3 < numidx; i += 4) {
+    for (j = 0; j < 3; j++) {
+      if (cidx[i+j] > nextnew) firstuseorder = FALSE;
+      if (cidx[i+j] == nextnew) nextnew++;
+    }
+    area += 0.5f * (v[cidx[i+1]] - v[cidx[i]]).cross(v[cidx[i+2]] - v[cidx[i]]).length();
+  }
+  BOOST_CHECK_MESSAGE(fabs(area - float((size-1) * (size-1))) < 1.0e-3f, "triangles changed");
+  BOOST_CHECK_MESSAGE(firstuseorder, "vertices should be stored in the order they are used");
+
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(mergeShapes)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coord = new SoCoordinate3;
+  coord->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+  coord->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+  coord->point.set1Value(2, SbVec3f(1.0f, 1.0f, 0.0f));
+  coord->point.set1Value(3, SbVec3f(0.0f, 1.0f, 0.0f));
+  root->addChild(coord);
+
+  // four shapes, so that shapes are merged into a run which already
+  // contains merged geometry
+  const int32_t tris[][4] = {
+    { 0, 1, 2, -1 }, { 0, 2, 3, -1 }, { 1, 2, 3, -1 }, { 0, 1, 3, -1 }
+  };
+  for (int i = 0; i < 4; i++) {
+    SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+    ifs->coordIndex.setValues(0, 4, tris[i]);
+    root->addChild(ifs);
+  }
+
+  SoReorganizeAction ra;
+  BOOST_CHECK(!ra.areShapesMerged());
+  ra.mergeShapes(TRUE);
+  ra.apply(root);
+
+  BOOST_REQUIRE_EQUAL(root->getNumChildren(), 2);
+  BOOST_REQUIRE(root->getChild(1)->isOfType(SoIndexedFaceSet::getClassTypeId()));
+  SoIndexedFaceSet * result = static_cast<SoIndexedFaceSet *>(root->getChild(1));
+  BOOST_CHECK_MESSAGE(result->coordIndex.getNum() == 16, "shapes should be merged");
+  SoVertexProperty * vp = static_cast<SoVertexProperty *>(result->vertexProperty.getValue());
+  BOOST_REQUIRE(vp != NULL);
+  BOOST_CHECK_MESSAGE(vp->vertex.getNum() == 4, "shared vertices should be welded");
+
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(noMergeInSwitchOrLOD)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coord = new SoCoordinate3;
+  coord->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+  coord->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+  coord->point.set1Value(2, SbVec3f(1.0f, 1.0f, 0.0f));
+  coord->point.set1Value(3, SbVec3f(0.0f, 1.0f, 0.0f));
+  root->addChild(coord);
+
+  // only one child of each of these groups is traversed at a time, so
+  // their children must never be merged into each other
+  SoSwitch * sw = new SoSwitch;
+  sw->whichChild = 0;
+  SoLOD * lod = new SoLOD;
+  lod->range.set1Value(0, 10.0f);
+  root->addChild(sw);
+  root->addChild(lod);
+
+  const int32_t tri0[] = { 0, 1, 2, -1 };
+  const int32_t tri1[] = { 0, 2, 3, -1 };
+  SoGroup * parents[] = { sw, lod };
+  for (int i = 0; i < 2; i++) {
+    SoIndexedFaceSet * ifs0 = new SoIndexedFaceSet;
+    ifs0->coordIndex.setValues(0, 4, tri0);
+    SoIndexedFaceSet * ifs1 = new SoIndexedFaceSet;
+    ifs1->coordIndex.setValues(0, 4, tri1);
+    parents[i]->addChild(ifs0);
+    parents[i]->addChild(ifs1);
+  }
+
+  SoReorganizeAction ra;
+  ra.mergeShapes(TRUE);
+  ra.apply(root);
+
+  for (int i = 0; i < 2; i++) {
+    BOOST_REQUIRE_EQUAL(parents[i]->getNumChildren(), 2);
+    for (int j = 0; j < 2; j++) {
+      SoNode * child = parents[i]->getChild(j);
+      BOOST_REQUIRE(child->isOfType(SoIndexedFaceSet::getClassTypeId()));
+      BOOST_CHECK_MESSAGE(static_cast<SoIndexedFaceSet *>(child)->coordIndex.getNum() == 4,
+                          "children of a switch or LOD should not be merged");
+    }
+  }
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
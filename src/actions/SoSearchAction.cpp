@@ -67,6 +67,10 @@
   calling unrefNoDelete() on your object, since reset() truncates
   the path list.
 
+  When the same scene graph is searched many times, searches can be
+  answered from lookup tables instead of traversing the scene graph.
+  See setIndexed().
+
   See the documentation of SoTexture2 for a full usage example of
   SoSearchAction.
 */
@@ -76,6 +80,7 @@
 #include <Inventor/nodes/SoNode.h>
 
 #include "actions/SoSubActionP.h"
+#include "actions/SoSearchIndex.h"
 
 // *************************************************************************
 
@@ -150,6 +155,7 @@ SoSearchAction::initClass(void)
 {
   SO_ACTION_INTERNAL_INIT_CLASS(SoSearchAction, SoAction);
   SoSearchAction::duringSearchAll = FALSE;
+  SoSearchIndex::initClass();
 }
 
 
@@ -431,6 +437,9 @@ SoSearchAction::addPath(SoPath * const pathptr)
 {
   assert(! this->isFound()); // shouldn't try to add path if found
 
+  // paths found while building a search index are not kept
+  if (SoSearchIndex::collect(this, pathptr)) return;
+
   switch (this->interest) {
   case FIRST:
     assert(! this->path); // should be NULL
@@ -456,6 +465,49 @@ SoSearchAction::addPath(SoPath * const pathptr)
   }
 }
 
+/*!
+  Turns indexing of the scene graph below \a root on or off.
+
+  Searches applied to an indexed root node are answered from lookup
+  tables of the nodes below it, instead of traversing the scene
+  graph. This is much faster when many searches are done on the same
+  scene graph, as is common in applications after loading a file.
+  The results are the same as when traversing.
+
+  The tables are built by the first search on \a root, for each
+  combination of isSearchingAll(),
+  SoBaseKit::isSearchingChildren() and SoFile::getSearchOK(). A node
+  sensor on \a root throws them away when the scene graph changes in
+  a way that might affect the result, and the next search rebuilds
+  them. Field changes in nodes without children, like transformation
+  updates, do not affect the tables.
+
+  Searches applied to paths, and searches for the empty name without
+  other criteria, are always done by traversal.
+
+  The index keeps a reference to \a root until indexing is turned off
+  again.
+
+  \since Coin 4.1
+*/
+void
+SoSearchAction::setIndexed(SoNode * root, const SbBool onoff)
+{
+  SoSearchIndex::setIndexed(root, onoff);
+}
+
+/*!
+  Returns whether the scene graph below \a root is indexed.
+
+  \sa setIndexed()
+  \since Coin 4.1
+*/
+SbBool
+SoSearchAction::isIndexed(SoNode * root)
+{
+  return SoSearchIndex::isIndexed(root);
+}
+
 // *************************************************************************
 
 // Documented in superclass. Overridden from superclass to initialize
@@ -471,7 +523,141 @@ SoSearchAction::beginTraversal(SoNode * nodeptr)
   // now obsoleted 'duringSearchAll' flag.
   SoSearchAction::duringSearchAll = this->isSearchingAll();
 
-  this->traverse(nodeptr); // begin traversal at root node
+  // searches from an indexed root are answered from the index if possible
+  if (this->getWhatAppliedTo() != SoAction::NODE ||
+      !SoSearchIndex::search(this, nodeptr)) {
+    this->traverse(nodeptr); // begin traversal at root node
+  }
 
   SoSearchAction::duringSearchAll = FALSE;
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoPath.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodekits/SoShapeKit.h>
+
+namespace {
+
+// Returns TRUE if the indexed search agrees with a traversing search,
+// which is done by applying the action to a path.
+SbBool
+search_matches_index(SoNode * root, const int find, SoNode * node, const SoType type,
+                     const SbName & name, const SoSearchAction::Interest interest,
+                     const SbBool searchall)
+{
+  SoPathList results[2];
+  SoPath * paths[2] = { NULL, NULL };
+  SoPath * rootpath = new SoPath(root);
+  rootpath->ref();
+  for (int i = 0; i < 2; i++) {
+    SoSearchAction sa;
+    sa.setNode(node);
+    sa.setType(type);
+    sa.setName(name);
+    sa.setFind(find);
+    sa.setInterest(interest);
+    sa.setSearchingAll(searchall);
+    if (i == 0) sa.apply(rootpath);
+    else sa.apply(root);
+    results[i] = sa.getPaths();
+    paths[i] = sa.getPath();
+    if (paths[i]) paths[i]->ref();
+  }
+  SbBool same = (results[0].getLength() == results[1].getLength());
+  for (int i = 0; same && i < results[0].getLength(); i++) {
+    same = (*results[0][i] == *results[1][i]);
+  }
+  if ((paths[0] == NULL) != (paths[1] == NULL)) same = FALSE;
+  else if (paths[0]) same = same && (*paths[0] == *paths[1]);
+  for (int i = 0; i < 2; i++) if (paths[i]) paths[i]->unref();
+  rootpath->unref();
+  return same;
+}
+
+SbBool
+all_searches_match_index(SoNode * root, SoNode * node)
+{
+  const SoType types[] = {
+    SoNode::getClassTypeId(), SoGroup::getClassTypeId(), SoShape::getClassTypeId(),
+    SoCube::getClassTypeId(), SoTransform::getClassTypeId()
+  };
+  const char * names[] = { "a", "b", "nosuchname" };
+  const SoSearchAction::Interest interests[] = {
+    SoSearchAction::FIRST, SoSearchAction::LAST, SoSearchAction::ALL
+  };
+  for (int searchall = 0; searchall < 2; searchall++) {
+    for (int i = 0; i < 3; i++) {
+      const SoSearchAction::Interest interest = interests[i];
+      for (int t = 0; t < 5; t++) {
+        if (!search_matches_index(root, SoSearchAction::TYPE, NULL, types[t], "",
+                                  interest, searchall)) return FALSE;
+        if (!search_matches_index(root, SoSearchAction::TYPE|SoSearchAction::NAME, NULL,
+                                  types[t], "a", interest, searchall)) return FALSE;
+      }
+      for (int n = 0; n < 3; n++) {
+        if (!search_matches_index(root, SoSearchAction::NAME, NULL, SoType::badType(),
+                                  names[n], interest, searchall)) return FALSE;
+      }
+      if (!search_matches_index(root, SoSearchAction::NODE, node, SoType::badType(), "",
+                                interest, searchall)) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(indexed)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCube * cube = new SoCube;
+  cube->setName("a");
+  SoSwitch * sw = new SoSwitch;
+  sw->whichChild = 0;
+  SoSeparator * sep = new SoSeparator;
+  sep->setName("b");
+  sep->addChild(new SoTransform);
+  sep->addChild(cube);
+  sw->addChild(sep);
+  sw->addChild(cube);
+  root->addChild(cube);
+  root->addChild(sw);
+  root->addChild(new SoShapeKit);
+  root->addChild(cube);
+
+  SoSearchAction::setIndexed(root, TRUE);
+  BOOST_CHECK(SoSearchAction::isIndexed(root));
+  BOOST_CHECK_MESSAGE(all_searches_match_index(root, cube),
+                      "indexed search differs from traversal");
+
+  // changes after the index has been built
+  sw->whichChild = 1;
+  BOOST_CHECK_MESSAGE(all_searches_match_index(root, cube),
+                      "index not updated for switch change");
+  SoSphere * sphere = new SoSphere;
+  sphere->setName("b");
+  sep->insertChild(sphere, 0);
+  BOOST_CHECK_MESSAGE(all_searches_match_index(root, sphere),
+                      "index not updated for new child");
+  cube->setName("b");
+  BOOST_CHECK_MESSAGE(all_searches_match_index(root, cube),
+                      "index not updated for renamed node");
+  SoBaseKit::setSearchingChildren(TRUE);
+  BOOST_CHECK_MESSAGE(all_searches_match_index(root, cube),
+                      "indexed search differs from traversal in node kits");
+  SoBaseKit::setSearchingChildren(FALSE);
+
+  SoSearchAction::setIndexed(root, FALSE);
+  BOOST_CHECK(!SoSearchAction::isIndexed(root));
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
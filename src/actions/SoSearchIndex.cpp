@@ -0,0 +1,460 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+  SoSearchIndex keeps, for each combination of the flags controlling
+  SoSearchAction traversal, the list of nodes a search from the root
+  would visit, in traversal order. The lists are built lazily with a
+  single SoSearchAction traversal, and thrown away when a node sensor
+  on the root reports a change which might alter the traversal:
+
+  - changes to child lists, SoSFNode and SoMFNode fields, or
+    notifications without a field, invalidate all lists
+
+  - other field changes in nodes with children (like
+    SoSwitch::whichChild) only invalidate the lists for searches
+    following normal traversal rules, since these nodes decide which
+    children are traversed
+
+  - field changes in nodes without children are ignored
+
+  Switch nodes do not pass on notifications from inactive children, so
+  lists for searches visiting all nodes get extra sensors on the
+  children of switch nodes.
+
+  Names are not stored, but looked up with SoNode::getByName() when
+  searching, since renaming a node does not trigger notification.
+
+  The set of indexed roots and their lists are guarded by a mutex, so
+  searches from several threads are answered one at a time. The list
+  being built is kept per thread, since the search action building it
+  must be told apart from search actions running in other threads.
+*/
+
+#include "actions/SoSearchIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/fields/SoSFNode.h>
+#include <Inventor/fields/SoMFNode.h>
+#include <Inventor/lists/SoNodeList.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodekits/SoBaseKit.h>
+#include <Inventor/nodes/SoFile.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/VRMLnodes/SoVRMLSwitch.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SoFullPath.h>
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbTypedStorage.h>
+#endif // COIN_THREADSAFE
+
+#include "tidbitsp.h"
+#include "threads/threadsutilp.h"
+
+// *************************************************************************
+
+static SbHash<const SoNode *, SoSearchIndex *> * sosearchindex_roots = NULL;
+static void * sosearchindex_mutex = NULL;
+
+#ifdef COIN_THREADSAFE
+static SbTypedStorage<void **> * sosearchindex_builder = NULL;
+
+static void
+sosearchindex_builder_init(void * ptr)
+{
+  *static_cast<void **>(ptr) = NULL;
+}
+#else // !COIN_THREADSAFE
+static void * sosearchindex_builder = NULL;
+#endif // !COIN_THREADSAFE
+
+// *************************************************************************
+
+SoSearchIndex::SoSearchIndex(SoNode * rootarg)
+  : root(rootarg), changed(FALSE)
+{
+  for (int i = 0; i < NUMTREES; i++) this->trees[i] = NULL;
+  this->root->ref();
+  // trigger information is only available to immediate sensors
+  this->sensor = new SoNodeSensor(SoSearchIndex::sensorCB, this);
+  this->sensor->setPriority(0);
+  this->sensor->attach(this->root);
+}
+
+SoSearchIndex::~SoSearchIndex()
+{
+  for (int i = 0; i < NUMTREES; i++) delete this->trees[i];
+  delete this->sensor;
+  this->root->unref();
+}
+
+// Called from SoSearchAction::initClass().
+void
+SoSearchIndex::initClass(void)
+{
+  CC_MUTEX_CONSTRUCT(sosearchindex_mutex);
+#ifdef COIN_THREADSAFE
+  sosearchindex_builder =
+    new SbTypedStorage<void **>(sizeof(void *), sosearchindex_builder_init, NULL);
+#endif // COIN_THREADSAFE
+  coin_atexit(SoSearchIndex::cleanup, CC_ATEXIT_NORMAL);
+}
+
+void
+SoSearchIndex::cleanup(void)
+{
+  if (sosearchindex_roots) {
+    SbList<const SoNode *> keys;
+    sosearchindex_roots->makeKeyList(keys);
+    for (int i = 0; i < keys.getLength(); i++) {
+      SoSearchIndex * index = NULL;
+      (void) sosearchindex_roots->get(keys[i], index);
+      delete index;
+    }
+    delete sosearchindex_roots;
+    sosearchindex_roots = NULL;
+  }
+#ifdef COIN_THREADSAFE
+  delete sosearchindex_builder;
+  sosearchindex_builder = NULL;
+#endif // COIN_THREADSAFE
+  CC_MUTEX_DESTRUCT(sosearchindex_mutex);
+}
+
+SoSearchIndex::Builder *
+SoSearchIndex::getBuilder(void)
+{
+#ifdef COIN_THREADSAFE
+  return static_cast<Builder *>(*sosearchindex_builder->get());
+#else // !COIN_THREADSAFE
+  return static_cast<Builder *>(sosearchindex_builder);
+#endif // !COIN_THREADSAFE
+}
+
+void
+SoSearchIndex::setBuilder(Builder * builder)
+{
+#ifdef COIN_THREADSAFE
+  *sosearchindex_builder->get() = builder;
+#else // !COIN_THREADSAFE
+  sosearchindex_builder = builder;
+#endif // !COIN_THREADSAFE
+}
+
+// Turns indexing for root on or off.
+void
+SoSearchIndex::setIndexed(SoNode * root, const SbBool onoff)
+{
+  CC_MUTEX_LOCK(sosearchindex_mutex);
+  if (!sosearchindex_roots && onoff) {
+    sosearchindex_roots = new SbHash<const SoNode *, SoSearchIndex *>;
+  }
+  SoSearchIndex * index = NULL;
+  const SbBool exists = sosearchindex_roots && sosearchindex_roots->get(root, index);
+  if (onoff && !exists) {
+    sosearchindex_roots->put(root, new SoSearchIndex(root));
+  }
+  else if (!onoff && exists) {
+    sosearchindex_roots->erase(root);
+    delete index;
+  }
+  CC_MUTEX_UNLOCK(sosearchindex_mutex);
+}
+
+SbBool
+SoSearchIndex::isIndexed(SoNode * root)
+{
+  CC_MUTEX_LOCK(sosearchindex_mutex);
+  SoSearchIndex * index = NULL;
+  const SbBool indexed = sosearchindex_roots && sosearchindex_roots->get(root, index);
+  CC_MUTEX_UNLOCK(sosearchindex_mutex);
+  return indexed;
+}
+
+// *************************************************************************
+
+void
+SoSearchIndex::sensorCB(void * closure, SoSensor * sensor)
+{
+  SoSearchIndex * thisp = static_cast<SoSearchIndex *>(closure);
+  thisp->changed = TRUE;
+  SoField * field = static_cast<SoNodeSensor *>(sensor)->getTriggerField();
+
+  if (!field ||
+      field->isOfType(SoSFNode::getClassTypeId()) ||
+      field->isOfType(SoMFNode::getClassTypeId())) {
+    thisp->invalidate(FALSE);
+    return;
+  }
+  SoFieldContainer * container = field->getContainer();
+  if (container && container->isOfType(SoNode::getClassTypeId()) &&
+      static_cast<SoNode *>(container)->getChildren()) {
+    thisp->invalidate(TRUE);
+  }
+}
+
+// Marks the lists which might be affected by a change as invalid. If
+// traversalonly is TRUE, lists for searches which visit all nodes are
+// kept. The lists are deleted later, since this is called from the
+// callbacks of their sensors.
+void
+SoSearchIndex::invalidate(const SbBool traversalonly)
+{
+  for (int i = 0; i < NUMTREES; i++) {
+    if (this->trees[i] && (!traversalonly || !(i & SEARCHINGALL))) {
+      this->trees[i]->valid = FALSE;
+    }
+  }
+}
+
+SoSearchIndex::Tree::~Tree()
+{
+  for (int i = 0; i < this->sensors.getLength(); i++) delete this->sensors[i];
+}
+
+// Returns the list for the search mode, or NULL if the scene graph
+// changed while building it (as when SoVRMLInline nodes load their
+// children during traversal).
+const SoSearchIndex::Tree *
+SoSearchIndex::getTree(const int mode)
+{
+  if (this->trees[mode] && !this->trees[mode]->valid) {
+    delete this->trees[mode];
+    this->trees[mode] = NULL;
+  }
+  if (!this->trees[mode]) {
+    Tree * tree = new Tree;
+    this->changed = FALSE;
+    this->build(tree, mode);
+    if (this->changed) {
+      delete tree;
+      return NULL;
+    }
+    this->trees[mode] = tree;
+  }
+  return this->trees[mode];
+}
+
+// Finds all nodes a search from the root visits, with a search action
+// matching all nodes. The paths found are passed to collect() one at a
+// time instead of being stored in the action.
+void
+SoSearchIndex::build(Tree * tree, const int mode)
+{
+  SoSearchAction sa;
+  sa.setType(SoNode::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.setSearchingAll((mode & SEARCHINGALL) ? TRUE : FALSE);
+
+  Builder builder;
+  builder.action = &sa;
+  builder.index = this;
+  builder.tree = tree;
+  builder.mode = mode;
+  SoSearchIndex::setBuilder(&builder);
+  sa.apply(this->root);
+  SoSearchIndex::setBuilder(NULL);
+}
+
+// Called by SoSearchAction::addPath(). Returns TRUE if the path was
+// collected for the index being built.
+SbBool
+SoSearchIndex::collect(const SoSearchAction * action, SoPath * path)
+{
+  Builder * b = SoSearchIndex::getBuilder();
+  if (!b || b->action != action) return FALSE;
+  Tree * tree = b->tree;
+
+  path->ref();
+  const SoFullPath * fullpath = reinterpret_cast<const SoFullPath *>(path);
+  const int len = fullpath->getLength();
+
+  // the paths come in traversal order, so the parent of each entry is
+  // the last entry found one level up
+  Tree::Entry entry;
+  entry.node = fullpath->getTail();
+  entry.parent = (len > 1) ? b->stack[len - 2] : -1;
+  entry.childindex = (len > 1) ? fullpath->getIndex(len - 1) : -1;
+  entry.nextnode = -1;
+  entry.nexttype = -1;
+  path->unref();
+
+  const int idx = tree->entries.getLength();
+  tree->entries.append(entry);
+  b->stack.truncate(SbMin(b->stack.getLength(), len - 1));
+  b->stack.append(idx);
+
+  int prev;
+  if (b->lastnode.get(entry.node, prev)) tree->entries[prev].nextnode = idx;
+  else tree->nodes.put(entry.node, idx);
+  b->lastnode.put(entry.node, idx);
+
+  const SoType type = entry.node->getTypeId();
+  if (b->lasttype.get(type.getKey(), prev)) tree->entries[prev].nexttype = idx;
+  else {
+    tree->types.put(type.getKey(), idx);
+    tree->typelist.append(type);
+  }
+  b->lasttype.put(type.getKey(), idx);
+
+  if ((b->mode & SEARCHINGALL) && entry.parent >= 0) {
+    const SoNode * parent = tree->entries[entry.parent].node;
+    if ((parent->isOfType(SoSwitch::getClassTypeId()) ||
+         parent->isOfType(SoVRMLSwitch::getClassTypeId())) &&
+        !b->watched.get(entry.node, prev)) {
+      SoNodeSensor * childsensor = new SoNodeSensor(SoSearchIndex::sensorCB, b->index);
+      childsensor->setPriority(0);
+      childsensor->attach(entry.node);
+      tree->sensors.append(childsensor);
+      b->watched.put(entry.node, idx);
+    }
+  }
+  return TRUE;
+}
+
+SoPath *
+SoSearchIndex::createPath(const Tree * tree, const int idx) const
+{
+  SbList<int> indices;
+  for (int i = idx; tree->entries[i].parent >= 0; i = tree->entries[i].parent) {
+    indices.append(tree->entries[i].childindex);
+  }
+  SoPath * path = new SoPath(indices.getLength() + 1);
+  path->setHead(this->root);
+  for (int i = indices.getLength() - 1; i >= 0; i--) path->append(indices[i]);
+  return path;
+}
+
+// *************************************************************************
+
+// Answers the search for action applied to root from the index, if
+// root is indexed. Returns FALSE if the scene graph must be traversed.
+SbBool
+SoSearchIndex::search(SoSearchAction * action, SoNode * root)
+{
+  // the action building an index must traverse, and so must searches
+  // started while building it, since the lock is already held
+  if (SoSearchIndex::getBuilder()) return FALSE;
+
+  CC_MUTEX_LOCK(sosearchindex_mutex);
+  const SbBool found = SoSearchIndex::lookup(action, root);
+  CC_MUTEX_UNLOCK(sosearchindex_mutex);
+  return found;
+}
+
+// Does the work of search(), with the lock held.
+SbBool
+SoSearchIndex::lookup(SoSearchAction * action, SoNode * root)
+{
+  SoSearchIndex * index = NULL;
+  if (!sosearchindex_roots || !sosearchindex_roots->get(root, index)) return FALSE;
+
+  const int lookfor = action->getFind();
+  const SbName name = action->getName();
+  SbBool chkderived;
+  const SoType type = action->getType(chkderived);
+
+  // unnamed nodes are not in the name dictionary
+  if ((lookfor & (SoSearchAction::NODE|SoSearchAction::TYPE|SoSearchAction::NAME)) ==
+      SoSearchAction::NAME && name == SbName::empty()) return FALSE;
+
+  int mode = 0;
+  if (action->isSearchingAll()) mode |= SEARCHINGALL;
+  if (SoBaseKit::isSearchingChildren()) mode |= SEARCHINGKITS;
+  if (SoFile::getSearchOK()) mode |= SEARCHINGFILES;
+  const Tree * tree = index->getTree(mode);
+  if (!tree) return FALSE;
+
+  // collect candidates from the most selective table
+  SbList<int> hits;
+  if (lookfor & SoSearchAction::NODE) {
+    int idx = -1;
+    tree->nodes.get(action->getNode(), idx);
+    for (; idx >= 0; idx = tree->entries[idx].nextnode) hits.append(idx);
+  }
+  else if (lookfor & SoSearchAction::NAME) {
+    SoNodeList named;
+    const int numnamed = SoNode::getByName(name, named);
+    for (int i = 0; i < numnamed; i++) {
+      int idx = -1;
+      tree->nodes.get(named[i], idx);
+      for (; idx >= 0; idx = tree->entries[idx].nextnode) hits.append(idx);
+    }
+  }
+  else if (lookfor & SoSearchAction::TYPE) {
+    for (int i = 0; i < tree->typelist.getLength(); i++) {
+      const SoType t = tree->typelist[i];
+      if (t == type || (chkderived && t.isDerivedFrom(type))) {
+        int idx = -1;
+        tree->types.get(t.getKey(), idx);
+        for (; idx >= 0; idx = tree->entries[idx].nexttype) hits.append(idx);
+      }
+    }
+  }
+  if (hits.getLength() > 1) std::sort(&hits[0], &hits[0] + hits.getLength());
+
+  // check the remaining criteria, like SoNode::search()
+  int numhits = 0;
+  for (int i = 0; i < hits.getLength(); i++) {
+    const SoNode * node = tree->entries[hits[i]].node;
+    if ((lookfor & SoSearchAction::NAME) && node->getName() != name) continue;
+    if ((lookfor & SoSearchAction::TYPE) &&
+        !(node->getTypeId() == type ||
+          (chkderived && node->getTypeId().isDerivedFrom(type)))) continue;
+    hits[numhits++] = hits[i];
+  }
+  hits.truncate(numhits);
+  if (numhits == 0) return TRUE;
+
+  switch (action->getInterest()) {
+  case SoSearchAction::FIRST:
+    action->addPath(index->createPath(tree, hits[0]));
+    break;
+  case SoSearchAction::LAST:
+    action->addPath(index->createPath(tree, hits[numhits - 1]));
+    break;
+  case SoSearchAction::ALL:
+    for (int i = 0; i < numhits; i++) {
+      action->addPath(index->createPath(tree, hits[i]));
+    }
+    break;
+  default:
+    assert(FALSE && "Interest setting is invalid");
+    break;
+  }
+  return TRUE;
+}
@@ -0,0 +1,125 @@
+#ifndef COIN_SOSEARCHINDEX_H
+#define COIN_SOSEARCHINDEX_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SoType.h>
+#include <Inventor/lists/SbList.h>
+
+#include "misc/SbHash.h"
+
+class SoNode;
+class SoNodeSensor;
+class SoPath;
+class SoSearchAction;
+class SoSensor;
+
+// Lookup tables for the nodes below an indexed root, used by
+// SoSearchAction to answer node, type and name queries without
+// traversing the scene graph. See SoSearchAction::setIndexed().
+class SoSearchIndex {
+public:
+  static void initClass(void);
+  static void setIndexed(SoNode * root, const SbBool onoff);
+  static SbBool isIndexed(SoNode * root);
+  static SbBool search(SoSearchAction * action, SoNode * root);
+  static SbBool collect(const SoSearchAction * action, SoPath * path);
+
+private:
+  SoSearchIndex(SoNode * root);
+  ~SoSearchIndex();
+
+  // the nodes found by one search traversal mode, in traversal order
+  class Tree {
+  public:
+    Tree(void) : valid(TRUE) { }
+    ~Tree();
+
+    struct Entry {
+      SoNode * node;
+      int parent;
+      int childindex;
+      int nextnode; // next entry with the same node
+      int nexttype; // next entry with the same type
+    };
+    SbList<Entry> entries;
+    SbHash<const SoNode *, int> nodes;
+    SbHash<int, int> types;
+    SbList<SoType> typelist;
+    // sensors on subgraphs where notifications might not reach the root
+    SbList<SoNodeSensor *> sensors;
+    SbBool valid;
+  };
+
+  enum {
+    SEARCHINGALL = 0x1,
+    SEARCHINGKITS = 0x2,
+    SEARCHINGFILES = 0x4,
+    NUMTREES = 8
+  };
+
+  // state while building a Tree
+  struct Builder {
+    const SoSearchAction * action;
+    SoSearchIndex * index;
+    Tree * tree;
+    int mode;
+    SbList<int> stack;
+    SbHash<const SoNode *, int> lastnode;
+    SbHash<int, int> lasttype;
+    SbHash<const SoNode *, int> watched;
+  };
+  // the Tree being built by the calling thread, if any
+  static Builder * getBuilder(void);
+  static void setBuilder(Builder * builder);
+
+  const Tree * getTree(const int mode);
+  void build(Tree * tree, const int mode);
+  void invalidate(const SbBool traversalonly);
+  SoPath * createPath(const Tree * tree, const int idx) const;
+
+  static SbBool lookup(SoSearchAction * action, SoNode * root);
+  static void sensorCB(void * closure, SoSensor * sensor);
+  static void cleanup(void);
+
+  SoNode * root;
+  SoNodeSensor * sensor;
+  Tree * trees[NUMTREES];
+  SbBool changed;
+};
+
+#endif // !COIN_SOSEARCHINDEX_H
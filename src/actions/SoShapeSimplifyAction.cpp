@@ -30,20 +30,55 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
-// FIXME: this class has not yet been implemented in Coin. this is a
-// placeholder / stub / skeleton code, not yet built (nor installed,
-// obviously).  --mortene.
-
 /*!
   \class SoShapeSimplifyAction SoShapeSimplifyAction.h Inventor/actions/SoShapeSimplifyAction.h
   \brief The SoShapeSimplifyAction class replaces complex primitives
   with simplified polygon representations.
+
+  \ingroup coin_actions
+
+  The action replaces each SoVertexShape node in the scene graph with
+  a level of detail node. The first child of the level of detail node
+  is the original shape, and the other children are SoIndexedFaceSet
+  nodes with simplified versions of the shape, one for each of the
+  simplification levels set with
+  SoSimplifyAction::setSimplificationLevels().
+
+  The shapes are simplified with the quadric error metric, by
+  collapsing the edges that change the surface the least first. The
+  vertices of the simplified shapes are a subset of the original
+  vertices, and the shapes are simplified in parallel. Seams where
+  the normals, texture coordinates or colors change are preserved.
+
+  The scene graph is changed in place. Shapes that are used several
+  times in the scene graph are simplified once, with the traversal
+  state of the first place they are used.
+
+  \since Coin 4.1
 */
 
-#include <Inventor/SbName.h>
 #include <Inventor/actions/SoShapeSimplifyAction.h>
-#include <coindefs.h> // COIN_STUB()
 
+#include <cassert>
+
+#include <Inventor/SbName.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/nodes/SoVertexShape.h>
+
+#include "actions/SoSubActionP.h"
+#include "actions/SoSimplifyMesh.h"
+
+class SoShapeSimplifyActionP {
+public:
+  void simplify(SoShapeSimplifyAction * action, const SoPathList & pathlist,
+                const SbBool obeysrules);
+
+  SoSearchAction sa;
+};
+
+#define PRIVATE(obj) obj->pimpl
 
 SO_ACTION_SOURCE(SoShapeSimplifyAction);
 
@@ -63,7 +98,7 @@ SoShapeSimplifyAction::initClass(void)
 
 SoShapeSimplifyAction::SoShapeSimplifyAction(void)
 {
-  COIN_STUB();
+  SO_ACTION_CONSTRUCTOR(SoShapeSimplifyAction);
 }
 
 /*!
@@ -72,12 +107,150 @@ SoShapeSimplifyAction::SoShapeSimplifyAction(void)
 
 SoShapeSimplifyAction::~SoShapeSimplifyAction(void)
 {
-  COIN_STUB();
+}
+
+/*!
+  Simplifies the shapes below \a root.
+*/
+void
+SoShapeSimplifyAction::apply(SoNode * root)
+{
+  root->ref();
+  SoPathList pathlist;
+  pathlist.append(new SoPath(root));
+  PRIVATE(this)->simplify(this, pathlist, TRUE);
+  pathlist.truncate(0);
+  root->unrefNoDelete();
+}
+
+/*!
+  Simplifies the shapes below the tail of \a path.
+*/
+void
+SoShapeSimplifyAction::apply(SoPath * path)
+{
+  SoPathList pathlist;
+  pathlist.append(path);
+  PRIVATE(this)->simplify(this, pathlist, TRUE);
+}
+
+/*!
+  Simplifies the shapes below the tails of the paths in \a pathlist.
+*/
+void
+SoShapeSimplifyAction::apply(const SoPathList & pathlist, SbBool obeysrules)
+{
+  PRIVATE(this)->simplify(this, pathlist, obeysrules);
 }
 
 // Documented in superclass.
 void
 SoShapeSimplifyAction::beginTraversal(SoNode * /* node */)
 {
-  COIN_STUB();
+  assert(0 && "should never get here");
 }
+
+// *************************************************************************
+
+// Finds the paths to the shapes below the tails of pathlist, and
+// simplifies them. The shape paths are found in traversal order, so
+// they obey the rules if pathlist does.
+void
+SoShapeSimplifyActionP::simplify(SoShapeSimplifyAction * action, const SoPathList & pathlist,
+                                 const SbBool obeysrules)
+{
+  SoPathList shapepaths;
+  this->sa.setType(SoVertexShape::getClassTypeId());
+  this->sa.setSearchingAll(TRUE);
+  this->sa.setInterest(SoSearchAction::ALL);
+  for (int i = 0; i < pathlist.getLength(); i++) {
+    SoPath * path = pathlist[i];
+    this->sa.apply(path->getTail());
+    const SoPathList & found = this->sa.getPaths();
+    for (int j = 0; j < found.getLength(); j++) {
+      // prepend the path to the tail, so the shapes get the state
+      // from the nodes along it
+      SoPath * shapepath = path->copy();
+      shapepath->append(found[j]);
+      shapepaths.append(shapepath);
+    }
+    this->sa.reset();
+  }
+  SoSimplifyMesh::simplifyShapes(action, shapepaths, obeysrules);
+}
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cmath>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoLevelOfDetail.h>
+
+BOOST_AUTO_TEST_CASE(simplifyGrid)
+{
+  const int size = 32;
+  int i, j;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coord = new SoCoordinate3;
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  root->addChild(coord);
+  root->addChild(ifs);
+
+  // a smooth height field
+  coord->point.setNum(size * size);
+  SbVec3f * pts = coord->point.startEditing();
+  for (i = 0; i < size; i++) {
+    for (j = 0; j < size; j++) {
+      pts[i*size+j].setValue(float(j), float(i),
+                             2.0f * float(sin(j * 0.2) * cos(i * 0.2)));
+    }
+  }
+  coord->point.finishEditing();
+
+  ifs->coordIndex.setNum((size-1) * (size-1) * 5);
+  int32_t * idx = ifs->coordIndex.startEditing();
+  for (i = 0; i < size-1; i++) {
+    for (j = 0; j < size-1; j++) {
+      *idx++ = i*size+j;
+      *idx++ = i*size+j+1;
+      *idx++ = (i+1)*size+j+1;
+      *idx++ = (i+1)*size+j;
+      *idx++ = -1;
+    }
+  }
+  ifs->coordIndex.finishEditing();
+
+  const float levels[] = { 1.0f, 0.25f, 0.05f };
+  SoShapeSimplifyAction sa;
+  sa.setSimplificationLevels(3, levels);
+  sa.apply(root);
+
+  BOOST_REQUIRE(root->getChild(1)->isOfType(SoLevelOfDetail::getClassTypeId()));
+  SoLevelOfDetail * lod = static_cast<SoLevelOfDetail *>(root->getChild(1));
+  BOOST_REQUIRE_EQUAL(lod->getNumChildren(), 3);
+  BOOST_CHECK(lod->getChild(0) == ifs);
+
+  const int numtriangles = (size-1) * (size-1) * 2;
+  for (i = 1; i < 3; i++) {
+    BOOST_REQUIRE(lod->getChild(i)->isOfType(SoIndexedFaceSet::getClassTypeId()));
+    const SoIndexedFaceSet * level = static_cast<SoIndexedFaceSet *>(lod->getChild(i));
+    const int num = level->coordIndex.getNum() / 4;
+    BOOST_CHECK_MESSAGE(num <= int(levels[i] * numtriangles),
+                        "level should be simplified to the requested size");
+    BOOST_CHECK(num > 0);
+  }
+  // coarser levels have larger errors, so they are used for smaller
+  // projected areas
+  BOOST_REQUIRE_EQUAL(lod->screenArea.getNum(), 3);
+  BOOST_CHECK(lod->screenArea[0] >= lod->screenArea[1]);
+  BOOST_CHECK(lod->screenArea[1] > lod->screenArea[2]);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -34,19 +34,43 @@
   \class SoSimplifyAction SoSimplifyAction.h Inventor/actions/SoSimplifyAction.h
   \brief The SoSimplifyAction class is the base class for the simplify
   action classes.
+
+  The simplify actions replace complex geometry with levels of detail
+  nodes, where the first child is the original geometry and the other
+  children are simplified versions of it. This class holds the
+  settings for how many levels to generate, and how the level of
+  detail nodes should switch between them.
+
+  \sa SoShapeSimplifyAction, SoGlobalSimplifyAction
 */
 
 #include <Inventor/actions/SoSimplifyAction.h>
 
 #include <Inventor/SbName.h>
+#include <Inventor/lists/SbList.h>
 
 #include "coindefs.h" // COIN_STUB()
 #include "actions/SoSubActionP.h"
 
 class SoSimplifyActionP {
 public:
+  SoSimplifyActionP(void)
+    : mintriangles(20),
+      screenspaceerror(2.0f)
+  {
+    this->levels.append(1.0f);
+    this->levels.append(0.3f);
+    this->levels.append(0.1f);
+  }
+
+  SbList<float> levels;
+  SbList<float> ranges;
+  int mintriangles;
+  float screenspaceerror;
 };
 
+#define PRIVATE(obj) obj->pimpl
+
 SO_ACTION_SOURCE(SoSimplifyAction);
 
 /*!
@@ -99,3 +123,129 @@ SoSimplifyAction::apply(const SoPathList & pathlist, SbBool obeysrules)
 {
   inherited::apply(pathlist, obeysrules);
 }
+
+/*!
+  Sets the simplification levels. Each level is the fraction of the
+  original number of triangles to keep, in decreasing order. A level
+  of 1.0 or more uses the original geometry. The default levels are
+  1.0, 0.3 and 0.1.
+
+  \since Coin 4.1
+*/
+void
+SoSimplifyAction::setSimplificationLevels(const int num, const float levels[])
+{
+  PRIVATE(this)->levels.truncate(0);
+  for (int i = 0; i < num; i++) PRIVATE(this)->levels.append(levels[i]);
+}
+
+/*!
+  Returns the number of simplification levels.
+
+  \since Coin 4.1
+*/
+int
+SoSimplifyAction::getNumSimplificationLevels(void) const
+{
+  return PRIVATE(this)->levels.getLength();
+}
+
+/*!
+  Returns the simplification levels.
+
+  \since Coin 4.1
+*/
+const float *
+SoSimplifyAction::getSimplificationLevels(void) const
+{
+  return PRIVATE(this)->levels.getArrayPtr();
+}
+
+/*!
+  Sets the distances for switching between the simplified
+  levels. When ranges are set, SoLOD nodes with these ranges are
+  created. Otherwise SoLevelOfDetail nodes are created, switching on
+  the projected size of the geometry as set with
+  setScreenSpaceError(). No ranges are set by default.
+
+  \since Coin 4.1
+*/
+void
+SoSimplifyAction::setRanges(const int num, const float ranges[])
+{
+  PRIVATE(this)->ranges.truncate(0);
+  for (int i = 0; i < num; i++) PRIVATE(this)->ranges.append(ranges[i]);
+}
+
+/*!
+  Returns the number of ranges.
+
+  \since Coin 4.1
+*/
+int
+SoSimplifyAction::getNumRanges(void) const
+{
+  return PRIVATE(this)->ranges.getLength();
+}
+
+/*!
+  Returns the ranges.
+
+  \since Coin 4.1
+*/
+const float *
+SoSimplifyAction::getRanges(void) const
+{
+  return PRIVATE(this)->ranges.getArrayPtr();
+}
+
+/*!
+  Sets the minimum number of triangles. Geometry with fewer triangles
+  than this is not simplified, and the simplified levels are not
+  reduced below this number of triangles. The default value is 20.
+
+  \since Coin 4.1
+*/
+void
+SoSimplifyAction::setMinTriangles(const int num)
+{
+  PRIVATE(this)->mintriangles = num;
+}
+
+/*!
+  Returns the minimum number of triangles.
+
+  \since Coin 4.1
+*/
+int
+SoSimplifyAction::getMinTriangles(void) const
+{
+  return PRIVATE(this)->mintriangles;
+}
+
+/*!
+  Sets the largest geometric error, in pixels, that a simplified
+  level may have on the screen. This is used to calculate the
+  SoLevelOfDetail::screenArea values from the errors of the simplified
+  levels. The default value is 2.0.
+
+  \since Coin 4.1
+*/
+void
+SoSimplifyAction::setScreenSpaceError(const float pixels)
+{
+  PRIVATE(this)->screenspaceerror = pixels;
+}
+
+/*!
+  Returns the screen space error.
+
+  \since Coin 4.1
+*/
+float
+SoSimplifyAction::getScreenSpaceError(void) const
+{
+  return PRIVATE(this)->screenspaceerror;
+}
+
+#undef PRIVATE
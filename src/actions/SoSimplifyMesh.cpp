@@ -0,0 +1,823 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// Triangle mesh simplification with the quadric error metric, as
+// described by Garland and Heckbert in "Surface Simplification Using
+// Quadric Error Metrics" (SIGGRAPH 97).
+//
+// Edges are collapsed into one of their end points, so the vertices
+// of the simplified levels are a subset of the original vertices and
+// the normals, texture coordinates and colors can be kept as they
+// are. The vertices (wedges) are welded by position for the
+// simplification, and positions with more than one wedge (on seams
+// between different normals, texture coordinates or colors) are never
+// removed, so seams are preserved. Normals generated by the shapes are
+// not kept, since flat shading would make every position a seam. Border edges get an extra quadric
+// that keeps them in place.
+
+#include "actions/SoSimplifyMesh.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoSimplifyAction.h>
+#include <Inventor/elements/SoMultiTextureEnabledElement.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoLOD.h>
+#include <Inventor/nodes/SoLevelOfDetail.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/nodes/SoVertexShape.h>
+
+#include "threads/parallelp.h"
+#include "misc/SbFNVHash.h"
+
+// *************************************************************************
+
+namespace {
+
+// symmetric 4x4 matrix, stored as the upper triangle
+class Quadric {
+public:
+  Quadric(void) { memset(this->q, 0, sizeof(this->q)); }
+
+  void addPlane(const double a, const double b, const double c, const double d,
+                const double weight) {
+    this->q[0] += weight * a * a;
+    this->q[1] += weight * a * b;
+    this->q[2] += weight * a * c;
+    this->q[3] += weight * a * d;
+    this->q[4] += weight * b * b;
+    this->q[5] += weight * b * c;
+    this->q[6] += weight * b * d;
+    this->q[7] += weight * c * c;
+    this->q[8] += weight * c * d;
+    this->q[9] += weight * d * d;
+  }
+  void add(const Quadric & other) {
+    for (int i = 0; i < 10; i++) this->q[i] += other.q[i];
+  }
+  double evaluate(const SbVec3f & v) const {
+    const double x = v[0], y = v[1], z = v[2];
+    return
+      this->q[0]*x*x + 2.0*this->q[1]*x*y + 2.0*this->q[2]*x*z + 2.0*this->q[3]*x +
+      this->q[4]*y*y + 2.0*this->q[5]*y*z + 2.0*this->q[6]*y +
+      this->q[7]*z*z + 2.0*this->q[8]*z +
+      this->q[9];
+  }
+
+  double q[10];
+};
+
+class Collapse {
+public:
+  double cost;
+  int from;
+  int to;
+  unsigned int fromstamp;
+  unsigned int tostamp;
+
+  // for a min heap with the std heap functions
+  bool operator<(const Collapse & other) const { return this->cost > other.cost; }
+};
+
+const double BORDER_WEIGHT = 10.0;
+
+class Simplifier {
+public:
+  Simplifier(const SbList<SbVec3f> & wedgevertices, const SbList<int32_t> & triangles);
+
+  void simplify(const int target);
+  void getTriangles(SbList<int32_t> & triangles) const;
+  int getNumTriangles(void) const { return this->numalive; }
+  double getMaxCost(void) const { return this->maxcost; }
+
+private:
+  double getCost(const int from, const int to) const;
+  void pushCollapses(const int pos);
+  bool collapse(const int from, const int to);
+  void getTriangles(const int pos, std::vector<int> & tris);
+
+  SbVec3f getPosition(const int tri, const int corner) const {
+    return this->positions[this->wedgepos[this->tris[tri*3+corner]]];
+  }
+
+  std::vector<SbVec3f> positions;
+  std::vector<int> wedgepos;
+  std::vector<bool> locked;
+  std::vector<bool> posalive;
+  std::vector<unsigned int> stamp;
+  std::vector<Quadric> quadrics;
+  std::vector< std::vector<int> > postris;
+
+  std::vector<int32_t> tris;
+  std::vector<bool> trialive;
+  int numalive;
+
+  std::vector<Collapse> heap;
+  double maxcost;
+
+  // scratch lists for collapse()
+  std::vector<int> fromtris;
+  std::vector<int> totris;
+};
+
+class SortVertex {
+public:
+  SortVertex(const SbList<SbVec3f> & v) : vertices(v) { }
+  bool operator()(const int a, const int b) const {
+    const SbVec3f & va = this->vertices[a];
+    const SbVec3f & vb = this->vertices[b];
+    if (va[0] != vb[0]) return va[0] < vb[0];
+    if (va[1] != vb[1]) return va[1] < vb[1];
+    return va[2] < vb[2];
+  }
+  const SbList<SbVec3f> & vertices;
+};
+
+Simplifier::Simplifier(const SbList<SbVec3f> & wedgevertices, const SbList<int32_t> & triangles)
+  : numalive(0), maxcost(0.0)
+{
+  int i, j;
+  const int numwedges = wedgevertices.getLength();
+
+  // weld the wedges by position
+  std::vector<int> order(numwedges);
+  for (i = 0; i < numwedges; i++) order[i] = i;
+  std::sort(order.begin(), order.end(), SortVertex(wedgevertices));
+  this->wedgepos.resize(numwedges);
+  for (i = 0; i < numwedges; i++) {
+    const int w = order[i];
+    if (i == 0 || wedgevertices[order[i-1]] != wedgevertices[w]) {
+      this->positions.push_back(wedgevertices[w]);
+      this->locked.push_back(false);
+    }
+    else {
+      // more than one wedge at this position
+      this->locked.back() = true;
+    }
+    this->wedgepos[w] = static_cast<int>(this->positions.size()) - 1;
+  }
+  const int numpos = static_cast<int>(this->positions.size());
+  this->posalive.resize(numpos, true);
+  this->stamp.resize(numpos, 0);
+  this->quadrics.resize(numpos);
+  this->postris.resize(numpos);
+
+  const int numtris = triangles.getLength() / 3;
+  this->tris.resize(numtris * 3);
+  this->trialive.resize(numtris, false);
+
+  // edges as (min position, max position, triangle), to find borders
+  std::vector< std::pair<std::pair<int, int>, int> > edges;
+  edges.reserve(numtris * 3);
+
+  for (i = 0; i < numtris; i++) {
+    int p[3];
+    for (j = 0; j < 3; j++) {
+      this->tris[i*3+j] = triangles[i*3+j];
+      p[j] = this->wedgepos[triangles[i*3+j]];
+    }
+    if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) continue;
+
+    const SbVec3f & v0 = this->positions[p[0]];
+    SbVec3f n = (this->positions[p[1]] - v0).cross(this->positions[p[2]] - v0);
+    if (n.normalize() == 0.0f) continue;
+
+    this->trialive[i] = true;
+    this->numalive++;
+    const double d = -n.dot(v0);
+    for (j = 0; j < 3; j++) {
+      this->quadrics[p[j]].addPlane(n[0], n[1], n[2], d, 1.0);
+      this->postris[p[j]].push_back(i);
+      const int a = p[j];
+      const int b = p[(j+1)%3];
+      edges.push_back(std::make_pair(std::make_pair(SbMin(a, b), SbMax(a, b)), i));
+    }
+  }
+
+  // add a plane perpendicular to the triangle for each border edge
+  std::sort(edges.begin(), edges.end());
+  const int numedges = static_cast<int>(edges.size());
+  for (i = 0; i < numedges; i++) {
+    if ((i > 0 && edges[i-1].first == edges[i].first) ||
+        (i < numedges-1 && edges[i+1].first == edges[i].first)) continue;
+
+    const int a = edges[i].first.first;
+    const int b = edges[i].first.second;
+    const int t = edges[i].second;
+    const SbVec3f v0 = this->getPosition(t, 0);
+    const SbVec3f n = (this->getPosition(t, 1) - v0).cross(this->getPosition(t, 2) - v0);
+    SbVec3f bn = (this->positions[b] - this->positions[a]).cross(n);
+    if (bn.normalize() == 0.0f) continue;
+    const double d = -bn.dot(this->positions[a]);
+    this->quadrics[a].addPlane(bn[0], bn[1], bn[2], d, BORDER_WEIGHT);
+    this->quadrics[b].addPlane(bn[0], bn[1], bn[2], d, BORDER_WEIGHT);
+  }
+
+  for (i = 0; i < numpos; i++) this->pushCollapses(i);
+}
+
+double
+Simplifier::getCost(const int from, const int to) const
+{
+  Quadric q = this->quadrics[from];
+  q.add(this->quadrics[to]);
+  return SbMax(q.evaluate(this->positions[to]), 0.0);
+}
+
+void
+Simplifier::pushCollapses(const int pos)
+{
+  const std::vector<int> & list = this->postris[pos];
+  for (size_t i = 0; i < list.size(); i++) {
+    const int t = list[i];
+    if (!this->trialive[t]) continue;
+    for (int j = 0; j < 3; j++) {
+      const int other = this->wedgepos[this->tris[t*3+j]];
+      if (other == pos) continue;
+      // push both directions, locked positions can only be targets
+      for (int k = 0; k < 2; k++) {
+        const int from = k ? other : pos;
+        const int to = k ? pos : other;
+        if (this->locked[from]) continue;
+        Collapse c;
+        c.cost = this->getCost(from, to);
+        c.from = from;
+        c.to = to;
+        c.fromstamp = this->stamp[from];
+        c.tostamp = this->stamp[to];
+        this->heap.push_back(c);
+        std::push_heap(this->heap.begin(), this->heap.end());
+      }
+    }
+  }
+}
+
+// Returns the alive triangles around pos, and removes dead triangles
+// from the list.
+void
+Simplifier::getTriangles(const int pos, std::vector<int> & result)
+{
+  result.clear();
+  std::vector<int> & list = this->postris[pos];
+  size_t n = 0;
+  for (size_t i = 0; i < list.size(); i++) {
+    const int t = list[i];
+    if (!this->trialive[t]) continue;
+    if (std::find(result.begin(), result.end(), t) != result.end()) continue;
+    result.push_back(t);
+    list[n++] = t;
+  }
+  list.resize(n);
+}
+
+bool
+Simplifier::collapse(const int from, const int to)
+{
+  size_t i;
+  int j;
+  this->getTriangles(from, this->fromtris);
+  this->getTriangles(to, this->totris);
+
+  // the triangles shared by the edge are removed, and the wedge of
+  // the target position in those triangles replaces the wedge of the
+  // removed position
+  int numshared = 0;
+  int towedge = -1;
+  for (i = 0; i < this->fromtris.size(); i++) {
+    const int t = this->fromtris[i];
+    for (j = 0; j < 3; j++) {
+      const int w = this->tris[t*3+j];
+      if (this->wedgepos[w] != to) continue;
+      if (towedge >= 0 && towedge != w) return false;
+      towedge = w;
+      numshared++;
+    }
+  }
+  if (numshared == 0) return false;
+
+  // the positions connected to both end points must be the ones
+  // opposite the edge, or the collapse makes the mesh non-manifold
+  int numcommon = 0;
+  for (i = 0; i < this->fromtris.size(); i++) {
+    const int t = this->fromtris[i];
+    for (j = 0; j < 3; j++) {
+      const int p = this->wedgepos[this->tris[t*3+j]];
+      if (p == from || p == to) continue;
+      bool counted = false;
+      for (size_t k = 0; k < i && !counted; k++) {
+        const int t2 = this->fromtris[k];
+        for (int l = 0; l < 3; l++) {
+          if (this->wedgepos[this->tris[t2*3+l]] == p) counted = true;
+        }
+      }
+      for (int l = 0; l < j && !counted; l++) {
+        if (this->wedgepos[this->tris[t*3+l]] == p) counted = true;
+      }
+      if (counted) continue;
+      for (size_t k = 0; k < this->totris.size(); k++) {
+        const int t2 = this->totris[k];
+        if (this->wedgepos[this->tris[t2*3]] == p ||
+            this->wedgepos[this->tris[t2*3+1]] == p ||
+            this->wedgepos[this->tris[t2*3+2]] == p) {
+          numcommon++;
+          break;
+        }
+      }
+    }
+  }
+  if (numcommon > numshared) return false;
+
+  // the remaining triangles must not flip or degenerate
+  const SbVec3f & target = this->positions[to];
+  for (i = 0; i < this->fromtris.size(); i++) {
+    const int t = this->fromtris[i];
+    SbVec3f v[3];
+    bool shared = false;
+    for (j = 0; j < 3; j++) {
+      v[j] = this->getPosition(t, j);
+      if (this->wedgepos[this->tris[t*3+j]] == to) shared = true;
+    }
+    if (shared) continue;
+    const SbVec3f n0 = (v[1] - v[0]).cross(v[2] - v[0]);
+    for (j = 0; j < 3; j++) {
+      if (this->wedgepos[this->tris[t*3+j]] == from) v[j] = target;
+    }
+    const SbVec3f n1 = (v[1] - v[0]).cross(v[2] - v[0]);
+    const float len0 = n0.length();
+    const float len1 = n1.length();
+    if (len1 <= len0 * 1.0e-4f) return false;
+    if (n0.dot(n1) < 0.2f * len0 * len1) return false;
+  }
+
+  // commit
+  for (i = 0; i < this->fromtris.size(); i++) {
+    const int t = this->fromtris[i];
+    bool shared = false;
+    for (j = 0; j < 3; j++) {
+      if (this->wedgepos[this->tris[t*3+j]] == to) shared = true;
+    }
+    if (shared) {
+      this->trialive[t] = false;
+      this->numalive--;
+      continue;
+    }
+    for (j = 0; j < 3; j++) {
+      if (this->wedgepos[this->tris[t*3+j]] == from) this->tris[t*3+j] = towedge;
+    }
+    this->postris[to].push_back(t);
+  }
+  this->quadrics[to].add(this->quadrics[from]);
+  this->posalive[from] = false;
+  this->postris[from].clear();
+  this->stamp[to]++;
+  this->pushCollapses(to);
+  return true;
+}
+
+void
+Simplifier::simplify(const int target)
+{
+  while (this->numalive > target && !this->heap.empty()) {
+    std::pop_heap(this->heap.begin(), this->heap.end());
+    const Collapse c = this->heap.back();
+    this->heap.pop_back();
+
+    if (!this->posalive[c.from] || !this->posalive[c.to] ||
+        this->stamp[c.from] != c.fromstamp ||
+        this->stamp[c.to] != c.tostamp) continue;
+
+    if (this->collapse(c.from, c.to)) {
+      this->maxcost = SbMax(this->maxcost, c.cost);
+    }
+  }
+}
+
+void
+Simplifier::getTriangles(SbList<int32_t> & triangles) const
+{
+  const int numtris = static_cast<int>(this->trialive.size());
+  for (int i = 0; i < numtris; i++) {
+    if (!this->trialive[i]) continue;
+    for (int j = 0; j < 3; j++) triangles.append(this->tris[i*3+j]);
+  }
+}
+
+} // anonymous namespace
+
+// *************************************************************************
+
+SoSimplifyMesh::SoSimplifyMesh(void)
+  : hasnormals(TRUE),
+    hastexcoords(FALSE),
+    hascolors(FALSE)
+{
+}
+
+SoSimplifyMesh::~SoSimplifyMesh()
+{
+  for (int i = 0; i < this->levels.getLength(); i++) {
+    delete this->levels[i];
+  }
+}
+
+SoSimplifyMesh::Wedge::operator unsigned long(void) const
+{
+  SbFNVHash hash;
+  hash.add(this->vertex.getValue(), 3);
+  hash.add(this->normal.getValue(), 3);
+  hash.add(this->texcoord.getValue(), 2);
+  hash.add(this->rgba);
+  return hash.getValue();
+}
+
+int
+SoSimplifyMesh::Wedge::operator==(const Wedge & w) const
+{
+  return
+    (this->vertex == w.vertex) &&
+    (this->normal == w.normal) &&
+    (this->texcoord == w.texcoord) &&
+    (this->rgba == w.rgba);
+}
+
+int32_t
+SoSimplifyMesh::addWedge(SoCallbackAction * action, const SoPrimitiveVertex * v)
+{
+  Wedge w;
+  w.vertex = v->getPoint();
+  w.normal.setValue(0.0f, 0.0f, 0.0f);
+  if (this->hasnormals) w.normal = v->getNormal();
+  w.texcoord.setValue(0.0f, 0.0f);
+  if (this->hastexcoords) {
+    const SbVec4f & tc = v->getTextureCoords();
+    w.texcoord.setValue(tc[0], tc[1]);
+  }
+  SbColor ambient, diffuse, specular, emissive;
+  float shininess, transparency;
+  action->getMaterial(ambient, diffuse, specular, emissive, shininess, transparency,
+                      v->getMaterialIndex());
+  w.rgba = diffuse.getPackedValue(transparency);
+  if (v->getMaterialIndex() != 0) this->hascolors = TRUE;
+
+  int32_t idx;
+  if (this->wedgehash.get(w, idx)) return idx;
+  idx = this->wedges.getLength();
+  this->wedges.append(w);
+  this->wedgehash.put(w, idx);
+  this->bbox.extendBy(w.vertex);
+  return idx;
+}
+
+void
+SoSimplifyMesh::addTriangle(SoCallbackAction * action,
+                            const SoPrimitiveVertex * v1,
+                            const SoPrimitiveVertex * v2,
+                            const SoPrimitiveVertex * v3)
+{
+  this->triangles.append(this->addWedge(action, v1));
+  this->triangles.append(this->addWedge(action, v2));
+  this->triangles.append(this->addWedge(action, v3));
+}
+
+int
+SoSimplifyMesh::getNumTriangles(void) const
+{
+  return this->triangles.getLength() / 3;
+}
+
+// Simplifies the mesh into a level for each of levels that is less
+// than 1.0, as a fraction of the original number of triangles. Does
+// not touch any scene graph data, so it can be called from any
+// thread.
+void
+SoSimplifyMesh::simplify(const int numlevels, const float * levelfractions, const int mintriangles)
+{
+  this->wedgehash.clear();
+
+  const int numtriangles = this->getNumTriangles();
+  SbList<SbVec3f> vertices(this->wedges.getLength());
+  for (int i = 0; i < this->wedges.getLength(); i++) {
+    vertices.append(this->wedges[i].vertex);
+  }
+  Simplifier simplifier(vertices, this->triangles);
+
+  int prevnum = numtriangles;
+  for (int i = 0; i < numlevels; i++) {
+    if (levelfractions[i] >= 1.0f) continue;
+    const int target = SbMax(mintriangles, int(levelfractions[i] * float(numtriangles)));
+    if (target >= prevnum) continue;
+
+    simplifier.simplify(target);
+    // stop when the mesh cannot be simplified any further
+    if (simplifier.getNumTriangles() >= prevnum) break;
+    prevnum = simplifier.getNumTriangles();
+
+    Level * level = new Level;
+    simplifier.getTriangles(level->triangles);
+    level->error = float(sqrt(simplifier.getMaxCost()));
+    this->levels.append(level);
+  }
+}
+
+// Creates a level of detail node with original as the first child,
+// followed by the simplified levels. Returns NULL if there are no
+// simplified levels.
+SoGroup *
+SoSimplifyMesh::createLOD(const SoSimplifyAction * action, SoNode * original) const
+{
+  const int numlevels = this->levels.getLength();
+  if (numlevels == 0) return NULL;
+
+  SoGroup * lod;
+  if (action->getNumRanges() > 0) {
+    SoLOD * distancelod = new SoLOD;
+    distancelod->center = this->bbox.getCenter();
+    distancelod->range.setValues(0, SbMin(action->getNumRanges(), numlevels),
+                                 action->getRanges());
+    lod = distancelod;
+  }
+  else {
+    // switch to a level when its error projects to less than the
+    // screen space error, assuming that the largest dimension of
+    // the bounding box is about the square root of the projected area
+    float dx, dy, dz;
+    this->bbox.getSize(dx, dy, dz);
+    const float size = SbMax(dx, SbMax(dy, dz));
+    const float tolerance = action->getScreenSpaceError();
+    SoLevelOfDetail * arealod = new SoLevelOfDetail;
+    arealod->screenArea.setNum(numlevels + 1);
+    float * areas = arealod->screenArea.startEditing();
+    for (int i = 0; i < numlevels; i++) {
+      const float error = SbMax(this->levels[i]->error, size * 1.0e-6f);
+      const float side = tolerance * size / error;
+      areas[i] = SbMin(side * side, FLT_MAX);
+    }
+    areas[numlevels] = 0.0f;
+    arealod->screenArea.finishEditing();
+    lod = arealod;
+  }
+  lod->addChild(original);
+
+  SbList<int32_t> wedgemap(this->wedges.getLength());
+  for (int i = 0; i < numlevels; i++) {
+    const SbList<int32_t> & tris = this->levels[i]->triangles;
+    const int numtris = tris.getLength() / 3;
+
+    // only the wedges used by this level
+    int j;
+    wedgemap.truncate(0);
+    for (j = 0; j < this->wedges.getLength(); j++) wedgemap.append(-1);
+    int numused = 0;
+    for (j = 0; j < tris.getLength(); j++) {
+      if (wedgemap[tris[j]] < 0) wedgemap[tris[j]] = numused++;
+    }
+
+    SoVertexProperty * vp = new SoVertexProperty;
+    vp->vertex.setNum(numused);
+    SbVec3f * vertex = vp->vertex.startEditing();
+    SbVec3f * normal = NULL;
+    SbVec2f * texcoord = NULL;
+    uint32_t * rgba = NULL;
+    if (this->hasnormals) {
+      vp->normal.setNum(numused);
+      normal = vp->normal.startEditing();
+      vp->normalBinding = SoVertexProperty::PER_VERTEX_INDEXED;
+    }
+    if (this->hastexcoords) {
+      vp->texCoord.setNum(numused);
+      texcoord = vp->texCoord.startEditing();
+    }
+    if (this->hascolors) {
+      vp->orderedRGBA.setNum(numused);
+      rgba = vp->orderedRGBA.startEditing();
+      vp->materialBinding = SoVertexProperty::PER_VERTEX_INDEXED;
+    }
+    for (j = 0; j < this->wedges.getLength(); j++) {
+      const int32_t idx = wedgemap[j];
+      if (idx < 0) continue;
+      const Wedge & w = this->wedges[j];
+      vertex[idx] = w.vertex;
+      if (normal) normal[idx] = w.normal;
+      if (texcoord) texcoord[idx] = w.texcoord;
+      if (rgba) rgba[idx] = w.rgba;
+    }
+    vp->vertex.finishEditing();
+    if (normal) vp->normal.finishEditing();
+    if (texcoord) vp->texCoord.finishEditing();
+    if (rgba) vp->orderedRGBA.finishEditing();
+
+    SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+    ifs->vertexProperty = vp;
+    ifs->coordIndex.setNum(numtris * 4);
+    int32_t * idx = ifs->coordIndex.startEditing();
+    for (j = 0; j < numtris; j++) {
+      *idx++ = wedgemap[tris[j*3]];
+      *idx++ = wedgemap[tris[j*3+1]];
+      *idx++ = wedgemap[tris[j*3+2]];
+      *idx++ = -1;
+    }
+    ifs->coordIndex.finishEditing();
+    lod->addChild(ifs);
+  }
+  return lod;
+}
+
+// *************************************************************************
+
+// Collects the triangles of the shapes at the tails of the paths,
+// simplifies them in parallel, and replaces each shape with a level
+// of detail node.
+class SoSimplifyMeshShapes {
+public:
+  SoSimplifyMeshShapes(void)
+    : cbaction(SbViewportRegion(640, 480)), keepnormals(TRUE), current(NULL) { }
+  ~SoSimplifyMeshShapes() {
+    for (int i = 0; i < this->meshes.getLength(); i++) {
+      this->shapes[i]->unref();
+      delete this->meshes[i];
+    }
+  }
+
+  const SoSimplifyAction * action;
+  SoCallbackAction cbaction;
+  SbBool keepnormals;
+  SbList<SoNode *> shapes;
+  SbList<SoSimplifyMesh *> meshes;
+  SbHash<const SoNode *, int> shapeidx;
+  SoSimplifyMesh * current;
+
+  static SoCallbackAction::Response pre_shape_cb(void * closure,
+                                                 SoCallbackAction * action,
+                                                 const SoNode * node);
+  static SoCallbackAction::Response post_shape_cb(void * closure,
+                                                  SoCallbackAction * action,
+                                                  const SoNode * node);
+  static void triangle_cb(void * userdata, SoCallbackAction * action,
+                          const SoPrimitiveVertex * v1,
+                          const SoPrimitiveVertex * v2,
+                          const SoPrimitiveVertex * v3);
+  static void simplify_cb(void * closure, int begin, int end);
+};
+
+SoCallbackAction::Response
+SoSimplifyMeshShapes::pre_shape_cb(void * closure, SoCallbackAction * action, const SoNode * node)
+{
+  SoSimplifyMeshShapes * thisp = static_cast<SoSimplifyMeshShapes *>(closure);
+  int idx;
+  // shapes used several times are only simplified once
+  if (thisp->shapeidx.get(node, idx)) return SoCallbackAction::PRUNE;
+
+  thisp->current = new SoSimplifyMesh;
+  // generated normals are not kept, so the simplified shapes
+  // generate their own normals with the same crease angle
+  const SoNode * vp =
+    static_cast<const SoVertexShape *>(node)->vertexProperty.getValue();
+  thisp->current->hasnormals = thisp->keepnormals &&
+    (action->getNumNormals() > 0 ||
+    (vp && vp->isOfType(SoVertexProperty::getClassTypeId()) &&
+     static_cast<const SoVertexProperty *>(vp)->normal.getNum() > 0));
+  thisp->current->hastexcoords =
+    SoMultiTextureEnabledElement::get(action->getState(), 0);
+  thisp->shapeidx.put(node, thisp->meshes.getLength());
+  thisp->meshes.append(thisp->current);
+  SoNode * shape = const_cast<SoNode *>(node);
+  shape->ref();
+  thisp->shapes.append(shape);
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+SoSimplifyMeshShapes::post_shape_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG(action),
+                                    const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoSimplifyMeshShapes * thisp = static_cast<SoSimplifyMeshShapes *>(closure);
+  thisp->current = NULL;
+  return SoCallbackAction::CONTINUE;
+}
+
+void
+SoSimplifyMeshShapes::triangle_cb(void * userdata, SoCallbackAction * action,
+                                  const SoPrimitiveVertex * v1,
+                                  const SoPrimitiveVertex * v2,
+                                  const SoPrimitiveVertex * v3)
+{
+  SoSimplifyMeshShapes * thisp = static_cast<SoSimplifyMeshShapes *>(userdata);
+  if (thisp->current) thisp->current->addTriangle(action, v1, v2, v3);
+}
+
+void
+SoSimplifyMeshShapes::simplify_cb(void * closure, int begin, int end)
+{
+  SoSimplifyMeshShapes * thisp = static_cast<SoSimplifyMeshShapes *>(closure);
+  const SoSimplifyAction * action = thisp->action;
+  for (int i = begin; i < end; i++) {
+    SoSimplifyMesh * mesh = thisp->meshes[i];
+    if (mesh->getNumTriangles() < action->getMinTriangles()) continue;
+    mesh->simplify(action->getNumSimplificationLevels(),
+                   action->getSimplificationLevels(),
+                   action->getMinTriangles());
+  }
+}
+
+// Replaces the SoVertexShape nodes at the tails of paths with level
+// of detail nodes with simplified versions of the shapes. The paths
+// are traversed with obeysrules as for SoAction::apply(). If
+// keepnormals is FALSE, the simplified shapes always generate their
+// own normals.
+void
+SoSimplifyMesh::simplifyShapes(const SoSimplifyAction * action, const SoPathList & paths,
+                               const SbBool obeysrules, const SbBool keepnormals)
+{
+  int i;
+  SoSimplifyMeshShapes data;
+  data.action = action;
+  data.keepnormals = keepnormals;
+
+  SoPathList shapepaths;
+  for (i = 0; i < paths.getLength(); i++) {
+    const SoFullPath * path = static_cast<const SoFullPath *>(paths[i]);
+    if (path->getLength() >= 2 &&
+        path->getTail()->isOfType(SoVertexShape::getClassTypeId()) &&
+        path->getNodeFromTail(1)->isOfType(SoGroup::getClassTypeId())) {
+      shapepaths.append(paths[i]);
+    }
+  }
+  if (shapepaths.getLength() == 0) return;
+
+  data.cbaction.addPreCallback(SoVertexShape::getClassTypeId(),
+                               SoSimplifyMeshShapes::pre_shape_cb, &data);
+  data.cbaction.addPostCallback(SoVertexShape::getClassTypeId(),
+                                SoSimplifyMeshShapes::post_shape_cb, &data);
+  data.cbaction.addTriangleCallback(SoVertexShape::getClassTypeId(),
+                                    SoSimplifyMeshShapes::triangle_cb, &data);
+  data.cbaction.apply(shapepaths, obeysrules);
+
+  cc_parallel_for(data.meshes.getLength(), 1, SoSimplifyMeshShapes::simplify_cb, &data);
+
+  SbList<SoGroup *> lods(data.meshes.getLength());
+  for (i = 0; i < data.meshes.getLength(); i++) {
+    SoGroup * lod = data.meshes[i]->createLOD(action, data.shapes[i]);
+    if (lod) lod->ref();
+    lods.append(lod);
+  }
+
+  for (i = 0; i < shapepaths.getLength(); i++) {
+    SoFullPath * path = static_cast<SoFullPath *>(shapepaths[i]);
+    SoNode * shape = path->getTail();
+    int idx;
+    if (!data.shapeidx.get(shape, idx) || lods[idx] == NULL) continue;
+    // the path is no longer valid if an earlier replacement changed it
+    SoGroup * parent = static_cast<SoGroup *>(path->getNodeFromTail(1));
+    const int childidx = path->getIndexFromTail(0);
+    if (parent->getChild(childidx) != shape) continue;
+    parent->replaceChild(childidx, lods[idx]);
+  }
+
+  for (i = 0; i < lods.getLength(); i++) {
+    if (lods[i]) lods[i]->unref();
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef COIN_SOSIMPLIFYMESH_H
+#define COIN_SOSIMPLIFYMESH_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+#include "misc/SbHash.h"
+
+class SoCallbackAction;
+class SoGroup;
+class SoNode;
+class SoPathList;
+class SoPrimitiveVertex;
+class SoSimplifyAction;
+
+// A triangle mesh which is simplified into several levels of detail
+// with quadric error metric edge collapses. Used by the simplify
+// actions.
+class SoSimplifyMesh {
+public:
+  SoSimplifyMesh(void);
+  ~SoSimplifyMesh();
+
+  void addTriangle(SoCallbackAction * action,
+                   const SoPrimitiveVertex * v1,
+                   const SoPrimitiveVertex * v2,
+                   const SoPrimitiveVertex * v3);
+  int getNumTriangles(void) const;
+
+  void simplify(const int numlevels, const float * levels, const int mintriangles);
+  SoGroup * createLOD(const SoSimplifyAction * action, SoNode * original) const;
+
+  static void simplifyShapes(const SoSimplifyAction * action, const SoPathList & paths,
+                             const SbBool obeysrules, const SbBool keepnormals = TRUE);
+
+  SbBool hasnormals;
+  SbBool hastexcoords;
+
+private:
+  class Wedge {
+  public:
+    SbVec3f vertex;
+    SbVec3f normal;
+    SbVec2f texcoord;
+    uint32_t rgba;
+
+    // needed for SbHash
+    operator unsigned long(void) const;
+    int operator==(const Wedge & w) const;
+  };
+
+  // a level is the remaining triangles, as wedge indices, and the
+  // largest error of the collapses done to get there
+  class Level {
+  public:
+    SbList<int32_t> triangles;
+    float error;
+  };
+
+  int32_t addWedge(SoCallbackAction * action, const SoPrimitiveVertex * v);
+
+  SbList<Wedge> wedges;
+  SbList<int32_t> triangles;
+  SbHash<Wedge, int32_t> wedgehash;
+  SbBool hascolors;
+  SbBox3f bbox;
+  SbList<Level *> levels;
+};
+
+#endif // !COIN_SOSIMPLIFYMESH_H
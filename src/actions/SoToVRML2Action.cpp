@@ -130,7 +130,6 @@
 #include "config.h"
 #endif // HAVE_CONFIG_H
 
-#include <Inventor/SbBSPTree.h>
 #include <Inventor/SbName.h>
 #include <Inventor/SbViewportRegion.h>
 #include <Inventor/SoInput.h>
@@ -160,11 +159,21 @@
 #include "SbBasicP.h"
 #include "actions/SoSubActionP.h"
 #include "misc/SbHash.h"
+#include "base/SbSpatialHash.h"
+#include "threads/parallelp.h"
 
 // default values for cases where a viewport is needed
 #define DEFAULT_VIEWPORT_WIDTH 1024
 #define DEFAULT_VIEWPORT_HEIGHT 768
 
+// the number of unshared triangle corners collected for a shape
+// before they are welded
+#define TOVRML2_WELD_BATCH (3 * 8192)
+
+// the minimum number of corners for welding the coordinates, normals
+// and texture coordinates in parallel
+#define TOVRML2_PARALLEL_WELD_MIN 3072
+
 
 // *************************************************************************
 
@@ -320,17 +329,14 @@ public:
 
   void init(void)
   {
-    this->bsptree = NULL;
-    this->bsptreetex = NULL;
-    this->bsptreenormal = NULL;
+    this->coordhash = NULL;
     this->coordidx = NULL;
-    this->normalidx = NULL;
-    this->texidx = NULL;
     this->coloridx = NULL;
 
     recentTex2 = NULL;
     do_post_primitives = FALSE;
     didpush = FALSE;
+    this->shape = NULL;
 
     delete this->vrmlcoords;
     delete this->vrmlnormals;
@@ -389,12 +395,8 @@ public:
   SoSearchAction searchaction;
   SbList <SoVRMLGroup*> separatorstack;
 
-  SbBSPTree * bsptree;
-  SbBSPTree * bsptreetex;
-  SbBSPTree * bsptreenormal;
+  SbSpatialHash * coordhash;
   SbList <int32_t> * coordidx;
-  SbList <int32_t> * normalidx;
-  SbList <int32_t> * texidx;
   SbList <int32_t> * coloridx;
   SoGetBoundingBoxAction * bboxaction;
 
@@ -402,6 +404,31 @@ public:
   SbBool do_post_primitives;
   SbBool didpush;
 
+  // The triangles collected for one shape converted via the triangle
+  // callback. The corners are stored unshared while traversing, and
+  // welded by weldCorners() into the arrays and index lists of the
+  // SoVRMLIndexedFaceSet each time TOVRML2_WELD_BATCH corners have
+  // been collected, and when the shape is finished.
+  class ShapeData {
+  public:
+    SbBool hastexture;
+    SbList <SbVec3f> points;
+    SbList <SbVec3f> normals;
+    SbList <SbVec3f> texcoords;
+
+    SbSpatialHash coordhash;
+    SbSpatialHash normalhash;
+    SbSpatialHash texhash;
+    SbList <int32_t> coordidx;
+    SbList <int32_t> normalidx;
+    SbList <int32_t> texidx;
+  };
+
+  ShapeData * shape;
+
+  static void weldCorners(ShapeData * shape);
+  static void weld_corners_cb(void * closure, int begin, int end);
+
   static SoCallbackAction::Response unsupported_cb(void *, SoCallbackAction *, const SoNode *);
 
   SoFullPath * vrml2path;
@@ -1491,7 +1518,7 @@ SoToVRML2ActionP::soils_cb(void * closure, SoCallbackAction * action, const SoNo
   }
 
   if (thisp->nodefuse && coordElem->getNum() > 0) {
-    SbBSPTree bsp;
+    SbSpatialHash bsp;
     int n = oldils->coordIndex.getNum();
     const int32_t * src = oldils->coordIndex.getValues(0);
 
@@ -1537,7 +1564,7 @@ SoToVRML2ActionP::soils_cb(void * closure, SoCallbackAction * action, const SoNo
 
     // Color per segment, convert to per vertex
     SbList <int32_t> coordIdx;
-    SbBSPTree bsp;
+    SbSpatialHash bsp;
     int32_t colidx = 0;
     SoVRMLColor * color = coin_assert_cast<SoVRMLColor *>(ils->color.getValue());
     int n = ils->coordIndex.getNum()-1;
@@ -1669,7 +1696,7 @@ SoToVRML2ActionP::solineset_cb(void * closure, SoCallbackAction * action, const
   if (action->getMaterialBinding() == SoMaterialBinding::PER_PART) {
     // Color per segment, convert to per vertex
     SbList <int32_t> coordIdx;
-    SbBSPTree bsp;
+    SbSpatialHash bsp;
     int32_t colidx = 0;
     SoVRMLColor * color = coin_assert_cast<SoVRMLColor *>(ils->color.getValue());
     int n = ils->coordIndex.getNum()-1;
@@ -1997,7 +2024,7 @@ SoToVRML2ActionP::sotoils_cb(void * closure, SoCallbackAction * action, const So
       thisp->didpush = TRUE;
     }
   }
-  thisp->bsptree = new SbBSPTree;
+  thisp->coordhash = new SbSpatialHash;
 
   thisp->coordidx = new SbList <int32_t>;
 
@@ -2019,12 +2046,12 @@ SoToVRML2ActionP::linesegment_cb(void * closure, SoCallbackAction * COIN_UNUSED_
                              const SoPrimitiveVertex * v2)
 {
   SoToVRML2ActionP * thisp = THISP(closure);
-  assert(thisp->bsptree);
+  assert(thisp->coordhash);
 
   SoPrimitiveVertex const * const arr[2] = {v1, v2};
   for (int i = 0; i < 2; i++) {
     const SoPrimitiveVertex * v = arr[i];
-    thisp->coordidx->append(thisp->bsptree->addPoint(v->getPoint()));
+    thisp->coordidx->append(thisp->coordhash->addPoint(v->getPoint()));
     if (thisp->coloridx) thisp->coloridx->append(v->getMaterialIndex());
   }
   thisp->coordidx->append(-1);
@@ -2043,13 +2070,13 @@ SoToVRML2ActionP::post_lines_cb(void * closure, SoCallbackAction * action, const
     SoVRMLPointSet * ps = NEW_NODE(SoVRMLPointSet, node);
     is = ps;
 
-    ps->coord = thisp->get_or_create_coordinate(thisp->bsptree->getPointsArrayPtr(),
-      thisp->bsptree->numPoints());
+    ps->coord = thisp->get_or_create_coordinate(thisp->coordhash->getPointsArrayPtr(),
+      thisp->coordhash->numPoints());
 
     if ( thisp->coloridx ) {
       // Copy the colors from the state
       SoLazyElement * colorElem = SoLazyElement::getInstance(action->getState());
-      if ( colorElem->getNumDiffuse() == thisp->bsptree->numPoints() ) {
+      if ( colorElem->getNumDiffuse() == thisp->coordhash->numPoints() ) {
         if ( colorElem->isPacked() ) {
           ps->color = thisp->get_or_create_color(colorElem->getPackedPointer(),
             colorElem->getNumDiffuse());
@@ -2066,8 +2093,8 @@ SoToVRML2ActionP::post_lines_cb(void * closure, SoCallbackAction * action, const
     SoVRMLIndexedLineSet * ils = NEW_NODE(SoVRMLIndexedLineSet, node);
     is = ils;
 
-    ils->coord = thisp->get_or_create_coordinate(thisp->bsptree->getPointsArrayPtr(),
-      thisp->bsptree->numPoints());
+    ils->coord = thisp->get_or_create_coordinate(thisp->coordhash->getPointsArrayPtr(),
+      thisp->coordhash->numPoints());
 
     if ( thisp->coloridx ) {
       // Copy the colors from the state
@@ -2090,13 +2117,9 @@ SoToVRML2ActionP::post_lines_cb(void * closure, SoCallbackAction * action, const
       thisp->coordidx->getArrayPtr());
   }
 
-  delete thisp->bsptree; thisp->bsptree = NULL;
-  delete thisp->bsptreetex; thisp->bsptreetex = NULL;
-  delete thisp->bsptreenormal; thisp->bsptreenormal = NULL;
+  delete thisp->coordhash; thisp->coordhash = NULL;
 
   delete thisp->coordidx; thisp->coordidx = NULL;
-  delete thisp->normalidx; thisp->normalidx = NULL;
-  delete thisp->texidx; thisp->texidx = NULL;
   delete thisp->coloridx; thisp->coloridx = NULL;
 
   thisp->insert_shape(action, is);
@@ -2124,11 +2147,7 @@ SoToVRML2ActionP::sotoifs_cb(void * closure, SoCallbackAction * action, const So
       thisp->didpush = TRUE;
     }
   }
-  thisp->bsptree = new SbBSPTree;
-  thisp->bsptreenormal = new SbBSPTree;
-
-  thisp->coordidx = new SbList <int32_t>;
-  thisp->normalidx = new SbList <int32_t>;
+  thisp->shape = new ShapeData;
 
   if (action->getMaterialBinding() != SoMaterialBinding::OVERALL) {
     const SoLazyElement * colorElem = SoLazyElement::getInstance(action->getState());
@@ -2139,10 +2158,7 @@ SoToVRML2ActionP::sotoifs_cb(void * closure, SoCallbackAction * action, const So
 
   thisp->recentTex2 =
     coin_safe_cast<SoTexture2 *>(thisp->search_for_recent_node(action, SoTexture2::getClassTypeId()));
-  if (thisp->recentTex2) {
-    thisp->bsptreetex = new SbBSPTree;
-    thisp->texidx = new SbList <int32_t>;
-  }
+  thisp->shape->hastexture = thisp->recentTex2 != NULL;
 
   thisp->do_post_primitives = TRUE;
 
@@ -2156,25 +2172,85 @@ SoToVRML2ActionP::triangle_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG
                              const SoPrimitiveVertex * v3)
 {
   SoToVRML2ActionP * thisp = THISP(closure);
-  assert(thisp->bsptree);
-  assert(thisp->bsptreenormal);
+  ShapeData * shape = thisp->shape;
+  assert(shape);
 
   SoPrimitiveVertex const * const arr[3] = {v1, v2, v3};
   for (int i = 0; i < 3; i++) {
     const SoPrimitiveVertex * v = arr[i];
-    thisp->coordidx->append(thisp->bsptree->addPoint(v->getPoint()));
-    thisp->normalidx->append(thisp->bsptreenormal->addPoint(v->getNormal()));
-    if (thisp->texidx) {
-      assert(thisp->bsptreetex);
+    shape->points.append(v->getPoint());
+    shape->normals.append(v->getNormal());
+    if (shape->hastexture) {
       const SbVec4f & tc = v->getTextureCoords();
-      thisp->texidx->append(thisp->bsptreetex->addPoint(SbVec3f(tc[0], tc[1], 0.0f)));
+      shape->texcoords.append(SbVec3f(tc[0], tc[1], 0.0f));
     }
     if (thisp->coloridx) thisp->coloridx->append(v->getMaterialIndex());
   }
-  thisp->coordidx->append(-1);
-  thisp->normalidx->append(-1);
-  if (thisp->texidx) thisp->texidx->append(-1);
   if (thisp->coloridx) thisp->coloridx->append(-1);
+
+  if (shape->points.getLength() >= TOVRML2_WELD_BATCH) {
+    SoToVRML2ActionP::weldCorners(shape);
+  }
+}
+
+// welds corners, and appends the index of each corner with a -1
+// after each triangle
+static void
+tovrml2_weld_triangles(const SbList <SbVec3f> & corners,
+                       SbSpatialHash & hash, SbList <int32_t> & indices)
+{
+  const int n = corners.getLength();
+  int32_t * welded = new int32_t[n];
+  hash.addPoints(corners.getArrayPtr(), n, welded);
+  indices.ensureCapacity(indices.getLength() + n + n / 3);
+  for (int i = 0; i + 2 < n; i += 3) {
+    indices.append(welded[i]);
+    indices.append(welded[i+1]);
+    indices.append(welded[i+2]);
+    indices.append(-1);
+  }
+  delete[] welded;
+}
+
+void
+SoToVRML2ActionP::weld_corners_cb(void * closure, int begin, int end)
+{
+  ShapeData * shape = static_cast<ShapeData *>(closure);
+  for (int i = begin; i < end; i++) {
+    switch (i) {
+    case 0:
+      tovrml2_weld_triangles(shape->points, shape->coordhash, shape->coordidx);
+      break;
+    case 1:
+      tovrml2_weld_triangles(shape->normals, shape->normalhash, shape->normalidx);
+      break;
+    default:
+      tovrml2_weld_triangles(shape->texcoords, shape->texhash, shape->texidx);
+      break;
+    }
+  }
+}
+
+//
+// Welds the corners collected for shape since the last call. The
+// coordinates, normals and texture coordinates are welded into
+// separate hashes, so for large batches they are welded in
+// parallel. Welding in batches keeps the memory used for the unshared
+// corners bounded, however large the shape is.
+//
+void
+SoToVRML2ActionP::weldCorners(ShapeData * shape)
+{
+  const int numlists = shape->hastexture ? 3 : 2;
+  if (shape->points.getLength() >= TOVRML2_PARALLEL_WELD_MIN) {
+    cc_parallel_for(numlists, 1, weld_corners_cb, shape);
+  }
+  else {
+    weld_corners_cb(shape, 0, numlists);
+  }
+  shape->points.truncate(0);
+  shape->normals.truncate(0);
+  shape->texcoords.truncate(0);
 }
 
 SoCallbackAction::Response
@@ -2184,18 +2260,22 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
   if (!thisp->do_post_primitives) return SoCallbackAction::CONTINUE;
   thisp->do_post_primitives = FALSE;
 
+  ShapeData * shape = thisp->shape;
+  thisp->shape = NULL;
+  SoToVRML2ActionP::weldCorners(shape);
+
   SoVRMLGeometry * is;
   if (action->getDrawStyle() == SoDrawStyle::POINTS) {
     SoVRMLPointSet * ps = NEW_NODE(SoVRMLPointSet, node);
     is = ps;
 
-    ps->coord = thisp->get_or_create_coordinate(thisp->bsptree->getPointsArrayPtr(),
-                                                thisp->bsptree->numPoints());
+    ps->coord = thisp->get_or_create_coordinate(shape->coordhash.getPointsArrayPtr(),
+                                                shape->coordhash.numPoints());
 
     if (thisp->coloridx) {
       // Copy the colors from the state
       SoLazyElement * colorElem = SoLazyElement::getInstance(action->getState());
-      if (colorElem->getNumDiffuse() == thisp->bsptree->numPoints()) {
+      if (colorElem->getNumDiffuse() == shape->coordhash.numPoints()) {
         if (colorElem->isPacked()) {
           ps->color = thisp->get_or_create_color(colorElem->getPackedPointer(),
                                                  colorElem->getNumDiffuse());
@@ -2212,8 +2292,8 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
     SoVRMLIndexedLineSet * ils = NEW_NODE(SoVRMLIndexedLineSet, node);
     is = ils;
 
-    ils->coord = thisp->get_or_create_coordinate(thisp->bsptree->getPointsArrayPtr(),
-                                                 thisp->bsptree->numPoints());
+    ils->coord = thisp->get_or_create_coordinate(shape->coordhash.getPointsArrayPtr(),
+                                                 shape->coordhash.numPoints());
 
     if (thisp->coloridx) {
       // Copy the colors from the state
@@ -2231,8 +2311,8 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
                                 thisp->coloridx->getArrayPtr());
     }
 
-    int n = thisp->coordidx->getLength();
-    const int32_t * a = thisp->coordidx->getArrayPtr();
+    int n = shape->coordidx.getLength();
+    const int32_t * a = shape->coordidx.getArrayPtr();
     SbList <int32_t> l;
     int32_t p = a[0];
     for (int i = 0; i < n; i++) {
@@ -2274,11 +2354,11 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
     ifs->solid = solid_field ? solid_field->getValue() : (SoShapeHintsElement::getShapeType(action->getState()) == SoShapeHintsElement::SOLID);
     ifs->convex = convex_field ? convex_field->getValue() : (action->getFaceType() == SoShapeHints::CONVEX);
 
-    ifs->coord = thisp->get_or_create_coordinate(thisp->bsptree->getPointsArrayPtr(),
-                                                thisp->bsptree->numPoints());
+    ifs->coord = thisp->get_or_create_coordinate(shape->coordhash.getPointsArrayPtr(),
+                                                shape->coordhash.numPoints());
 
-    ifs->normal = thisp->get_or_create_normal(thisp->bsptreenormal->getPointsArrayPtr(),
-                                             thisp->bsptreenormal->numPoints());
+    ifs->normal = thisp->get_or_create_normal(shape->normalhash.getPointsArrayPtr(),
+                                             shape->normalhash.numPoints());
 
     if (thisp->coloridx) {
       // Copy the colors from the state
@@ -2297,38 +2377,31 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
 
     }
 
-    if (thisp->texidx) {
+    if (shape->hastexture) {
       // Copy texture coordinates
       SoVRMLTextureCoordinate * tex = new SoVRMLTextureCoordinate;
-      int n = thisp->bsptreetex->numPoints();
+      int n = shape->texhash.numPoints();
       tex->point.setNum(n);
       SbVec2f * ptr = tex->point.startEditing();
       for (int i = 0; i < n; i++) {
-        SbVec3f p = thisp->bsptreetex->getPoint(i);
+        SbVec3f p = shape->texhash.getPoint(i);
         ptr[i] = SbVec2f(p[0], p[1]);
       }
       tex->point.finishEditing();
       ifs->texCoord = tex;
 
       // Index
-      ifs->texCoordIndex.setValues(0, thisp->texidx->getLength(),
-                                  thisp->texidx->getArrayPtr());
+      ifs->texCoordIndex.setValues(0, shape->texidx.getLength(),
+                                  shape->texidx.getArrayPtr());
     }
 
-    ifs->coordIndex.setValues(0, thisp->coordidx->getLength(),
-                             thisp->coordidx->getArrayPtr());
-    ifs->normalIndex.setValues(0, thisp->normalidx->getLength(),
-                              thisp->normalidx->getArrayPtr());
-
+    ifs->coordIndex.setValues(0, shape->coordidx.getLength(),
+                             shape->coordidx.getArrayPtr());
+    ifs->normalIndex.setValues(0, shape->normalidx.getLength(),
+                              shape->normalidx.getArrayPtr());
   }
 
-  delete thisp->bsptree; thisp->bsptree = NULL;
-  delete thisp->bsptreetex; thisp->bsptreetex = NULL;
-  delete thisp->bsptreenormal; thisp->bsptreenormal = NULL;
-
-  delete thisp->coordidx; thisp->coordidx = NULL;
-  delete thisp->normalidx; thisp->normalidx = NULL;
-  delete thisp->texidx; thisp->texidx = NULL;
+  delete shape;
   delete thisp->coloridx; thisp->coloridx = NULL;
 
   thisp->insert_shape(action, is);
@@ -2342,9 +2415,212 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
 #undef NEW_NODE
 #undef DEFAULT_VIEWPORT_WIDTH
 #undef DEFAULT_VIEWPORT_HEIGHT
+#undef TOVRML2_WELD_BATCH
+#undef TOVRML2_PARALLEL_WELD_MIN
 
 #undef PRIVATE
 #undef PUBLIC
 #undef THISP
 
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoQuadMesh.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/VRMLnodes/SoVRMLGroup.h>
+#include <Inventor/VRMLnodes/SoVRMLIndexedFaceSet.h>
+#include <Inventor/VRMLnodes/SoVRMLCoordinate.h>
+#include <Inventor/VRMLnodes/SoVRMLIndexedLineSet.h>
+#include <Inventor/VRMLnodes/SoVRMLTextureCoordinate.h>
+
+static SoSeparator *
+tovrml2_test_quadmesh(const int side, const float z)
+{
+  SoSeparator * sep = new SoSeparator;
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setNum(side * side);
+  SbVec3f * pts = coords->point.startEditing();
+  for (int y = 0; y < side; y++) {
+    for (int x = 0; x < side; x++) {
+      pts[y * side + x].setValue(float(x), float(y), z);
+    }
+  }
+  coords->point.finishEditing();
+  sep->addChild(coords);
+  SoQuadMesh * mesh = new SoQuadMesh;
+  mesh->verticesPerRow = side;
+  mesh->verticesPerColumn = side;
+  sep->addChild(mesh);
+  return sep;
+}
+
+BOOST_AUTO_TEST_CASE(weldQuadMesh)
+{
+  // the triangles generated for the quad mesh share vertices, which
+  // should be welded back to the grid points
+  const int side = 3;
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setNum(side * side);
+  SbVec3f * pts = coords->point.startEditing();
+  for (int y = 0; y < side; y++) {
+    for (int x = 0; x < side; x++) {
+      // mix -0.0 and 0.0, which are equal and should be welded
+      pts[y * side + x].setValue(float(x), float(y), (x % 2) ? -0.0f : 0.0f);
+    }
+  }
+  coords->point.finishEditing();
+  root->addChild(coords);
+  SoQuadMesh * mesh = new SoQuadMesh;
+  mesh->verticesPerRow = side;
+  mesh->verticesPerColumn = side;
+  root->addChild(mesh);
+
+  SoToVRML2Action tovrml2;
+  tovrml2.apply(root);
+  SoVRMLGroup * vrmlroot = tovrml2.getVRML2SceneGraph();
+  BOOST_REQUIRE(vrmlroot != NULL);
+  vrmlroot->ref();
+
+  SoSearchAction sa;
+  sa.setType(SoVRMLIndexedFaceSet::getClassTypeId());
+  sa.apply(vrmlroot);
+  BOOST_REQUIRE(sa.getPath() != NULL);
+  SoVRMLIndexedFaceSet * ifs =
+    static_cast<SoVRMLIndexedFaceSet *>(static_cast<SoFullPath *>(sa.getPath())->getTail());
+  SoVRMLCoordinate * vrmlcoords =
+    static_cast<SoVRMLCoordinate *>(ifs->coord.getValue());
+  BOOST_REQUIRE(vrmlcoords != NULL);
+
+  const int numcoords = vrmlcoords->point.getNum();
+  BOOST_CHECK_MESSAGE(numcoords == side * side, "vertices were not welded");
+
+  // all triangles should reference valid, distinct points
+  const int n = ifs->coordIndex.getNum();
+  BOOST_CHECK_MESSAGE(n == (side - 1) * (side - 1) * 2 * 4, "unexpected number of indices");
+  int numwrong = 0;
+  for (int i = 0; i + 3 < n; i += 4) {
+    const int32_t * idx = ifs->coordIndex.getValues(i);
+    if (idx[3] != -1) numwrong++;
+    for (int j = 0; j < 3; j++) {
+      if (idx[j] < 0 || idx[j] >= numcoords) numwrong++;
+    }
+    if (idx[0] == idx[1] || idx[1] == idx[2] || idx[0] == idx[2]) numwrong++;
+  }
+  BOOST_CHECK_MESSAGE(numwrong == 0, "invalid triangle indices");
+
+  vrmlroot->unref();
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(weldLargeShape)
+{
+  // the corners of a shape with more triangles than fit in one weld
+  // batch must still be welded into one set of points
+  const int side = 70;
+  SoSeparator * root = tovrml2_test_quadmesh(side, 0.0f);
+  root->ref();
+
+  SoToVRML2Action tovrml2;
+  tovrml2.apply(root);
+  SoVRMLGroup * vrmlroot = tovrml2.getVRML2SceneGraph();
+  BOOST_REQUIRE(vrmlroot != NULL);
+  vrmlroot->ref();
+
+  SoSearchAction sa;
+  sa.setType(SoVRMLIndexedFaceSet::getClassTypeId());
+  sa.apply(vrmlroot);
+  BOOST_REQUIRE(sa.getPath() != NULL);
+  SoVRMLIndexedFaceSet * ifs =
+    static_cast<SoVRMLIndexedFaceSet *>(static_cast<SoFullPath *>(sa.getPath())->getTail());
+  SoVRMLCoordinate * coords = static_cast<SoVRMLCoordinate *>(ifs->coord.getValue());
+  BOOST_REQUIRE(coords != NULL);
+  BOOST_CHECK_MESSAGE(coords->point.getNum() == side * side, "vertices were not welded");
+
+  const int numindices = (side - 1) * (side - 1) * 2 * 4;
+  BOOST_CHECK_MESSAGE(ifs->coordIndex.getNum() == numindices &&
+                      ifs->normalIndex.getNum() == numindices,
+                      "unexpected number of indices");
+
+  vrmlroot->unref();
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(multipleShapes)
+{
+  // the shapes must keep their order and their own geometry
+  const int numshapes = 8;
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < numshapes; i++) {
+    SoSeparator * sep = tovrml2_test_quadmesh(i + 2, float(i));
+    if (i % 2) {
+      SoTexture2 * tex = new SoTexture2;
+      const unsigned char image[] = { 0, 255, 255, 0 };
+      tex->image.setValue(SbVec2s(2, 2), 1, image);
+      sep->insertChild(tex, 0);
+    }
+    root->addChild(sep);
+  }
+  SoSeparator * linesep = tovrml2_test_quadmesh(3, 100.0f);
+  SoDrawStyle * drawstyle = new SoDrawStyle;
+  drawstyle->style = SoDrawStyle::LINES;
+  linesep->insertChild(drawstyle, 0);
+  root->addChild(linesep);
+
+  SoToVRML2Action tovrml2;
+  tovrml2.apply(root);
+  SoVRMLGroup * vrmlroot = tovrml2.getVRML2SceneGraph();
+  BOOST_REQUIRE(vrmlroot != NULL);
+  vrmlroot->ref();
+
+  SoSearchAction sa;
+  sa.setType(SoVRMLIndexedFaceSet::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.apply(vrmlroot);
+  const SoPathList & paths = sa.getPaths();
+  BOOST_REQUIRE(paths.getLength() == numshapes);
+
+  int numwrong = 0;
+  for (int i = 0; i < numshapes; i++) {
+    SoVRMLIndexedFaceSet * ifs =
+      static_cast<SoVRMLIndexedFaceSet *>(static_cast<SoFullPath *>(paths[i])->getTail());
+    SoVRMLCoordinate * coords = static_cast<SoVRMLCoordinate *>(ifs->coord.getValue());
+    const int side = i + 2;
+    if (coords == NULL ||
+        coords->point.getNum() != side * side ||
+        coords->point[0][2] != float(i)) {
+      numwrong++;
+      continue;
+    }
+    const int numindices = (side - 1) * (side - 1) * 2 * 4;
+    if (ifs->coordIndex.getNum() != numindices ||
+        ifs->normalIndex.getNum() != numindices) numwrong++;
+    const SbBool hastexture = (i % 2) != 0;
+    if ((ifs->texCoord.getValue() != NULL) != hastexture) numwrong++;
+    if (hastexture && ifs->texCoordIndex.getNum() != numindices) numwrong++;
+  }
+  BOOST_CHECK_MESSAGE(numwrong == 0, "wrong geometry in converted shapes");
+
+  sa.setType(SoVRMLIndexedLineSet::getClassTypeId());
+  sa.setInterest(SoSearchAction::FIRST);
+  sa.apply(vrmlroot);
+  BOOST_REQUIRE(sa.getPath() != NULL);
+  SoVRMLIndexedLineSet * ils =
+    static_cast<SoVRMLIndexedLineSet *>(static_cast<SoFullPath *>(sa.getPath())->getTail());
+  SoVRMLCoordinate * ilscoords = static_cast<SoVRMLCoordinate *>(ils->coord.getValue());
+  BOOST_CHECK_MESSAGE(ilscoords != NULL && ilscoords->point.getNum() == 9,
+                      "wrong geometry in converted line set");
+
+  vrmlroot->unref();
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_VRML97
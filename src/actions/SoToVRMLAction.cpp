@@ -66,7 +66,6 @@
 #include <Inventor/nodes/SoNodes.h>
 #include <Inventor/SoInput.h>
 #include <Inventor/SoOutput.h>
-#include <Inventor/SbBSPTree.h>
 #include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/actions/SoGetPrimitiveCountAction.h>
@@ -90,6 +89,7 @@
 #include "actions/SoSubActionP.h"
 #include "coindefs.h"
 #include "SbBasicP.h"
+#include "base/SbSpatialHash.h"
 
 // FIXME: currently only VRML2-nodes to VRML1-nodes is
 // supported. Inventor/Coin specific nodes must also be supported
@@ -137,9 +137,9 @@ public:
 
     this->nodefuse = FALSE; // for optimizing bad scene graphs
 
-    this->bsptree = NULL;
-    this->bsptreetex = NULL;
-    this->bsptreenormal = NULL;
+    this->coordhash = NULL;
+    this->texhash = NULL;
+    this->normalhash = NULL;
     this->coordidx = NULL;
     this->normalidx = NULL;
     this->texidx = NULL;
@@ -178,9 +178,9 @@ public:
   SoFullPath * vrmlpath;
   SoSeparator * vrmlroot;
 
-  SbBSPTree * bsptree;
-  SbBSPTree * bsptreetex;
-  SbBSPTree * bsptreenormal;
+  SbSpatialHash * coordhash;
+  SbSpatialHash * texhash;
+  SbSpatialHash * normalhash;
 
   SbList <int32_t> * coordidx;
   SbList <int32_t> * normalidx;
@@ -652,9 +652,9 @@ SoToVRMLActionP::init_gen(const SbBool color)
     }
   }
 
-  this->bsptree = new SbBSPTree;
-  if (dotex) this->bsptreetex = new SbBSPTree;
-  this->bsptreenormal = new SbBSPTree;
+  this->coordhash = new SbSpatialHash;
+  if (dotex) this->texhash = new SbSpatialHash;
+  this->normalhash = new SbSpatialHash;
 
   this->coordidx = new SbList <int32_t>;
   this->normalidx = new SbList <int32_t>;
@@ -670,14 +670,14 @@ SoToVRMLActionP::post_primitives_cb(void * closure, SoCallbackAction * COIN_UNUS
   int n;
   SoGroup * tail = thisp->get_current_tail();
   SoCoordinate3 * coord = new SoCoordinate3;
-  coord->point.setValues(0, thisp->bsptree->numPoints(),
-                         thisp->bsptree->getPointsArrayPtr());
+  coord->point.setValues(0, thisp->coordhash->numPoints(),
+                         thisp->coordhash->getPointsArrayPtr());
   tail->addChild(coord);
 
   SoIndexedFaceSet * ifs = NEW_NODE(SoIndexedFaceSet, node);
   SoNormal * normal = new SoNormal;
-  normal->vector.setValues(0, thisp->bsptreenormal->numPoints(),
-                           thisp->bsptreenormal->getPointsArrayPtr());
+  normal->vector.setValues(0, thisp->normalhash->numPoints(),
+                           thisp->normalhash->getPointsArrayPtr());
   tail->addChild(normal);
 
   ifs->coordIndex.setValues(0, thisp->coordidx->getLength(),
@@ -689,11 +689,11 @@ SoToVRMLActionP::post_primitives_cb(void * closure, SoCallbackAction * COIN_UNUS
     ifs->textureCoordIndex.setValues(0, thisp->texidx->getLength(),
                                      thisp->texidx->getArrayPtr());
     tail->addChild(tex);
-    n = thisp->bsptreetex->numPoints();
+    n = thisp->texhash->numPoints();
     tex->point.setNum(n);
     SbVec2f * ptr = tex->point.startEditing();
     for (int i = 0; i < n; i++) {
-      SbVec3f p = thisp->bsptreetex->getPoint(i);
+      SbVec3f p = thisp->texhash->getPoint(i);
       ptr[i] = SbVec2f(p[0], p[1]);
     }
     tex->point.finishEditing();
@@ -709,9 +709,9 @@ SoToVRMLActionP::post_primitives_cb(void * closure, SoCallbackAction * COIN_UNUS
 
   tail->addChild(ifs);
 
-  delete thisp->bsptree; thisp->bsptree = NULL;
-  delete thisp->bsptreetex; thisp->bsptreetex = NULL;
-  delete thisp->bsptreenormal; thisp->bsptreenormal = NULL;
+  delete thisp->coordhash; thisp->coordhash = NULL;
+  delete thisp->texhash; thisp->texhash = NULL;
+  delete thisp->normalhash; thisp->normalhash = NULL;
 
   delete thisp->coordidx; thisp->coordidx = NULL;
   delete thisp->normalidx; thisp->normalidx = NULL;
@@ -728,18 +728,18 @@ SoToVRMLActionP::triangle_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG(
                              const SoPrimitiveVertex * v3)
 {
   SoToVRMLActionP * thisp = THISP(closure);
-  assert(thisp->bsptree);
-  assert(thisp->bsptreenormal);
+  assert(thisp->coordhash);
+  assert(thisp->normalhash);
 
   SoPrimitiveVertex const * const arr[3] = {v1, v2, v3};
   for (int i = 0; i < 3; i++) {
     const SoPrimitiveVertex * v = arr[i];
-    thisp->coordidx->append(thisp->bsptree->addPoint(v->getPoint()));
-    thisp->normalidx->append(thisp->bsptreenormal->addPoint(v->getNormal()));
+    thisp->coordidx->append(thisp->coordhash->addPoint(v->getPoint()));
+    thisp->normalidx->append(thisp->normalhash->addPoint(v->getNormal()));
     if (thisp->texidx) {
-      assert(thisp->bsptreetex);
+      assert(thisp->texhash);
       const SbVec4f & tc = v->getTextureCoords();
-      thisp->texidx->append(thisp->bsptreetex->addPoint(SbVec3f(tc[0], tc[1], 0.0f)));
+      thisp->texidx->append(thisp->texhash->addPoint(SbVec3f(tc[0], tc[1], 0.0f)));
     }
     if (thisp->coloridx) thisp->coloridx->append(v->getMaterialIndex());
   }
@@ -1096,7 +1096,7 @@ SoToVRMLActionP::vrmlils_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG(a
   }
 
   if (thisp->nodefuse && coord) {
-    SbBSPTree bsp;
+    SbSpatialHash bsp;
     int n = oldils->coordIndex.getNum();
     const int32_t * src = oldils->coordIndex.getValues(0);
 
@@ -259,6 +259,7 @@ SoWriteAction::beginTraversal(SoNode * node)
     outobj->resolveRoutes();
   }
   if (!this->continuing) {
+    this->outobj->flushFile();
     SoWriterefCounter::instance(this->getOutput())->debugCleanup();
 #if COIN_DEBUG
     delete sensor;
@@ -359,4 +360,70 @@ BOOST_AUTO_TEST_CASE(GlobalField)
 
 }
 
+// check that multiple references are written with DEF/USE, that
+// named nodes keep their names, and that the same SoOutput can be
+// used for several write actions.
+
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/lists/SbIntList.h>
+
+static void *
+writeaction_test_realloc(void * bufptr, size_t size)
+{
+  return realloc(bufptr, size);
+}
+
+BOOST_AUTO_TEST_CASE(MultipleReferences)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCube * shared = new SoCube;
+  SoCube * named = new SoCube;
+  named->setName("namedcube");
+  SoSeparator * sep = new SoSeparator;
+  sep->addChild(shared);
+  sep->addChild(named);
+  root->addChild(sep);
+  root->addChild(shared);
+  root->addChild(new SoCube);
+
+  SoOutput out;
+  out.setBuffer(malloc(1024), 1024, writeaction_test_realloc);
+  SoWriteAction wa(&out);
+  wa.apply(root);
+  wa.apply(root);
+
+  void * buffer;
+  size_t size;
+  out.getBuffer(buffer, size);
+  SbString written(static_cast<const char *>(buffer), 0, static_cast<int>(size) - 1);
+  free(buffer);
+  root->unref();
+
+  // only the shared node and the named node should be DEF'ed, and the
+  // second write action must write the complete graph again
+  SbIntList defs;
+  written.findAll("DEF", defs);
+  BOOST_CHECK(defs.getLength() == 4);
+
+  SoInput in;
+  in.setBuffer(written.getString(), written.getLength());
+  SoSeparator * top = SoDB::readAll(&in);
+  BOOST_REQUIRE(top);
+  top->ref();
+  BOOST_REQUIRE(top->getNumChildren() == 2);
+  for (int i = 0; i < 2; i++) {
+    SoSeparator * readroot = static_cast<SoSeparator *>(top->getChild(i));
+    BOOST_REQUIRE(readroot->getNumChildren() == 3);
+    SoSeparator * readsep = static_cast<SoSeparator *>(readroot->getChild(0));
+    BOOST_REQUIRE(readsep->getNumChildren() == 2);
+    BOOST_CHECK_MESSAGE(readsep->getChild(0) == readroot->getChild(1),
+                        "shared node not written with DEF/USE");
+    BOOST_CHECK(readsep->getChild(1)->getName() == SbName("namedcube"));
+    BOOST_CHECK(readroot->getChild(2)->getName() == SbName::empty());
+  }
+  BOOST_CHECK(top->getChild(0) != top->getChild(1));
+  top->unref();
+}
+
 #endif // COIN_TEST_SUITE
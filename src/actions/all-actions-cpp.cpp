@@ -41,17 +41,22 @@
 #include "SoActionP.cpp"
 #include "SoBoxHighlightRenderAction.cpp"
 #include "SoCallbackAction.cpp"
+#include "SoFlattenAction.cpp"
 #include "SoGLRenderAction.cpp"
 #include "SoGetBoundingBoxAction.cpp"
 #include "SoGetMatrixAction.cpp"
 #include "SoGetPrimitiveCountAction.cpp"
+#include "SoGlobalSimplifyAction.cpp"
 #include "SoHandleEventAction.cpp"
 #include "SoLineHighlightRenderAction.cpp"
 #include "SoPickAction.cpp"
 #include "SoRayPickAction.cpp"
 #include "SoReorganizeAction.cpp"
 #include "SoSearchAction.cpp"
+#include "SoSearchIndex.cpp"
+#include "SoShapeSimplifyAction.cpp"
 #include "SoSimplifyAction.cpp"
+#include "SoSimplifyMesh.cpp"
 #include "SoToVRMLAction.cpp"
 #include "SoWriteAction.cpp"
 #include "SoAudioRenderAction.cpp"
@@ -437,17 +437,18 @@ SbBox3f::transform(const SbMatrix & matrix)
   }
 #endif // COIN_DEBUG
 
-  SbVec3f dst;
   SbVec3f points[2] = {this->minpt, this->maxpt};
-  SbVec3f corner;
+  SbVec3f corners[8];
   SbBox3f newbox;
 
   //transform all the corners and include them into the new box.
   for (int i=0;i<8;i++) {
     //Find all corners the "binary" way :-)
-    corner.setValue(points[(i&4)>>2][0], points[(i&2)>>1][1], points[i&1][2]);
-    matrix.multVecMatrix(corner, dst);
-    newbox.extendBy(dst);
+    corners[i].setValue(points[(i&4)>>2][0], points[(i&2)>>1][1], points[i&1][2]);
+  }
+  matrix.multVecMatrix(corners, corners, 8);
+  for (int i=0;i<8;i++) {
+    newbox.extendBy(corners[i]);
   }
   this->setBounds(newbox.minpt, newbox.maxpt);
 }
@@ -500,14 +501,13 @@ SbBox3f::outside(const SbMatrix & mvp, int & cullbits) const
   // pederb). 20000615 mortene.
 
   int i;
-  SbVec3f tmp;
   SbVec3f clip[8];
   for (i = 0; i < 8; i++) {
-    tmp[0] = i & 4 ? this->minpt[0] : this->maxpt[0];
-    tmp[1] = i & 2 ? this->minpt[1] : this->maxpt[1];
-    tmp[2] = i & 1 ? this->minpt[2] : this->maxpt[2];
-    mvp.multVecMatrix(tmp, clip[i]);
+    clip[i][0] = i & 4 ? this->minpt[0] : this->maxpt[0];
+    clip[i][1] = i & 2 ? this->minpt[1] : this->maxpt[1];
+    clip[i][2] = i & 1 ? this->minpt[2] : this->maxpt[2];
   }
+  mvp.multVecMatrix(clip, clip, 8);
   for (int j = 0; j < 3; j++) {
     if (cullbits & (1<<j)) {
       int inside = 0;
@@ -134,6 +134,14 @@
 
 #include "coindefs.h" // COIN_STUB()
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SBMATRIX_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SBMATRIX_NEON
+#endif
+
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
 using std::memmove;
 using std::memcmp;
@@ -213,6 +221,83 @@ const SbMat SbMatrixP::IDENTITYMATRIX = {
   { 0.0f, 0.0f, 0.0f, 1.0f }
 };
 
+// *************************************************************************
+
+// Matrix multiplications and batch transforms are done one matrix row
+// at a time, using SSE or NEON where available. The products are
+// summed in the same order as in the scalar code, so the results are
+// the same as when transforming one vector at a time.
+
+namespace {
+
+#if defined(SBMATRIX_SSE)
+
+typedef __m128 sbmatrix_row;
+
+inline sbmatrix_row sbmatrix_load(const float * v) { return _mm_loadu_ps(v); }
+inline void sbmatrix_store(float * v, const sbmatrix_row r) { _mm_storeu_ps(v, r); }
+inline sbmatrix_row sbmatrix_splat(const float f) { return _mm_set1_ps(f); }
+inline sbmatrix_row sbmatrix_add(const sbmatrix_row a, const sbmatrix_row b) { return _mm_add_ps(a, b); }
+inline sbmatrix_row sbmatrix_mul(const sbmatrix_row a, const sbmatrix_row b) { return _mm_mul_ps(a, b); }
+
+#elif defined(SBMATRIX_NEON)
+
+typedef float32x4_t sbmatrix_row;
+
+inline sbmatrix_row sbmatrix_load(const float * v) { return vld1q_f32(v); }
+inline void sbmatrix_store(float * v, const sbmatrix_row r) { vst1q_f32(v, r); }
+inline sbmatrix_row sbmatrix_splat(const float f) { return vdupq_n_f32(f); }
+inline sbmatrix_row sbmatrix_add(const sbmatrix_row a, const sbmatrix_row b) { return vaddq_f32(a, b); }
+inline sbmatrix_row sbmatrix_mul(const sbmatrix_row a, const sbmatrix_row b) { return vmulq_f32(a, b); }
+
+#else // scalar fallback
+
+struct sbmatrix_row { float v[4]; };
+
+inline sbmatrix_row sbmatrix_load(const float * v) {
+  sbmatrix_row r = { { v[0], v[1], v[2], v[3] } };
+  return r;
+}
+inline void sbmatrix_store(float * v, const sbmatrix_row r) {
+  v[0] = r.v[0]; v[1] = r.v[1]; v[2] = r.v[2]; v[3] = r.v[3];
+}
+inline sbmatrix_row sbmatrix_splat(const float f) {
+  sbmatrix_row r = { { f, f, f, f } };
+  return r;
+}
+inline sbmatrix_row sbmatrix_add(const sbmatrix_row a, const sbmatrix_row b) {
+  sbmatrix_row r = { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+  return r;
+}
+inline sbmatrix_row sbmatrix_mul(const sbmatrix_row a, const sbmatrix_row b) {
+  sbmatrix_row r = { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+  return r;
+}
+
+#endif // scalar fallback
+
+// dst = a * b, where dst may be the same matrix as a or b
+inline void
+sbmatrix_mult(const SbMat & a, const SbMat & b, SbMat & dst)
+{
+  const sbmatrix_row b0 = sbmatrix_load(b[0]);
+  const sbmatrix_row b1 = sbmatrix_load(b[1]);
+  const sbmatrix_row b2 = sbmatrix_load(b[2]);
+  const sbmatrix_row b3 = sbmatrix_load(b[3]);
+
+  sbmatrix_row rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] =
+      sbmatrix_add(sbmatrix_add(sbmatrix_add(sbmatrix_mul(sbmatrix_splat(a[i][0]), b0),
+                                             sbmatrix_mul(sbmatrix_splat(a[i][1]), b1)),
+                                sbmatrix_mul(sbmatrix_splat(a[i][2]), b2)),
+                   sbmatrix_mul(sbmatrix_splat(a[i][3]), b3));
+  }
+  for (int i = 0; i < 4; i++) { sbmatrix_store(dst[i], rows[i]); }
+}
+
+} // anonymous namespace
+
 SbMatrixP::HMatrix SbMatrixP::mat_id = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};
 
 /*!
@@ -1349,19 +1434,7 @@ SbMatrix::multRight(const SbMatrix & m)
   SbMat & tfm = this->matrix;
   if (SbMatrixP::isIdentity(tfm)) { *this = m; return *this; }
 
-  SbMat tmp;
-  (void)memcpy(tmp, tfm, 4*4*sizeof(float));
-
-  for (int i=0; i < 4; i++) {
-    for (int j=0; j < 4; j++) {
-      tfm[i][j] =
-        tmp[i][0] * mfm[0][j] +
-        tmp[i][1] * mfm[1][j] +
-        tmp[i][2] * mfm[2][j] +
-        tmp[i][3] * mfm[3][j];
-    }
-  }
-
+  sbmatrix_mult(tfm, mfm, tfm);
   return *this;
 }
 
@@ -1387,18 +1460,7 @@ SbMatrix::multLeft(const SbMatrix & m)
   SbMat & tfm = this->matrix;
   if (SbMatrixP::isIdentity(tfm)) { *this = m; return *this; }
 
-  SbMat tmp;
-  (void)memcpy(tmp, tfm, 4*4*sizeof(float));
-
-  for (int i=0; i < 4; i++) {
-    for (int j=0; j < 4; j++) {
-      tfm[i][j] =
-        tmp[0][j] * mfm[i][0] +
-        tmp[1][j] * mfm[i][1] +
-        tmp[2][j] * mfm[i][2] +
-        tmp[3][j] * mfm[i][3];
-    }
-  }
+  sbmatrix_mult(mfm, tfm, tfm);
   return *this;
 }
 
@@ -1525,6 +1587,81 @@ SbMatrix::multDirMatrix(const SbVec3f & src, SbVec3f & dst) const
   dst[2] = s[0]*t0[2] + s[1]*t1[2] + s[2]*t2[2];
 }
 
+/*!
+  \overload
+
+  Multiplies the \a num vectors in \a src with this matrix, and
+  returns the results in \a dst. This gives the same results as
+  calling multVecMatrix() for each vector, but is considerably faster
+  for large arrays.
+
+  It is safe to let \a src and \a dst be the same array.
+
+  \since Coin 4.1
+*/
+void
+SbMatrix::multVecMatrix(const SbVec3f * src, SbVec3f * dst, const int num) const
+{
+  if (SbMatrixP::isIdentity(this->matrix)) {
+    if (src != dst) { for (int i = 0; i < num; i++) { dst[i] = src[i]; } }
+    return;
+  }
+
+  const sbmatrix_row t0 = sbmatrix_load(this->matrix[0]);
+  const sbmatrix_row t1 = sbmatrix_load(this->matrix[1]);
+  const sbmatrix_row t2 = sbmatrix_load(this->matrix[2]);
+  const sbmatrix_row t3 = sbmatrix_load(this->matrix[3]);
+  // no need to divide by W for affine transformations
+  const SbBool affine =
+    this->matrix[0][3] == 0.0f && this->matrix[1][3] == 0.0f &&
+    this->matrix[2][3] == 0.0f && this->matrix[3][3] == 1.0f;
+
+  float d[4];
+  for (int i = 0; i < num; i++) {
+    const float * s = src[i].getValue();
+    sbmatrix_store(d, sbmatrix_add(sbmatrix_add(sbmatrix_add(sbmatrix_mul(sbmatrix_splat(s[0]), t0),
+                                                             sbmatrix_mul(sbmatrix_splat(s[1]), t1)),
+                                                sbmatrix_mul(sbmatrix_splat(s[2]), t2)),
+                                   t3));
+    if (affine) dst[i].setValue(d[0], d[1], d[2]);
+    else dst[i].setValue(d[0]/d[3], d[1]/d[3], d[2]/d[3]);
+  }
+}
+
+/*!
+  \overload
+
+  Multiplies the \a num direction vectors in \a src with this matrix,
+  ignoring the translation components, and returns the results in \a
+  dst. This gives the same results as calling multDirMatrix() for
+  each vector, but is considerably faster for large arrays.
+
+  It is safe to let \a src and \a dst be the same array.
+
+  \since Coin 4.1
+*/
+void
+SbMatrix::multDirMatrix(const SbVec3f * src, SbVec3f * dst, const int num) const
+{
+  if (SbMatrixP::isIdentity(this->matrix)) {
+    if (src != dst) { for (int i = 0; i < num; i++) { dst[i] = src[i]; } }
+    return;
+  }
+
+  const sbmatrix_row t0 = sbmatrix_load(this->matrix[0]);
+  const sbmatrix_row t1 = sbmatrix_load(this->matrix[1]);
+  const sbmatrix_row t2 = sbmatrix_load(this->matrix[2]);
+
+  float d[4];
+  for (int i = 0; i < num; i++) {
+    const float * s = src[i].getValue();
+    sbmatrix_store(d, sbmatrix_add(sbmatrix_add(sbmatrix_mul(sbmatrix_splat(s[0]), t0),
+                                                sbmatrix_mul(sbmatrix_splat(s[1]), t1)),
+                                   sbmatrix_mul(sbmatrix_splat(s[2]), t2)));
+    dst[i].setValue(d[0], d[1], d[2]);
+  }
+}
+
 /*!
   Multiplies line point with the full matrix and multiplies the
   line direction with the matrix without the translation components.
@@ -2053,6 +2190,9 @@ SbMatrixP::decomp_affine(SbMatrixP::HMatrix A, SbMatrixP::AffineParts * parts)
 
 #ifdef COIN_TEST_SUITE
 #include <Inventor/SbDPMatrix.h>
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/SbVec3f.h>
 
 BOOST_AUTO_TEST_CASE(constructFromSbDPMatrix) {
   SbMatrixd a(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
@@ -2063,4 +2203,52 @@ BOOST_AUTO_TEST_CASE(constructFromSbDPMatrix) {
   BOOST_CHECK_MESSAGE(b == d,
                       "Equality comparrison failed!");
 }
+
+BOOST_AUTO_TEST_CASE(batchTransform) {
+  SbMatrix affine;
+  affine.setTransform(SbVec3f(1.0f, -2.0f, 3.0f),
+                      SbRotation(SbVec3f(1.0f, 2.0f, 3.0f), 0.7f),
+                      SbVec3f(0.5f, 2.0f, 3.0f));
+  SbMatrix projective = affine;
+  projective[0][3] = 0.1f;
+  projective[2][3] = -0.05f;
+  const SbMatrix matrices[] = { affine, projective, SbMatrix::identity() };
+
+  SbVec3f src[17];
+  for (int i = 0; i < 17; i++) {
+    src[i].setValue(float(i) * 0.5f, float(i % 5) - 2.0f, 1.0f / float(i + 1));
+  }
+  for (int m = 0; m < 3; m++) {
+    SbVec3f points[17], dirs[17], inplace[17];
+    matrices[m].multVecMatrix(src, points, 17);
+    matrices[m].multDirMatrix(src, dirs, 17);
+    for (int i = 0; i < 17; i++) inplace[i] = src[i];
+    matrices[m].multVecMatrix(inplace, inplace, 17);
+    for (int i = 0; i < 17; i++) {
+      SbVec3f point, dir;
+      matrices[m].multVecMatrix(src[i], point);
+      matrices[m].multDirMatrix(src[i], dir);
+      BOOST_CHECK_MESSAGE(points[i] == point, "batch point transform differs");
+      BOOST_CHECK_MESSAGE(dirs[i] == dir, "batch direction transform differs");
+      BOOST_CHECK_MESSAGE(inplace[i] == point, "in place batch transform differs");
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(multiply) {
+  SbMatrix a(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+  SbMatrix b(2, 0, 1, 0, 0, 3, 0, 1, 1, 0, 1, 0, 4, 5, 6, 1);
+  SbMatrix expected;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      expected[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+    }
+  }
+  SbMatrix right = a;
+  right.multRight(b);
+  BOOST_CHECK_MESSAGE(right == expected, "multRight() failed");
+  SbMatrix left = b;
+  left.multLeft(a);
+  BOOST_CHECK_MESSAGE(left == expected, "multLeft() failed");
+}
 #endif //COIN_TEST_SUITE
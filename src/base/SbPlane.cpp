@@ -213,23 +213,42 @@ SbPlane::intersect(const SbLine& l, SbVec3f& intersection) const
 void
 SbPlane::transform(const SbMatrix& matrix)
 {
-  SbVec3f ptInPlane = this->normal * this->distance;
+  SbPlane::transform(matrix, this, 1);
+}
+
+/*!
+  \overload
+
+  Transforms the \a num planes in \a planes by \a matrix. This
+  gives the same results as calling transform() on each plane, but
+  the inverse transpose matrix needed to transform the plane normals
+  is only calculated once.
 
+  \since Coin 4.1
+*/
+void
+SbPlane::transform(const SbMatrix & matrix, SbPlane * planes, const int num)
+{
   // according to discussions on comp.graphics.algorithms, the inverse
   // transpose matrix should be used to rotate the plane normal.
   SbMatrix invtransp = matrix.inverse().transpose();
-  invtransp.multDirMatrix(this->normal, this->normal);
 
-  // the point should be transformed using the original matrix
-  matrix.multVecMatrix(ptInPlane, ptInPlane);
+  for (int i = 0; i < num; i++) {
+    SbPlane & plane = planes[i];
+    SbVec3f ptInPlane = plane.normal * plane.distance;
+    invtransp.multDirMatrix(plane.normal, plane.normal);
 
-  if (this->normal.normalize() == 0.0f) {
+    // the point should be transformed using the original matrix
+    matrix.multVecMatrix(ptInPlane, ptInPlane);
+
+    if (plane.normal.normalize() == 0.0f) {
 #if COIN_DEBUG
-    SoDebugError::postWarning("SbPlane::transform",
-                              "The transformation invalidated the plane.");
+      SoDebugError::postWarning("SbPlane::transform",
+                                "The transformation invalidated the plane.");
 #endif // COIN_DEBUG
+    }
+    plane.distance = plane.normal.dot(ptInPlane);
   }
-  this->distance = this->normal.dot(ptInPlane);
 }
 
 /*!
@@ -386,6 +405,8 @@ SbPlane::print(FILE * fp) const
 #ifdef COIN_TEST_SUITE
 #include <Inventor/SbPlane.h>
 #include <Inventor/SbLine.h>
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbRotation.h>
 
 using namespace SIM::Coin::TestSuite;
 
@@ -403,4 +424,23 @@ BOOST_AUTO_TEST_CASE(signCorrect)
 
 }
 
+BOOST_AUTO_TEST_CASE(batchTransform)
+{
+  SbMatrix matrix;
+  matrix.setTransform(SbVec3f(1.0f, 2.0f, 3.0f),
+                      SbRotation(SbVec3f(0.0f, 1.0f, 1.0f), 0.5f),
+                      SbVec3f(1.0f, 2.0f, 0.5f));
+  SbPlane planes[3] = {
+    SbPlane(SbVec3f(1.0f, 0.0f, 0.0f), 2.0f),
+    SbPlane(SbVec3f(0.0f, 1.0f, 1.0f), -1.0f),
+    SbPlane(SbVec3f(1.0f, 1.0f, 1.0f), 0.0f)
+  };
+  SbPlane single[3] = { planes[0], planes[1], planes[2] };
+  SbPlane::transform(matrix, planes, 3);
+  for (int i = 0; i < 3; i++) {
+    single[i].transform(matrix);
+    BOOST_CHECK_MESSAGE(planes[i] == single[i], "batch plane transform differs");
+  }
+}
+
 #endif //COIN_TEST_SUITE
@@ -0,0 +1,366 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+  SbSpatialHash is used to weld points, i.e. to find or add a point in
+  a set of unique points in constant time. It has the same addPoint()
+  and findPoint() semantics as SbBSPTree, but is backed by a hash
+  table instead of a tree, which is a lot faster for large point
+  sets. SbBSPTree should still be used when points must be removed,
+  or for range queries.
+
+  With the default epsilon of 0, points are only merged when they
+  compare equal. With a positive epsilon, the points are hashed into
+  a uniform grid with cell size epsilon, and a new point is merged
+  with the first added point not further away than epsilon.
+*/
+
+#include "SbSpatialHash.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// *************************************************************************
+
+namespace {
+
+  const int SPATIALHASH_MIN_TABLESIZE = 16;
+
+  inline uint32_t
+  spatialhash_mix(uint32_t h)
+  {
+    // finalizer from MurmurHash3
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+  }
+
+  inline uint32_t
+  spatialhash_combine(const uint32_t a, const uint32_t b, const uint32_t c)
+  {
+    return spatialhash_mix(a * 73856093U ^ b * 19349663U ^ c * 83492791U);
+  }
+
+  inline uint32_t
+  spatialhash_floatbits(float v)
+  {
+    // -0.0 and 0.0 compare equal, and must hash equal
+    if (v == 0.0f) v = 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+  }
+
+  inline int32_t
+  spatialhash_cellcoord(const float v, const float invcellsize)
+  {
+    const double c = floor(double(v) * double(invcellsize));
+    // clamp to avoid overflow for huge or non-finite coordinates. The
+    // distance test still decides if points match.
+    if (!(c > -1073741824.0)) return -1073741824;
+    if (c > 1073741824.0) return 1073741824;
+    return static_cast<int32_t>(c);
+  }
+
+} // anonymous namespace
+
+// *************************************************************************
+
+SbSpatialHash::SbSpatialHash(const float eps, const int initsize)
+  : points(initsize),
+    userdata(initsize)
+{
+  this->epsilon = (eps > 0.0f) ? eps : 0.0f;
+  this->invcellsize = (eps > 0.0f) ? 1.0f / eps : 0.0f;
+  this->table = NULL;
+  this->tablemask = 0;
+  this->numcells = 0;
+  this->resize(initsize);
+}
+
+SbSpatialHash::~SbSpatialHash()
+{
+  delete[] this->table;
+}
+
+int
+SbSpatialHash::numPoints(void) const
+{
+  return this->points.getLength();
+}
+
+SbVec3f
+SbSpatialHash::getPoint(const int idx) const
+{
+  assert(idx < this->points.getLength());
+  return this->points[idx];
+}
+
+const SbVec3f *
+SbSpatialHash::getPointsArrayPtr(void) const
+{
+  return this->points.getArrayPtr();
+}
+
+void *
+SbSpatialHash::getUserData(const int idx) const
+{
+  assert(idx < this->userdata.getLength());
+  return this->userdata[idx];
+}
+
+void
+SbSpatialHash::setUserData(const int idx, void * const data)
+{
+  assert(idx < this->userdata.getLength());
+  this->userdata[idx] = data;
+}
+
+const SbBox3f &
+SbSpatialHash::getBBox(void) const
+{
+  return this->bbox;
+}
+
+/*
+  Adds \a pt to the set and returns its index. If an equal point (or
+  a point within epsilon) has already been added, the index of that
+  point is returned, and its user data is left unchanged.
+*/
+int
+SbSpatialHash::addPoint(const SbVec3f & pt, void * const data)
+{
+  this->bbox.extendBy(pt);
+  int idx;
+  if (this->epsilon == 0.0f) {
+    // the common case, only probe the table once
+    const int slot = this->findSlot(pt);
+    idx = this->table[slot];
+    if (idx >= 0) return idx;
+    idx = this->points.getLength();
+    this->points.append(pt);
+    this->userdata.append(data);
+    if (2 * (this->numcells + 1) > static_cast<int>(this->tablemask + 1)) {
+      this->resize(this->numcells + 1);
+    }
+    else {
+      this->table[slot] = idx;
+      this->numcells++;
+    }
+    return idx;
+  }
+
+  idx = this->findPoint(pt);
+  if (idx >= 0) return idx;
+  idx = this->points.getLength();
+  this->points.append(pt);
+  this->userdata.append(data);
+  this->next.append(-1);
+  this->insert(idx);
+  return idx;
+}
+
+/*
+  Adds \a num points, and writes the index of each point to \a
+  indices. The table is sized for the new points up front, so this is
+  faster than adding the points one by one.
+*/
+void
+SbSpatialHash::addPoints(const SbVec3f * pts, const int num, int32_t * indices)
+{
+  const int total = this->points.getLength() + num;
+  this->points.ensureCapacity(total);
+  this->userdata.ensureCapacity(total);
+  if (this->epsilon > 0.0f) this->next.ensureCapacity(total);
+  if (2 * total > static_cast<int>(this->tablemask + 1)) this->resize(total);
+
+  for (int i = 0; i < num; i++) {
+    indices[i] = this->addPoint(pts[i]);
+  }
+}
+
+/*
+  Returns the index of the point matching \a pt, or -1 if no such
+  point has been added.
+*/
+int
+SbSpatialHash::findPoint(const SbVec3f & pt) const
+{
+  if (this->epsilon == 0.0f) {
+    return this->table[this->findSlot(pt)];
+  }
+
+  const Cell center = this->getCell(pt);
+  int found = -1;
+  Cell cell;
+  for (int z = -1; z <= 1; z++) {
+    cell.c[2] = center.c[2] + z;
+    for (int y = -1; y <= 1; y++) {
+      cell.c[1] = center.c[1] + y;
+      for (int x = -1; x <= 1; x++) {
+        cell.c[0] = center.c[0] + x;
+        const int idx = this->findInCell(cell, pt);
+        if (idx >= 0 && (found < 0 || idx < found)) found = idx;
+      }
+    }
+  }
+  return found;
+}
+
+/*
+  Removes all points.
+*/
+void
+SbSpatialHash::clear(const int initsize)
+{
+  this->points.truncate(0, TRUE);
+  this->userdata.truncate(0, TRUE);
+  this->next.truncate(0, TRUE);
+  this->bbox.makeEmpty();
+  delete[] this->table;
+  this->table = NULL;
+  this->tablemask = 0;
+  this->resize(initsize);
+}
+
+// *************************************************************************
+
+SbSpatialHash::Cell
+SbSpatialHash::getCell(const SbVec3f & pt) const
+{
+  Cell cell;
+  for (int i = 0; i < 3; i++) {
+    cell.c[i] = spatialhash_cellcoord(pt[i], this->invcellsize);
+  }
+  return cell;
+}
+
+uint32_t
+SbSpatialHash::hashPoint(const SbVec3f & pt) const
+{
+  return spatialhash_combine(spatialhash_floatbits(pt[0]),
+                             spatialhash_floatbits(pt[1]),
+                             spatialhash_floatbits(pt[2]));
+}
+
+uint32_t
+SbSpatialHash::hashCell(const Cell & cell) const
+{
+  return spatialhash_combine(static_cast<uint32_t>(cell.c[0]),
+                             static_cast<uint32_t>(cell.c[1]),
+                             static_cast<uint32_t>(cell.c[2]));
+}
+
+// returns the slot holding a point equal to pt, or the empty slot
+// where it should be inserted
+int
+SbSpatialHash::findSlot(const SbVec3f & pt) const
+{
+  uint32_t slot = this->hashPoint(pt) & this->tablemask;
+  for (;;) {
+    const int idx = this->table[slot];
+    if (idx < 0 || this->points[idx] == pt) return static_cast<int>(slot);
+    slot = (slot + 1) & this->tablemask;
+  }
+}
+
+// returns the slot holding the first point in cell, or the empty slot
+// where it should be inserted
+int
+SbSpatialHash::findSlot(const Cell & cell) const
+{
+  uint32_t slot = this->hashCell(cell) & this->tablemask;
+  for (;;) {
+    const int idx = this->table[slot];
+    if (idx < 0 || this->getCell(this->points[idx]) == cell) return static_cast<int>(slot);
+    slot = (slot + 1) & this->tablemask;
+  }
+}
+
+int
+SbSpatialHash::findInCell(const Cell & cell, const SbVec3f & pt) const
+{
+  const float eps2 = this->epsilon * this->epsilon;
+  int found = -1;
+  for (int idx = this->table[this->findSlot(cell)]; idx >= 0; idx = this->next[idx]) {
+    if ((this->points[idx] - pt).sqrLength() <= eps2) found = idx;
+  }
+  // the cell list is in descending order, so found is the first
+  // added point within epsilon
+  return found;
+}
+
+// adds the point at idx to the table, assuming there is room for it
+void
+SbSpatialHash::insert(const int idx)
+{
+  if (2 * (this->numcells + 1) > static_cast<int>(this->tablemask + 1)) {
+    // resize() adds all points, including idx
+    this->resize(this->numcells + 1);
+    return;
+  }
+  if (this->epsilon == 0.0f) {
+    this->table[this->findSlot(this->points[idx])] = idx;
+    this->numcells++;
+  }
+  else {
+    const int slot = this->findSlot(this->getCell(this->points[idx]));
+    if (this->table[slot] < 0) this->numcells++;
+    this->next[idx] = this->table[slot];
+    this->table[slot] = idx;
+  }
+}
+
+// reallocates the table to hold at least num cells, and adds all
+// points to it
+void
+SbSpatialHash::resize(const int num)
+{
+  int size = SPATIALHASH_MIN_TABLESIZE;
+  while (size < 2 * num) size <<= 1;
+  if (this->table && size <= static_cast<int>(this->tablemask + 1)) {
+    size = static_cast<int>(this->tablemask + 1) << 1;
+  }
+
+  delete[] this->table;
+  this->table = new int[size];
+  this->tablemask = static_cast<uint32_t>(size - 1);
+  for (int i = 0; i < size; i++) this->table[i] = -1;
+  this->numcells = 0;
+
+  const int n = this->points.getLength();
+  for (int i = 0; i < n; i++) this->insert(i);
+}
@@ -0,0 +1,95 @@
+#ifndef COIN_SBSPATIALHASH_H
+#define COIN_SBSPATIALHASH_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* ! COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/lists/SbList.h>
+
+// *************************************************************************
+
+class SbSpatialHash {
+public:
+  SbSpatialHash(const float epsilon = 0.0f, const int initsize = 4);
+  ~SbSpatialHash();
+
+  int numPoints(void) const;
+  SbVec3f getPoint(const int idx) const;
+  const SbVec3f * getPointsArrayPtr(void) const;
+  void * getUserData(const int idx) const;
+  void setUserData(const int idx, void * const data);
+  const SbBox3f & getBBox(void) const;
+
+  int addPoint(const SbVec3f & pt, void * const userdata = NULL);
+  void addPoints(const SbVec3f * pts, const int num, int32_t * indices);
+  int findPoint(const SbVec3f & pt) const;
+  void clear(const int initsize = 4);
+
+private:
+  struct Cell {
+    int32_t c[3];
+    int operator==(const Cell & cell) const {
+      return (this->c[0] == cell.c[0]) && (this->c[1] == cell.c[1]) && (this->c[2] == cell.c[2]);
+    }
+  };
+
+  Cell getCell(const SbVec3f & pt) const;
+  uint32_t hashPoint(const SbVec3f & pt) const;
+  uint32_t hashCell(const Cell & cell) const;
+  int findSlot(const SbVec3f & pt) const;
+  int findSlot(const Cell & cell) const;
+  int findInCell(const Cell & cell, const SbVec3f & pt) const;
+  void insert(const int idx);
+  void resize(const int numpoints);
+
+  float epsilon;
+  float invcellsize;
+  SbList <SbVec3f> points;
+  SbList <void *> userdata;
+  // next point in the same cell, only used when epsilon > 0
+  SbList <int> next;
+  // open addressing table with point indices, -1 for empty slots
+  int * table;
+  uint32_t tablemask;
+  int numcells;
+  SbBox3f bbox;
+};
+
+#endif // !COIN_SBSPATIALHASH_H
@@ -40,6 +40,16 @@
   triangles. It handles concave polygons, does Delaunay triangulation
   and avoids generating self-intersecting triangles.
 
+  Polygons with many vertices are instead split into y-monotone
+  pieces with a sweep line, and the pieces are triangulated in linear
+  time, which makes the tessellation run in O(n log n) time. The
+  Delaunay-like ear clipping gives better shaped triangles, but its
+  running time grows quadratically with the number of vertices, so it
+  is only used for polygons with up to 64 vertices. This limit can be
+  changed with the environment variable
+  COIN_TESSELLATOR_SWEEP_THRESHOLD. The sweep line is also used for
+  polygons with holes, see SbTesselator::nextContour().
+
   Here's a simple example which shows how to tessellate a quad polygon
   with corners in <0, 0, 0>, <1, 0, 0>, <1, 1, 0> and <0, 1, 0>.
 
@@ -106,11 +116,17 @@
 #include <Inventor/SbTesselator.h>
 
 #include <cstdio>
+#include <cstdlib>
 #include <climits>
 #include <cassert>
 #include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <set>
+#include <vector>
 
 #include <Inventor/C/base/heap.h>
+#include <Inventor/C/tidbits.h>
 #include <Inventor/SbBSPTree.h>
 #include <Inventor/SbSphere.h>
 #include <Inventor/lists/SbList.h>
@@ -177,10 +193,72 @@ public:
 
   static double heap_evaluate(void * v);
   static int heap_compare(void * v0, void * v1);
+
+  // storage index of the first vertex of each contour but the first
+  SbList <int> contourStarts;
+
+  // sweep line triangulation, for large polygons and polygons with
+  // holes
+  struct SweepPoint {
+    double x, y;
+    int prev, next;
+    Vertex * vertex;
+  };
+  // orders the edges crossing the sweep line from left to right. An
+  // edge is identified by the index of its first point, and -1 is the
+  // query point.
+  class EdgeLess {
+  public:
+    EdgeLess(const PImpl * thisp) : thisp(thisp) { }
+    bool operator()(const int e0, const int e1) const;
+  private:
+    const PImpl * thisp;
+  };
+  class PointAbove {
+  public:
+    PointAbove(const PImpl * thisp) : thisp(thisp) { }
+    bool operator()(const int p0, const int p1) const { return thisp->above(p0, p1) != FALSE; }
+  private:
+    const PImpl * thisp;
+  };
+  typedef std::set<int, EdgeLess> EdgeSet;
+
+  SbList <SweepPoint> points;
+  SbList <int> order;
+  SbList <int> helper;
+  SbList <int> diagonals;
+  SbList <int> triangles;
+  double query[2];
+  double expectedArea;
+  int expectedTriangles;
+
+  SbBool sweepTriangulate(void);
+  SbBool addContour(const int start, const int end);
+  SbBool decompose(void);
+  SbBool triangulateFaces(void);
+  SbBool triangulateMonotone(const int * face, const int num);
+  void addTriangle(const int p0, const int p1, const int p2);
+  SbBool above(const int p0, const int p1) const;
+  double orient(const int p0, const int p1, const int p2) const;
+  double edgeSide(const int edge, const double x, const double y) const;
+  void calcProjection(void);
 };
 
 #define PRIVATE(obj) ((obj)->pimpl)
 
+// polygons with more vertices than this are tessellated with the
+// sweep line instead of ear clipping
+static int
+sbtesselator_sweep_threshold(void)
+{
+  static int threshold = -1;
+  if (threshold < 0) {
+    const char * env = coin_getenv("COIN_TESSELLATOR_SWEEP_THRESHOLD");
+    threshold = env ? SbMax(atoi(env), 3) : 64;
+  }
+  return threshold;
+}
+
 // *************************************************************************
 // strict weak ordering is needed
 int
@@ -280,6 +358,7 @@ SbTesselator::beginPolygon(SbBool keepVerts, const SbVec3f & normal)
   PRIVATE(this)->headV = PRIVATE(this)->tailV = NULL;
   PRIVATE(this)->numVerts = 0;
   PRIVATE(this)->bbox.makeEmpty();
+  PRIVATE(this)->contourStarts.truncate(0);
 }
 
 /*!
@@ -289,7 +368,11 @@ SbTesselator::beginPolygon(SbBool keepVerts, const SbVec3f & normal)
 void
 SbTesselator::addVertex(const SbVec3f & v, void * data)
 {
+  const int numcontours = PRIVATE(this)->contourStarts.getLength();
+  const SbBool newcontour = numcontours > 0 &&
+    PRIVATE(this)->contourStarts[numcontours - 1] == PRIVATE(this)->currVertex;
   if (PRIVATE(this)->tailV &&
+      !newcontour &&
       !PRIVATE(this)->keepVertices &&
       v == PRIVATE(this)->tailV->v)
     return;
@@ -310,6 +393,30 @@ SbTesselator::addVertex(const SbVec3f & v, void * data)
   PRIVATE(this)->numVerts++;
 }
 
+/*!
+  Ends the current contour of the polygon, and starts a new one. The
+  following vertices will be added to the new contour.
+
+  Contours inside an odd number of other contours are holes in the
+  polygon, and contours inside holes are filled again. The contours
+  must not intersect each other or themselves, and their orientation
+  does not matter. Polygons with more than one contour are tessellated
+  with a sweep line. If that fails because of intersecting or
+  degenerate contours, each contour is tessellated as a separate
+  polygon.
+
+  \since Coin 4.1
+*/
+void
+SbTesselator::nextContour(void)
+{
+  const int numcontours = PRIVATE(this)->contourStarts.getLength();
+  const int start = numcontours ? PRIVATE(this)->contourStarts[numcontours - 1] : 0;
+  if (PRIVATE(this)->currVertex > start) {
+    PRIVATE(this)->contourStarts.append(PRIVATE(this)->currVertex);
+  }
+}
+
 /*!
   Signals the tessellator to begin tessellating. The callback function
   specified in the constructor (or set using the
@@ -319,8 +426,41 @@ SbTesselator::addVertex(const SbVec3f & v, void * data)
 void
 SbTesselator::endPolygon(void)
 {
-  // projection enums
-  enum { OXY, OXZ, OYZ };
+  const int numcontours = PRIVATE(this)->contourStarts.getLength();
+  if (numcontours > 0 &&
+      PRIVATE(this)->contourStarts[numcontours - 1] == PRIVATE(this)->currVertex) {
+    // nextContour() was called after the last vertex
+    PRIVATE(this)->contourStarts.truncate(numcontours - 1);
+  }
+  if (PRIVATE(this)->contourStarts.getLength() > 0) {
+    if (PRIVATE(this)->sweepTriangulate()) return;
+
+    // the contours could not be tessellated together, so tessellate
+    // them as separate polygons instead
+    SbList <int> starts;
+    starts.append(0);
+    for (int i = 0; i < PRIVATE(this)->contourStarts.getLength(); i++) {
+      starts.append(PRIVATE(this)->contourStarts[i]);
+    }
+    starts.append(PRIVATE(this)->currVertex);
+    PRIVATE(this)->contourStarts.truncate(0);
+    for (int c = 0; c < starts.getLength() - 1; c++) {
+      PRIVATE(this)->headV = PRIVATE(this)->tailV = NULL;
+      PRIVATE(this)->numVerts = 0;
+      for (int i = starts[c]; i < starts[c + 1]; i++) {
+        PImpl::Vertex * v = PRIVATE(this)->vertexStorage[i];
+        v->prev = PRIVATE(this)->tailV;
+        v->next = NULL;
+        v->dirtyweight = 1;
+        if (!PRIVATE(this)->headV) PRIVATE(this)->headV = v;
+        if (PRIVATE(this)->tailV) PRIVATE(this)->tailV->next = v;
+        PRIVATE(this)->tailV = v;
+        PRIVATE(this)->numVerts++;
+      }
+      this->endPolygon();
+    }
+    return;
+  }
 
   // check for special case when last point equals the first point
   if (!PRIVATE(this)->keepVertices && PRIVATE(this)->numVerts >= 3) {
@@ -338,43 +478,14 @@ SbTesselator::endPolygon(void)
 
   if (PRIVATE(this)->numVerts > 3) {
     PRIVATE(this)->calcPolygonNormal();
+    PRIVATE(this)->calcProjection();
 
-    // Find best projection plane
-    int projection;
-    if (fabs(PRIVATE(this)->polyNormal[0]) > fabs(PRIVATE(this)->polyNormal[1]))
-      if (fabs(PRIVATE(this)->polyNormal[0]) > fabs(PRIVATE(this)->polyNormal[2]))
-        projection = OYZ;
-      else
-        projection = OXY;
-    else
-      if (fabs(PRIVATE(this)->polyNormal[1]) > fabs(PRIVATE(this)->polyNormal[2]))
-        projection = OXZ;
-      else
-        projection = OXY;
-
-    switch (projection) {
-    case OYZ:
-      PRIVATE(this)->X = 1;
-      PRIVATE(this)->Y = 2;
-      PRIVATE(this)->polyDir = PRIVATE(this)->polyNormal[0] > 0 ? 1 : -1;
-      break;
-    case OXY:
-      PRIVATE(this)->X = 0;
-      PRIVATE(this)->Y = 1;
-      PRIVATE(this)->polyDir = PRIVATE(this)->polyNormal[2] > 0 ? 1 : -1;
-      break;
-    case OXZ:
-      PRIVATE(this)->X = 2;
-      PRIVATE(this)->Y = 0;
-      PRIVATE(this)->polyDir = PRIVATE(this)->polyNormal[1] > 0 ? 1 : -1;
-      break;
+    // ear clipping is quadratic in the number of vertices
+    if (PRIVATE(this)->numVerts > sbtesselator_sweep_threshold() &&
+        PRIVATE(this)->sweepTriangulate()) {
+      return;
     }
 
-    // find epsilon based on bbox
-    SbVec3f d;
-    PRIVATE(this)->bbox.getSize(d[0], d[1], d[2]);
-    PRIVATE(this)->epsilon = SbMin(d[PRIVATE(this)->X], d[PRIVATE(this)->Y]) * FLT_EPSILON * FLT_EPSILON;
-
     //Make loop
     PRIVATE(this)->tailV->next = PRIVATE(this)->headV;
     PRIVATE(this)->headV->prev = PRIVATE(this)->tailV;
@@ -717,6 +828,509 @@ SbTesselator::PImpl::calcPolygonNormal()
   }
 }
 
+//
+// Finds the best projection plane for the polygon normal, and the
+// epsilon used for empty triangles.
+//
+void
+SbTesselator::PImpl::calcProjection(void)
+{
+  // projection enums
+  enum { OXY, OXZ, OYZ };
+
+  // Find best projection plane
+  int projection;
+  if (fabs(polyNormal[0]) > fabs(polyNormal[1]))
+    if (fabs(polyNormal[0]) > fabs(polyNormal[2]))
+      projection = OYZ;
+    else
+      projection = OXY;
+  else
+    if (fabs(polyNormal[1]) > fabs(polyNormal[2]))
+      projection = OXZ;
+    else
+      projection = OXY;
+
+  switch (projection) {
+  case OYZ:
+    X = 1;
+    Y = 2;
+    polyDir = polyNormal[0] > 0 ? 1 : -1;
+    break;
+  case OXY:
+    X = 0;
+    Y = 1;
+    polyDir = polyNormal[2] > 0 ? 1 : -1;
+    break;
+  case OXZ:
+    X = 2;
+    Y = 0;
+    polyDir = polyNormal[1] > 0 ? 1 : -1;
+    break;
+  }
+
+  // find epsilon based on bbox
+  SbVec3f d;
+  bbox.getSize(d[0], d[1], d[2]);
+  epsilon = SbMin(d[X], d[Y]) * FLT_EPSILON * FLT_EPSILON;
+}
+
+// *************************************************************************
+//
+// Sweep line triangulation. The polygon is split into y-monotone
+// pieces by a sweep from top to bottom, which adds diagonals from the
+// split and merge vertices (where the boundary turns back upwards or
+// downwards), and each piece is then triangulated with a stack in
+// linear time. See chapter 3 of "Computational Geometry: Algorithms
+// and Applications" by de Berg et al.
+//
+// The points are projected to the plane so that the polygon is
+// counterclockwise, with the outer contours counterclockwise and the
+// holes clockwise, i.e. the polygon interior is always to the left
+// of the edges.
+//
+
+static inline double
+sbtesselator_orient(const double x0, const double y0,
+                    const double x1, const double y1,
+                    const double x2, const double y2)
+{
+  return (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+}
+
+// TRUE if point p0 is passed before p1 by the sweep line, which runs
+// from top to bottom, and from left to right for points at the same
+// height.
+SbBool
+SbTesselator::PImpl::above(const int p0, const int p1) const
+{
+  const SweepPoint & a = this->points.getArrayPtr()[p0];
+  const SweepPoint & b = this->points.getArrayPtr()[p1];
+  if (a.y != b.y) return a.y > b.y;
+  if (a.x != b.x) return a.x < b.x;
+  return p0 < p1;
+}
+
+// twice the signed area of the triangle p0, p1, p2
+double
+SbTesselator::PImpl::orient(const int p0, const int p1, const int p2) const
+{
+  const SweepPoint * pts = this->points.getArrayPtr();
+  return sbtesselator_orient(pts[p0].x, pts[p0].y, pts[p1].x, pts[p1].y,
+                             pts[p2].x, pts[p2].y);
+}
+
+// positive if (x, y) is to the right of edge, seen from above
+double
+SbTesselator::PImpl::edgeSide(const int edge, const double x, const double y) const
+{
+  const SweepPoint * pts = this->points.getArrayPtr();
+  int p0 = edge, p1 = pts[edge].next;
+  if (this->above(p1, p0)) std::swap(p0, p1);
+  return sbtesselator_orient(pts[p0].x, pts[p0].y, pts[p1].x, pts[p1].y, x, y);
+}
+
+bool
+SbTesselator::PImpl::EdgeLess::operator()(const int e0, const int e1) const
+{
+  if (e0 == e1) return false;
+  if (e0 < 0) return thisp->edgeSide(e1, thisp->query[0], thisp->query[1]) < 0.0;
+  if (e1 < 0) return thisp->edgeSide(e0, thisp->query[0], thisp->query[1]) > 0.0;
+
+  // test the upper point of the edge that was inserted last against
+  // the other edge, or its lower point if the edges share the upper
+  // point
+  const SweepPoint * pts = thisp->points.getArrayPtr();
+  int u0 = e0, l0 = pts[e0].next;
+  if (thisp->above(l0, u0)) std::swap(u0, l0);
+  int u1 = e1, l1 = pts[e1].next;
+  if (thisp->above(l1, u1)) std::swap(u1, l1);
+
+  if (thisp->above(u0, u1)) {
+    double side = thisp->edgeSide(e0, pts[u1].x, pts[u1].y);
+    if (side == 0.0) side = thisp->edgeSide(e0, pts[l1].x, pts[l1].y);
+    return side > 0.0;
+  }
+  double side = thisp->edgeSide(e1, pts[u0].x, pts[u0].y);
+  if (side == 0.0) side = thisp->edgeSide(e1, pts[l0].x, pts[l0].y);
+  return side < 0.0;
+}
+
+//
+// Adds the vertices in vertexStorage from start to end as a closed
+// contour.
+//
+SbBool
+SbTesselator::PImpl::addContour(const int start, int end)
+{
+  if (!keepVertices && end - start >= 3 &&
+      vertexStorage[start]->v == vertexStorage[end - 1]->v) {
+    end--;
+  }
+  if (end - start < 3) return keepVertices ? FALSE : TRUE;
+
+  const int first = points.getLength();
+  const double dir = polyDir;
+  for (int i = start; i < end; i++) {
+    SweepPoint p;
+    p.x = vertexStorage[i]->v[X] * dir;
+    p.y = vertexStorage[i]->v[Y];
+    p.prev = points.getLength() - 1;
+    p.next = points.getLength() + 1;
+    p.vertex = vertexStorage[i];
+    points.append(p);
+  }
+  const int last = points.getLength() - 1;
+  points[first].prev = last;
+  points[last].next = first;
+  return TRUE;
+}
+
+//
+// Triangulates the polygon, and calls the callback for each
+// triangle. Returns FALSE, without calling the callback, if the
+// polygon could not be triangulated, which may happen for self
+// intersecting or degenerate polygons.
+//
+SbBool
+SbTesselator::PImpl::sweepTriangulate(void)
+{
+  const int numcontours = contourStarts.getLength() + 1;
+  if (numcontours > 1) {
+    // Newell's method, summed over the contours
+    if (!hasNormal) {
+      polyNormal.setValue(0.0f, 0.0f, 0.0f);
+      for (int c = 0; c < numcontours; c++) {
+        const int start = c ? contourStarts[c - 1] : 0;
+        const int end = (c < numcontours - 1) ? contourStarts[c] : currVertex;
+        for (int i = start; i < end; i++) {
+          const SbVec3f & v0 = vertexStorage[i]->v;
+          const SbVec3f & v1 = vertexStorage[(i + 1 < end) ? i + 1 : start]->v;
+          polyNormal[0] += (v0[1] - v1[1]) * (v0[2] + v1[2]);
+          polyNormal[1] += (v0[2] - v1[2]) * (v0[0] + v1[0]);
+          polyNormal[2] += (v0[0] - v1[0]) * (v0[1] + v1[1]);
+        }
+      }
+      if (polyNormal.normalize() == 0.0f) return FALSE;
+    }
+    calcProjection();
+  }
+
+  points.truncate(0);
+  SbList <int> contourfirst;
+  if (numcontours == 1) {
+    contourfirst.append(0);
+    if (!addContour(0, numVerts)) return FALSE;
+  }
+  else {
+    for (int c = 0; c < numcontours; c++) {
+      contourfirst.append(points.getLength());
+      if (!addContour(c ? contourStarts[c - 1] : 0,
+                      (c < numcontours - 1) ? contourStarts[c] : currVertex)) {
+        return FALSE;
+      }
+    }
+  }
+  contourfirst.append(points.getLength());
+  const int numpoints = points.getLength();
+  if (numpoints < 3) return FALSE;
+
+  // orient outer contours counterclockwise and holes clockwise
+  SweepPoint * pts = &points[0];
+  expectedArea = 0.0;
+  expectedTriangles = 0;
+  for (int c = 0; c < numcontours; c++) {
+    const int first = contourfirst[c];
+    const int end = contourfirst[c + 1];
+    if (end - first < 3) continue;
+    double area = 0.0;
+    for (int i = first; i < end; i++) {
+      const SweepPoint & p1 = pts[pts[i].next];
+      area += pts[i].x * p1.y - p1.x * pts[i].y;
+    }
+    if (area == 0.0) return FALSE;
+    // even-odd containment of the contour's first point
+    int depth = 0;
+    for (int o = 0; o < numcontours; o++) {
+      if (o == c) continue;
+      SbBool inside = FALSE;
+      for (int i = contourfirst[o]; i < contourfirst[o + 1]; i++) {
+        const SweepPoint & a = pts[i];
+        const SweepPoint & b = pts[a.next];
+        if ((a.y > pts[first].y) != (b.y > pts[first].y) &&
+            pts[first].x < a.x + (pts[first].y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+          inside = !inside;
+        }
+      }
+      if (inside) depth++;
+    }
+    const SbBool hole = (depth & 1) != 0;
+    if ((area < 0.0) != hole) {
+      for (int i = first; i < end; i++) std::swap(pts[i].prev, pts[i].next);
+      area = -area;
+    }
+    expectedArea += area * 0.5;
+    expectedTriangles += (end - first) + (hole ? 2 : -2);
+  }
+  if (expectedArea <= 0.0) return FALSE;
+
+  triangles.truncate(0);
+  if (!decompose() || !triangulateFaces()) return FALSE;
+
+  // verify that the triangles cover the polygon
+  const int numtriangles = triangles.getLength() / 3;
+  if (numtriangles != expectedTriangles) return FALSE;
+  const int * tri = triangles.getArrayPtr();
+  double sum = 0.0;
+  for (int i = 0; i < numtriangles; i++) {
+    sum += orient(tri[i*3], tri[i*3+1], tri[i*3+2]) * 0.5;
+  }
+  if (fabs(sum - expectedArea) > expectedArea * 1e-6) return FALSE;
+
+  for (int i = 0; i < numtriangles; i++) {
+    const int * t = tri + i * 3;
+    if (!keepVertices && orient(t[0], t[1], t[2]) * 0.5 <= epsilon) continue;
+    callback(pts[t[0]].vertex->data, pts[t[1]].vertex->data,
+             pts[t[2]].vertex->data, callbackData);
+  }
+  return TRUE;
+}
+
+//
+// Sweeps the polygon from top to bottom, and adds the diagonals that
+// split it into y-monotone pieces.
+//
+SbBool
+SbTesselator::PImpl::decompose(void)
+{
+  const int numpoints = points.getLength();
+  order.truncate(0);
+  for (int i = 0; i < numpoints; i++) order.append(i);
+  std::sort(&order[0], &order[0] + numpoints, PointAbove(this));
+
+  enum { START, END, SPLIT, MERGE, REGULAR };
+  SbList <char> type(numpoints);
+  helper.truncate(0);
+  for (int i = 0; i < numpoints; i++) {
+    const SweepPoint & p = points.getArrayPtr()[i];
+    const SbBool prevbelow = above(i, p.prev);
+    const SbBool nextbelow = above(i, p.next);
+    const SbBool convex = orient(p.prev, i, p.next) > 0.0;
+    if (prevbelow && nextbelow) type.append(convex ? START : SPLIT);
+    else if (!prevbelow && !nextbelow) type.append(convex ? END : MERGE);
+    else type.append(REGULAR);
+    helper.append(-1);
+  }
+
+  EdgeSet status((EdgeLess(this)));
+  std::vector<EdgeSet::iterator> edges(numpoints, status.end());
+  diagonals.truncate(0);
+
+  for (int n = 0; n < numpoints; n++) {
+    const int v = order[n];
+    const int prev = points.getArrayPtr()[v].prev;
+
+    // the edge ending at v
+    if (type[v] == END || type[v] == MERGE ||
+        (type[v] == REGULAR && !above(v, prev))) {
+      if (edges[prev] == status.end()) return FALSE;
+      if (helper[prev] >= 0 && type[helper[prev]] == MERGE) {
+        diagonals.append(v);
+        diagonals.append(helper[prev]);
+      }
+      status.erase(edges[prev]);
+      edges[prev] = status.end();
+    }
+
+    // the edge directly to the left of v
+    if (type[v] == SPLIT || type[v] == MERGE ||
+        (type[v] == REGULAR && above(v, prev))) {
+      query[0] = points.getArrayPtr()[v].x;
+      query[1] = points.getArrayPtr()[v].y;
+      EdgeSet::iterator it = status.lower_bound(-1);
+      if (it == status.begin()) return FALSE;
+      const int left = *(--it);
+      if (type[v] == SPLIT ||
+          (helper[left] >= 0 && type[helper[left]] == MERGE)) {
+        diagonals.append(v);
+        diagonals.append(helper[left]);
+      }
+      helper[left] = v;
+    }
+
+    // the edge starting at v
+    if (type[v] == START || type[v] == SPLIT ||
+        (type[v] == REGULAR && !above(v, prev))) {
+      std::pair<EdgeSet::iterator, bool> inserted = status.insert(v);
+      if (!inserted.second) return FALSE;
+      edges[v] = inserted.first;
+      helper[v] = v;
+    }
+  }
+  return TRUE;
+}
+
+//
+// Walks the faces made by the polygon edges and the diagonals, and
+// triangulates each of them.
+//
+SbBool
+SbTesselator::PImpl::triangulateFaces(void)
+{
+  const int numpoints = points.getLength();
+  const int numdiagonals = diagonals.getLength() / 2;
+  const SweepPoint * pts = points.getArrayPtr();
+
+  // the half edges leaving each point, as (to, id) pairs. The
+  // polygon edges have the id of their first point, and diagonal i
+  // has the ids numpoints + 2i and numpoints + 2i + 1.
+  std::vector< std::vector< std::pair<int, int> > > out(numpoints);
+  for (int i = 0; i < numpoints; i++) {
+    out[i].push_back(std::make_pair(pts[i].next, i));
+  }
+  for (int i = 0; i < numdiagonals; i++) {
+    const int a = diagonals[i*2];
+    const int b = diagonals[i*2+1];
+    out[a].push_back(std::make_pair(b, numpoints + i*2));
+    out[b].push_back(std::make_pair(a, numpoints + i*2 + 1));
+  }
+
+  const int numhalfedges = numpoints + numdiagonals * 2;
+  std::vector<char> visited(numhalfedges, 0);
+  SbList <int> face;
+
+  for (int p = 0; p < numpoints; p++) {
+    for (size_t e = 0; e < out[p].size(); e++) {
+      if (visited[out[p][e].second]) continue;
+      face.truncate(0);
+      int from = p;
+      std::pair<int, int> h = out[p][e];
+      while (!visited[h.second]) {
+        visited[h.second] = 1;
+        face.append(from);
+        if (face.getLength() > numpoints) return FALSE;
+
+        // the face continues with the first half edge clockwise
+        // from the reverse of this one
+        const int to = h.first;
+        const double back = atan2(pts[from].y - pts[to].y, pts[from].x - pts[to].x);
+        double best = 0.0;
+        int bestidx = -1;
+        for (size_t k = 0; k < out[to].size(); k++) {
+          const int c = out[to][k].first;
+          double angle = back - atan2(pts[c].y - pts[to].y, pts[c].x - pts[to].x);
+          while (angle <= 0.0) angle += 2.0 * M_PI;
+          while (angle > 2.0 * M_PI) angle -= 2.0 * M_PI;
+          if (bestidx < 0 || angle < best) {
+            best = angle;
+            bestidx = (int) k;
+          }
+        }
+        from = to;
+        h = out[to][bestidx];
+      }
+      if (from != p) return FALSE;
+      if (face.getLength() < 3) return FALSE;
+      if (!triangulateMonotone(face.getArrayPtr(), face.getLength())) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+//
+// Triangulates a y-monotone counterclockwise polygon.
+//
+SbBool
+SbTesselator::PImpl::triangulateMonotone(const int * face, const int num)
+{
+  if (num == 3) {
+    addTriangle(face[0], face[1], face[2]);
+    return TRUE;
+  }
+
+  int top = 0, bottom = 0;
+  for (int i = 1; i < num; i++) {
+    if (above(face[i], face[top])) top = i;
+    if (above(face[bottom], face[i])) bottom = i;
+  }
+
+  // merge the two chains from top to bottom. The polygon is
+  // counterclockwise, so the left chain runs forward from the top.
+  SbList <int> sorted(num);
+  SbList <char> left(num);
+  int l = top, r = top;
+  sorted.append(face[top]);
+  left.append(TRUE);
+  while (sorted.getLength() < num) {
+    const int nl = (l + 1) % num;
+    const int nr = (r + num - 1) % num;
+    const SbBool takeleft = (l != bottom) &&
+      (r == bottom || above(face[nl], face[nr]));
+    if (takeleft) {
+      if (!above(face[l], face[nl])) return FALSE;
+      l = nl;
+      sorted.append(face[l]);
+      left.append(TRUE);
+    }
+    else {
+      if (!above(face[r], face[nr])) return FALSE;
+      r = nr;
+      sorted.append(face[r]);
+      left.append(FALSE);
+    }
+  }
+
+  SbList <int> stack;
+  stack.append(0);
+  stack.append(1);
+  for (int j = 2; j < num - 1; j++) {
+    const int top = stack[stack.getLength() - 1];
+    if (left[j] != left[top]) {
+      // connect to all the points on the stack
+      while (stack.getLength() > 1) {
+        const int s = stack.pop();
+        addTriangle(sorted[j], sorted[s], sorted[stack[stack.getLength() - 1]]);
+      }
+      stack.truncate(0);
+      stack.append(j - 1);
+      stack.append(j);
+    }
+    else {
+      int last = stack.pop();
+      while (stack.getLength() > 0) {
+        const int s = stack[stack.getLength() - 1];
+        const double o = orient(sorted[j], sorted[s], sorted[last]);
+        if (left[j] ? o <= 0.0 : o >= 0.0) break;
+        addTriangle(sorted[j], sorted[last], sorted[s]);
+        last = stack.pop();
+      }
+      stack.append(last);
+      stack.append(j);
+    }
+  }
+  // the bottom point connects to the rest of the stack
+  while (stack.getLength() > 1) {
+    const int s = stack.pop();
+    addTriangle(sorted[num - 1], sorted[s], sorted[stack[stack.getLength() - 1]]);
+  }
+  return TRUE;
+}
+
+// adds a counterclockwise triangle
+void
+SbTesselator::PImpl::addTriangle(const int p0, const int p1, const int p2)
+{
+  triangles.append(p0);
+  if (orient(p0, p1, p2) < 0.0) {
+    triangles.append(p2);
+    triangles.append(p1);
+  }
+  else {
+    triangles.append(p1);
+    triangles.append(p2);
+  }
+}
+
 //
 // makes sure Vertexes are not allocated and deallocated
 // all the time, by storing them in a growable array. This
@@ -745,3 +1359,122 @@ SbTesselator::PImpl::cleanUp()
 // *************************************************************************
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+#include <cmath>
+
+typedef SbList<SbVec3f> TessellatorTestTriangles;
+
+static void
+tessellator_test_cb(void * v0, void * v1, void * v2, void * data)
+{
+  TessellatorTestTriangles * triangles = static_cast<TessellatorTestTriangles *>(data);
+  triangles->append(*static_cast<SbVec3f *>(v0));
+  triangles->append(*static_cast<SbVec3f *>(v1));
+  triangles->append(*static_cast<SbVec3f *>(v2));
+}
+
+// the summed area of the triangles, which is negative if any of them
+// are clockwise
+static double
+tessellator_test_area(const TessellatorTestTriangles & triangles)
+{
+  double sum = 0.0;
+  const SbVec3f * t = triangles.getArrayPtr();
+  for (int i = 0; i < triangles.getLength(); i += 3) {
+    const double area = ((t[i+1] - t[i]).cross(t[i+2] - t[i]))[2] * 0.5;
+    if (area < 0.0) return -1.0;
+    sum += area;
+  }
+  return sum;
+}
+
+BOOST_AUTO_TEST_CASE(largeConcave)
+{
+  // a comb, which is well above the sweep line threshold
+  const int teeth = 100;
+  SbList<SbVec3f> points;
+  points.append(SbVec3f(0.0f, 0.0f, 0.0f));
+  points.append(SbVec3f(2.0f * teeth, 0.0f, 0.0f));
+  for (int i = teeth - 1; i >= 0; i--) {
+    points.append(SbVec3f(2.0f * i + 2.0f, 5.0f, 0.0f));
+    points.append(SbVec3f(2.0f * i + 1.0f, 5.0f, 0.0f));
+    points.append(SbVec3f(2.0f * i + 1.0f, 1.0f, 0.0f));
+    points.append(SbVec3f(2.0f * i, 1.0f, 0.0f));
+  }
+
+  TessellatorTestTriangles triangles;
+  SbTesselator tessellator(tessellator_test_cb, &triangles);
+  tessellator.beginPolygon();
+  for (int i = 0; i < points.getLength(); i++) {
+    tessellator.addVertex(points[i], &points[i]);
+  }
+  tessellator.endPolygon();
+
+  BOOST_CHECK_MESSAGE(triangles.getLength() == (points.getLength() - 2) * 3,
+                      "wrong number of triangles");
+  BOOST_CHECK_MESSAGE(fabs(tessellator_test_area(triangles) - 6.0 * teeth) < 1e-3,
+                      "triangles do not cover the polygon");
+}
+
+BOOST_AUTO_TEST_CASE(holes)
+{
+  // a square with four square holes, one of which has an island
+  SbList<SbVec3f> points;
+  const float squares[][3] = {
+    { 0.0f, 0.0f, 10.0f },
+    { 1.0f, 1.0f, 3.0f }, { 6.0f, 1.0f, 3.0f }, { 1.0f, 6.0f, 3.0f },
+    { 6.0f, 6.0f, 3.0f }, { 7.0f, 7.0f, 1.0f }
+  };
+  for (int i = 0; i < 6; i++) {
+    points.append(SbVec3f(squares[i][0], squares[i][1], 0.0f));
+    points.append(SbVec3f(squares[i][0] + squares[i][2], squares[i][1], 0.0f));
+    points.append(SbVec3f(squares[i][0] + squares[i][2], squares[i][1] + squares[i][2], 0.0f));
+    points.append(SbVec3f(squares[i][0], squares[i][1] + squares[i][2], 0.0f));
+  }
+
+  TessellatorTestTriangles triangles;
+  SbTesselator tessellator(tessellator_test_cb, &triangles);
+  tessellator.beginPolygon();
+  for (int i = 0; i < points.getLength(); i++) {
+    if (i > 0 && i % 4 == 0) tessellator.nextContour();
+    tessellator.addVertex(points[i], &points[i]);
+  }
+  tessellator.endPolygon();
+
+  // n + 2 * holes - 2 triangles for the outer square with its holes,
+  // and two for the island
+  BOOST_CHECK_MESSAGE(triangles.getLength() == (20 + 2 * 4 - 2 + 2) * 3,
+                      "wrong number of triangles");
+  BOOST_CHECK_MESSAGE(fabs(tessellator_test_area(triangles) - (100.0 - 4 * 9.0 + 1.0)) < 1e-3,
+                      "triangles do not cover the polygon");
+}
+
+BOOST_AUTO_TEST_CASE(small)
+{
+  // an L shape, which is tessellated by ear clipping
+  SbList<SbVec3f> points;
+  points.append(SbVec3f(0.0f, 0.0f, 0.0f));
+  points.append(SbVec3f(2.0f, 0.0f, 0.0f));
+  points.append(SbVec3f(2.0f, 1.0f, 0.0f));
+  points.append(SbVec3f(1.0f, 1.0f, 0.0f));
+  points.append(SbVec3f(1.0f, 2.0f, 0.0f));
+  points.append(SbVec3f(0.0f, 2.0f, 0.0f));
+
+  TessellatorTestTriangles triangles;
+  SbTesselator tessellator(tessellator_test_cb, &triangles);
+  tessellator.beginPolygon();
+  for (int i = 0; i < points.getLength(); i++) {
+    tessellator.addVertex(points[i], &points[i]);
+  }
+  tessellator.endPolygon();
+
+  BOOST_CHECK_MESSAGE(triangles.getLength() == 4 * 3, "wrong number of triangles");
+  BOOST_CHECK_MESSAGE(fabs(tessellator_test_area(triangles) - 3.0) < 1e-6,
+                      "triangles do not cover the polygon");
+}
+
+#endif // COIN_TEST_SUITE
@@ -222,20 +222,21 @@ SbXfBox3f::extendBy(const SbBox3f & bb)
   SbBox3f box1 = *this;
   {
     SbMatrix im = this->getInverse();
-    // Transform all the corners and include them into the new box.
+    SbVec3f corners[8], dsts[8];
     for (int i=0; i < 8; i++) {
-      SbVec3f corner, dst;
       // Find all corners the "binary" way :-)
-      corner.setValue(points[(i&4)>>2][0],
-                      points[(i&2)>>1][1],
-                      points[i&1][2]);
-      // Don't try to optimize the transformation out of the loop,
-      // it's not as easy as it seems.
-      im.multVecMatrix(corner, dst);
+      corners[i].setValue(points[(i&4)>>2][0],
+                          points[(i&2)>>1][1],
+                          points[i&1][2]);
+    }
+    im.multVecMatrix(corners, dsts, 8);
+    // Include all the transformed corners into the new box.
+    for (int i=0; i < 8; i++) {
+      const SbVec3f & dst = dsts[i];
 #if 0 // debug
       SoDebugError::postInfo("SbXfBox3f::extendBy",
                              "point: <%f, %f, %f> -> <%f, %f, %f>",
-                             corner[0], corner[1], corner[2],
+                             corners[i][0], corners[i][1], corners[i][2],
                              dst[0], dst[1], dst[2]);
 #endif // debug
       box1.extendBy(dst);
@@ -340,16 +341,20 @@ SbXfBox3f::extendBy(const SbXfBox3f & bb)
       SbMatrix m = bb.getTransform();
       m.multRight(box1.getInverse());
 
+      SbVec3f corners[8], dsts[8];
+      for (int i=0; i < 8; i++) {
+        corners[i].setValue(points[(i&4)>>2][0],
+                            points[(i&2)>>1][1],
+                            points[i&1][2]);
+      }
+      m.multVecMatrix(corners, dsts, 8);
+
       for (int i=0; i < 8; i++) {
-        SbVec3f corner, dst;
-        corner.setValue(points[(i&4)>>2][0],
-                        points[(i&2)>>1][1],
-                        points[i&1][2]);
-        m.multVecMatrix(corner, dst);
+        const SbVec3f & dst = dsts[i];
 #if 0 // debug
         SoDebugError::postInfo("SbXfBox3f::extendBy",
                                "corner: <%f, %f, %f>, dst <%f, %f, %f>",
-                               corner[0], corner[1], corner[2],
+                               corners[i][0], corners[i][1], corners[i][2],
                                dst[0], dst[1], dst[2]);
 #endif // debug
         static_cast<SbBox3f *>(&box1)->extendBy(dst);
@@ -377,16 +382,20 @@ SbXfBox3f::extendBy(const SbXfBox3f & bb)
       SbMatrix m = this->getTransform();
       m.multRight(box2.getInverse());
 
+      SbVec3f corners[8], dsts[8];
       for (int i=0; i < 8; i++) {
-        SbVec3f corner, dst;
-        corner.setValue(points[(i&4)>>2][0],
-                        points[(i&2)>>1][1],
-                        points[i&1][2]);
-        m.multVecMatrix(corner, dst);
+        corners[i].setValue(points[(i&4)>>2][0],
+                            points[(i&2)>>1][1],
+                            points[i&1][2]);
+      }
+      m.multVecMatrix(corners, dsts, 8);
+
+      for (int i=0; i < 8; i++) {
+        const SbVec3f & dst = dsts[i];
 #if 0 // debug
         SoDebugError::postInfo("SbXfBox3f::extendBy",
                                "corner: <%f, %f, %f>, dst <%f, %f, %f>",
-                               corner[0], corner[1], corner[2],
+                               corners[i][0], corners[i][1], corners[i][2],
                                dst[0], dst[1], dst[2]);
 #endif // debug
         static_cast<SbBox3f *>(&box2)->extendBy(dst);
@@ -549,11 +558,13 @@ intersect_box_box(const SbVec3f & min,
   SbVec3f transpoints[8];
   SbBox3f alignedBox;
   for (int i = 0;  i < 8; i++) {
-    SbVec3f tmp, tmp2;
-    tmp.setValue((i&4) ? boxmin[0] : boxmax[0],
-                 (i&2) ? boxmin[1] : boxmax[1],
-                 (i&1) ? boxmin[2] : boxmax[2]);
-    matrix.multVecMatrix(tmp, tmp2);
+    transpoints[i].setValue((i&4) ? boxmin[0] : boxmax[0],
+                            (i&2) ? boxmin[1] : boxmax[1],
+                            (i&1) ? boxmin[2] : boxmax[2]);
+  }
+  matrix.multVecMatrix(transpoints, transpoints, 8);
+  for (int i = 0;  i < 8; i++) {
+    const SbVec3f & tmp2 = transpoints[i];
     // is point inside
     if (tmp2[0] >= min[0] &&
         tmp2[0] <= max[0] &&
@@ -564,7 +575,6 @@ intersect_box_box(const SbVec3f & min,
       return TRUE;
     }
     alignedBox.extendBy(tmp2);
-    transpoints[i] = tmp2;
   }
   // this is just an optimization:
   // if the axis aligned box doesn't intersect the box, there
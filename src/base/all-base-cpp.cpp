@@ -59,6 +59,7 @@
 #include "SbDPPlane.cpp"
 #include "SbRotation.cpp"
 #include "SbDPRotation.cpp"
+#include "SbSpatialHash.cpp"
 #include "SbSphere.cpp"
 #include "SbString.cpp"
 #include "SbTesselator.cpp"
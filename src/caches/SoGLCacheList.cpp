@@ -58,6 +58,7 @@
 #include "tidbitsp.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLRenderStatistics.h"
 
 // *************************************************************************
 
@@ -180,7 +181,10 @@ SoGLCacheList::call(SoGLRenderAction * action)
 {
   // do a quick return if there are no caches in the list
   int n = PRIVATE(this)->itemlist.getLength();
-  if (n == 0) return FALSE;
+  if (n == 0) {
+    SoGLRenderStatistics::count(SoGLRenderAction::RENDER_CACHE_MISSES);
+    return FALSE;
+  }
 
   int i;
   SoState * state = action->getState();
@@ -204,6 +208,7 @@ SoGLCacheList::call(SoGLRenderAction * action)
         SoGLLazyElement::postCacheCall(state, cache->getPostLazyState());
         cache->unref(state);
         PRIVATE(this)->numused++;
+        SoGLRenderStatistics::count(SoGLRenderAction::RENDER_CACHE_HITS);
 
 #if COIN_DEBUG
         // The GL error test is default disabled for this optimized
@@ -447,6 +452,7 @@ SoGLCacheList::call(SoGLRenderAction * action)
     }
   }
 #endif // debug
+  SoGLRenderStatistics::count(SoGLRenderAction::RENDER_CACHE_MISSES);
   return FALSE;
 }
 
@@ -609,6 +615,7 @@ SoGLCacheList::close(SoGLRenderAction * action)
 #endif // debug
     PRIVATE(this)->itemlist.append(PRIVATE(this)->opencache);
     PRIVATE(this)->opencache = NULL;
+    SoGLRenderStatistics::count(SoGLRenderAction::RENDER_CACHES_CREATED);
   }
 
   PRIVATE(this)->numshapes = SoGLCacheContextElement::getNumShapes(state);
@@ -51,16 +51,63 @@
 #include <Inventor/caches/SoNormalCache.h>
 
 #include <cfloat> // FLT_EPSILON
+#include <cstring>
 
 #include <Inventor/misc/SoNormalGenerator.h>
 #include <Inventor/lists/SbList.h>
 #include <Inventor/errors/SoDebugError.h>
 
 #include "tidbitsp.h"
+#include "misc/SoPartialChangeLog.h"
 
 // *************************************************************************
 
 #ifndef DOXYGEN_SKIP_THIS
+
+//
+// The mesh topology used when generating per vertex normals, kept so
+// that the normals can be updated when only some of the coordinates
+// have changed. Only well-formed index sets (all indices valid, and
+// at least three vertices per face) are supported.
+//
+class SoNormalCacheTopology {
+public:
+  SoNormalCacheTopology(void);
+  ~SoNormalCacheTopology();
+
+  SbBool build(const SbVec3f * coords, const unsigned int numcoords,
+               const int32_t * vindex, const int numvi,
+               const float threshold, const SbBool ccw,
+               SbList <SbVec3f> & normals, SbList <int32_t> & indices);
+  SbBool matches(const unsigned int numcoords,
+                 const int32_t * vindex, const int numvi,
+                 const float threshold, const SbBool ccw) const;
+  SbBool update(const SbVec3f * coords, const int start, const int num,
+                SbList <SbVec3f> & normals, SbList <int32_t> & indices);
+
+private:
+  void calcFaceNormal(const SbVec3f * coords, const int face);
+  void calcVertexNormals(const int vertex, const SbBool append,
+                           SbList <SbVec3f> & normals,
+                           SbList <int32_t> & indices);
+
+  int32_t * coordindex;
+  int numvi;
+  unsigned int numcoords;
+  float threshold;
+  SbBool ccw;
+
+  int numfaces;
+  int * facestart;         // [numfaces+1], offset of first index of face
+  int32_t * cornerface;    // [numvi], face for each index, -1 for separators
+  SbVec3f * facenormals;   // [numfaces]
+  int * vertexstart;       // [numcoords+1], offsets into vertexcorners
+  int32_t * vertexcorners; // [numvi], the indices (corners) using a vertex
+  int * slotstart;         // [numcoords], first normal used by a vertex
+  int * slotcount;         // [numcoords], number of normals reserved for a vertex
+  int numunused;           // number of normals no longer used by any vertex
+};
+
 class SoNormalCacheP {
 public:
   int numNormals;
@@ -70,6 +117,10 @@ public:
   } normalData;
   SbList <int32_t> indices;
   SbList <SbVec3f> normalArray;
+
+  SoNormalCache * prevcache;
+  SbUniqueId coordnodeid;
+  SoNormalCacheTopology * topology;
 };
 #endif // DOXYGEN_SKIP_THIS
 
@@ -83,6 +134,10 @@ public:
 
 #define NORMALCACHE_DEBUG 0 // Set to one for debug output
 
+// Minimum number of coordinate indices before the topology needed to
+// update the per vertex normals is kept.
+#define INCREMENTAL_MIN_INDICES 4096
+
 // *************************************************************************
 
 /*!
@@ -94,6 +149,9 @@ SoNormalCache::SoNormalCache(SoState * const state)
   PRIVATE(this) = new SoNormalCacheP;
   PRIVATE(this)->normalData.normals = NULL;
   PRIVATE(this)->numNormals = 0;
+  PRIVATE(this)->prevcache = NULL;
+  PRIVATE(this)->coordnodeid = 0;
+  PRIVATE(this)->topology = NULL;
 
 #if COIN_DEBUG
   if (coin_debug_caching_level() > 0) {
@@ -260,6 +318,51 @@ SoNormalCache::generatePerVertex(const SbVec3f * const coords,
   PRIVATE(this)->indices.truncate(0);
   PRIVATE(this)->normalArray.truncate(0);
 
+  float threshold = static_cast<float>(cos(SbClamp(crease_angle, 0.0f, static_cast<float>(M_PI))));
+
+  SoNormalCache * prevcache = PRIVATE(this)->prevcache;
+  PRIVATE(this)->prevcache = NULL;
+
+  int changestart, numchanged;
+  if (prevcache && !tristrip && (facenormals == NULL) &&
+      (numvi >= INCREMENTAL_MIN_INDICES) &&
+      SoPartialChangeLog::getChanges(PRIVATE(prevcache)->coordnodeid,
+                                     PRIVATE(this)->coordnodeid,
+                                     changestart, numchanged)) {
+    SoNormalCacheTopology * topology = PRIVATE(prevcache)->topology;
+    SbBool ok = FALSE;
+    if (topology && topology->matches(numcoords, vindex, numvi, threshold, ccw)) {
+      // only some of the coordinates have changed, update the normals
+      // around these coordinates
+      PRIVATE(prevcache)->topology = NULL;
+      PRIVATE(this)->normalArray = PRIVATE(prevcache)->normalArray;
+      PRIVATE(this)->indices = PRIVATE(prevcache)->indices;
+      ok = topology->update(coords, changestart, numchanged,
+                            PRIVATE(this)->normalArray, PRIVATE(this)->indices);
+      if (!ok) {
+        delete topology;
+        topology = NULL;
+      }
+    }
+    if (!ok) {
+      // the coordinates are being edited. Generate all normals, but
+      // keep the topology to make the next update faster.
+      topology = new SoNormalCacheTopology;
+      ok = topology->build(coords, numcoords, vindex, numvi, threshold, ccw,
+                           PRIVATE(this)->normalArray, PRIVATE(this)->indices);
+      if (!ok) delete topology;
+    }
+    if (ok) {
+      PRIVATE(this)->topology = topology;
+      if (PRIVATE(this)->normalArray.getLength()) {
+        PRIVATE(this)->normalData.normals = PRIVATE(this)->normalArray.getArrayPtr();
+        PRIVATE(this)->numNormals = PRIVATE(this)->normalArray.getLength();
+      }
+      return;
+    }
+    PRIVATE(this)->indices.truncate(0);
+    PRIVATE(this)->normalArray.truncate(0);
+  }
 
 #if COIN_DEBUG && 0 // debug
   SoDebugError::postInfo("SoNormalCache::generatePerVertex", "%d", numvi);
@@ -361,7 +464,6 @@ SoNormalCache::generatePerVertex(const SbVec3f * const coords,
     }
   }
 
-  float threshold = static_cast<float>(cos(SbClamp(crease_angle, 0.0f, static_cast<float>(M_PI))));
   SbBool found;
   int currindex = 0; // current normal index
   int nindex = 0;
@@ -445,6 +547,26 @@ SoNormalCache::generatePerVertex(const SbVec3f * const coords,
   delete [] vertexNormalArray;
 }
 
+/*!
+  Sets the cache this cache replaces, and the id of the coordinate
+  node the normals will be generated from. If only a range of the
+  coordinates has changed since \a prevcache was generated, the next
+  call to generatePerVertex() will update the normals from \a
+  prevcache instead of generating all of them again.
+
+  \a prevcache is only used by the next call to generatePerVertex(),
+  and must not be destructed before this call.
+
+  \COIN_FUNCTION_EXTENSION
+*/
+void
+SoNormalCache::setPreviousCache(SoNormalCache * prevcache,
+                                const SbUniqueId coordnodeid)
+{
+  PRIVATE(this)->prevcache = prevcache;
+  PRIVATE(this)->coordnodeid = coordnodeid;
+}
+
 /*!
   Generates face normals for the faceset defined by \a coords
   and \a cind. 
@@ -1135,8 +1257,484 @@ SoNormalCache::clearGenerator(void)
   }
   PRIVATE(this)->normalData.normals = NULL;
   PRIVATE(this)->numNormals = 0;
+  delete PRIVATE(this)->topology;
+  PRIVATE(this)->topology = NULL;
+}
+
+// *************************************************************************
+
+#ifndef DOXYGEN_SKIP_THIS
+
+SoNormalCacheTopology::SoNormalCacheTopology(void)
+  : coordindex(NULL),
+    numvi(0),
+    numcoords(0),
+    threshold(0.0f),
+    ccw(TRUE),
+    numfaces(0),
+    facestart(NULL),
+    cornerface(NULL),
+    facenormals(NULL),
+    vertexstart(NULL),
+    vertexcorners(NULL),
+    slotstart(NULL),
+    slotcount(NULL),
+    numunused(0)
+{
+}
+
+SoNormalCacheTopology::~SoNormalCacheTopology()
+{
+  delete[] this->coordindex;
+  delete[] this->facestart;
+  delete[] this->cornerface;
+  delete[] this->facenormals;
+  delete[] this->vertexstart;
+  delete[] this->vertexcorners;
+  delete[] this->slotstart;
+  delete[] this->slotcount;
+}
+
+//
+// Returns TRUE if the topology was built from the same indices and
+// settings.
+//
+SbBool
+SoNormalCacheTopology::matches(const unsigned int numcoordsarg,
+                               const int32_t * vindex, const int numviarg,
+                               const float thresholdarg, const SbBool ccwarg) const
+{
+  return
+    (this->numcoords == numcoordsarg) &&
+    (this->numvi == numviarg) &&
+    (this->threshold == thresholdarg) &&
+    (this->ccw == ccwarg) &&
+    (memcmp(this->coordindex, vindex, numviarg * sizeof(int32_t)) == 0);
+}
+
+//
+// Calculates the normal for a face, using the same method as
+// SoNormalCache::generatePerFace().
+//
+void
+SoNormalCacheTopology::calcFaceNormal(const SbVec3f * coords, const int face)
+{
+  const int32_t * cind = this->coordindex + this->facestart[face];
+  const int n = this->facestart[face+1] - this->facestart[face] - 1;
+  SbVec3f tmpvec;
+
+  if (n == 3) {
+    const SbVec3f & c0 = coords[cind[0]];
+    const SbVec3f & c1 = coords[cind[1]];
+    const SbVec3f & c2 = coords[cind[2]];
+    if (!this->ccw)
+      tmpvec = (c0 - c1).cross(c2 - c1);
+    else
+      tmpvec = (c2 - c1).cross(c0 - c1);
+    tmpvec.normalize();
+  }
+  else {
+    // Newell's method
+    const SbVec3f * vert1, * vert2;
+    tmpvec.setValue(0.0f, 0.0f, 0.0f);
+    vert2 = coords + cind[0];
+    for (int i = 1; i <= n; i++) {
+      vert1 = vert2;
+      vert2 = coords + cind[i < n ? i : 0]; // last edge back to v0
+      tmpvec[0] += ((*vert1)[1] - (*vert2)[1]) * ((*vert1)[2] + (*vert2)[2]);
+      tmpvec[1] += ((*vert1)[2] - (*vert2)[2]) * ((*vert1)[0] + (*vert2)[0]);
+      tmpvec[2] += ((*vert1)[0] - (*vert2)[0]) * ((*vert1)[1] + (*vert2)[1]);
+    }
+    tmpvec.normalize();
+    if (!this->ccw) tmpvec = -tmpvec;
+  }
+  this->facenormals[face] = tmpvec;
+}
+
+//
+// Calculates the normals for all corners using a vertex, using the
+// same method as SoNormalCache::generatePerVertex(). Equal normals
+// are shared, but only between corners using the same vertex. When
+// not appending, the normals are written into the slots reserved for
+// the vertex. If there's not enough slots, new slots are allocated at
+// the end of the normal array, and the old slots are left unused.
+//
+void
+SoNormalCacheTopology::calcVertexNormals(const int vertex, const SbBool append,
+                                         SbList <SbVec3f> & normals,
+                                         SbList <int32_t> & indices)
+{
+  const int cstart = this->vertexstart[vertex];
+  const int cend = this->vertexstart[vertex+1];
+  if (append) {
+    this->slotstart[vertex] = normals.getLength();
+    this->slotcount[vertex] = 0;
+  }
+  const int first = this->slotstart[vertex];
+  int used = 0;
+
+  for (int i = cstart; i < cend; i++) {
+    const int corner = this->vertexcorners[i];
+    const int face = this->cornerface[corner];
+    const SbVec3f & facenormal = this->facenormals[face];
+    SbVec3f vertnormal = facenormal;
+    for (int j = cstart; j < cend; j++) {
+      const int currface = this->cornerface[this->vertexcorners[j]];
+      if (currface != face) {
+        const SbVec3f & normal = this->facenormals[currface];
+        if (normal.dot(facenormal) > this->threshold) {
+          vertnormal += normal;
+        }
+      }
+    }
+    vertnormal.normalize();
+
+    int idx = -1;
+    for (int k = 0; k < used && idx < 0; k++) {
+      if (normals[first + k].equals(vertnormal, NORMAL_EPSILON)) idx = first + k;
+    }
+    if (idx < 0) {
+      if (append) {
+        normals.append(vertnormal);
+        this->slotcount[vertex]++;
+      }
+      else if (used < this->slotcount[vertex]) {
+        normals[first + used] = vertnormal;
+      }
+      else {
+        this->numunused += this->slotcount[vertex];
+        this->slotstart[vertex] = normals.getLength();
+        this->slotcount[vertex] = cend - cstart;
+        for (int k = 0; k < cend - cstart; k++) normals.append(SbVec3f(0.0f, 0.0f, 0.0f));
+        this->calcVertexNormals(vertex, FALSE, normals, indices);
+        return;
+      }
+      idx = first + used;
+      used++;
+    }
+    indices[corner] = idx;
+  }
+}
+
+//
+// Builds the topology and generates all normals. Returns FALSE if
+// the indices are not supported.
+//
+SbBool
+SoNormalCacheTopology::build(const SbVec3f * coords, const unsigned int numcoordsarg,
+                             const int32_t * vindex, const int numviarg,
+                             const float thresholdarg, const SbBool ccwarg,
+                             SbList <SbVec3f> & normals, SbList <int32_t> & indices)
+{
+  int i;
+  this->numcoords = numcoordsarg;
+  this->numvi = numviarg;
+  this->threshold = thresholdarg;
+  this->ccw = ccwarg;
+
+  // find the faces, and verify that all faces are valid
+  this->cornerface = new int32_t[numviarg];
+  SbList <int> starts;
+  int numinface = 0;
+  starts.append(0);
+  for (i = 0; i < numviarg; i++) {
+    const int32_t idx = vindex[i];
+    if (idx >= 0 && static_cast<unsigned int>(idx) < numcoordsarg) {
+      this->cornerface[i] = starts.getLength() - 1;
+      numinface++;
+    }
+    else if (idx == -1 && numinface >= 3) {
+      this->cornerface[i] = -1;
+      starts.append(i + 1);
+      numinface = 0;
+    }
+    else {
+      return FALSE;
+    }
+  }
+  if (numinface > 0) {
+    // last face not terminated with -1
+    if (numinface < 3) return FALSE;
+    starts.append(numviarg + 1);
+  }
+  this->numfaces = starts.getLength() - 1;
+  this->facestart = new int[starts.getLength()];
+  memcpy(this->facestart, starts.getArrayPtr(), starts.getLength() * sizeof(int));
+
+  this->coordindex = new int32_t[numviarg];
+  memcpy(this->coordindex, vindex, numviarg * sizeof(int32_t));
+
+  this->facenormals = new SbVec3f[this->numfaces > 0 ? this->numfaces : 1];
+  for (i = 0; i < this->numfaces; i++) {
+    this->calcFaceNormal(coords, i);
+  }
+
+  // for each vertex, store all corners using the vertex, in the order
+  // they are specified
+  this->vertexstart = new int[numcoordsarg + 1];
+  memset(this->vertexstart, 0, (numcoordsarg + 1) * sizeof(int));
+  for (i = 0; i < numviarg; i++) {
+    if (vindex[i] >= 0) this->vertexstart[vindex[i] + 1]++;
+  }
+  for (i = 0; i < static_cast<int>(numcoordsarg); i++) {
+    this->vertexstart[i+1] += this->vertexstart[i];
+  }
+  this->vertexcorners = new int32_t[numviarg];
+  int * fill = new int[numcoordsarg > 0 ? numcoordsarg : 1];
+  memcpy(fill, this->vertexstart, numcoordsarg * sizeof(int));
+  for (i = 0; i < numviarg; i++) {
+    if (vindex[i] >= 0) this->vertexcorners[fill[vindex[i]]++] = i;
+  }
+  delete[] fill;
+
+  normals.truncate(0);
+  indices.truncate(0);
+  indices.ensureCapacity(numviarg);
+  for (i = 0; i < numviarg; i++) indices.append(-1);
+
+  this->slotstart = new int[numcoordsarg > 0 ? numcoordsarg : 1];
+  this->slotcount = new int[numcoordsarg > 0 ? numcoordsarg : 1];
+  for (i = 0; i < static_cast<int>(numcoordsarg); i++) {
+    this->calcVertexNormals(i, TRUE, normals, indices);
+  }
+  return TRUE;
 }
 
+//
+// Updates the normals after coordinates [start, start+num> have
+// changed. Returns FALSE if the normals should be generated again
+// to reduce memory usage.
+//
+SbBool
+SoNormalCacheTopology::update(const SbVec3f * coords, const int start, const int num,
+                              SbList <SbVec3f> & normals, SbList <int32_t> & indices)
+{
+  const int end = SbMin(start + num, static_cast<int>(this->numcoords));
+  int i, j;
+
+  // find and update the faces using the changed coordinates
+  SbList <int> faces;
+  unsigned char * facemark = new unsigned char[this->numfaces > 0 ? this->numfaces : 1];
+  memset(facemark, 0, this->numfaces);
+  for (i = SbMax(start, 0); i < end; i++) {
+    for (j = this->vertexstart[i]; j < this->vertexstart[i+1]; j++) {
+      const int face = this->cornerface[this->vertexcorners[j]];
+      if (!facemark[face]) {
+        facemark[face] = 1;
+        faces.append(face);
+      }
+    }
+  }
+  delete[] facemark;
+
+  const int numchangedfaces = faces.getLength();
+  for (i = 0; i < numchangedfaces; i++) {
+    this->calcFaceNormal(coords, faces[i]);
+  }
+
+  // the normals of all vertices in these faces need to be updated
+  unsigned char * vertexmark = new unsigned char[this->numcoords > 0 ? this->numcoords : 1];
+  memset(vertexmark, 0, this->numcoords);
+  for (i = 0; i < numchangedfaces; i++) {
+    const int face = faces[i];
+    for (j = this->facestart[face]; j < this->facestart[face+1] - 1; j++) {
+      const int vertex = this->coordindex[j];
+      if (!vertexmark[vertex]) {
+        vertexmark[vertex] = 1;
+        this->calcVertexNormals(vertex, FALSE, normals, indices);
+      }
+    }
+  }
+  delete[] vertexmark;
+
+  // generate the normals again when too many normals are unused
+  return this->numunused <= normals.getLength() / 2;
+}
+
+#endif // DOXYGEN_SKIP_THIS
+
+#undef INCREMENTAL_MIN_INDICES
 #undef NORMAL_EPSILON
 #undef NORMALCACHE_DEBUG
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoCoordinate3.h>
+
+static void
+generate_grid_normals(SoNormalCache * cache, SoCoordinate3 * coord,
+                      const SbList <int32_t> & cindex)
+{
+  cache->generatePerVertex(coord->point.getValues(0), coord->point.getNum(),
+                           cindex.getArrayPtr(), cindex.getLength(),
+                           0.5f, NULL, -1, TRUE, FALSE);
+}
+
+BOOST_AUTO_TEST_CASE(partialUpdate)
+{
+  const int size = 64;
+  int i, j;
+
+  SoCoordinate3 * coord = new SoCoordinate3;
+  coord->ref();
+  coord->point.setNum(size * size);
+  SbVec3f * pts = coord->point.startEditing();
+  for (i = 0; i < size; i++) {
+    for (j = 0; j < size; j++) {
+      pts[i*size+j].setValue(float(j), float(i), float((i*j) % 5) * 0.25f);
+    }
+  }
+  coord->point.finishEditing();
+
+  SbList <int32_t> cindex;
+  for (i = 0; i < size - 1; i++) {
+    for (j = 0; j < size - 1; j++) {
+      cindex.append(i*size+j);
+      cindex.append(i*size+j+1);
+      cindex.append((i+1)*size+j+1);
+      if (j % 2) cindex.append((i+1)*size+j); // mix triangles and quads
+      cindex.append(-1);
+    }
+  }
+
+  SoNormalCache * prev = new SoNormalCache(NULL);
+  prev->ref();
+  prev->setPreviousCache(NULL, coord->getNodeId());
+  generate_grid_normals(prev, coord, cindex);
+
+  // the first edit keeps the topology, the following ones update
+  // the normals from the previous cache
+  for (int edit = 0; edit < 3; edit++) {
+    const int idx = 10 * size + 10 + edit * 7;
+    coord->point.set1Value(idx, coord->point[idx] + SbVec3f(0.0f, 0.0f, 3.0f));
+
+    SoNormalCache * cache = new SoNormalCache(NULL);
+    cache->ref();
+    cache->setPreviousCache(prev, coord->getNodeId());
+    generate_grid_normals(cache, coord, cindex);
+    prev->unref();
+    prev = cache;
+
+    SoNormalCache * full = new SoNormalCache(NULL);
+    full->ref();
+    generate_grid_normals(full, coord, cindex);
+
+    BOOST_REQUIRE(cache->getNumIndices() == full->getNumIndices());
+    const int32_t * ci = cache->getIndices();
+    const int32_t * fi = full->getIndices();
+    SbBool same = TRUE;
+    for (i = 0; i < full->getNumIndices(); i++) {
+      if (fi[i] < 0 || ci[i] < 0) {
+        if (fi[i] != ci[i]) same = FALSE;
+      }
+      else if (!cache->getNormals()[ci[i]].equals(full->getNormals()[fi[i]], 1.0e-6f)) {
+        same = FALSE;
+      }
+    }
+    BOOST_CHECK_MESSAGE(same, "updated normals differ from generated normals");
+    full->unref();
+  }
+  prev->unref();
+  coord->unref();
+}
+
+static SbBool
+same_grid_normals(SoNormalCache * cache, SoCoordinate3 * coord,
+                  const SbList <int32_t> & cindex)
+{
+  SoNormalCache * full = new SoNormalCache(NULL);
+  full->ref();
+  generate_grid_normals(full, coord, cindex);
+
+  SbBool same = cache->getNumIndices() == full->getNumIndices();
+  const int32_t * ci = cache->getIndices();
+  const int32_t * fi = full->getIndices();
+  for (int i = 0; same && i < full->getNumIndices(); i++) {
+    if (fi[i] < 0 || ci[i] < 0) {
+      if (fi[i] != ci[i]) same = FALSE;
+    }
+    else if (!cache->getNormals()[ci[i]].equals(full->getNormals()[fi[i]], 1.0e-6f)) {
+      same = FALSE;
+    }
+  }
+  full->unref();
+  return same;
+}
+
+BOOST_AUTO_TEST_CASE(partialUpdateWithoutNotify)
+{
+  const int size = 64;
+  int i, j;
+
+  SoCoordinate3 * coord = new SoCoordinate3;
+  coord->ref();
+  coord->point.setNum(size * size);
+  SbVec3f * pts = coord->point.startEditing();
+  for (i = 0; i < size; i++) {
+    for (j = 0; j < size; j++) {
+      pts[i*size+j].setValue(float(j), float(i), 0.0f);
+    }
+  }
+  coord->point.finishEditing();
+
+  SbList <int32_t> cindex;
+  for (i = 0; i < size - 1; i++) {
+    for (j = 0; j < size - 1; j++) {
+      cindex.append(i*size+j);
+      cindex.append(i*size+j+1);
+      cindex.append((i+1)*size+j+1);
+      cindex.append((i+1)*size+j);
+      cindex.append(-1);
+    }
+  }
+
+  SoNormalCache * prev = new SoNormalCache(NULL);
+  prev->ref();
+  prev->setPreviousCache(NULL, coord->getNodeId());
+  generate_grid_normals(prev, coord, cindex);
+
+  // edits done while notification is disabled on either the field or
+  // the node must not be lost by the next partial update
+  for (int edit = 0; edit < 4; edit++) {
+    const int idx = 10 * size + 10 + edit * 7;
+    const SbVec3f offset(0.0f, 0.0f, 3.0f);
+    coord->point.set1Value(idx, coord->point[idx] + offset);
+
+    SoNormalCache * cache = new SoNormalCache(NULL);
+    cache->ref();
+    cache->setPreviousCache(prev, coord->getNodeId());
+    generate_grid_normals(cache, coord, cindex);
+    prev->unref();
+    prev = cache;
+    BOOST_CHECK_MESSAGE(same_grid_normals(cache, coord, cindex),
+                        "updated normals differ from generated normals");
+
+    const int silentidx = 40 * size + 20 + edit * 5;
+    if (edit % 2) {
+      const SbBool old = coord->point.enableNotify(FALSE);
+      coord->point.set1Value(silentidx, coord->point[silentidx] + offset);
+      coord->point.enableNotify(old);
+    }
+    else {
+      const SbBool old = coord->enableNotify(FALSE);
+      coord->point.set1Value(silentidx, coord->point[silentidx] + offset);
+      coord->enableNotify(old);
+    }
+  }
+
+  // the last silent edit followed by a partial edit
+  coord->point.set1Value(5 * size + 5, coord->point[5 * size + 5] + SbVec3f(0.0f, 0.0f, 1.0f));
+  SoNormalCache * cache = new SoNormalCache(NULL);
+  cache->ref();
+  cache->setPreviousCache(prev, coord->getNodeId());
+  generate_grid_normals(cache, coord, cindex);
+  BOOST_CHECK_MESSAGE(same_grid_normals(cache, coord, cindex),
+                      "edits made without notification were lost");
+  cache->unref();
+  prev->unref();
+  coord->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
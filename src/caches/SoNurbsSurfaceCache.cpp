@@ -0,0 +1,569 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoNurbsSurfaceCache SoNurbsSurfaceCache.h caches/SoNurbsSurfaceCache.h
+  The SoNurbsSurfaceCache class stores a NURBS surface tessellated into a mesh.
+
+  The surface is evaluated on a grid of parameter values. The number
+  of segments in each knot span is chosen from the curvature of the
+  control polygon over that span, so that the mesh stays within the
+  given tolerance of the surface. Flat parts of a surface therefore
+  get few triangles, and the grid keeps neighbouring rows and columns
+  crack free. The rows of large grids are evaluated in parallel.
+
+  The mesh is stored as getNumU() times getNumV() points, with normals
+  and texture coordinates, u changing fastest. SoNurbsSurface and
+  SoIndexedNurbsSurface render and generate primitives from the same
+  cache, instead of tessellating with GLU on every traversal.
+
+  \internal
+*/
+
+#include "caches/SoNurbsSurfaceCache.h"
+
+#include <cmath>
+
+#include <Inventor/system/gl.h>
+
+#include "threads/parallelp.h"
+
+// *************************************************************************
+
+namespace {
+
+  const int NURBS_PARALLEL_MIN_CHUNK = 4096;
+  const int NURBS_MAX_SEGMENTS = 64;
+  const int NURBS_MAX_POINTS = 1 << 22;
+
+  // the parameter values sampled in one direction, with the knot
+  // span, the basis functions and their derivatives for each value
+  class NurbsSamples {
+  public:
+    NurbsSamples(const float * knots, const int order, const int numctrlpts)
+      : knots(knots), order(order), numctrlpts(numctrlpts) { }
+
+    void add(double u);
+    int getNum(void) const { return this->params.getLength(); }
+
+    const float * knots;
+    const int order;
+    const int numctrlpts;
+    SbList <double> params;
+    SbList <int> spans;
+    SbList <double> basis;
+    SbList <double> derivs;
+  };
+
+  // finds the knot span containing u. The parameter value at the end
+  // of the domain belongs to the last non-empty span.
+  int
+  nurbs_find_span(const double u, const int order, const int numctrlpts,
+                  const float * knots)
+  {
+    int low = order - 1;
+    int high = numctrlpts;
+    if (u >= knots[high]) {
+      low = high - 1;
+      while (low > order - 1 && knots[low] >= knots[low + 1]) low--;
+      return low;
+    }
+    while (high - low > 1) {
+      const int mid = (low + high) / 2;
+      if (u < knots[mid]) high = mid;
+      else low = mid;
+    }
+    return low;
+  }
+
+  // the basis functions and their first derivatives, see algorithm
+  // A2.3 in "The NURBS Book" by Piegl and Tiller
+  void
+  nurbs_basis(const float * knots, const int order, const int span,
+              const double u, double * n, double * dn)
+  {
+    const int p = order - 1;
+    double ndu[SoNurbsSurfaceCache::MAXORDER][SoNurbsSurfaceCache::MAXORDER];
+    double left[SoNurbsSurfaceCache::MAXORDER];
+    double right[SoNurbsSurfaceCache::MAXORDER];
+
+    ndu[0][0] = 1.0;
+    for (int j = 1; j <= p; j++) {
+      left[j] = u - knots[span + 1 - j];
+      right[j] = knots[span + j] - u;
+      double saved = 0.0;
+      for (int r = 0; r < j; r++) {
+        ndu[j][r] = right[r + 1] + left[j - r];
+        const double temp = ndu[r][j - 1] / ndu[j][r];
+        ndu[r][j] = saved + right[r + 1] * temp;
+        saved = left[j - r] * temp;
+      }
+      ndu[j][j] = saved;
+    }
+    for (int r = 0; r <= p; r++) {
+      n[r] = ndu[r][p];
+      double d = 0.0;
+      if (r > 0) d += ndu[r - 1][p - 1] / ndu[p][r - 1];
+      if (r < p) d -= ndu[r][p - 1] / ndu[p][r];
+      dn[r] = d * p;
+    }
+  }
+
+  void
+  NurbsSamples::add(double u)
+  {
+    const double start = this->knots[this->order - 1];
+    const double end = this->knots[this->numctrlpts];
+    if (u < start) u = start;
+    if (u > end) u = end;
+    const int span = nurbs_find_span(u, this->order, this->numctrlpts, this->knots);
+    double n[SoNurbsSurfaceCache::MAXORDER];
+    double dn[SoNurbsSurfaceCache::MAXORDER];
+    nurbs_basis(this->knots, this->order, span, u, n, dn);
+    this->params.append(u);
+    this->spans.append(span);
+    for (int i = 0; i < this->order; i++) {
+      this->basis.append(n[i]);
+      this->derivs.append(dn[i]);
+    }
+  }
+
+  SbBool
+  nurbs_valid(const float * knots, const int numknots, const int numctrlpts)
+  {
+    const int order = numknots - numctrlpts;
+    if (knots == NULL || order < 2 || order > SoNurbsSurfaceCache::MAXORDER) return FALSE;
+    if (numctrlpts < order) return FALSE;
+    for (int i = 1; i < numknots; i++) {
+      if (knots[i] < knots[i - 1]) return FALSE;
+    }
+    return knots[numctrlpts] > knots[order - 1];
+  }
+
+  // The number of segments needed in each knot span in one direction
+  // of the surface. The deviation between a polynomial curve of
+  // degree p and a chord over a parameter interval h is at most
+  // h^2/8 times its second derivative, which is bounded by p(p-1)
+  // times the second differences of the control points. The control
+  // points are addressed as first + i * stride for the direction, and
+  // j * crossstride for each of the numcross curves across it.
+  void
+  nurbs_segments(SbList <int> & segments, const SbVec3f * points,
+                 const float * weights, const int order, const int numctrlpts,
+                 const int stride, const int crossstride, const int numcross,
+                 const float tolerance)
+  {
+    const int p = order - 1;
+    segments.truncate(0);
+    for (int span = 0; span < numctrlpts; span++) {
+      if (span < p || p < 2) {
+        segments.append(1);
+        continue;
+      }
+      double maxdiff = 0.0;
+      double minweight = HUGE_VAL, maxweight = 0.0;
+      for (int j = 0; j < numcross; j++) {
+        const int offset = j * crossstride;
+        for (int i = span - p; i <= span; i++) {
+          const double w = fabs(weights[offset + i * stride]);
+          if (w < minweight) minweight = w;
+          if (w > maxweight) maxweight = w;
+          if (i == span - p || i == span) continue;
+          const SbVec3f diff =
+            points[offset + (i - 1) * stride] - 2.0f * points[offset + i * stride] +
+            points[offset + (i + 1) * stride];
+          if (diff.length() > maxdiff) maxdiff = diff.length();
+        }
+      }
+      // rational curves bend more where the weights differ
+      if (minweight > 0.0) maxdiff *= maxweight / minweight;
+      const double n = ceil(sqrt(p * (p - 1) * maxdiff / (8.0 * tolerance)));
+      segments.append(int(SbClamp(n, 1.0, double(NURBS_MAX_SEGMENTS))));
+    }
+  }
+
+  void
+  nurbs_sample(NurbsSamples & samples, const SbList <int> & segments)
+  {
+    const float * knots = samples.knots;
+    for (int span = samples.order - 1; span < samples.numctrlpts; span++) {
+      const double k0 = knots[span];
+      const double k1 = knots[span + 1];
+      if (k1 <= k0) continue;
+      const int n = segments[span];
+      for (int i = 0; i < n; i++) samples.add(k0 + (k1 - k0) * i / n);
+    }
+    samples.add(knots[samples.numctrlpts]);
+  }
+
+  // evaluation of the surface rows in [begin, end)
+  struct nurbs_eval_data {
+    const NurbsSamples * u;
+    const NurbsSamples * v;
+    const float * ctrlpts;
+    int dim;
+    // for the geometry
+    SbVec3f * coords;
+    SbVec3f * normals;
+    // for the texture coordinates
+    SbVec4f * texcoords;
+  };
+
+  void
+  nurbs_eval_rows(void * closure, int begin, int end)
+  {
+    const nurbs_eval_data * data = static_cast<nurbs_eval_data *>(closure);
+    const NurbsSamples * u = data->u;
+    const NurbsSamples * v = data->v;
+    const int numu = u->getNum();
+    const int uorder = u->order;
+    const int vorder = v->order;
+    const int dim = data->dim;
+    const SbBool homogeneous = data->coords && dim == 4;
+
+    for (int l = begin; l < end; l++) {
+      const double * nv = v->basis.getArrayPtr() + l * vorder;
+      const double * dnv = v->derivs.getArrayPtr() + l * vorder;
+      const int vfirst = v->spans.getArrayPtr()[l] - vorder + 1;
+      for (int k = 0; k < numu; k++) {
+        const double * nu = u->basis.getArrayPtr() + k * uorder;
+        const double * dnu = u->derivs.getArrayPtr() + k * uorder;
+        const int ufirst = u->spans.getArrayPtr()[k] - uorder + 1;
+
+        double p[4] = { 0.0, 0.0, 0.0, 0.0 };
+        double pu[4] = { 0.0, 0.0, 0.0, 0.0 };
+        double pv[4] = { 0.0, 0.0, 0.0, 0.0 };
+        for (int b = 0; b < vorder; b++) {
+          double row[4] = { 0.0, 0.0, 0.0, 0.0 };
+          double rowu[4] = { 0.0, 0.0, 0.0, 0.0 };
+          const float * cp =
+            data->ctrlpts + ((vfirst + b) * u->numctrlpts + ufirst) * dim;
+          for (int a = 0; a < uorder; a++, cp += dim) {
+            for (int c = 0; c < dim; c++) {
+              row[c] += nu[a] * cp[c];
+              rowu[c] += dnu[a] * cp[c];
+            }
+          }
+          for (int c = 0; c < 4; c++) {
+            p[c] += nv[b] * row[c];
+            pu[c] += nv[b] * rowu[c];
+            pv[c] += dnv[b] * row[c];
+          }
+        }
+
+        const int idx = l * numu + k;
+        if (data->coords == NULL) {
+          if (dim == 2) p[3] = 1.0;
+          data->texcoords[idx].setValue(float(p[0]), float(p[1]), float(p[2]), float(p[3]));
+          continue;
+        }
+        if (!homogeneous) {
+          p[3] = 1.0;
+          pu[3] = pv[3] = 0.0;
+        }
+        const double w = (p[3] != 0.0) ? p[3] : 1.0;
+        double s[3], su[3], sv[3];
+        for (int c = 0; c < 3; c++) {
+          s[c] = p[c] / w;
+          su[c] = (pu[c] - pu[3] * s[c]) / w;
+          sv[c] = (pv[c] - pv[3] * s[c]) / w;
+        }
+        const double n[3] = {
+          su[1] * sv[2] - su[2] * sv[1],
+          su[2] * sv[0] - su[0] * sv[2],
+          su[0] * sv[1] - su[1] * sv[0]
+        };
+        const double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        data->coords[idx].setValue(float(s[0]), float(s[1]), float(s[2]));
+        if (len > 1e-12) {
+          data->normals[idx].setValue(float(n[0] / len), float(n[1] / len), float(n[2] / len));
+        }
+        else {
+          // degenerate, fixed from the neighbours afterwards
+          data->normals[idx].setValue(0.0f, 0.0f, 0.0f);
+        }
+      }
+    }
+  }
+
+  void
+  nurbs_eval(nurbs_eval_data & data)
+  {
+    const int numu = data.u->getNum();
+    const int numv = data.v->getNum();
+    cc_parallel_for(numv, SbMax(NURBS_PARALLEL_MIN_CHUNK / numu, 1),
+                    nurbs_eval_rows, &data);
+  }
+
+} // anonymous namespace
+
+// *************************************************************************
+
+/*!
+  Constructor.
+*/
+SoNurbsSurfaceCache::SoNurbsSurfaceCache(SoState * const state)
+  : SoCache(state),
+    nodeid(0),
+    tolerance(0.0f),
+    numu(0),
+    numv(0)
+{
+}
+
+/*!
+  Destructor.
+*/
+SoNurbsSurfaceCache::~SoNurbsSurfaceCache()
+{
+}
+
+/*!
+  Tessellates the surface so that the mesh is within \a tolerance of
+  the surface. The control points are given in \a ctrlpts with \a dim
+  floats each, 3 for non-rational and 4 for rational surfaces, with
+  the u index changing fastest. \a nodeid is the id of the node at
+  the time of tessellation, to be compared in matches().
+
+  The texture coordinates are evaluated from the texture coordinate
+  surface if \a texctrlpts is set, and are otherwise mapped linearly
+  from the knot range.
+
+  Returns FALSE, and leaves the cache empty, if the surface can not
+  be evaluated.
+*/
+SbBool
+SoNurbsSurfaceCache::generate(const SbUniqueId nodeid, const float tolerance,
+                              const int numuctrlpts, const int numvctrlpts,
+                              const float * uknotvec, const int numuknots,
+                              const float * vknotvec, const int numvknots,
+                              const float * ctrlpts, const int dim,
+                              const int numsctrlpts, const int numtctrlpts,
+                              const float * sknotvec, const int numsknots,
+                              const float * tknotvec, const int numtknots,
+                              const float * texctrlpts, const int texdim)
+{
+  this->nodeid = nodeid;
+  this->tolerance = tolerance;
+  this->numu = this->numv = 0;
+  this->coords.truncate(0);
+  this->normals.truncate(0);
+  this->texcoords.truncate(0);
+
+  if (ctrlpts == NULL || (dim != 3 && dim != 4) || !(tolerance > 0.0f) ||
+      !nurbs_valid(uknotvec, numuknots, numuctrlpts) ||
+      !nurbs_valid(vknotvec, numvknots, numvctrlpts)) {
+    return FALSE;
+  }
+  const int uorder = numuknots - numuctrlpts;
+  const int vorder = numvknots - numvctrlpts;
+
+  // the control points in affine space, for the refinement
+  const int numctrlpts = numuctrlpts * numvctrlpts;
+  SbList <SbVec3f> points(numctrlpts);
+  SbList <float> weights(numctrlpts);
+  for (int i = 0; i < numctrlpts; i++) {
+    const float * cp = ctrlpts + i * dim;
+    const float w = (dim == 4 && cp[3] != 0.0f) ? cp[3] : 1.0f;
+    points.append(SbVec3f(cp[0] / w, cp[1] / w, cp[2] / w));
+    weights.append(w);
+  }
+
+  NurbsSamples usamples(uknotvec, uorder, numuctrlpts);
+  NurbsSamples vsamples(vknotvec, vorder, numvctrlpts);
+  SbList <int> usegments, vsegments;
+  float tol = tolerance;
+  for (;;) {
+    nurbs_segments(usegments, points.getArrayPtr(), weights.getArrayPtr(),
+                   uorder, numuctrlpts, 1, numuctrlpts, numvctrlpts, tol);
+    nurbs_segments(vsegments, points.getArrayPtr(), weights.getArrayPtr(),
+                   vorder, numvctrlpts, numuctrlpts, 1, numuctrlpts, tol);
+    int nu = 1, nv = 1;
+    for (int i = 0; i < usegments.getLength(); i++) nu += usegments[i];
+    for (int i = 0; i < vsegments.getLength(); i++) nv += vsegments[i];
+    if (double(nu) * double(nv) <= NURBS_MAX_POINTS) break;
+    tol *= 4.0f;
+  }
+  nurbs_sample(usamples, usegments);
+  nurbs_sample(vsamples, vsegments);
+
+  this->numu = usamples.getNum();
+  this->numv = vsamples.getNum();
+  const int num = this->numu * this->numv;
+  for (int i = 0; i < num; i++) {
+    this->coords.append(SbVec3f(0.0f, 0.0f, 0.0f));
+    this->normals.append(SbVec3f(0.0f, 0.0f, 0.0f));
+    this->texcoords.append(SbVec4f(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+
+  nurbs_eval_data data;
+  data.u = &usamples;
+  data.v = &vsamples;
+  data.ctrlpts = ctrlpts;
+  data.dim = dim;
+  data.coords = &this->coords[0];
+  data.normals = &this->normals[0];
+  data.texcoords = NULL;
+  nurbs_eval(data);
+
+  // degenerate normals, such as at the poles of a sphere, are taken
+  // from the next point in u, or else in v
+  SbVec3f * normals = &this->normals[0];
+  const SbVec3f zero(0.0f, 0.0f, 0.0f);
+  for (int l = 0; l < this->numv; l++) {
+    for (int k = 0; k < this->numu; k++) {
+      SbVec3f & n = normals[l * this->numu + k];
+      if (n != zero) continue;
+      const int ku = (k + 1 < this->numu) ? k + 1 : k - 1;
+      const int lv = (l + 1 < this->numv) ? l + 1 : l - 1;
+      if (normals[l * this->numu + ku] != zero) n = normals[l * this->numu + ku];
+      else if (lv >= 0) n = normals[lv * this->numu + k];
+      if (n == zero) n.setValue(0.0f, 0.0f, 1.0f);
+    }
+  }
+
+  if (texctrlpts && (texdim == 2 || texdim == 4) &&
+      nurbs_valid(sknotvec, numsknots, numsctrlpts) &&
+      nurbs_valid(tknotvec, numtknots, numtctrlpts)) {
+    NurbsSamples ssamples(sknotvec, numsknots - numsctrlpts, numsctrlpts);
+    NurbsSamples tsamples(tknotvec, numtknots - numtctrlpts, numtctrlpts);
+    for (int k = 0; k < this->numu; k++) ssamples.add(usamples.params[k]);
+    for (int l = 0; l < this->numv; l++) tsamples.add(vsamples.params[l]);
+    data.u = &ssamples;
+    data.v = &tsamples;
+    data.ctrlpts = texctrlpts;
+    data.dim = texdim;
+    data.coords = NULL;
+    data.normals = NULL;
+    data.texcoords = &this->texcoords[0];
+    nurbs_eval(data);
+  }
+  else {
+    // the default texture coordinates span the whole knot range
+    const double u0 = uknotvec[0], u1 = uknotvec[numuknots - 1];
+    const double v0 = vknotvec[0], v1 = vknotvec[numvknots - 1];
+    for (int l = 0; l < this->numv; l++) {
+      const float t = float((vsamples.params[l] - v0) / (v1 - v0));
+      for (int k = 0; k < this->numu; k++) {
+        const float s = float((usamples.params[k] - u0) / (u1 - u0));
+        this->texcoords[l * this->numu + k].setValue(s, t, 0.0f, 1.0f);
+      }
+    }
+  }
+  return TRUE;
+}
+
+/*!
+  Returns TRUE if the cache was generated for the node with id \a
+  nodeid, with a tolerance close enough to \a tolerance. The
+  tolerance may change by a factor of two before the surface is
+  tessellated again, so that the mesh does not change on every frame
+  while the camera moves.
+*/
+SbBool
+SoNurbsSurfaceCache::matches(const SbUniqueId nodeid, const float tolerance) const
+{
+  return
+    (nodeid == this->nodeid) &&
+    (tolerance >= this->tolerance * 0.5f) &&
+    (tolerance <= this->tolerance * 2.0f);
+}
+
+/*!
+  Returns the number of points in the u direction.
+*/
+int
+SoNurbsSurfaceCache::getNumU(void) const
+{
+  return this->numu;
+}
+
+/*!
+  Returns the number of points in the v direction.
+*/
+int
+SoNurbsSurfaceCache::getNumV(void) const
+{
+  return this->numv;
+}
+
+/*!
+  Returns the points of the mesh.
+*/
+const SbVec3f *
+SoNurbsSurfaceCache::getCoords(void) const
+{
+  return this->coords.getArrayPtr();
+}
+
+/*!
+  Returns the normals of the mesh.
+*/
+const SbVec3f *
+SoNurbsSurfaceCache::getNormals(void) const
+{
+  return this->normals.getArrayPtr();
+}
+
+/*!
+  Returns the texture coordinates of the mesh.
+*/
+const SbVec4f *
+SoNurbsSurfaceCache::getTexCoords(void) const
+{
+  return this->texcoords.getArrayPtr();
+}
+
+/*!
+  Renders the mesh as one triangle strip for each row, with the
+  triangles counterclockwise as seen from the side the normals point
+  to.
+*/
+void
+SoNurbsSurfaceCache::render(void) const
+{
+  const SbVec3f * coords = this->coords.getArrayPtr();
+  const SbVec3f * normals = this->normals.getArrayPtr();
+  const SbVec4f * texcoords = this->texcoords.getArrayPtr();
+  for (int l = 0; l < this->numv - 1; l++) {
+    glBegin(GL_TRIANGLE_STRIP);
+    for (int k = 0; k < this->numu; k++) {
+      for (int i = 1; i >= 0; i--) {
+        const int idx = (l + i) * this->numu + k;
+        glTexCoord4fv(texcoords[idx].getValue());
+        glNormal3fv(normals[idx].getValue());
+        glVertex3fv(coords[idx].getValue());
+      }
+    }
+    glEnd();
+  }
+}
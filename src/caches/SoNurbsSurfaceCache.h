@@ -0,0 +1,90 @@
+#ifndef COIN_SONURBSSURFACECACHE_H
+#define COIN_SONURBSSURFACECACHE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/caches/SoCache.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/SbVec4f.h>
+#include <Inventor/lists/SbList.h>
+
+class SoState;
+
+// *************************************************************************
+
+class SoNurbsSurfaceCache : public SoCache {
+  typedef SoCache inherited;
+
+public:
+  SoNurbsSurfaceCache(SoState * const state);
+  virtual ~SoNurbsSurfaceCache();
+
+  enum { MAXORDER = 16 };
+
+  SbBool generate(const SbUniqueId nodeid, const float tolerance,
+                  const int numuctrlpts, const int numvctrlpts,
+                  const float * uknotvec, const int numuknots,
+                  const float * vknotvec, const int numvknots,
+                  const float * ctrlpts, const int dim,
+                  const int numsctrlpts = 0, const int numtctrlpts = 0,
+                  const float * sknotvec = NULL, const int numsknots = 0,
+                  const float * tknotvec = NULL, const int numtknots = 0,
+                  const float * texctrlpts = NULL, const int texdim = 0);
+
+  SbBool matches(const SbUniqueId nodeid, const float tolerance) const;
+
+  int getNumU(void) const;
+  int getNumV(void) const;
+  const SbVec3f * getCoords(void) const;
+  const SbVec3f * getNormals(void) const;
+  const SbVec4f * getTexCoords(void) const;
+
+  void render(void) const;
+
+private:
+  SbUniqueId nodeid;
+  float tolerance;
+  int numu;
+  int numv;
+  SbList <SbVec3f> coords;
+  SbList <SbVec3f> normals;
+  SbList <SbVec4f> texcoords;
+};
+
+// *************************************************************************
+
+#endif // !COIN_SONURBSSURFACECACHE_H
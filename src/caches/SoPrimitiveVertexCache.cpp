@@ -169,6 +169,7 @@ public:
   SoGLLazyElement::GLState poststate;
 
   void addVertex(const Vertex & v);
+  void optimizeVertexOrder(void);
 
   void renderImmediate(const cc_glglue * glue,
                        const GLint * indices,
@@ -834,6 +835,10 @@ SoPrimitiveVertexCache::fit(void)
   if (PRIVATE(this)->triangleindexer) PRIVATE(this)->triangleindexer->close();
   if (PRIVATE(this)->lineindexer) PRIVATE(this)->lineindexer->close();
   if (PRIVATE(this)->pointindexer) PRIVATE(this)->pointindexer->close();
+
+  if (SoVertexArrayIndexer::shouldOptimizeVertexCache()) {
+    PRIVATE(this)->optimizeVertexOrder();
+  }
 }
 
 void
@@ -925,6 +930,110 @@ SoPrimitiveVertexCacheP::Vertex::operator==(const Vertex & v)
     (this->rgba[3] == v.rgba[3]);
 }
 
+// reorder the items in list, neworder[i] being the old position of
+// the item which should be at position i
+template <class Type>
+static void
+reorder_list(SbList <Type> & list, const int32_t * neworder,
+             const int numvertices, const int itemspervertex)
+{
+  if (list.getLength() != numvertices * itemspervertex) return;
+  Type * tmp = new Type[list.getLength()];
+  memcpy(tmp, list.getArrayPtr(), list.getLength() * sizeof(Type));
+  Type * dst = const_cast<Type *>(list.getArrayPtr());
+  for (int i = 0; i < numvertices; i++) {
+    for (int j = 0; j < itemspervertex; j++) {
+      dst[i*itemspervertex+j] = tmp[neworder[i]*itemspervertex+j];
+    }
+  }
+  delete[] tmp;
+}
+
+//
+// Reorders the vertices in the order they are first used by the
+// triangles, lines and points, so that the GPU reads the vertex data
+// sequentially.
+//
+void
+SoPrimitiveVertexCacheP::optimizeVertexOrder(void)
+{
+  const int numv = this->vertexlist.getLength();
+  if (numv == 0 || this->vertexvbo) return;
+
+  // all per vertex lists must have one item per vertex, or be empty
+  if ((this->normallist.getLength() != numv) ||
+      (this->texcoordlist.getLength() != numv) ||
+      (this->bumpcoordlist.getLength() != numv) ||
+      (this->rgbalist.getLength() != numv * 4) ||
+      (this->tangentlist.getLength() && this->tangentlist.getLength() != numv)) {
+    return;
+  }
+  int i;
+  if (this->multitexcoords) {
+    for (i = 1; i <= this->lastenabled; i++) {
+      const int len = this->multitexcoords[i].getLength();
+      if (len && len != numv) return;
+    }
+  }
+
+  SoVertexArrayIndexer * indexers[3];
+  indexers[0] = this->triangleindexer;
+  indexers[1] = this->lineindexer;
+  indexers[2] = this->pointindexer;
+
+  int32_t * oldtonew = new int32_t[numv];
+  int32_t * neworder = new int32_t[numv];
+  for (i = 0; i < numv; i++) oldtonew[i] = -1;
+  int numused = 0;
+  int idx;
+  for (idx = 0; idx < 3; idx++) {
+    if (indexers[idx] == NULL) continue;
+    const GLint * indices = indexers[idx]->getIndices();
+    const int n = indexers[idx]->getNumIndices();
+    for (i = 0; i < n; i++) {
+      const int v = indices[i];
+      if (v < 0 || v >= numv) {
+        delete[] oldtonew;
+        delete[] neworder;
+        return;
+      }
+      if (oldtonew[v] < 0) {
+        oldtonew[v] = numused;
+        neworder[numused++] = v;
+      }
+    }
+  }
+  // unused vertices are kept at the end
+  for (i = 0; i < numv; i++) {
+    if (oldtonew[i] < 0) {
+      oldtonew[i] = numused;
+      neworder[numused++] = i;
+    }
+  }
+
+  reorder_list(this->vertexlist, neworder, numv, 1);
+  reorder_list(this->normallist, neworder, numv, 1);
+  reorder_list(this->texcoordlist, neworder, numv, 1);
+  reorder_list(this->bumpcoordlist, neworder, numv, 1);
+  reorder_list(this->rgbalist, neworder, numv, 4);
+  reorder_list(this->tangentlist, neworder, numv, 1);
+  if (this->multitexcoords) {
+    for (i = 1; i <= this->lastenabled; i++) {
+      reorder_list(this->multitexcoords[i], neworder, numv, 1);
+    }
+  }
+
+  for (idx = 0; idx < 3; idx++) {
+    if (indexers[idx] == NULL) continue;
+    GLint * indices = indexers[idx]->getWriteableIndices();
+    const int n = indexers[idx]->getNumIndices();
+    for (i = 0; i < n; i++) indices[i] = oldtonew[indices[i]];
+  }
+
+  delete[] oldtonew;
+  delete[] neworder;
+}
+
 void
 SoPrimitiveVertexCacheP::addVertex(const Vertex & v)
 {
@@ -0,0 +1,267 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoTessellationCache SoTessellationCache.h caches/SoTessellationCache.h
+  The SoTessellationCache is used to share generated geometry between
+  node instances and frames.
+
+  Nodes which compute their geometry from field values, such as
+  SoVRMLExtrusion and the profiled sides of SoText3, build a Key from
+  all the input data of the computation, and look the key up before
+  computing anything. Identical input will then only be tessellated
+  once, regardless of how many nodes use it.
+
+  Geometries are reference counted. Geometries which are no longer
+  referenced are kept around, up to a maximum number, in case they
+  are needed again, and the least recently used ones are deleted
+  first.
+
+  \internal
+*/
+
+#include "caches/SoTessellationCache.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "threads/threadsutilp.h"
+
+// *************************************************************************
+
+/*!
+  Constructor. Creates an empty key.
+*/
+SoTessellationCache::Key::Key(void)
+{
+}
+
+// Adds a 32 bit word to the data and the hash value.
+void
+SoTessellationCache::Key::addWord(const uint32_t word)
+{
+  this->data.append(word);
+  this->hash.add(word);
+}
+
+/*!
+  Adds \a value to the key.
+*/
+void
+SoTessellationCache::Key::add(const int32_t value)
+{
+  this->addWord(static_cast<uint32_t>(value));
+}
+
+/*!
+  Adds \a value to the key.
+*/
+void
+SoTessellationCache::Key::add(const float value)
+{
+  uint32_t word;
+  memcpy(&word, &value, sizeof(word));
+  this->addWord(word);
+}
+
+/*!
+  Adds \a num values to the key. The number of values is added as
+  well, so that arrays of different lengths never give the same key.
+*/
+void
+SoTessellationCache::Key::add(const float * values, const int num)
+{
+  this->add(static_cast<int32_t>(num));
+  for (int i = 0; i < num; i++) {
+    this->add(values[i]);
+  }
+}
+
+/*!
+  Adds \a string to the key.
+*/
+void
+SoTessellationCache::Key::add(const char * string)
+{
+  const int len = static_cast<int>(strlen(string));
+  this->add(static_cast<int32_t>(len));
+  for (int i = 0; i < len; i += 4) {
+    uint32_t word = 0;
+    memcpy(&word, string + i, SbMin(4, len - i));
+    this->addWord(word);
+  }
+}
+
+/*!
+  Returns \c TRUE if the two keys contain the same data.
+*/
+int
+SoTessellationCache::Key::operator==(const Key & key) const
+{
+  const int n = this->data.getLength();
+  if (this->hash.getValue() != key.hash.getValue() ||
+      n != key.data.getLength()) return FALSE;
+  return memcmp(this->data.getArrayPtr(), key.data.getArrayPtr(),
+                n * sizeof(uint32_t)) == 0;
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. At most \a maxunused geometries without references will
+  be kept in the cache.
+*/
+SoTessellationCache::SoTessellationCache(const int maxunused)
+  : first(NULL),
+    last(NULL),
+    numunused(0),
+    maxunused(maxunused),
+    mutex(NULL)
+{
+  CC_MUTEX_CONSTRUCT(this->mutex);
+}
+
+/*!
+  Destructor. Deletes all geometries, including the ones that are
+  still referenced.
+*/
+SoTessellationCache::~SoTessellationCache()
+{
+  SbList<Key> keys;
+  this->dict.makeKeyList(keys);
+  for (int i = 0; i < keys.getLength(); i++) {
+    Geometry * geometry = NULL;
+    (void) this->dict.get(keys[i], geometry);
+    delete geometry;
+  }
+  CC_MUTEX_DESTRUCT(this->mutex);
+}
+
+/*!
+  Returns the geometry for \a key, or \c NULL if it isn't cached. The
+  returned geometry is referenced, and must be unreferenced with
+  unref() when the caller is done with it.
+*/
+const SoTessellationCache::Geometry *
+SoTessellationCache::find(const Key & key)
+{
+  CC_MUTEX_LOCK(this->mutex);
+  Geometry * geometry = NULL;
+  if (this->dict.get(key, geometry)) {
+    if (geometry->refcount == 0) this->unlink(geometry);
+    geometry->refcount++;
+  }
+  CC_MUTEX_UNLOCK(this->mutex);
+  return geometry;
+}
+
+/*!
+  Stores \a geometry for \a key, and returns it referenced. The cache
+  takes over ownership of \a geometry. If another thread stored a
+  geometry for the same key after the last find(), \a geometry is
+  deleted and the existing one is returned instead.
+*/
+const SoTessellationCache::Geometry *
+SoTessellationCache::insert(const Key & key, Geometry * geometry)
+{
+  CC_MUTEX_LOCK(this->mutex);
+  Geometry * existing = NULL;
+  if (this->dict.get(key, existing)) {
+    delete geometry;
+    geometry = existing;
+    if (geometry->refcount == 0) this->unlink(geometry);
+  }
+  else {
+    geometry->key = key;
+    geometry->refcount = 0;
+    geometry->prev = geometry->next = NULL;
+    (void) this->dict.put(key, geometry);
+  }
+  geometry->refcount++;
+  CC_MUTEX_UNLOCK(this->mutex);
+  return geometry;
+}
+
+/*!
+  Unreferences \a geometry. Unreferenced geometries are kept until
+  more than the maximum number of unreferenced geometries are cached.
+*/
+void
+SoTessellationCache::unref(const Geometry * geometry)
+{
+  CC_MUTEX_LOCK(this->mutex);
+  Geometry * g = const_cast<Geometry *>(geometry);
+  assert(g->refcount > 0);
+  if (--g->refcount == 0) {
+    this->link(g);
+    while (this->numunused > this->maxunused) {
+      Geometry * lru = this->first;
+      this->unlink(lru);
+      (void) this->dict.erase(lru->key);
+      delete lru;
+    }
+  }
+  CC_MUTEX_UNLOCK(this->mutex);
+}
+
+/*!
+  Returns the number of cached geometries, referenced or not.
+*/
+int
+SoTessellationCache::getNumGeometries(void) const
+{
+  return static_cast<int>(this->dict.getNumElements());
+}
+
+// appends geometry to the list of unreferenced geometries
+void
+SoTessellationCache::link(Geometry * geometry)
+{
+  geometry->prev = this->last;
+  geometry->next = NULL;
+  if (this->last) this->last->next = geometry;
+  else this->first = geometry;
+  this->last = geometry;
+  this->numunused++;
+}
+
+// removes geometry from the list of unreferenced geometries
+void
+SoTessellationCache::unlink(Geometry * geometry)
+{
+  if (geometry->prev) geometry->prev->next = geometry->next;
+  else this->first = geometry->next;
+  if (geometry->next) geometry->next->prev = geometry->prev;
+  else this->last = geometry->prev;
+  geometry->prev = geometry->next = NULL;
+  this->numunused--;
+}
@@ -0,0 +1,105 @@
+#ifndef COIN_SOTESSELLATIONCACHE_H
+#define COIN_SOTESSELLATIONCACHE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+#include "misc/SbFNVHash.h"
+#include "misc/SbHash.h"
+
+class SoTessellationCache {
+public:
+  class Key {
+  public:
+    Key(void);
+
+    void add(const int32_t value);
+    void add(const float value);
+    void add(const float * values, const int num);
+    void add(const char * string);
+
+    int operator==(const Key & key) const;
+    // needed for SbHash
+    operator unsigned long(void) const { return this->hash.getValue(); }
+
+  private:
+    void addWord(const uint32_t word);
+
+    SbList <uint32_t> data;
+    SbFNVHash hash;
+  };
+
+  class Geometry {
+  public:
+    SbList <SbVec3f> coords;
+    SbList <SbVec3f> normals;
+    SbList <SbVec2f> texcoords;
+    SbList <int32_t> indices;
+
+  private:
+    friend class SoTessellationCache;
+    Key key;
+    int refcount;
+    Geometry * prev;
+    Geometry * next;
+  };
+
+  SoTessellationCache(const int maxunused);
+  ~SoTessellationCache();
+
+  const Geometry * find(const Key & key);
+  const Geometry * insert(const Key & key, Geometry * geometry);
+  void unref(const Geometry * geometry);
+
+  int getNumGeometries(void) const;
+
+private:
+  void link(Geometry * geometry);
+  void unlink(Geometry * geometry);
+  SbHash<Key, Geometry *> dict;
+  // unreferenced geometries, least recently used first
+  Geometry * first;
+  Geometry * last;
+  int numunused;
+  int maxunused;
+  void * mutex;
+};
+
+#endif // !COIN_SOTESSELLATIONCACHE_H
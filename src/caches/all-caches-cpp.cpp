@@ -41,3 +41,5 @@
 #include "SoGlyphCache.cpp"
 #include "SoShaderProgramCache.cpp"
 #include "SoVBOCache.cpp"
+#include "SoTessellationCache.cpp"
+#include "SoNurbsSurfaceCache.cpp"
@@ -61,6 +61,7 @@
 
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLRenderStatistics.h"
 #include "coindefs.h"
 
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
@@ -295,6 +296,7 @@ SoGLDisplayList::call(SoState * state, int index)
 {
   if (PRIVATE(this)->type == DISPLAY_LIST) {
     glCallList((GLuint) (PRIVATE(this)->firstindex + index));
+    SoGLRenderStatistics::count(SoGLRenderAction::DISPLAY_LIST_CALLS);
   }
   else {
     assert(PRIVATE(this)->type == TEXTURE_OBJECT);
@@ -87,6 +87,7 @@
 #include <Inventor/SbViewVolume.h>
 #include <cstring>
 #include <cassert>
+#include <cmath>
 
 #include "coindefs.h"
 #include "SbBasicP.h"
@@ -95,6 +96,127 @@
 #include <Inventor/errors/SoDebugError.h>
 #endif // COIN_DEBUG
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SOCULLELEMENT_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SOCULLELEMENT_NEON
+#endif
+
+// cullTestBoxes() tests four boxes at a time, with one box in each
+// lane, using SSE or NEON where available.
+
+namespace {
+
+#if defined(SOCULLELEMENT_SSE)
+
+typedef __m128 socull_vec;
+typedef __m128 socull_mask;
+
+inline socull_vec socull_load(const float * v) { return _mm_loadu_ps(v); }
+inline socull_vec socull_splat(const float f) { return _mm_set1_ps(f); }
+inline socull_vec socull_add(const socull_vec a, const socull_vec b) { return _mm_add_ps(a, b); }
+inline socull_vec socull_sub(const socull_vec a, const socull_vec b) { return _mm_sub_ps(a, b); }
+inline socull_vec socull_mul(const socull_vec a, const socull_vec b) { return _mm_mul_ps(a, b); }
+inline socull_vec socull_div(const socull_vec a, const socull_vec b) { return _mm_div_ps(a, b); }
+inline socull_vec socull_abs(const socull_vec a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline socull_mask socull_lt(const socull_vec a, const socull_vec b) { return _mm_cmplt_ps(a, b); }
+inline socull_mask socull_and(const socull_mask a, const socull_mask b) { return _mm_and_ps(a, b); }
+inline socull_mask socull_or(const socull_mask a, const socull_mask b) { return _mm_or_ps(a, b); }
+inline socull_mask socull_true(void) { return _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); }
+inline socull_mask socull_false(void) { return _mm_setzero_ps(); }
+inline int socull_bits(const socull_mask m) { return _mm_movemask_ps(m); }
+
+#elif defined(SOCULLELEMENT_NEON)
+
+typedef float32x4_t socull_vec;
+typedef uint32x4_t socull_mask;
+
+inline socull_vec socull_load(const float * v) { return vld1q_f32(v); }
+inline socull_vec socull_splat(const float f) { return vdupq_n_f32(f); }
+inline socull_vec socull_add(const socull_vec a, const socull_vec b) { return vaddq_f32(a, b); }
+inline socull_vec socull_sub(const socull_vec a, const socull_vec b) { return vsubq_f32(a, b); }
+inline socull_vec socull_mul(const socull_vec a, const socull_vec b) { return vmulq_f32(a, b); }
+inline socull_vec socull_div(const socull_vec a, const socull_vec b) {
+  float av[4], bv[4];
+  vst1q_f32(av, a); vst1q_f32(bv, b);
+  for (int i = 0; i < 4; i++) { av[i] /= bv[i]; }
+  return vld1q_f32(av);
+}
+inline socull_vec socull_abs(const socull_vec a) { return vabsq_f32(a); }
+inline socull_mask socull_lt(const socull_vec a, const socull_vec b) { return vcltq_f32(a, b); }
+inline socull_mask socull_and(const socull_mask a, const socull_mask b) { return vandq_u32(a, b); }
+inline socull_mask socull_or(const socull_mask a, const socull_mask b) { return vorrq_u32(a, b); }
+inline socull_mask socull_true(void) { return vdupq_n_u32(0xffffffff); }
+inline socull_mask socull_false(void) { return vdupq_n_u32(0); }
+inline int socull_bits(const socull_mask m) {
+  uint32_t v[4];
+  vst1q_u32(v, m);
+  return (v[0] & 1) | ((v[1] & 1) << 1) | ((v[2] & 1) << 2) | ((v[3] & 1) << 3);
+}
+
+#else // scalar fallback
+
+struct socull_vec { float v[4]; };
+struct socull_mask { int v[4]; };
+
+inline socull_vec socull_load(const float * v) {
+  socull_vec r = { { v[0], v[1], v[2], v[3] } };
+  return r;
+}
+inline socull_vec socull_splat(const float f) {
+  socull_vec r = { { f, f, f, f } };
+  return r;
+}
+inline socull_vec socull_add(const socull_vec a, const socull_vec b) {
+  socull_vec r = { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+  return r;
+}
+inline socull_vec socull_sub(const socull_vec a, const socull_vec b) {
+  socull_vec r = { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+  return r;
+}
+inline socull_vec socull_mul(const socull_vec a, const socull_vec b) {
+  socull_vec r = { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+  return r;
+}
+inline socull_vec socull_div(const socull_vec a, const socull_vec b) {
+  socull_vec r = { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+  return r;
+}
+inline socull_vec socull_abs(const socull_vec a) {
+  socull_vec r = { { std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3]) } };
+  return r;
+}
+inline socull_mask socull_lt(const socull_vec a, const socull_vec b) {
+  socull_mask r = { { a.v[0] < b.v[0], a.v[1] < b.v[1], a.v[2] < b.v[2], a.v[3] < b.v[3] } };
+  return r;
+}
+inline socull_mask socull_and(const socull_mask a, const socull_mask b) {
+  socull_mask r = { { a.v[0] & b.v[0], a.v[1] & b.v[1], a.v[2] & b.v[2], a.v[3] & b.v[3] } };
+  return r;
+}
+inline socull_mask socull_or(const socull_mask a, const socull_mask b) {
+  socull_mask r = { { a.v[0] | b.v[0], a.v[1] | b.v[1], a.v[2] | b.v[2], a.v[3] | b.v[3] } };
+  return r;
+}
+inline socull_mask socull_true(void) {
+  socull_mask r = { { 1, 1, 1, 1 } };
+  return r;
+}
+inline socull_mask socull_false(void) {
+  socull_mask r = { { 0, 0, 0, 0 } };
+  return r;
+}
+inline int socull_bits(const socull_mask m) {
+  return m.v[0] | (m.v[1] << 1) | (m.v[2] << 2) | (m.v[3] << 3);
+}
+
+#endif // scalar fallback
+
+} // anonymous namespace
+
 SO_ELEMENT_SOURCE(SoCullElement);
 
 /*!
@@ -235,6 +357,152 @@ SoCullElement::cullTest(SoState * state, const SbBox3f & box, const SbBool trans
   return SoCullElement::docull(state, box, transform, FALSE);
 }
 
+/*!
+  Cull test against \a numboxes boxes at once. The result for
+  box \a i is stored in \a outside[i], which is set to \c TRUE if the
+  box is outside one of the planes. Like cullTest(), this method
+  does not update the element state.
+
+  The boxes are tested several at a time using SIMD instructions where
+  available. To stay consistent with cullTest(), a box is only reported
+  as outside when it is outside a plane by more than the rounding
+  error of the plane distance computation. Such a box is always culled
+  by cullTest() too, while a box touching a plane might be reported as
+  inside here and outside by cullTest(). Empty boxes are never
+  reported as outside.
+
+  \since Coin 4.1
+*/
+void
+SoCullElement::cullTestBoxes(SoState * state, const SbBox3f * boxes, const int numboxes,
+                             SbBool * outside, const SbBool transform)
+{
+  int i;
+  for (i = 0; i < numboxes; i++) outside[i] = FALSE;
+
+  const SoCullElement * elem = coin_safe_cast<const SoCullElement *>
+    (
+     state->getElementNoPush(classStackIndex)
+    );
+  if (!elem) return;
+
+  // only test against the planes not already known to contain the geometry
+  const SbPlane * active[MAXPLANES];
+  int numactive = 0;
+  unsigned int mask = 0x0001;
+  for (i = 0; i < elem->numplanes; i++, mask <<= 1) {
+    if (!(elem->flags & mask)) active[numactive++] = &elem->plane[i];
+  }
+  if (numactive == 0) return;
+
+  SbMatrix mm = SbMatrix::identity();
+  if (transform) {
+    SbBool wasopen = state->isCacheOpen();
+    // close the cache, since we don't create a cache dependency on
+    // the model matrix element
+    state->setCacheOpen(FALSE);
+    mm = SoModelMatrixElement::get(state);
+    state->setCacheOpen(wasopen);
+  }
+  const SbBool affine =
+    mm[0][3] == 0.0f && mm[1][3] == 0.0f && mm[2][3] == 0.0f && mm[3][3] == 1.0f;
+
+  socull_vec m[4][4];
+  for (i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) m[i][j] = socull_splat(mm[i][j]);
+  }
+  socull_vec pn[MAXPLANES][3];
+  socull_vec pd[MAXPLANES];
+  socull_vec pdabs[MAXPLANES];
+  for (i = 0; i < numactive; i++) {
+    const SbVec3f & n = active[i]->getNormal();
+    const float d = active[i]->getDistanceFromOrigin();
+    pn[i][0] = socull_splat(n[0]);
+    pn[i][1] = socull_splat(n[1]);
+    pn[i][2] = socull_splat(n[2]);
+    pd[i] = socull_splat(d);
+    pdabs[i] = socull_splat(static_cast<float>(std::fabs(d)));
+  }
+  // relative bound on the error of the float plane distance compared
+  // to the partly double precision one in SbPlane::getDistance()
+  const socull_vec eps = socull_splat(1e-6f);
+  const socull_vec zero = socull_splat(0.0f);
+
+  for (int first = 0; first < numboxes; first += 4) {
+    // gather box extents into structure-of-arrays layout, padding
+    // the last block with empty boxes
+    float ext[2][3][4];
+    int valid = 0;
+    for (int lane = 0; lane < 4; lane++) {
+      const int idx = first + lane;
+      if (idx < numboxes && !boxes[idx].isEmpty()) {
+        const SbVec3f & bmin = boxes[idx].getMin();
+        const SbVec3f & bmax = boxes[idx].getMax();
+        for (int c = 0; c < 3; c++) {
+          ext[0][c][lane] = bmin[c];
+          ext[1][c][lane] = bmax[c];
+        }
+        valid |= 1 << lane;
+      }
+      else {
+        for (int c = 0; c < 3; c++) { ext[0][c][lane] = ext[1][c][lane] = 0.0f; }
+      }
+    }
+    if (!valid) continue;
+
+    socull_vec lo[3], hi[3];
+    for (int c = 0; c < 3; c++) {
+      lo[c] = socull_load(ext[0][c]);
+      hi[c] = socull_load(ext[1][c]);
+    }
+
+    socull_mask allout[MAXPLANES];
+    for (i = 0; i < numactive; i++) allout[i] = socull_true();
+
+    for (int corner = 0; corner < 8; corner++) {
+      const socull_vec cx = corner & 1 ? lo[0] : hi[0];
+      const socull_vec cy = corner & 2 ? lo[1] : hi[1];
+      const socull_vec cz = corner & 4 ? lo[2] : hi[2];
+
+      // same operation order as SbMatrix::multVecMatrix()
+      socull_vec p[3];
+      for (int c = 0; c < 3; c++) {
+        p[c] = socull_add(socull_add(socull_add(socull_mul(cx, m[0][c]),
+                                                socull_mul(cy, m[1][c])),
+                                     socull_mul(cz, m[2][c])),
+                          m[3][c]);
+      }
+      if (!affine) {
+        const socull_vec w =
+          socull_add(socull_add(socull_add(socull_mul(cx, m[0][3]),
+                                           socull_mul(cy, m[1][3])),
+                                socull_mul(cz, m[2][3])),
+                     m[3][3]);
+        for (int c = 0; c < 3; c++) p[c] = socull_div(p[c], w);
+      }
+      const socull_vec mag =
+        socull_add(socull_add(socull_abs(p[0]), socull_abs(p[1])), socull_abs(p[2]));
+
+      for (i = 0; i < numactive; i++) {
+        const socull_vec dist =
+          socull_sub(socull_add(socull_add(socull_mul(pn[i][0], p[0]),
+                                           socull_mul(pn[i][1], p[1])),
+                                socull_mul(pn[i][2], p[2])),
+                     pd[i]);
+        const socull_vec tol = socull_mul(eps, socull_add(mag, pdabs[i]));
+        allout[i] = socull_and(allout[i], socull_lt(dist, socull_sub(zero, tol)));
+      }
+    }
+
+    socull_mask culled = socull_false();
+    for (i = 0; i < numactive; i++) culled = socull_or(culled, allout[i]);
+    const int bits = socull_bits(culled) & valid;
+    for (int lane = 0; lane < 4; lane++) {
+      if (bits & (1 << lane)) outside[first + lane] = TRUE;
+    }
+  }
+}
+
 /*!
   Returns \c TRUE if the current geometry is completely inside all
   planes. There is no need to do a cull test if this is the case.
@@ -306,8 +574,8 @@ SoCullElement::docull(SoState * state, const SbBox3f & box, const SbBool transfo
     pts[i][0] = i & 1 ? min[0] : max[0];
     pts[i][1] = i & 2 ? min[1] : max[1];
     pts[i][2] = i & 4 ? min[2] : max[2];
-    if (!identity) mm.multVecMatrix(pts[i], pts[i]);
   }
+  if (!identity) mm.multVecMatrix(pts, pts, 8);
 
   const int n = elem->numplanes;
   unsigned int flags = elem->flags;
@@ -340,3 +608,93 @@ SoCullElement::docull(SoState * state, const SbBox3f & box, const SbBool transfo
   }
   return FALSE;
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/SbViewVolume.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/lists/SbList.h>
+
+namespace {
+
+struct CullTestBoxesResult {
+  int numboxes;
+  int numculled;
+  int numagree;
+  int numwrong;
+};
+
+SoCallbackAction::Response
+cull_test_boxes_cb(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+  CullTestBoxesResult * result = static_cast<CullTestBoxesResult *>(userdata);
+  SoState * state = action->getState();
+
+  SbViewVolume vv;
+  vv.perspective(0.8f, 1.3f, 1.0f, 100.0f);
+  vv.rotateCamera(SbRotation(SbVec3f(0.3f, 1.0f, 0.2f), 0.4f));
+  SoCullElement::setViewVolume(state, vv);
+
+  // a grid of boxes of varying size, with a few empty ones
+  SbList<SbBox3f> boxes;
+  for (int x = -20; x <= 20; x++) {
+    for (int y = -20; y <= 20; y++) {
+      for (int z = -30; z <= 10; z++) {
+        SbBox3f box;
+        if ((x + y + z) % 17 != 0) {
+          const float size = 0.1f + ((x * 7 + y * 3 + z) & 7) * 0.2f;
+          const SbVec3f center(x * 1.5f, y * 1.5f, z * 1.5f);
+          box.setBounds(center - SbVec3f(size, size, size), center + SbVec3f(size, size, size));
+        }
+        boxes.append(box);
+      }
+    }
+  }
+
+  const int num = boxes.getLength();
+  SbBool * outside = new SbBool[num];
+  SoCullElement::cullTestBoxes(state, boxes.getArrayPtr(), num, outside);
+  result->numboxes = num;
+  for (int i = 0; i < num; i++) {
+    const SbBool single = !boxes[i].isEmpty() && SoCullElement::cullTest(state, boxes[i]);
+    if (single) result->numculled++;
+    if (outside[i] == single) result->numagree++;
+    if (outside[i] && !single) result->numwrong++;
+  }
+  delete [] outside;
+  return SoCallbackAction::CONTINUE;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(cullTestBoxes)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTransform * transform = new SoTransform;
+  transform->translation.setValue(0.5f, -2.0f, -15.0f);
+  transform->rotation.setValue(SbVec3f(1.0f, 0.5f, 0.0f), 0.3f);
+  transform->scaleFactor.setValue(0.8f, 1.2f, 0.9f);
+  root->addChild(transform);
+  root->addChild(new SoCube);
+
+  CullTestBoxesResult result = { 0, 0, 0, 0 };
+  SoCallbackAction cba;
+  cba.addPreCallback(SoCube::getClassTypeId(), cull_test_boxes_cb, &result);
+  cba.apply(root);
+  root->unref();
+
+  BOOST_CHECK_MESSAGE(result.numboxes > 0, "callback not invoked");
+  BOOST_CHECK_MESSAGE(result.numculled > result.numboxes / 2, "too few boxes culled");
+  BOOST_CHECK_MESSAGE(result.numwrong == 0,
+                      "cullTestBoxes() culled boxes cullTest() keeps");
+  // only boxes touching a plane may be kept by cullTestBoxes() alone
+  BOOST_CHECK_MESSAGE(result.numagree >= result.numboxes - result.numboxes / 1000,
+                      "cullTestBoxes() differs too much from cullTest()");
+}
+
+#endif // COIN_TEST_SUITE
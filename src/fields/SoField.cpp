@@ -135,6 +135,7 @@
 #include "fields/SoGlobalField.h"
 #include "io/SoWriterefCounter.h"
 #include "misc/SoConfigSettings.h"
+#include "misc/SoPartialChangeLog.h"
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
 inline unsigned int SbHashFunc(const void * key);
@@ -1575,6 +1576,14 @@ SoField::enableNotify(SbBool on)
 {
   const SbBool old = this->getStatus(FLAG_DONOTIFY);
   (void) this->changeStatusBits(FLAG_DONOTIFY, on);
+  // values of node fields may have been changed without notification,
+  // so the partial changes logged for the nodes can't be trusted
+  if (on && !old && this->isOfType(SoMField::getClassTypeId())) {
+    SoFieldContainer * container = this->getContainer();
+    if (container && container->isOfType(SoNode::getClassTypeId())) {
+      SoPartialChangeLog::invalidate();
+    }
+  }
   return old;
 }
 
@@ -54,11 +54,11 @@
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoIndexedFaceSet.h>
 #include <Inventor/nodes/SoInfo.h>
-#include <Inventor/SbBSPTree.h>
 #include <Inventor/SoPrimitiveVertex.h>
 
 #include "steel.h"
 #include "nodekits/SoSubKitP.h"
+#include "base/SbSpatialHash.h"
 
 
 #if 0
@@ -79,8 +79,8 @@ public:
   SoSTLFileKitP(SoSTLFileKit * pub)
   : api(pub) {
     this->data = new SbList<uint16_t>;
-    this->points = new SbBSPTree;
-    this->normals = new SbBSPTree;
+    this->points = new SbSpatialHash;
+    this->normals = new SbSpatialHash;
   }
   ~SoSTLFileKitP(void) {
     delete this->data;
@@ -92,8 +92,8 @@ public:
   SoSTLFileKit * const api;
 
   SbList<uint16_t> * data;
-  SbBSPTree * points;
-  SbBSPTree * normals;
+  SbSpatialHash * points;
+  SbSpatialHash * normals;
 
   int numfacets;
   int numvertices;
@@ -341,7 +341,7 @@ SoSTLFileKit::readFile(const char * filename)
     }
   }
 
-  // done - no need for the BSP trees to contain data any more
+  // done - no need for the point hashes to contain data any more
   PRIVATE(this)->points->clear();
   PRIVATE(this)->normals->clear();
 
@@ -381,7 +381,7 @@ SoSTLFileKit::readScene(SoNode * scene)
   cba.apply(scene);
   scene->unrefNoDelete();
 
-  // no need for the BSP trees to contain data any more
+  // no need for the point hashes to contain data any more
   PRIVATE(this)->points->clear();
   PRIVATE(this)->normals->clear();
 
@@ -249,6 +249,7 @@
 #include "glue/gl_cgl.h"
 #include "glue/gl_glx.h"
 #include "glue/gl_wgl.h"
+#include "rendering/SoGLRenderStatistics.h"
 #include "threads/threadsutilp.h"
 
 /* ********************************************************************** */
@@ -3407,6 +3408,7 @@ cc_glglue_glDrawArrays(const cc_glglue * glue,
 {
   assert(glue->glDrawArrays);
   glue->glDrawArrays(mode, first, count);
+  SoGLRenderStatistics::count(SoGLRenderAction::DRAW_CALLS);
 }
 
 void
@@ -3416,6 +3418,7 @@ cc_glglue_glDrawElements(const cc_glglue * glue,
 {
   assert(glue->glDrawElements);
   glue->glDrawElements(mode, count, type, indices);
+  SoGLRenderStatistics::count(SoGLRenderAction::DRAW_CALLS);
 }
 
 void
@@ -3425,6 +3428,7 @@ cc_glglue_glDrawRangeElements(const cc_glglue * glue,
 {
   assert(glue->glDrawRangeElements);
   glue->glDrawRangeElements(mode, start, end, count, type, indices);
+  SoGLRenderStatistics::count(SoGLRenderAction::DRAW_CALLS);
 }
 
 void
@@ -3447,6 +3451,7 @@ cc_glglue_glMultiDrawArrays(const cc_glglue * glue, GLenum mode, const GLint * f
 {
   assert(glue->glMultiDrawArrays);
   glue->glMultiDrawArrays(mode, first, count, primcount);
+  SoGLRenderStatistics::count(SoGLRenderAction::DRAW_CALLS);
 }
 
 void
@@ -3455,6 +3460,7 @@ cc_glglue_glMultiDrawElements(const cc_glglue * glue, GLenum mode, const GLsizei
 {
   assert(glue->glMultiDrawElements);
   glue->glMultiDrawElements(mode, count, type, indices, primcount);
+  SoGLRenderStatistics::count(SoGLRenderAction::DRAW_CALLS);
 }
 
 SbBool
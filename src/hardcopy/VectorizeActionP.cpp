@@ -696,9 +696,7 @@ SoVectorizeActionP::pre_shape_cb(void * userdata,
     const SbViewVolume & vv = SoViewVolumeElement::get(state);
     vv.getViewVolumePlanes(thisp->vvplane);
     SbMatrix toobj = SoModelMatrixElement::get(state).inverse();
-    for (int i =0; i < 6; i++) {
-      thisp->vvplane[i].transform(toobj);
-    }
+    SbPlane::transform(toobj, thisp->vvplane, 6);
   }
   const SoClipPlaneElement * celem = SoClipPlaneElement::getInstance(state);
   thisp->clipplanes.truncate(0);
@@ -53,7 +53,9 @@
 #include <Inventor/errors/SoDebugError.h>
 
 #include "io/gzmemio.h"
+#include "io/gzparallel.h"
 #include "glue/zlib.h"
+#include "threads/parallelp.h"
 #include "glue/bzip2.h"
 
 // We don't want to include bzlib.h, so we just define the constants
@@ -304,6 +306,67 @@ SoInput_GZMemBufferReader::readBuffer(char * buffer, const size_t readlen)
   return cc_gzm_read(this->gzmfile, buffer, (uint32_t)readlen);
 }
 
+//
+// read-ahead for the compressed file readers
+//
+
+static const size_t READAHEAD_BUFFER_SIZE = 256 * 1024;
+
+SoInput_ReadAhead::SoInput_ReadAhead(ReadFunc * funcarg, void * closurearg)
+{
+  this->func = funcarg;
+  this->closure = closurearg;
+  this->buffer[0] = new char[READAHEAD_BUFFER_SIZE];
+  this->buffer[1] = new char[READAHEAD_BUFFER_SIZE];
+  this->buflen[0] = this->buflen[1] = 0;
+  this->current = 0;
+  this->pos = 0;
+  this->eof = FALSE;
+
+  // start filling the buffer we will switch to on the first read
+  this->task = cc_parallel_task_start(SoInput_ReadAhead::readTask, this);
+}
+
+SoInput_ReadAhead::~SoInput_ReadAhead()
+{
+  if (this->task) cc_parallel_task_wait(this->task);
+  delete[] this->buffer[0];
+  delete[] this->buffer[1];
+}
+
+void
+SoInput_ReadAhead::readTask(void * closure)
+{
+  SoInput_ReadAhead * thisp = static_cast<SoInput_ReadAhead *>(closure);
+  const int fill = 1 - thisp->current;
+  thisp->buflen[fill] = thisp->func(thisp->closure, thisp->buffer[fill],
+                                    READAHEAD_BUFFER_SIZE);
+}
+
+size_t
+SoInput_ReadAhead::read(char * buf, const size_t readlen)
+{
+  if (this->pos == this->buflen[this->current]) {
+    if (this->eof) return 0;
+
+    cc_parallel_task_wait(this->task);
+    this->task = NULL;
+    this->current = 1 - this->current;
+    this->pos = 0;
+    if (this->buflen[this->current] == 0) {
+      this->eof = TRUE;
+      return 0;
+    }
+    this->task = cc_parallel_task_start(SoInput_ReadAhead::readTask, this);
+  }
+
+  size_t num = this->buflen[this->current] - this->pos;
+  if (num > readlen) num = readlen;
+  (void)memcpy(buf, this->buffer[this->current] + this->pos, num);
+  this->pos += num;
+  return num;
+}
+
 //
 // gzFile class
 //
@@ -312,10 +375,15 @@ SoInput_GZFileReader::SoInput_GZFileReader(const char * const filenamearg, void
 {
   this->gzfp = fp;
   this->filename = filenamearg;
+  this->readahead = NULL;
+  if (cc_gzp_get_num_threads() > 1) {
+    this->readahead = new SoInput_ReadAhead(SoInput_GZFileReader::readDirect, this);
+  }
 }
 
 SoInput_GZFileReader::~SoInput_GZFileReader()
 {
+  delete this->readahead;
   assert(this->gzfp);
   cc_zlibglue_gzclose(this->gzfp);
 }
@@ -329,9 +397,17 @@ SoInput_GZFileReader::getType(void) const
 size_t
 SoInput_GZFileReader::readBuffer(char * buf, const size_t readlen)
 {
+  if (this->readahead) return this->readahead->read(buf, readlen);
+  return SoInput_GZFileReader::readDirect(this, buf, readlen);
+}
+
+size_t
+SoInput_GZFileReader::readDirect(void * closure, char * buf, const size_t readlen)
+{
+  SoInput_GZFileReader * thisp = static_cast<SoInput_GZFileReader *>(closure);
   // FIXME: about the cast; see note about the call to cc_gzm_open()
   // above. 20050525 mortene.
-  int result = cc_zlibglue_gzread(this->gzfp, (void*) buf, (uint32_t)readlen);
+  int result = cc_zlibglue_gzread(thisp->gzfp, (void*) buf, (uint32_t)readlen);
 
   // the signature of this this function was changed to return size_t
   // without checking that gzread() actually returns a signed
@@ -356,10 +432,15 @@ SoInput_BZ2FileReader::SoInput_BZ2FileReader(const char * const filenamearg, voi
 {
   this->bzfp = fp;
   this->filename = filenamearg;
+  this->readahead = NULL;
+  if (cc_gzp_get_num_threads() > 1) {
+    this->readahead = new SoInput_ReadAhead(SoInput_BZ2FileReader::readDirect, this);
+  }
 }
 
 SoInput_BZ2FileReader::~SoInput_BZ2FileReader()
 {
+  delete this->readahead;
   if (this->bzfp) {
     int bzerror = BZ_OK;
     cc_bzglue_BZ2_bzReadClose(&bzerror, this->bzfp);
@@ -375,17 +456,25 @@ SoInput_BZ2FileReader::getType(void) const
 size_t
 SoInput_BZ2FileReader::readBuffer(char * buf, const size_t readlen)
 {
-  if (this->bzfp == NULL) { return 0; }
+  if (this->readahead) return this->readahead->read(buf, readlen);
+  return SoInput_BZ2FileReader::readDirect(this, buf, readlen);
+}
+
+size_t
+SoInput_BZ2FileReader::readDirect(void * closure, char * buf, const size_t readlen)
+{
+  SoInput_BZ2FileReader * thisp = static_cast<SoInput_BZ2FileReader *>(closure);
+  if (thisp->bzfp == NULL) { return 0; }
 
   int bzerror = BZ_OK;
   // FIXME: about the cast; see note about the call to cc_gzm_open()
   // above. 20050525 mortene.
-  int ret = cc_bzglue_BZ2_bzRead(&bzerror, this->bzfp,
+  int ret = cc_bzglue_BZ2_bzRead(&bzerror, thisp->bzfp,
                                  buf, (uint32_t)readlen);
   if ((bzerror != BZ_OK) && (bzerror != BZ_STREAM_END)) {
     ret = 0;
-    cc_bzglue_BZ2_bzReadClose(&bzerror, this->bzfp);
-    this->bzfp = NULL;
+    cc_bzglue_BZ2_bzReadClose(&bzerror, thisp->bzfp);
+    thisp->bzfp = NULL;
   }
   // the signature of this this function was changed to return size_t
   // without checking that bzRead() actually returns a signed
@@ -124,6 +124,30 @@ public:
 };
 
 
+// Decompresses ahead of the parser in a separate thread, using two
+// buffers which are swapped when the parser has consumed one of them.
+class SoInput_ReadAhead {
+public:
+  typedef size_t ReadFunc(void * closure, char * buf, const size_t readlen);
+
+  SoInput_ReadAhead(ReadFunc * func, void * closure);
+  ~SoInput_ReadAhead();
+
+  size_t read(char * buf, const size_t readlen);
+
+private:
+  static void readTask(void * closure);
+
+  ReadFunc * func;
+  void * closure;
+  char * buffer[2];
+  size_t buflen[2];
+  int current;
+  size_t pos;
+  SbBool eof;
+  struct cc_parallel_task * task;
+};
+
 class SoInput_GZFileReader : public SoInput_Reader {
 public:
   SoInput_GZFileReader(const char * const filename, void * fp);
@@ -135,8 +159,11 @@ public:
   virtual const SbString & getFilename(void);
 
 public:
+  static size_t readDirect(void * closure, char * buf, const size_t readlen);
+
   void * gzfp;
   SbString filename;
+  SoInput_ReadAhead * readahead;
 };
 
 class SoInput_BZ2FileReader : public SoInput_Reader {
@@ -150,8 +177,11 @@ public:
   virtual const SbString & getFilename(void);
 
 public:
+  static size_t readDirect(void * closure, char * buf, const size_t readlen);
+
   void * bzfp;
   SbString filename;
+  SoInput_ReadAhead * readahead;
 };
 
 #endif // COIN_SOINPUT_READER_H
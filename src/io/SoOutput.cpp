@@ -81,6 +81,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <cmath>
 
 #ifdef HAVE_WINDOWS_H
 #include <windows.h>
@@ -176,6 +177,7 @@ class SoOutputP {
 public:
   SoOutputP(void) {
     this->writer = NULL;
+    this->counter = NULL;
   }
   ~SoOutputP() {
     delete this->writer;
@@ -185,6 +187,7 @@ public:
   SbBool usercalledopenfile;
   SbString fltprecision;
   SbString dblprecision;
+  int fltdigits;
   int indentlevel;
   SbBool writecompact;
   SbBool disabledwriting;
@@ -295,6 +298,145 @@ SoOutput_compression_list_init(void)
   coin_atexit((coin_atexit_f*) SoOutput_compression_list_cleanup, CC_ATEXIT_NORMAL);
 }
 
+// *************************************************************************
+
+// Writing ASCII files is dominated by the formatting of numbers, so
+// integers and floats are formatted without going through sprintf(),
+// and without having to switch to a portable locale for each value.
+
+// formats i in base 10 into buf (which must have room for at least 12
+// characters). Returns the number of characters.
+static int
+SoOutput_format_int(char * buf, const int i)
+{
+  char tmp[12];
+  int n = 0;
+  // avoid overflow for the most negative value by working on the
+  // negative number
+  int val = i < 0 ? i : -i;
+  do {
+    tmp[n++] = static_cast<char>('0' - (val % 10));
+    val /= 10;
+  } while (val != 0);
+
+  int len = 0;
+  if (i < 0) buf[len++] = '-';
+  while (n > 0) buf[len++] = tmp[--n];
+  return len;
+}
+
+// formats i in base 16, prefixed with "0x", like sprintf("0x%x")
+// does. buf must have room for at least 10 characters. Returns the
+// number of characters.
+static int
+SoOutput_format_hex(char * buf, unsigned int i)
+{
+  static const char hexdigits[] = "0123456789abcdef";
+  char tmp[8];
+  int n = 0;
+  do {
+    tmp[n++] = hexdigits[i & 0xf];
+    i >>= 4;
+  } while (i != 0);
+
+  int len = 0;
+  buf[len++] = '0';
+  buf[len++] = 'x';
+  while (n > 0) buf[len++] = tmp[--n];
+  return len;
+}
+
+// Formats f into buf (which must have room for at least 32
+// characters) like sprintf("%.<precision>g") does, with the exponent
+// written with at least three digits. Returns the number of
+// characters, or -1 if the value must be formatted with sprintf().
+//
+// The value is scaled to an integer with precision digits using a
+// single correctly rounded multiplication or division with an exact
+// power of ten. The rounding to the last digit is only done here when
+// the scaled value is not close to halfway between two integers, so
+// that the result always matches rounding the exact value.
+static int
+SoOutput_format_float(char * buf, const float f, const int precision)
+{
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const int maxpow10 = 22;
+
+  if (f == 0.0f || !coin_finite(f)) return -1;
+
+  const int numdigits = precision > 0 ? precision : 1;
+  const double d = fabs(static_cast<double>(f));
+  int exponent = static_cast<int>(floor(log10(d)));
+
+  double scaled = 0.0;
+  // log10() might be off by one for values close to a power of ten
+  for (int tries = 0; tries < 3; tries++) {
+    const int k = numdigits - 1 - exponent;
+    if (k > maxpow10 || k < -maxpow10) return -1;
+    scaled = (k >= 0) ? d * pow10[k] : d / pow10[-k];
+    if (scaled >= pow10[numdigits]) exponent++;
+    else if (scaled < pow10[numdigits - 1]) exponent--;
+    else break;
+  }
+  if (scaled >= pow10[numdigits] || scaled < pow10[numdigits - 1]) return -1;
+
+  const double intpart = floor(scaled);
+  const double frac = scaled - intpart;
+  if (fabs(frac - 0.5) < 1.0e-6) return -1;
+
+  uint32_t digits = static_cast<uint32_t>(intpart);
+  if (frac > 0.5) digits++;
+  if (digits >= static_cast<uint32_t>(pow10[numdigits])) {
+    digits /= 10;
+    exponent++;
+  }
+
+  char digitstr[12];
+  int i;
+  for (i = numdigits - 1; i >= 0; i--) {
+    digitstr[i] = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  }
+  // %g doesn't write trailing zeros
+  int numsignificant = numdigits;
+  while (numsignificant > 1 && digitstr[numsignificant - 1] == '0') numsignificant--;
+
+  int len = 0;
+  if (f < 0.0f) buf[len++] = '-';
+
+  if (exponent < -4 || exponent >= numdigits) {
+    buf[len++] = digitstr[0];
+    if (numsignificant > 1) {
+      buf[len++] = '.';
+      for (i = 1; i < numsignificant; i++) buf[len++] = digitstr[i];
+    }
+    buf[len++] = 'e';
+    buf[len++] = exponent < 0 ? '-' : '+';
+    const int absexp = exponent < 0 ? -exponent : exponent;
+    if (absexp >= 100) buf[len++] = static_cast<char>('0' + absexp / 100);
+    else buf[len++] = '0';
+    buf[len++] = static_cast<char>('0' + (absexp / 10) % 10);
+    buf[len++] = static_cast<char>('0' + absexp % 10);
+  }
+  else if (exponent >= 0) {
+    for (i = 0; i <= exponent; i++) buf[len++] = digitstr[i];
+    if (numsignificant > exponent + 1) {
+      buf[len++] = '.';
+      for (i = exponent + 1; i < numsignificant; i++) buf[len++] = digitstr[i];
+    }
+  }
+  else {
+    buf[len++] = '0';
+    buf[len++] = '.';
+    for (i = 0; i < -exponent - 1; i++) buf[len++] = '0';
+    for (i = 0; i < numsignificant; i++) buf[len++] = digitstr[i];
+  }
+  return len;
+}
+
 #define PRIVATE(obj) (obj->pimpl)
 
 /*!
@@ -340,6 +482,7 @@ SoOutput::constructorCommon(void)
   PRIVATE(this)->usercalledopenfile = FALSE;
   PRIVATE(this)->binarystream = FALSE;
   PRIVATE(this)->fltprecision = "%.8g";
+  PRIVATE(this)->fltdigits = 8;
   PRIVATE(this)->dblprecision = "%.16lg";
   PRIVATE(this)->disabledwriting = FALSE;
   this->wroteHeader = FALSE;
@@ -358,6 +501,7 @@ SoOutput::constructorCommon(void)
 */
 SoOutput::~SoOutput(void)
 {
+  PRIVATE(this)->counter = NULL;
   SoWriterefCounter::destruct(this);
   this->reset();
   delete PRIVATE(this)->headerstring;
@@ -397,6 +541,9 @@ SoOutput::setFilePointer(FILE * newFP)
 FILE *
 SoOutput::getFilePointer(void) const
 {
+  // the caller might write directly to the file, so make sure
+  // everything written so far is in the file
+  PRIVATE(this)->getWriter()->flush();
   return PRIVATE(this)->getWriter()->getFilePointer();
 }
 
@@ -445,6 +592,24 @@ SoOutput::closeFile(void)
   }
 }
 
+/*!
+  Passes any data written to a file, but still kept in the buffer used
+  by SoOutput to collect small writes, on to the file. This is done
+  automatically when the file is closed, when getFilePointer() is
+  called and at the end of each SoWriteAction traversal.
+
+  Call this before writing directly to a file pointer set with
+  setFilePointer(), or before closing it, if data has been written
+  through SoOutput outside of an SoWriteAction.
+
+  \sa setFilePointer(), closeFile()
+*/
+void
+SoOutput::flushFile(void)
+{
+  PRIVATE(this)->getWriter()->flush();
+}
+
 /*!
 
   Sets the compression method and level used when writing the file. \a
@@ -724,6 +889,7 @@ SoOutput::setFloatPrecision(const int precision)
   const int dblnum = precision * 2;
 
   PRIVATE(this)->fltprecision.sprintf("%%.%dg", fltnum);
+  PRIVATE(this)->fltdigits = fltnum;
   PRIVATE(this)->dblprecision.sprintf("%%.%dlg", dblnum);
 }
 
@@ -847,16 +1013,9 @@ void
 SoOutput::write(const int i)
 {
   if (!this->isBinary()) {
-    // Use portable locale, to make sure we don't write thousands
-    // separators for integers.
-    cc_string storedlocale;
-    SbBool changed = coin_locale_set_portable(&storedlocale);
-
-    SbString s;
-    s.sprintf("%d", i);
-    this->writeBytesWithPadding(s.getString(), s.getLength());
-
-    if (changed) { coin_locale_reset(&storedlocale); }
+    char buf[12];
+    const int len = SoOutput_format_int(buf, i);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     // FIXME: breaks on 64-bit architectures, which is pretty
@@ -875,9 +1034,9 @@ void
 SoOutput::write(const unsigned int i)
 {
   if (!this->isBinary()) {
-    SbString s;
-    s.sprintf("0x%x", i);
-    this->writeBytesWithPadding(s.getString(), s.getLength());
+    char buf[12];
+    const int len = SoOutput_format_hex(buf, i);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     assert(sizeof(i) == sizeof(int32_t));
@@ -895,16 +1054,9 @@ void
 SoOutput::write(const short s)
 {
   if (!this->isBinary()) {
-    // Use portable locale, to make sure we don't write thousands
-    // separators for integers.
-    cc_string storedlocale;
-    SbBool changed = coin_locale_set_portable(&storedlocale);
-
-    SbString str;
-    str.sprintf("%hd", s);
-    this->writeBytesWithPadding(str.getString(), str.getLength());
-
-    if (changed) { coin_locale_reset(&storedlocale); }
+    char buf[12];
+    const int len = SoOutput_format_int(buf, s);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     this->write((int)s);
@@ -920,9 +1072,9 @@ void
 SoOutput::write(const unsigned short s)
 {
   if (!this->isBinary()) {
-    SbString str;
-    str.sprintf("0x%hx", s);
-    this->writeBytesWithPadding(str.getString(), str.getLength());
+    char buf[12];
+    const int len = SoOutput_format_hex(buf, s);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     this->write((unsigned int)s);
@@ -936,6 +1088,13 @@ void
 SoOutput::write(const float f)
 {
   if (!this->isBinary()) {
+    char buf[32];
+    const int len = SoOutput_format_float(buf, f, PRIVATE(this)->fltdigits);
+    if (len > 0) {
+      this->writeBytesWithPadding(buf, len);
+      return;
+    }
+
     // Use portable locale, to make sure we don't write thousands
     // separators for integers.
     cc_string storedlocale;
@@ -1036,9 +1195,9 @@ SoOutput::writeBinaryArray(const unsigned char * constc, const int length)
 
   this->checkHeader();
 
-  size_t wrote = PRIVATE(this)->getWriter()->write((const char*) constc,
-                                                   (size_t) length,
-                                                   PRIVATE(this)->binarystream);
+  size_t wrote = PRIVATE(this)->getWriter()->bufferedWrite((const char*) constc,
+                                                           (size_t) length,
+                                                           PRIVATE(this)->binarystream);
   if (wrote != (size_t)length) {
     SoDebugError::postWarning("SoOutput::writeBinaryArray",
                               "Couldn't write to file/memory buffer");
@@ -1346,7 +1505,8 @@ SoOutput::isToBuffer(void) const
 size_t
 SoOutput::bytesInBuf(void) const
 {
-  return PRIVATE(this)->getWriter()->bytesInBuf();
+  SoOutput_Writer * writer = PRIVATE(this)->getWriter();
+  return writer->bytesInBuf() + writer->bytesBuffered();
 
 //   if (this->isToBuffer()) { return PRIVATE(this)->bufferoffset; }
 //   else { return ftell(PRIVATE(this)->filep); }
@@ -1716,4 +1876,147 @@ SoOutput_getHeaderString(const SoOutputP * pout)
   else return SoOutput::getDefaultASCIIHeader();
 }
 
+// Used by SoWriterefCounter::instance() to avoid looking up the
+// counter in the global dictionary for each object written.
+SoWriterefCounter *
+SoOutput_getWriterefCounter(const SoOutputP * pout)
+{
+  return pout->counter;
+}
+
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static void *
+SoOutput_test_realloc(void * bufptr, size_t size)
+{
+  return realloc(bufptr, size);
+}
+
+// formats the value the way SoOutput did before numbers were
+// formatted without sprintf()
+static SbString
+SoOutput_test_reference(const float f, const int precision)
+{
+  char buf[64];
+  sprintf(buf, "%.*g", precision, f);
+  char * e = strchr(buf, 'e');
+  if (e) { sprintf(e + 2, "%03d", atoi(e + 2)); }
+  return SbString(buf);
+}
+
+BOOST_AUTO_TEST_CASE(formatNumbers)
+{
+  SbString expected;
+  SoOutput out;
+  out.setBuffer(malloc(1024), 1024, SoOutput_test_realloc);
+
+  const int ints[] = { 0, 1, -1, 42, -1234567, 2147483647, -2147483647 - 1 };
+  for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+    out.write(ints[i]);
+    out.write(' ');
+    expected.addIntString(ints[i]);
+    expected += ' ';
+  }
+  out.write(static_cast<short>(-32768));
+  out.write(' ');
+  out.write(static_cast<unsigned int>(0xdeadbeef));
+  out.write(' ');
+  out.write(static_cast<unsigned short>(0x00ff));
+  out.write(' ');
+  expected += "-32768 0xdeadbeef 0xff ";
+
+  uint32_t seed = 1;
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1664525 + 1013904223;
+    const float mantissa = static_cast<float>(seed >> 8) / 16777216.0f;
+    const int exponent = static_cast<int>(seed % 17) - 8;
+    float f = mantissa * static_cast<float>(pow(10.0, exponent));
+    if (seed & 0x80) f = -f;
+    if (i % 100 == 0) f = static_cast<float>(i) * 0.5f;
+
+    const int precision = (i < 10000) ? 8 : 1 + (i % 8);
+    out.setFloatPrecision(precision);
+    out.write(f);
+    out.write(' ');
+    expected += SoOutput_test_reference(f, precision);
+    expected += ' ';
+  }
+
+  void * buffer;
+  size_t size;
+  out.getBuffer(buffer, size);
+  // skip the file header written in front of the first value
+  const int start = static_cast<int>(size) - expected.getLength();
+  BOOST_REQUIRE(start >= 0);
+  const SbString written(static_cast<const char *>(buffer), start, static_cast<int>(size) - 1);
+  free(buffer);
+
+  BOOST_CHECK_MESSAGE(written == expected,
+                      "numbers not formatted like sprintf() does");
+}
+
+BOOST_AUTO_TEST_CASE(compressedRoundTrip)
+{
+  unsigned int num;
+  const SbName * methods = SoOutput::getAvailableCompressionMethods(num);
+  SbBool hasgzip = FALSE;
+  for (unsigned int i = 0; i < num; i++) {
+    if (methods[i] == "GZIP") hasgzip = TRUE;
+  }
+  if (!hasgzip) return;
+
+  // enough data to span several compression blocks
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  const int numpoints = 100000;
+  coords->point.setNum(numpoints);
+  SbVec3f * points = coords->point.startEditing();
+  for (int i = 0; i < numpoints; i++) {
+    points[i].setValue(static_cast<float>(i), static_cast<float>(i % 97) * 0.25f, 1.0f);
+  }
+  coords->point.finishEditing();
+  root->addChild(coords);
+
+  const char * filename = "SoOutput_compressedRoundTrip.iv.gz";
+  SoOutput out;
+  BOOST_REQUIRE(out.setCompression("GZIP", 0.5f));
+  BOOST_REQUIRE(out.openFile(filename));
+  SoWriteAction wa(&out);
+  wa.apply(root);
+  out.closeFile();
+
+  SoInput in;
+  BOOST_REQUIRE(in.openFile(filename));
+  SoSeparator * readroot = SoDB::readAll(&in);
+  in.closeFile();
+  (void)remove(filename);
+  BOOST_REQUIRE(readroot != NULL);
+  readroot->ref();
+
+  BOOST_REQUIRE(readroot->getNumChildren() == 1);
+  const SoCoordinate3 * readcoords =
+    static_cast<const SoCoordinate3 *>(readroot->getChild(0));
+  BOOST_REQUIRE(readcoords->isOfType(SoCoordinate3::getClassTypeId()));
+  BOOST_CHECK_EQUAL(readcoords->point.getNum(), numpoints);
+  BOOST_CHECK_MESSAGE(memcmp(readcoords->point.getValues(0),
+                             coords->point.getValues(0),
+                             numpoints * sizeof(SbVec3f)) == 0,
+                      "compressed file not read back unchanged");
+
+  readroot->unref();
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
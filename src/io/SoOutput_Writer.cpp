@@ -52,6 +52,7 @@
 #include <Inventor/SbName.h>
 
 #include "glue/zlib.h"
+#include "io/gzparallel.h"
 #include "glue/bzip2.h"
 
 // We don't want to include bzlib.h, so we just define the constants
@@ -65,16 +66,70 @@
 #define BZ_IO_ERROR (-6)
 #endif // BZ_IO_ERROR
 
+// size of the buffer used to collect small writes
+static const size_t WRITE_BUFFER_SIZE = 64 * 1024;
+
 //
 // abstract interface class
 //
 
 SoOutput_Writer::SoOutput_Writer(void)
+  : writebuf(NULL),
+    writebufused(0),
+    writebufbinary(FALSE)
 {
 }
 
 SoOutput_Writer::~SoOutput_Writer()
 {
+  // subclasses using the buffer must flush it in their destructor
+  assert(this->writebufused == 0);
+  delete[] this->writebuf;
+}
+
+size_t
+SoOutput_Writer::bufferedWrite(const char * buf, size_t numbytes, const SbBool binary)
+{
+  if (this->getType() == MEMBUFFER) {
+    // no need to buffer when writing to memory
+    return this->write(buf, numbytes, binary);
+  }
+  if (this->writebufused && (binary != this->writebufbinary)) {
+    this->flush();
+  }
+  if (this->writebufused + numbytes > WRITE_BUFFER_SIZE) {
+    this->flush();
+    if (numbytes > WRITE_BUFFER_SIZE / 2) {
+      // no point in copying large blocks
+      return this->write(buf, numbytes, binary);
+    }
+  }
+  if (this->writebuf == NULL) {
+    this->writebuf = new char[WRITE_BUFFER_SIZE];
+  }
+  (void)memcpy(this->writebuf + this->writebufused, buf, numbytes);
+  this->writebufused += numbytes;
+  this->writebufbinary = binary;
+  return numbytes;
+}
+
+void
+SoOutput_Writer::flush(void)
+{
+  if (this->writebufused == 0) return;
+
+  const size_t numbytes = this->writebufused;
+  this->writebufused = 0;
+  if (this->write(this->writebuf, numbytes, this->writebufbinary) != numbytes) {
+    SoDebugError::postWarning("SoOutput_Writer::flush",
+                              "Couldn't write to file");
+  }
+}
+
+size_t
+SoOutput_Writer::bytesBuffered(void) const
+{
+  return this->writebufused;
 }
 
 FILE * 
@@ -125,6 +180,7 @@ SoOutput_FileWriter::SoOutput_FileWriter(FILE * fptr, const SbBool shouldclosear
 
 SoOutput_FileWriter::~SoOutput_FileWriter()
 {
+  this->flush();
   if (this->shouldclose) {
     assert(this->fp);
     fclose(this->fp);
@@ -224,17 +280,36 @@ SoOutput_MemBufferWriter::makeRoomInBuf(size_t bytes)
 // zlib writer
 //
 
-SoOutput_GZFileWriter::SoOutput_GZFileWriter(FILE * fp, const SbBool shouldclose, const float level)
+SoOutput_GZFileWriter::SoOutput_GZFileWriter(FILE * fparg, const SbBool shouldclosearg, const float level)
 {
   this->gzfp = NULL;
+  this->gzpfp = NULL;
+  this->fp = NULL;
+  this->shouldclose = FALSE;
+
+  // convert level from [0.0, 1.0] to [1, 9]
+  const int intlevel = (int) SbClamp((level * 8.0f) + 1.0f, 1.0f, 9.0f);
+
+  // compress blocks in parallel when there are threads to spare
+  if (cc_gzp_get_num_threads() > 1) {
+    this->gzpfp = cc_gzp_open(fparg, intlevel);
+    if (this->gzpfp) {
+      this->fp = fparg;
+      this->shouldclose = shouldclosearg;
+    }
+    else {
+      SoDebugError::postWarning("SoOutput_GZFileWriter::SoOutput_GZFileWriter",
+                                "Unable to open file for writing.");
+    }
+    return;
+  }
 
-  int fd = fileno(fp);
-  if (fd >= 0 && !shouldclose) fd = dup(fd);
+  int fd = fileno(fparg);
+  if (fd >= 0 && !shouldclosearg) fd = dup(fd);
 
   if (fd >= 0) {
     SbString mode = "wb";
-    // convert level from [0.0, 1.0] to [1, 9]
-    mode.addIntString((int) SbClamp((level * 8.0f) + 1.0f, 1.0f, 9.0f));
+    mode.addIntString(intlevel);
 
     this->gzfp = cc_zlibglue_gzdopen(fd, mode.getString());
     if (!this->gzfp) {
@@ -251,9 +326,18 @@ SoOutput_GZFileWriter::SoOutput_GZFileWriter(FILE * fp, const SbBool shouldclose
 
 SoOutput_GZFileWriter::~SoOutput_GZFileWriter()
 {
+  this->flush();
   if (this->gzfp) {
     cc_zlibglue_gzclose(this->gzfp);
   }
+  if (this->gzpfp) {
+    if (cc_gzp_close(this->gzpfp) != 0) {
+      SoDebugError::postWarning("SoOutput_GZFileWriter::~SoOutput_GZFileWriter",
+                                "Error when writing gzip file.");
+    }
+    if (this->shouldclose) fclose(this->fp);
+    else fflush(this->fp);
+  }
 }
 
 
@@ -272,6 +356,9 @@ SoOutput_GZFileWriter::write(const char * buf, size_t numbytes, const SbBool COI
     // fixed in the interface instead. 20050526 mortene.
     return cc_zlibglue_gzwrite(this->gzfp, (void*)buf, (int)numbytes);
   }
+  if (this->gzpfp) {
+    return cc_gzp_write(this->gzpfp, buf, (uint32_t)numbytes);
+  }
   return 0;
 }
 
@@ -281,6 +368,9 @@ SoOutput_GZFileWriter::bytesInBuf(void)
   if (this->gzfp) {
     return cc_zlibglue_gztell(this->gzfp);
   }
+  if (this->gzpfp) {
+    return cc_gzp_tell(this->gzpfp);
+  }
   return 0;
 }
 
@@ -307,6 +397,7 @@ SoOutput_BZ2FileWriter::SoOutput_BZ2FileWriter(FILE * fparg, const SbBool should
 
 SoOutput_BZ2FileWriter::~SoOutput_BZ2FileWriter()
 {
+  this->flush();
   if (this->bzfp) {
     int bzerror = BZ_OK;
     cc_bzglue_BZ2_bzWriteClose(&bzerror, this->bzfp, 0, NULL, NULL);
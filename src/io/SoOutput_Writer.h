@@ -76,6 +76,23 @@ public:
                                         const SbName & compmethod,
                                         const float level);
 
+  // writes numbytes bytes from buf. For writers other than
+  // MEMBUFFER, the bytes are collected in a buffer, which is passed on
+  // to write() when it's full, or when flush() is called.
+  size_t bufferedWrite(const char * buf, size_t numbytes, const SbBool binary);
+
+  // passes any buffered bytes on to write(). Must be called by the
+  // destructor of writers using the buffer.
+  void flush(void);
+
+  // returns the number of bytes in the buffer, not yet passed on to
+  // write()
+  size_t bytesBuffered(void) const;
+
+private:
+  char * writebuf;
+  size_t writebufused;
+  SbBool writebufbinary;
 };
 
 // class for stdio writing
@@ -130,6 +147,9 @@ public:
 
 public:
   void * gzfp;
+  void * gzpfp;
+  FILE * fp;
+  SbBool shouldclose;
 };
 
 class SoOutput_BZ2FileWriter : public SoOutput_Writer {
@@ -59,7 +59,9 @@ public:
 
 // *************************************************************************
 
-typedef SbHash<const SoBase *, SoWriterefCounterBaseData *> SoBase2SoWriterefCounterBaseDataMap;
+// The data is stored by value to avoid a heap allocation for each
+// object counted during the first write pass.
+typedef SbHash<const SoBase *, SoWriterefCounterBaseData> SoBase2SoWriterefCounterBaseDataMap;
 
 class SoWriterefCounterOutputData {
 public:
@@ -109,15 +111,6 @@ private:
   int refcount;
 
   void cleanup(void) {
-    for(
-       SoBase2SoWriterefCounterBaseDataMap::const_iterator iter =
-         writerefdict.const_begin();
-       iter!=writerefdict.const_end();
-       ++iter
-       ) {
-      delete iter->obj;
-    }
-
     this->writerefdict.clear();
   }
 
@@ -252,6 +245,9 @@ SoWriterefCounter::setInstancePrefix(const SbString & s)
   (*SoWriterefCounterP::refwriteprefix) = s;
 }
 
+// Implemented in SoOutput.cpp.
+extern SoWriterefCounter * SoOutput_getWriterefCounter(const SoOutputP * pout);
+
 SoWriterefCounter *
 SoWriterefCounter::instance(SoOutput * out)
 {
@@ -260,6 +256,20 @@ SoWriterefCounter::instance(SoOutput * out)
     return SoWriterefCounterP::current;
   }
 
+  // This is called several times for each object written, so use the
+  // instance cached in the SoOutput when it's available. It's only
+  // missing while the SoOutput is being constructed or destructed.
+  SoWriterefCounter * cached = SoOutput_getWriterefCounter(out->pimpl);
+  if (cached) {
+    // only lock when the instance for instance(NULL) has to change
+    if (SoWriterefCounterP::current != cached) {
+      CC_MUTEX_LOCK(SoWriterefCounterP::mutex);
+      SoWriterefCounterP::current = cached;
+      CC_MUTEX_UNLOCK(SoWriterefCounterP::mutex);
+    }
+    return cached;
+  }
+
   CC_MUTEX_LOCK(SoWriterefCounterP::mutex);
 
   SoWriterefCounter * inst = NULL;
@@ -275,9 +285,10 @@ SoWriterefCounter::instance(SoOutput * out)
 SbBool
 SoWriterefCounter::shouldWrite(const SoBase * base) const
 {
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    return data->ingraph;
+  SoBase2SoWriterefCounterBaseDataMap::const_iterator iter =
+    PRIVATE(this)->outputdata->writerefdict.find(base);
+  if (iter != PRIVATE(this)->outputdata->writerefdict.const_end()) {
+    return iter->obj.ingraph;
   }
   return FALSE;
 }
@@ -285,19 +296,16 @@ SoWriterefCounter::shouldWrite(const SoBase * base) const
 SbBool
 SoWriterefCounter::hasMultipleWriteRefs(const SoBase * base) const
 {
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    return data->writeref > 1;
-  }
-  return FALSE;
+  return this->getWriteref(base) > 1;
 }
 
 int
 SoWriterefCounter::getWriteref(const SoBase * base) const
 {
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    return data->writeref;
+  SoBase2SoWriterefCounterBaseDataMap::const_iterator iter =
+    PRIVATE(this)->outputdata->writerefdict.find(base);
+  if (iter != PRIVATE(this)->outputdata->writerefdict.const_end()) {
+    return iter->obj.writeref;
   }
   return 0;
 }
@@ -311,16 +319,7 @@ SoWriterefCounter::setWriteref(const SoBase * base, const int ref)
   //          isInGraph(base));
   //   }
 
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    data->writeref = ref;
-  }
-  else {
-    data = new SoWriterefCounterBaseData;
-    data->writeref = ref;
-    (void) PRIVATE(this)->outputdata->writerefdict.put(base, data);
-  }
-
+  PRIVATE(this)->outputdata->writerefdict[base].writeref = ref;
 
   if (ref == 0) {
     SoOutput * out = PRIVATE(this)->out;
@@ -355,36 +354,32 @@ SoWriterefCounter::decrementWriteref(const SoBase * base)
 SbBool
 SoWriterefCounter::isInGraph(const SoBase * base) const
 {
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    return data->ingraph;
-  }
-  return FALSE;
+  return this->shouldWrite(base);
 }
 
 void
 SoWriterefCounter::setInGraph(const SoBase * base, const SbBool ingraph)
 {
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    data->ingraph = ingraph;
-  }
-  else {
-    data = new SoWriterefCounterBaseData;
-    data->ingraph = ingraph;
-    (void)PRIVATE(this)->outputdata->writerefdict.put(base, data);
-  }
+  PRIVATE(this)->outputdata->writerefdict[base].ingraph = ingraph;
+}
+
+/*!
+  Adds a write reference to \a base, and marks it as part of the
+  graph if \a ingraph is \c TRUE. Returns the number of write
+  references before this one was added.
+*/
+int
+SoWriterefCounter::addWriteref(const SoBase * base, const SbBool ingraph)
+{
+  SoWriterefCounterBaseData & data = PRIVATE(this)->outputdata->writerefdict[base];
+  if (ingraph) data.ingraph = TRUE;
+  return data.writeref++;
 }
 
 void
 SoWriterefCounter::removeWriteref(const SoBase * base)
 {
-  SoWriterefCounterBaseData * data;
-  if (PRIVATE(this)->outputdata->writerefdict.get(base, data)) {
-    delete data;
-    (void) PRIVATE(this)->outputdata->writerefdict.erase(base);
-  }
-  else {
+  if (!PRIVATE(this)->outputdata->writerefdict.erase(base)) {
     assert(0 && "writedata not found");
   }
 }
@@ -63,6 +63,7 @@ public:
   void setWriteref(const SoBase * base, const int ref);
   void removeWriteref(const SoBase * base);
   void decrementWriteref(const SoBase * base);
+  int addWriteref(const SoBase * base, const SbBool ingraph);
   
   SbBool isInGraph(const SoBase * base) const;
   void setInGraph(const SoBase * base, const SbBool ingraph);
@@ -41,3 +41,4 @@
 #include "SoTranSender.cpp"
 #include "SoWriterefCounter.cpp"
 #include "gzmemio.cpp"
+#include "gzparallel.cpp"
@@ -0,0 +1,348 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+  Writes gzip files with the compression split over several threads,
+  like pigz does. The input is cut into blocks which are deflated
+  independently of each other. Each block is terminated with a sync
+  flush instead of ending the deflate stream, so the concatenated
+  blocks form a single, valid deflate stream that any gzip reader can
+  decompress.
+
+  The blocks are collected in batches of one block per thread. While
+  one batch is being compressed and written in the background, the
+  caller fills the next one.
+
+  Since the blocks don't share dictionaries, the compression ratio is
+  slightly worse than when compressing the data as one stream.
+*/
+
+#include "io/gzparallel.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbBasic.h>
+
+#include "glue/zlib.h"
+#include "threads/parallelp.h"
+
+/* stuff copied from the zlib.h header file (we want to avoid
+   including it here so that zlib is not required to compile Coin),
+   like in gzmemio.cpp. The stream struct is renamed so that both
+   files can be compiled as one unit. */
+struct internal_state;
+typedef void * (*alloc_func)(void * opaque, unsigned int items, unsigned int size);
+typedef void   (*free_func)(void * opaque, void * address);
+
+#define Z_DEFAULT_STRATEGY 0
+#define Z_OK 0
+#define Z_STREAM_END 1
+#define Z_SYNC_FLUSH 2
+#define Z_FINISH 4
+#define Z_DEFLATED 8
+#define MAX_WBITS 15
+#define DEF_MEM_LEVEL 8
+
+typedef struct {
+  unsigned char * next_in;
+  unsigned int avail_in;
+  unsigned long total_in;
+
+  unsigned char * next_out;
+  unsigned int avail_out;
+  unsigned long total_out;
+
+  char * msg;
+  struct internal_state * state;
+
+  alloc_func zalloc;
+  free_func  zfree;
+  void * opaque;
+
+  int data_type;
+  unsigned long adler;
+  unsigned long reserved;
+} gzp_z_stream;
+
+/* ********************************************************************** */
+
+#define GZP_BLOCKSIZE (256 * 1024)
+
+typedef struct {
+  FILE * fp;
+  int level;
+  int numblocks;
+
+  /* the batch being filled by the caller, and the one being compressed */
+  uint8_t * inbuf[2];
+  uint32_t inlen[2];
+  int current;
+  int compressing;
+  cc_parallel_task * task;
+
+  uint8_t ** outbuf;
+  uint32_t * outlen;
+  uint32_t outsize;
+
+  unsigned long crc;
+  uint32_t isize;
+  off_t total;
+  int err;
+} cc_gzp_file;
+
+/* deflates one block into out, which must be large enough to hold
+   all of the output. Returns the number of bytes written to out, or 0
+   on error. */
+static uint32_t
+gzp_deflate(const uint8_t * in, uint32_t inlen, uint8_t * out, uint32_t outsize,
+            int level, int flush)
+{
+  gzp_z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+
+  /* windowBits is passed < 0 to suppress the zlib header */
+  if (cc_zlibglue_deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS,
+                               DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return 0;
+  }
+  stream.next_in = (unsigned char *) in;
+  stream.avail_in = inlen;
+  stream.next_out = out;
+  stream.avail_out = outsize;
+
+  const int err = cc_zlibglue_deflate(&stream, flush);
+  const SbBool ok = (flush == Z_FINISH) ?
+    (err == Z_STREAM_END) :
+    (err == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+  (void) cc_zlibglue_deflateEnd(&stream);
+
+  return ok ? outsize - stream.avail_out : 0;
+}
+
+static void
+gzp_compress_blocks(void * closure, int begin, int end)
+{
+  cc_gzp_file * s = (cc_gzp_file *) closure;
+  const int batch = s->compressing;
+  for (int i = begin; i < end; i++) {
+    const uint32_t start = (uint32_t) i * GZP_BLOCKSIZE;
+    uint32_t len = s->inlen[batch] - start;
+    if (len > GZP_BLOCKSIZE) len = GZP_BLOCKSIZE;
+    s->outlen[i] = gzp_deflate(s->inbuf[batch] + start, len,
+                               s->outbuf[i], s->outsize,
+                               s->level, Z_SYNC_FLUSH);
+  }
+}
+
+static void
+gzp_compress_batch(void * closure)
+{
+  cc_gzp_file * s = (cc_gzp_file *) closure;
+  const int batch = s->compressing;
+  const uint32_t len = s->inlen[batch];
+  const int numblocks = (int) ((len + GZP_BLOCKSIZE - 1) / GZP_BLOCKSIZE);
+
+  s->crc = (uint32_t) cc_zlibglue_crc32(s->crc, (const char *) s->inbuf[batch], len);
+  s->isize += len;
+
+  cc_parallel_for(numblocks, 1, gzp_compress_blocks, s);
+
+  for (int i = 0; i < numblocks; i++) {
+    if (s->outlen[i] == 0 ||
+        fwrite(s->outbuf[i], 1, s->outlen[i], s->fp) != s->outlen[i]) {
+      s->err = 1;
+    }
+  }
+}
+
+/* starts compressing the batch that has been filled, and switches to
+   the other one */
+static void
+gzp_submit(cc_gzp_file * s)
+{
+  if (s->task) {
+    cc_parallel_task_wait(s->task);
+    s->task = NULL;
+  }
+  if (s->inlen[s->current] == 0) return;
+
+  s->compressing = s->current;
+  s->current = 1 - s->current;
+  s->inlen[s->current] = 0;
+  s->task = cc_parallel_task_start(gzp_compress_batch, s);
+}
+
+static SbBool
+gzp_put_long(FILE * fp, uint32_t x)
+{
+  uint8_t buf[4];
+  for (int i = 0; i < 4; i++) {
+    buf[i] = (uint8_t) (x & 0xff);
+    x >>= 8;
+  }
+  return fwrite(buf, 1, 4, fp) == 4;
+}
+
+/* ********************************************************************** */
+
+/*
+  Returns the number of blocks to compress in parallel, which is the
+  number of threads available for cc_parallel_for(), or the value of
+  the COIN_COMPRESSION_THREADS environment variable if set. Gzip and
+  bzip2 files are only compressed in parallel, and decompressed in a
+  separate thread, when this is larger than one.
+*/
+int
+cc_gzp_get_num_threads(void)
+{
+  static int numthreads = -1;
+  if (numthreads < 0) {
+    int num = cc_parallel_get_num_threads();
+    const char * env = coin_getenv("COIN_COMPRESSION_THREADS");
+    if (env) num = atoi(env);
+    if (num < 1) num = 1;
+    if (num > 64) num = 64;
+    numthreads = num;
+  }
+  return numthreads;
+}
+
+/*
+  Opens a gzip stream which writes to \a fp, with compression level
+  \a level (1-9). Returns NULL if the stream could not be opened.
+*/
+void *
+cc_gzp_open(FILE * fp, int level)
+{
+  static const uint8_t header[10] = {
+    0x1f, 0x8b, /* magic */
+    Z_DEFLATED, 0x00, /* method, flags */
+    0x00, 0x00, 0x00, 0x00, /* modification time */
+    0x00, 0xff /* extra flags, unknown OS */
+  };
+  if (fwrite(header, 1, sizeof(header), fp) != sizeof(header)) return NULL;
+
+  cc_gzp_file * s = (cc_gzp_file *) malloc(sizeof(cc_gzp_file));
+  s->fp = fp;
+  s->level = level;
+  s->numblocks = cc_gzp_get_num_threads();
+  s->current = 0;
+  s->compressing = 0;
+  s->task = NULL;
+  s->crc = (uint32_t) cc_zlibglue_crc32(0L, NULL, 0);
+  s->isize = 0;
+  s->total = 0;
+  s->err = 0;
+
+  int i;
+  for (i = 0; i < 2; i++) {
+    s->inbuf[i] = (uint8_t *) malloc((size_t) s->numblocks * GZP_BLOCKSIZE);
+    s->inlen[i] = 0;
+  }
+  /* room for incompressible data, the stored block headers and the
+     sync flush marker */
+  s->outsize = GZP_BLOCKSIZE + (GZP_BLOCKSIZE >> 10) + 64;
+  s->outbuf = (uint8_t **) malloc(s->numblocks * sizeof(uint8_t *));
+  s->outlen = (uint32_t *) malloc(s->numblocks * sizeof(uint32_t));
+  for (i = 0; i < s->numblocks; i++) {
+    s->outbuf[i] = (uint8_t *) malloc(s->outsize);
+    s->outlen[i] = 0;
+  }
+  return s;
+}
+
+/*
+  Writes \a len bytes from \a buf to \a file. Returns the number of
+  bytes written, or 0 if an error has occurred.
+*/
+int
+cc_gzp_write(void * file, const void * buf, uint32_t len)
+{
+  cc_gzp_file * s = (cc_gzp_file *) file;
+  if (s->err) return 0;
+
+  const uint32_t batchsize = (uint32_t) s->numblocks * GZP_BLOCKSIZE;
+  const uint8_t * ptr = (const uint8_t *) buf;
+  uint32_t left = len;
+  while (left > 0) {
+    uint32_t n = batchsize - s->inlen[s->current];
+    if (n > left) n = left;
+    memcpy(s->inbuf[s->current] + s->inlen[s->current], ptr, n);
+    s->inlen[s->current] += n;
+    ptr += n;
+    left -= n;
+    if (s->inlen[s->current] == batchsize) gzp_submit(s);
+  }
+  s->total += len;
+  return (int) len;
+}
+
+/*
+  Returns the number of uncompressed bytes written to \a file.
+*/
+off_t
+cc_gzp_tell(void * file)
+{
+  return ((cc_gzp_file *) file)->total;
+}
+
+/*
+  Compresses and writes any remaining data, and finishes the gzip
+  stream. The FILE is not closed. Returns 0 on success.
+*/
+int
+cc_gzp_close(void * file)
+{
+  cc_gzp_file * s = (cc_gzp_file *) file;
+  gzp_submit(s);
+  if (s->task) cc_parallel_task_wait(s->task);
+
+  /* an empty final block ends the deflate stream */
+  uint8_t end[16];
+  const uint32_t n = gzp_deflate(NULL, 0, end, sizeof(end), s->level, Z_FINISH);
+  if (n == 0 || fwrite(end, 1, n, s->fp) != n) s->err = 1;
+  if (!gzp_put_long(s->fp, (uint32_t) s->crc) ||
+      !gzp_put_long(s->fp, s->isize)) {
+    s->err = 1;
+  }
+
+  const int err = s->err;
+  int i;
+  for (i = 0; i < 2; i++) free(s->inbuf[i]);
+  for (i = 0; i < s->numblocks; i++) free(s->outbuf[i]);
+  free(s->outbuf);
+  free(s->outlen);
+  free(s);
+  return err;
+}
@@ -0,0 +1,78 @@
+#ifndef COIN_SBFNVHASH_H
+#define COIN_SBFNVHASH_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+//
+// Incremental FNV-1a hash, for the keys of hash tables that are
+// looked up by value (welded vertices, tessellation input, ...).
+//
+// Floating point values are hashed by their bit patterns, except that
+// -0.0 and 0.0 compare equal, and must get the same key.
+//
+
+#include <cstddef>
+
+#include <Inventor/system/inttypes.h>
+
+class SbFNVHash {
+public:
+  SbFNVHash(void) : value(2166136261u) { }
+
+  void addData(const void * data, const size_t size) {
+    const unsigned char * ptr = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+      this->value = (this->value ^ ptr[i]) * 16777619u;
+    }
+  }
+  void add(const uint32_t word) {
+    this->addData(&word, sizeof(word));
+  }
+  void add(const float value) {
+    const float f = (value == 0.0f) ? 0.0f : value;
+    this->addData(&f, sizeof(f));
+  }
+  void add(const float * values, const int num) {
+    for (int i = 0; i < num; i++) this->add(values[i]);
+  }
+
+  uint32_t getValue(void) const { return this->value; }
+
+private:
+  uint32_t value;
+};
+
+#endif // !COIN_SBFNVHASH_H
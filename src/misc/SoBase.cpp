@@ -896,7 +896,8 @@ SoBase::addWriteReference(SoOutput * out, SbBool isfromfield)
 {
   assert(out->getStage() == SoOutput::COUNT_REFS);
 
-  int refcount = SoWriterefCounter::instance(out)->getWriteref(this);
+  const int refcount =
+    SoWriterefCounter::instance(out)->addWriteref(this, !isfromfield);
 
 #if COIN_DEBUG
   if (SoWriterefCounter::debugWriterefs()) {
@@ -907,13 +908,6 @@ SoBase::addWriteReference(SoOutput * out, SbBool isfromfield)
                            refcount, refcount + 1);
   }
 #endif // COIN_DEBUG
-
-  refcount++;
-
-  if (!isfromfield) {
-    SoWriterefCounter::instance(out)->setInGraph(this, TRUE);
-  }
-  SoWriterefCounter::instance(out)->setWriteref(this, refcount);
 }
 
 /*!
@@ -1217,11 +1211,20 @@ SoBase::writeHeader(SoOutput * out, SbBool isgroup, SbBool isengine) const
     out->indent();
   }
 
+  SoWriterefCounter * counter = SoWriterefCounter::instance(out);
   SbName name = this->getName();
   int refid = out->findReference(this);
   SbBool firstwrite = (refid == SoWriterefCounter::FIRSTWRITE);
-  SbBool multiref = SoWriterefCounter::instance(out)->hasMultipleWriteRefs(this);
-  SbName writename = SoWriterefCounter::instance(out)->getWriteName(this);
+  int writerefcount = counter->getWriteref(this);
+  SbBool multiref = writerefcount > 1;
+
+  // Most objects are unnamed and referenced only once. They are
+  // written without DEF, and are forgotten right after being written,
+  // so we don't need to make up and register a name for them.
+  SbName writename = SbName::empty();
+  if (!firstwrite || multiref || (name != SbName::empty()) || (writerefcount != 1)) {
+    writename = counter->getWriteName(this);
+  }
 
   // Write the node
   if (!firstwrite) {
@@ -1296,8 +1299,6 @@ SoBase::writeHeader(SoOutput * out, SbBool isgroup, SbBool isengine) const
     }
   }
 
-  int writerefcount = SoWriterefCounter::instance(out)->getWriteref(this);
-
 #if COIN_DEBUG
   if (SoWriterefCounter::debugWriterefs()) {
     SoDebugError::postInfo("SoBase::writeHeader",
@@ -1310,7 +1311,7 @@ SoBase::writeHeader(SoOutput * out, SbBool isgroup, SbBool isengine) const
 #endif // COIN_DEBUG
 
   writerefcount--;
-  SoWriterefCounter::instance(out)->setWriteref(this, writerefcount);
+  counter->setWriteref(this, writerefcount);
 
   // Don't need to write out the rest if we are writing anything but
   // the first instance.
@@ -118,6 +118,7 @@
 #include "misc/CoinStaticObjectInDLL.h"
 #include "misc/systemsanity.icc"
 #include "misc/SoDBP.h"
+#include "misc/SoPartialChangeLog.h"
 #include "misc/SbHash.h"
 #include "misc/SoConfigSettings.h"
 #include "rendering/SoVBO.h"
@@ -344,6 +345,7 @@ SoDB::init(void)
 
   SoShader::init();
   SoVBO::init();
+  SoPartialChangeLog::init();
 
   // FIXME: probably temporary. Add FXViz::init() or something? pederb, 2007-03-09
   SoShadowGroup::init();
@@ -42,11 +42,46 @@
 #include <Inventor/misc/SoNormalGenerator.h>
 
 #include <cstdio>
+#include <cstring>
 
 #include <Inventor/errors/SoDebugError.h>
 
 #include "tidbitsp.h"
 #include "coindefs.h" // COIN_OBSOLETED()
+#include "threads/parallelp.h"
+#include "misc/SbFNVHash.h"
+
+// Meshes with fewer faces/vertices than this are processed in the
+// calling thread only. Below this size the overhead of handing out
+// work to other threads is larger than the gain.
+static const int PARALLEL_MIN_CHUNK = 4096;
+
+static uint32_t
+sonormalgenerator_hash(const SbVec3f & v)
+{
+  SbFNVHash hash;
+  hash.add(v.getValue(), 3);
+  // the table index is taken from the low bits, so fold in the high
+  // bits as well
+  const uint32_t h = hash.getValue();
+  return h ^ (h >> 15);
+}
+
+class SoNormalGeneratorP {
+public:
+  SoNormalGeneratorP(const int approxVertices)
+    : points(approxVertices),
+      faceStart(approxVertices / 4)
+  { }
+
+  SbList <SbVec3f> points;
+  SbList <int> pointHash;
+  SbList <int> faceStart;
+
+  int addPoint(const SbVec3f & v);
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
 
 /*!
   Constructor with \a isccw indicating if polygons are specified
@@ -55,14 +90,15 @@
 */
 SoNormalGenerator::SoNormalGenerator(const SbBool isccw,
                                      const int approxVertices)
-  : bsp(128, approxVertices),
-    vertexList(approxVertices),
+  : vertexList(approxVertices),
     vertexFace(approxVertices),
     faceNormals(approxVertices / 4),
     vertexNormals(approxVertices),
     ccw(isccw),
-    perVertex(TRUE)
+    perVertex(TRUE),
+    currFaceStart(0)
 {
+  PRIVATE(this) = new SoNormalGeneratorP(approxVertices);
 }
 
 /*!
@@ -70,6 +106,7 @@ SoNormalGenerator::SoNormalGenerator(const SbBool isccw,
 */
 SoNormalGenerator::~SoNormalGenerator()
 {
+  delete PRIVATE(this);
 }
 
 /*!
@@ -84,9 +121,11 @@ void
 SoNormalGenerator::reset(const SbBool ccwarg)
 {
   this->ccw = ccwarg;
-  this->bsp.clear();
+  PRIVATE(this)->points.truncate(0);
+  PRIVATE(this)->pointHash.truncate(0);
   this->vertexList.truncate(0);
   this->vertexFace.truncate(0);
+  PRIVATE(this)->faceStart.truncate(0);
   this->faceNormals.truncate(0);
   this->vertexNormals.truncate(0);
 }
@@ -111,8 +150,8 @@ SoNormalGenerator::beginPolygon(void)
 void
 SoNormalGenerator::polygonVertex(const SbVec3f &v)
 {
-  this->vertexList.append(this->bsp.addPoint(v));
-  this->vertexFace.append(this->faceNormals.getLength());
+  this->vertexList.append(PRIVATE(this)->addPoint(v));
+  this->vertexFace.append(PRIVATE(this)->faceStart.getLength());
 }
 
 /*!
@@ -123,8 +162,10 @@ SoNormalGenerator::polygonVertex(const SbVec3f &v)
 void
 SoNormalGenerator::endPolygon(void)
 {
-  SbVec3f n = this->calcFaceNormal();
-  this->faceNormals.append(n);
+  assert(this->vertexList.getLength() - this->currFaceStart >= 3);
+  // the face normal is calculated when normals are generated, so
+  // that all faces can be processed in one go
+  PRIVATE(this)->faceStart.append(this->currFaceStart);
 }
 
 /*!
@@ -165,14 +206,13 @@ SoNormalGenerator::quad(const SbVec3f &v0,
 //
 static void
 calc_normal_vec(const SbVec3f *facenormals, const int facenum,
-                SbList <int32_t> &faceArray, const float threshold,
+                const int32_t * faceArray, const int n, const float threshold,
                 SbVec3f &vertnormal)
 {
   // start with face normal vector
   const SbVec3f * facenormal = &facenormals[facenum];
   vertnormal = *facenormal;
 
-  int n = faceArray.getLength();
   int currface;
 
   for (int i = 0; i < n; i++) {
@@ -187,6 +227,95 @@ calc_normal_vec(const SbVec3f *facenormals, const int facenum,
   }
 }
 
+//
+// Calculates the normal vector for a face. Returns FALSE if the face
+// is degenerate, in which case the normal is set to (0,0,0) so that
+// the face will not influence normal smoothing.
+//
+static SbBool
+calc_face_normal(const SbVec3f * coords, const int * cind, const int num,
+                 const SbBool ccw, SbVec3f & ret)
+{
+  if (num == 3) { // triangle
+    const SbVec3f v0 = coords[cind[0]] - coords[cind[1]];
+    const SbVec3f v1 = coords[cind[2]] - coords[cind[1]];
+    if (!ccw) { ret = v0.cross(v1); }
+    else { ret = v1.cross(v0); }
+  }
+  else {
+    // For non-triangle faces
+    const SbVec3f *vert1, *vert2;
+    ret.setValue(0.0f, 0.0f, 0.0f);
+    vert2 = coords + cind[num-1];
+    for (int i = 0; i < num; i++) {
+      vert1 = vert2;
+      vert2 = coords + cind[i];
+      ret[0] += ((*vert1)[1] - (*vert2)[1]) * ((*vert1)[2] + (*vert2)[2]);
+      ret[1] += ((*vert1)[2] - (*vert2)[2]) * ((*vert1)[0] + (*vert2)[0]);
+      ret[2] += ((*vert1)[0] - (*vert2)[0]) * ((*vert1)[1] + (*vert2)[1]);
+    }
+    if (!ccw) ret = -ret;
+  }
+
+  if (ret.normalize() == 0.0f) {
+    ret.setValue(0.0f, 0.0f, 0.0f);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// data shared by the threads calculating face normals
+typedef struct {
+  const SbVec3f * coords;
+  const int * vertexlist;
+  const int * facestart;
+  int numfaces;
+  int numvertices;
+  SbBool ccw;
+  SbVec3f * facenormals;
+} sonormalgenerator_facedata;
+
+static void
+calc_face_normals_cb(void * closure, int begin, int end)
+{
+  sonormalgenerator_facedata * data = (sonormalgenerator_facedata *) closure;
+  for (int i = begin; i < end; i++) {
+    const int start = data->facestart[i];
+    const int stop = (i+1 < data->numfaces) ? data->facestart[i+1] : data->numvertices;
+    (void) calc_face_normal(data->coords, data->vertexlist + start, stop - start,
+                            data->ccw, data->facenormals[i]);
+  }
+}
+
+// data shared by the threads calculating vertex normals
+typedef struct {
+  const SbVec3f * facenormals;
+  const int * vertexlist;
+  const int * vertexface;
+  const int * corners; // corner index for each normal, or NULL
+  const int32_t * pointfaces;
+  const int * pointoffset;
+  float threshold;
+  SbVec3f * normals;
+} sonormalgenerator_vertexdata;
+
+static void
+calc_vertex_normals_cb(void * closure, int begin, int end)
+{
+  sonormalgenerator_vertexdata * data = (sonormalgenerator_vertexdata *) closure;
+  for (int i = begin; i < end; i++) {
+    const int corner = data->corners ? data->corners[i] : i;
+    const int point = data->vertexlist[corner];
+    const int offset = data->pointoffset[point];
+    calc_normal_vec(data->facenormals,
+                    data->vertexface[corner],
+                    data->pointfaces + offset,
+                    data->pointoffset[point+1] - offset,
+                    data->threshold, data->normals[i]);
+    (void) data->normals[i].normalize();
+  }
+}
+
 /*!
   Triggers the normal generation. Normals are generated using
   \a creaseAngle to find which edges should be flat-shaded
@@ -199,6 +328,9 @@ calc_normal_vec(const SbVec3f *facenormals, const int facenum,
   have to know how OpenGL/Coin generate triangles from triangle
   strips.
 
+  For large meshes, the face and vertex normals are calculated by
+  several threads in parallel. The result is the same as when
+  calculated in a single thread.
 */
 void
 SoNormalGenerator::generate(const float creaseAngle,
@@ -213,66 +345,74 @@ SoNormalGenerator::generate(const float creaseAngle,
 
   int i;
 
-  // for each vertex, store all faceindices the vertex is a part of
-  SbList <int32_t> * vertexFaceArray = new SbList<int32_t>[bsp.numPoints()];
+  this->calcFaceNormals();
+
+  // for each vertex, store all faceindices the vertex is a part of,
+  // as one array with an offset per vertex. The faces are stored in
+  // the order they were added, so the normals are accumulated in the
+  // same order as before.
+  const int numpoints = PRIVATE(this)->points.getLength();
+  const int numvi = this->vertexList.getLength();
+  const int * vlist = this->vertexList.getArrayPtr();
 
-  int numvi = this->vertexList.getLength();
+  int * pointoffset = new int[numpoints + 1];
+  memset(pointoffset, 0, sizeof(int) * (numpoints + 1));
+  for (i = 0; i < numvi; i++) pointoffset[vlist[i] + 1]++;
+  for (i = 0; i < numpoints; i++) pointoffset[i+1] += pointoffset[i];
 
+  int32_t * pointfaces = new int32_t[numvi > 0 ? numvi : 1];
+  int * fill = new int[numpoints > 0 ? numpoints : 1];
+  memcpy(fill, pointoffset, sizeof(int) * numpoints);
   for (i = 0; i < numvi; i++) {
-    vertexFaceArray[vertexList[i]].append(this->vertexFace[i]);
+    pointfaces[fill[vlist[i]]++] = this->vertexFace[i];
   }
+  delete[] fill;
 
   float threshold = (float)cos(SbClamp(creaseAngle, 0.0f, (float) M_PI));
 
+  // find which corners we need normals for
+  SbList <int> corners;
   if (striplens) {
     i = 0;
     for (int j = 0; j < numstrips; j++) {
       assert(i+2 < numvi);
-      SbVec3f tmpvec;
-      calc_normal_vec(this->faceNormals.getArrayPtr(),
-                      this->vertexFace[i],
-                      vertexFaceArray[vertexList[i]],
-                      threshold, tmpvec);
-      (void) tmpvec.normalize();
-      this->vertexNormals.append(tmpvec);
-      calc_normal_vec(this->faceNormals.getArrayPtr(),
-                      this->vertexFace[i+1],
-                      vertexFaceArray[vertexList[i+1]],
-                      threshold, tmpvec);
-      (void) tmpvec.normalize();
-      this->vertexNormals.append(tmpvec);
+      corners.append(i);
+      corners.append(i+1);
 
       int num = striplens[j] - 2;
 
       while (num--) {
         i += 2;
         assert(i < numvi);
-        calc_normal_vec(this->faceNormals.getArrayPtr(),
-                        this->vertexFace[i],
-                        vertexFaceArray[vertexList[i]],
-                        threshold, tmpvec);
-        (void) tmpvec.normalize();
-        this->vertexNormals.append(tmpvec);
+        corners.append(i);
         i++;
       }
     }
   }
-  else {
-    for (i = 0; i < numvi; i++) {
-      SbVec3f tmpvec;
-      calc_normal_vec(this->faceNormals.getArrayPtr(),
-                      this->vertexFace[i],
-                      vertexFaceArray[vertexList[i]],
-                      threshold, tmpvec);
-      (void) tmpvec.normalize();
-      this->vertexNormals.append(tmpvec);
-    }
-  }
-  delete [] vertexFaceArray;
+
+  const int numnormals = striplens ? corners.getLength() : numvi;
+  this->vertexNormals.truncate(0);
+  this->vertexNormals.ensureCapacity(numnormals);
+  for (i = 0; i < numnormals; i++) this->vertexNormals.append(SbVec3f(0.0f, 0.0f, 0.0f));
+
+  sonormalgenerator_vertexdata data;
+  data.facenormals = this->faceNormals.getArrayPtr();
+  data.vertexlist = vlist;
+  data.vertexface = this->vertexFace.getArrayPtr();
+  data.corners = striplens ? corners.getArrayPtr() : NULL;
+  data.pointfaces = pointfaces;
+  data.pointoffset = pointoffset;
+  data.threshold = threshold;
+  data.normals = numnormals ? &this->vertexNormals[0] : NULL;
+  cc_parallel_for(numnormals, PARALLEL_MIN_CHUNK, calc_vertex_normals_cb, &data);
+
+  delete[] pointfaces;
+  delete[] pointoffset;
   this->vertexFace.truncate(0, TRUE);
   this->vertexList.truncate(0, TRUE);
   this->faceNormals.truncate(0, TRUE);
-  this->bsp.clear();
+  PRIVATE(this)->points.truncate(0, TRUE);
+  PRIVATE(this)->pointHash.truncate(0, TRUE);
   this->vertexNormals.fit();
 
   // return vertex normals
@@ -286,6 +426,7 @@ void
 SoNormalGenerator::generatePerStrip(const int32_t * striplens,
                                     const int numstrips)
 {
+  this->calcFaceNormals();
   int cnt = 0;
   for (int i = 0; i < numstrips; i++) {
     int n = striplens[i] - 2;
@@ -310,7 +451,7 @@ SoNormalGenerator::generatePerStrip(const int32_t * striplens,
 void
 SoNormalGenerator::generatePerFace(void)
 {
-  // face normals have already been generated. Just set flag.
+  this->calcFaceNormals();
   this->perVertex = FALSE;
   this->faceNormals.fit();
 }
@@ -323,6 +464,7 @@ SoNormalGenerator::generatePerFace(void)
 void
 SoNormalGenerator::generateOverall(void)
 {
+  this->calcFaceNormals();
   const int n = this->faceNormals.getLength();
   const SbVec3f * normals = this->faceNormals.getArrayPtr();
   SbVec3f acc(0.0f, 0.0f, 0.0f);
@@ -396,59 +538,162 @@ SoNormalGenerator::setNormal(const int32_t /* index */,
 }
 
 //
-// Calculates the face normal to the current face.
+// Returns the index of the point \a v, adding it if it has not been
+// seen before. Points are only merged if they are exactly equal.
 //
-SbVec3f
-SoNormalGenerator::calcFaceNormal(void)
+int
+SoNormalGeneratorP::addPoint(const SbVec3f & v)
 {
-  const int num = this->vertexList.getLength() - this->currFaceStart;
-
-  assert(num >= 3);
-  const int * cind = (const int *) this->vertexList.getArrayPtr() + this->currFaceStart;
-  const SbVec3f * coords = this->bsp.getPointsArrayPtr();
-  SbVec3f ret;
-
-  if (num == 3) { // triangle
-    const SbVec3f v0 = coords[cind[0]] - coords[cind[1]];
-    const SbVec3f v1 = coords[cind[2]] - coords[cind[1]];
-    if (!this->ccw) { ret = v0.cross(v1); }
-    else { ret = v1.cross(v0); }
-  }
-  else {
-    // For non-triangle faces
-    const SbVec3f *vert1, *vert2;
-    ret.setValue(0.0f, 0.0f, 0.0f);
-    vert2 = coords + cind[num-1];
-    for (int i = 0; i < num; i++) {
-      vert1 = vert2;
-      vert2 = coords + cind[i];
-      ret[0] += ((*vert1)[1] - (*vert2)[1]) * ((*vert1)[2] + (*vert2)[2]);
-      ret[1] += ((*vert1)[2] - (*vert2)[2]) * ((*vert1)[0] + (*vert2)[0]);
-      ret[2] += ((*vert1)[0] - (*vert2)[0]) * ((*vert1)[1] + (*vert2)[1]);
+  int size = this->pointHash.getLength();
+  if (this->points.getLength() * 2 >= size) {
+    // grow and rehash
+    int newsize = size ? size * 2 : 1024;
+    while (newsize <= this->points.getLength() * 2) newsize *= 2;
+    this->pointHash.truncate(0);
+    this->pointHash.ensureCapacity(newsize);
+    int i;
+    for (i = 0; i < newsize; i++) this->pointHash.append(-1);
+    for (i = 0; i < this->points.getLength(); i++) {
+      uint32_t idx = sonormalgenerator_hash(this->points[i]) & (newsize - 1);
+      while (this->pointHash[idx] >= 0) idx = (idx + 1) & (newsize - 1);
+      this->pointHash[idx] = i;
     }
-    if (!this->ccw) ret = -ret;
+    size = newsize;
   }
 
-  if (ret.normalize() == 0.0f) {
+  const SbVec3f * pts = this->points.getArrayPtr();
+  uint32_t idx = sonormalgenerator_hash(v) & (size - 1);
+  int curr;
+  while ((curr = this->pointHash[idx]) >= 0) {
+    if (pts[curr] == v) return curr;
+    idx = (idx + 1) & (size - 1);
+  }
+  curr = this->points.getLength();
+  this->points.append(v);
+  this->pointHash[idx] = curr;
+  return curr;
+}
+
+//
+// Calculates the normal vectors for all faces added since the last
+// time normals were generated.
+//
+void
+SoNormalGenerator::calcFaceNormals(void)
+{
+  const int numfaces = PRIVATE(this)->faceStart.getLength();
+  if (numfaces == 0) return;
+
+  this->faceNormals.truncate(0);
+  this->faceNormals.ensureCapacity(numfaces);
+  int i;
+  for (i = 0; i < numfaces; i++) this->faceNormals.append(SbVec3f(0.0f, 0.0f, 0.0f));
+
+  sonormalgenerator_facedata data;
+  data.coords = PRIVATE(this)->points.getArrayPtr();
+  data.vertexlist = this->vertexList.getArrayPtr();
+  data.facestart = PRIVATE(this)->faceStart.getArrayPtr();
+  data.numfaces = numfaces;
+  data.numvertices = this->vertexList.getLength();
+  data.ccw = this->ccw;
+  data.facenormals = &this->faceNormals[0];
+  cc_parallel_for(numfaces, PARALLEL_MIN_CHUNK, calc_face_normals_cb, &data);
+
 #if COIN_DEBUG
-    // make this an optional warning since it's really ok (in most
-    // cases) to have empty triangles. pederb, 2005-12-21
-    if (coin_debug_extra()) {
+  // make this an optional warning since it's really ok (in most
+  // cases) to have empty triangles. pederb, 2005-12-21
+  if (coin_debug_extra()) {
+    for (i = 0; i < numfaces; i++) {
+      if (this->faceNormals[i] != SbVec3f(0.0f, 0.0f, 0.0f)) continue;
+      const int start = PRIVATE(this)->faceStart[i];
+      const int stop = (i+1 < numfaces) ? PRIVATE(this)->faceStart[i+1] : data.numvertices;
       SbString s;
-      for (int i = 0; i < num; i++) {
-        const SbVec3f v = coords[cind[i]];
+      for (int j = start; j < stop; j++) {
+        const SbVec3f v = PRIVATE(this)->points[this->vertexList[j]];
         SbString c;
         c.sprintf(" <%f, %f, %f>", v[0], v[1], v[2]);
         s += c;
       }
-      SoDebugError::postWarning("SoNormalGenerator::calcFaceNormal",
+      SoDebugError::postWarning("SoNormalGenerator::calcFaceNormals",
                                 "Normal vector found to be of zero length "
                                 "for face with vertex coordinates:%s",
                                 s.getString());
     }
-#endif // COIN_DEBUG      
-    // set to (0,0,0) so that this face will not influence normal smoothing
-    ret.setValue(0.0f, 0.0f, 0.0f);
   }
-  return ret;
+#endif // COIN_DEBUG
+
+  PRIVATE(this)->faceStart.truncate(0, TRUE);
 }
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+BOOST_AUTO_TEST_CASE(creaseAngle)
+{
+  // two triangles meeting at a right angle along the edge (0,0,0)-(1,0,0)
+  const SbVec3f p0(0.0f, 0.0f, 0.0f);
+  const SbVec3f p1(1.0f, 0.0f, 0.0f);
+  const SbVec3f p2(0.0f, 1.0f, 0.0f);
+  const SbVec3f p3(0.0f, 0.0f, 1.0f);
+
+  SoNormalGenerator gen(TRUE);
+  gen.triangle(p0, p1, p2);
+  gen.triangle(p1, p0, p3);
+  gen.generate(0.5f);
+  BOOST_CHECK_MESSAGE(gen.getNumNormals() == 6, "wrong number of normals");
+  BOOST_CHECK_MESSAGE(gen.getNormal(0) == SbVec3f(0.0f, 0.0f, 1.0f), "edge should be sharp");
+  BOOST_CHECK_MESSAGE(gen.getNormal(3) == SbVec3f(0.0f, 1.0f, 0.0f), "edge should be sharp");
+
+  gen.reset(TRUE);
+  gen.triangle(p0, p1, p2);
+  gen.triangle(p1, p0, p3);
+  gen.generate(float(M_PI) * 0.6f);
+  SbVec3f smooth(0.0f, 1.0f, 1.0f);
+  smooth.normalize();
+  BOOST_CHECK_MESSAGE(gen.getNormal(0).equals(smooth, 1.0e-6f), "edge should be smooth");
+  BOOST_CHECK_MESSAGE(gen.getNormal(4).equals(smooth, 1.0e-6f), "edge should be smooth");
+  BOOST_CHECK_MESSAGE(gen.getNormal(2) == SbVec3f(0.0f, 0.0f, 1.0f), "unshared vertex changed");
+}
+
+BOOST_AUTO_TEST_CASE(classLayout)
+{
+  // the public class must keep the size it had before the private
+  // implementation was added
+  struct formerlayout {
+    SbBSPTree bsp;
+    SbList <int> vertexList;
+    SbList <int> vertexFace;
+    SbList <SbVec3f> faceNormals;
+    SbList <SbVec3f> vertexNormals;
+    SbBool ccw;
+    SbBool perVertex;
+    int currFaceStart;
+  };
+  BOOST_CHECK_MESSAGE(sizeof(SoNormalGenerator) == sizeof(formerlayout),
+                      "size of SoNormalGenerator changed");
+}
+
+BOOST_AUTO_TEST_CASE(largeMesh)
+{
+  // big enough to be split over several threads when available
+  const int n = 100;
+  SoNormalGenerator gen(TRUE, (n+1) * (n+1));
+  for (int y = 0; y < n; y++) {
+    for (int x = 0; x < n; x++) {
+      gen.quad(SbVec3f(float(x), float(y), 0.0f),
+               SbVec3f(float(x+1), float(y), 0.0f),
+               SbVec3f(float(x+1), float(y+1), 0.0f),
+               SbVec3f(float(x), float(y+1), 0.0f));
+    }
+  }
+  gen.generate(0.5f);
+  BOOST_CHECK_MESSAGE(gen.getNumNormals() == n * n * 4, "wrong number of normals");
+  int wrong = 0;
+  for (int i = 0; i < gen.getNumNormals(); i++) {
+    if (!gen.getNormal(i).equals(SbVec3f(0.0f, 0.0f, 1.0f), 1.0e-6f)) wrong++;
+  }
+  BOOST_CHECK_MESSAGE(wrong == 0, "unexpected normals for a flat mesh");
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,184 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoPartialChangeLog
+  \brief The SoPartialChangeLog class records partial changes to multiple value fields.
+
+  Nodes like SoCoordinate3 call addChange() when a notification only
+  changed a range of values in a field, and didn't change the number
+  of values. Caches which depend on the node can then use getChanges()
+  to find which values have changed since the cache was created, and
+  update only the affected parts of the cache.
+
+  Only the most recent changes are kept. getChanges() returns \c FALSE
+  when the changes since the given id are not known, in which case
+  the cache should be regenerated.
+
+  Values changed while notification is disabled on a field never show
+  up in the log. SoField::enableNotify() calls invalidate() when
+  notification is enabled again, so that no change is reported across
+  such edits.
+*/
+
+#include "misc/SoPartialChangeLog.h"
+
+#include <cstddef>
+
+#include <Inventor/nodes/SoNode.h>
+
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+
+// number of changes kept in the log
+static const int CHANGELOG_SIZE = 256;
+// max number of changes getChanges() will merge
+static const int CHANGELOG_MAX_STEPS = 32;
+
+typedef struct {
+  SbUniqueId previd;
+  SbUniqueId id;
+  int start;
+  int num;
+} sopartialchangelog_entry;
+
+static sopartialchangelog_entry * changelog = NULL;
+static int changelog_next = 0;
+// changes can't be reported since ids older than this
+static SbUniqueId changelog_minid = 0;
+static void * changelog_mutex = NULL;
+
+static void
+changelog_cleanup(void)
+{
+  delete[] changelog;
+  changelog = NULL;
+  changelog_next = 0;
+  changelog_minid = 0;
+  CC_MUTEX_DESTRUCT(changelog_mutex);
+}
+
+// returns the log entry for the change that resulted in id, or NULL
+static const sopartialchangelog_entry *
+changelog_find(const SbUniqueId id)
+{
+  for (int i = 0; i < CHANGELOG_SIZE; i++) {
+    if (changelog[i].id == id) return &changelog[i];
+  }
+  return NULL;
+}
+
+/*!
+  Sets up the log. Called from SoDB::init().
+*/
+void
+SoPartialChangeLog::init(void)
+{
+  CC_MUTEX_CONSTRUCT(changelog_mutex);
+  changelog = new sopartialchangelog_entry[CHANGELOG_SIZE];
+  for (int i = 0; i < CHANGELOG_SIZE; i++) {
+    changelog[i].previd = changelog[i].id = 0;
+  }
+  coin_atexit(changelog_cleanup, CC_ATEXIT_NORMAL);
+}
+
+/*!
+  Forgets all changes made so far. Caches created before this call
+  will be regenerated.
+*/
+void
+SoPartialChangeLog::invalidate(void)
+{
+  // nothing is logged before SoDB::init() or after the cleanup
+  if (changelog == NULL) return;
+  CC_MUTEX_LOCK(changelog_mutex);
+  changelog_minid = SoNode::getNextNodeId();
+  CC_MUTEX_UNLOCK(changelog_mutex);
+}
+
+/*!
+  Records that \a id differs from \a previd only in the \a num values
+  starting at \a start.
+*/
+void
+SoPartialChangeLog::addChange(const SbUniqueId previd, const SbUniqueId id,
+                              const int start, const int num)
+{
+  if (changelog == NULL) return;
+  CC_MUTEX_LOCK(changelog_mutex);
+  sopartialchangelog_entry & entry = changelog[changelog_next];
+  entry.previd = previd;
+  entry.id = id;
+  entry.start = start;
+  entry.num = num;
+  changelog_next = (changelog_next + 1) % CHANGELOG_SIZE;
+  CC_MUTEX_UNLOCK(changelog_mutex);
+}
+
+/*!
+  Finds the range of values changed between \a sinceid and \a id.
+  Returns \c FALSE if this isn't known.
+*/
+SbBool
+SoPartialChangeLog::getChanges(const SbUniqueId sinceid, const SbUniqueId id,
+                               int & start, int & num)
+{
+  if (changelog == NULL || sinceid == 0 || sinceid == id) return FALSE;
+
+  SbBool found = FALSE;
+  int minidx = 0, maxidx = 0;
+  SbUniqueId curr = id;
+
+  CC_MUTEX_LOCK(changelog_mutex);
+  if (sinceid < changelog_minid) {
+    CC_MUTEX_UNLOCK(changelog_mutex);
+    return FALSE;
+  }
+  for (int step = 0; step < CHANGELOG_MAX_STEPS; step++) {
+    const sopartialchangelog_entry * entry = changelog_find(curr);
+    if (entry == NULL) break;
+    if (step == 0 || entry->start < minidx) minidx = entry->start;
+    if (step == 0 || entry->start + entry->num > maxidx) maxidx = entry->start + entry->num;
+    curr = entry->previd;
+    if (curr == sinceid) {
+      found = TRUE;
+      break;
+    }
+  }
+  CC_MUTEX_UNLOCK(changelog_mutex);
+
+  if (found) {
+    start = minidx;
+    num = maxidx - minidx;
+  }
+  return found;
+}
@@ -69,6 +69,7 @@
 #include "SoNormalGenerator.cpp"
 #include "SoNotRec.cpp"
 #include "SoNotification.cpp"
+#include "SoPartialChangeLog.cpp"
 #include "SoPath.cpp"
 #include "SoPick.cpp"
 #include "SoPickedPoint.cpp"
@@ -0,0 +1,87 @@
+#ifndef COIN_SOCHILDCULLER_H
+#define COIN_SOCHILDCULLER_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+/*
+  Culls runs of SoSeparator children of a wide group against the view
+  volume before they are traversed, using
+  SoCullElement::cullTestBoxes(). Used by SoGroup and SoSeparator
+  during SoGLRenderAction traversal.
+
+  A child reported as culled is guaranteed to cull itself when
+  traversed, so it can be skipped without changing the rendering. All
+  other children must be traversed as usual, since they might still
+  be culled by their own test. The class is implemented in
+  SoSeparator.cpp, as it needs access to the bounding box cache of the
+  child separators.
+*/
+
+// *************************************************************************
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/lists/SbList.h>
+
+class SoNode;
+class SoGLRenderAction;
+
+// *************************************************************************
+
+class SoChildCuller {
+public:
+  SoChildCuller(SoGLRenderAction * action, SoNode ** children, const int numchildren);
+
+  SbBool cullChild(const int idx);
+
+private:
+  void cullRun(const int first);
+
+  SoGLRenderAction * action;
+  SoNode ** children;
+  int numchildren;
+  SbBool enabled;
+
+  // children in [runstart, runend) have their results in culled
+  int runstart;
+  int runend;
+  SbList<SbBool> culled;
+  SbList<SbBox3f> boxes;
+  SbList<int> boxindex;
+  SbList<SbBool> boxoutside;
+};
+
+#endif // !COIN_SOCHILDCULLER_H
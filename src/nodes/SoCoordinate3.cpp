@@ -63,9 +63,11 @@
 #include <Inventor/actions/SoPickAction.h>
 #include <Inventor/elements/SoGLCoordinateElement.h>
 #include <Inventor/elements/SoGLVBOElement.h>
+#include <Inventor/misc/SoNotification.h>
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoVBO.h"
+#include "misc/SoPartialChangeLog.h"
 
 /*!
   \var SoMFVec3f SoCoordinate3::point
@@ -74,9 +76,10 @@
 
 class SoCoordinate3P {
  public:
-  SoCoordinate3P() : vbo(NULL) { }
+  SoCoordinate3P() : vbo(NULL), numpoints(1) { }
   ~SoCoordinate3P() { delete this->vbo; }
   SoVBO * vbo;
+  int numpoints; // number of points at the last notification
 };
 
 #define PRIVATE(obj) obj->pimpl
@@ -149,9 +152,23 @@ SoCoordinate3::GLRender(SoGLRenderAction * action)
       dirty = TRUE;
     }
     if (dirty) {
-      PRIVATE(this)->vbo->setBufferData(this->point.getValues(0),
-                                        num*sizeof(SbVec3f),
-                                        this->getNodeId());
+      // try to upload only the modified points if we know which
+      // points have changed since the buffer was last updated
+      int start, numchanged;
+      if (!PRIVATE(this)->vbo->getBufferDataId() ||
+          !SoPartialChangeLog::getChanges(PRIVATE(this)->vbo->getBufferDataId(),
+                                          this->getNodeId(),
+                                          start, numchanged) ||
+          (start + numchanged > num) ||
+          !PRIVATE(this)->vbo->updateBufferData(this->point.getValues(0),
+                                                num*sizeof(SbVec3f),
+                                                start*sizeof(SbVec3f),
+                                                numchanged*sizeof(SbVec3f),
+                                                this->getNodeId())) {
+        PRIVATE(this)->vbo->setBufferData(this->point.getValues(0),
+                                          num*sizeof(SbVec3f),
+                                          this->getNodeId());
+      }
     }
   }
   else if (PRIVATE(this)->vbo && PRIVATE(this)->vbo->getBufferDataId()) {
@@ -190,4 +207,41 @@ SoCoordinate3::getPrimitiveCount(SoGetPrimitiveCountAction * action)
   SoCoordinate3::doAction(action);
 }
 
+/*!
+  Overridden to keep track of which points have been modified when
+  only a range of values in SoCoordinate3::point has been set, so
+  that caches depending on the coordinates can be updated instead of
+  regenerated.
+
+  Values changed while notification was disabled on the field are not
+  seen here. SoField::enableNotify() invalidates the logged changes
+  when notification is enabled again, so such changes make the caches
+  regenerate everything.
+*/
+void
+SoCoordinate3::notify(SoNotList * l)
+{
+  const SbUniqueId previd = this->getNodeId();
+  const int prevnum = PRIVATE(this)->numpoints;
+  // don't evaluate connected fields during notification
+  const int num = this->point.isConnected() ? -1 : this->point.getNum();
+  PRIVATE(this)->numpoints = num;
+
+  int start = -1, numchanged = 0;
+  if ((l->getLastField() == &this->point) && (num >= 0) && (prevnum == num)) {
+    SoNotRec * rec = l->getLastRec();
+    if (rec && (rec->getOperationType() == SoNotRec::FIELD_UPDATE)) {
+      start = rec->getIndex();
+      numchanged = rec->getFieldNumIndices();
+    }
+  }
+
+  inherited::notify(l);
+
+  if ((start >= 0) && (numchanged > 0) && (start + numchanged <= num) &&
+      (this->getNodeId() != previd)) {
+    SoPartialChangeLog::addChange(previd, this->getNodeId(), start, numchanged);
+  }
+}
+
 #undef PRIVATE
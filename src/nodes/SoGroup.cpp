@@ -210,6 +210,7 @@
 #include <Inventor/system/gl.h>
 
 #include "nodes/SoSubNodeP.h"
+#include "nodes/SoChildCuller.h"
 #include "rendering/SoGL.h"
 #include "glue/glp.h"
 #include "io/SoWriterefCounter.h"
@@ -593,8 +594,13 @@ SoGroup::getBoundingBox(SoGetBoundingBoxAction * action)
 // *************************************************************************
 
 void
-SoGroupP::childGLRender(SoGroup * COIN_UNUSED_ARG(thisp), SoNode * child, SoGLRenderAction * action)
+SoGroupP::childGLRender(SoGroup * thisp, SoNode * child, SoGLRenderAction * action)
 {
+  // tracing can be turned on after the function pointer has been set
+  if (SoProfilerTrace::isActive()) {
+    SoGroupP::childGLRenderProfiler(thisp, child, action);
+    return;
+  }
   child->GLRender(action);
 }
 
@@ -641,6 +647,8 @@ SoGroup::GLRender(SoGLRenderAction * action)
   else {
     action->pushCurPath();
     int n = this->getChildren()->getLength();
+    // separators are not traversed off the path, so there is nothing to cull
+    SoChildCuller culler(action, childarray, (pathcode == SoAction::OFF_PATH) ? 0 : n);
     for (int i = 0; i < n && !action->hasTerminated(); i++) {
       action->popPushCurPath(i, childarray[i]);
 
@@ -654,6 +662,8 @@ SoGroup::GLRender(SoGLRenderAction * action)
 	break;
       }
 
+      if (culler.cullChild(i)) continue;
+
       (*SoGroupP::glrenderfunc)(this, childarray[i], action);
 
 #if COIN_DEBUG
@@ -85,6 +85,11 @@
   to decide when to switch children, so that node will still work with
   SoOrthographicCamera.)
 
+  When an SoGLRenderAction has a triangle or time budget set, the
+  child selected from the range values may be replaced by a less
+  detailed one to keep the frame within the budget. See
+  SoGLRenderAction::setLODTriangleBudget().
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     LOD {
@@ -111,6 +116,7 @@
 #include "nodes/SoSubNodeP.h"
 #include "nodes/SoSoundElementHelper.h"
 #include "profiler/SoNodeProfiling.h"
+#include "rendering/SoGLLODBudget.h"
 
 // *************************************************************************
 
@@ -272,7 +278,7 @@ SoLOD::GLRender(SoGLRenderAction * action)
 void
 SoLOD::GLRenderBelowPath(SoGLRenderAction * action)
 {
-  int idx = this->whichToTraverse(action);
+  int idx = SoGLLODBudget::select(action, this, this->whichToTraverse(action));
   if (idx >= 0) {
     SoNode * child = (SoNode*) this->children->get(idx);
     action->pushCurPath(idx, child);
@@ -141,6 +141,11 @@
   we could switch to a less complex version without losing enough
   detail that it gives a noticeable visual degradation.
 
+  When an SoGLRenderAction has a triangle or time budget set, the
+  child selected from the screenArea values may be replaced by a less
+  detailed one to keep the frame within the budget. See
+  SoGLRenderAction::setLODTriangleBudget().
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     LevelOfDetail {
@@ -183,6 +188,7 @@
 
 #include "tidbitsp.h"
 #include "nodes/SoSubNodeP.h"
+#include "rendering/SoGLLODBudget.h"
 
 // *************************************************************************
 
@@ -410,6 +416,10 @@ SoLevelOfDetail::doAction(SoAction *action)
   // (fall through to traverse:)
 
  traverse:
+  // projarea is only set when the screenArea thresholds were used
+  if (projarea > 0.0f && action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    idx = SoGLLODBudget::select(static_cast<SoGLRenderAction *>(action), this, idx, projarea);
+  }
   this->getChildren()->traverse(action, idx);
   return;
 }
@@ -96,6 +96,8 @@
 #include "nodes/SoSubNodeP.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLRenderStatistics.h"
+#include "nodes/SoChildCuller.h"
 #include "misc/SoDBP.h"
 
 #include <Inventor/annex/Profiler/SoProfiler.h>
@@ -264,6 +266,11 @@ int SoSeparator::numrendercaches = 2;
   careful to monitor the change in execution speed if setting this
   field to SoSeparator::ON.
 
+  When a group has many SoSeparator children next to each other, the
+  bounding boxes of these children are culled together, several at a
+  time, before the children are traversed. Children found to be
+  outside the view volume are then skipped without being visited.
+
   See also documentation for SoSeparator::renderCaching.
 */
 /*!
@@ -664,6 +671,7 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
     if (!state->isCacheOpen()) {
       didcull = TRUE;
       if (this->cullTest(state)) {
+        SoGLRenderStatistics::count(SoGLRenderAction::SEPARATORS_CULLED);
         state->pop();
         return;
       }
@@ -707,6 +715,7 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
   if (createcache || !outsidefrustum) {
     int n = this->children->getLength();
     SoNode ** childarray = (n!=0)? reinterpret_cast<SoNode**>(this->children->getArrayPtr()) : NULL;
+    SoChildCuller culler(action, childarray, n);
     action->pushCurPath();
     for (int i = 0; i < n && !action->hasTerminated(); i++) {
       action->popPushCurPath(i, childarray[i]);
@@ -715,6 +724,7 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
         SoCacheElement::invalidate(state);
         break;
       }
+      if (culler.cullChild(i)) continue;
 
       {
         SoNodeProfiling profiling;
@@ -746,6 +756,9 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
     }
     action->popCurPath();
   }
+  else {
+    SoGLRenderStatistics::count(SoGLRenderAction::SEPARATORS_CULLED);
+  }
   state->pop();
   if (createcache) {
     createcache->close(action);
@@ -1038,6 +1051,89 @@ SoSeparator::cullTestNoPush(SoState * state)
 
 // *************************************************************************
 
+// Groups with fewer children than this are traversed without the
+// culling pre-pass, and shorter runs of separators are not tested.
+static const int SOCHILDCULLER_MINCHILDREN = 16;
+static const int SOCHILDCULLER_MINRUN = 4;
+
+SoChildCuller::SoChildCuller(SoGLRenderAction * actionarg,
+                             SoNode ** childrenarg, const int numchildrenarg)
+  : action(actionarg),
+    children(childrenarg),
+    numchildren(numchildrenarg),
+    runstart(0),
+    runend(0)
+{
+  // the pre-pass would hide culled children from the profiler
+  this->enabled =
+    (numchildrenarg >= SOCHILDCULLER_MINCHILDREN) && !SoProfiler::isEnabled();
+}
+
+// Returns TRUE if child idx is a separator which would cull itself if
+// traversed now, and can be skipped.
+SbBool
+SoChildCuller::cullChild(const int idx)
+{
+  if (!this->enabled) return FALSE;
+  if (idx < this->runstart || idx >= this->runend) this->cullRun(idx);
+  if (this->culled[idx - this->runstart]) {
+    SoGLRenderStatistics::count(SoGLRenderAction::SEPARATORS_CULLED);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+// Tests the run of SoSeparator children starting at first. Only
+// separators of exactly this type are included, since subclasses
+// might cull differently, and the run ends at the first other child,
+// which might change the state the following separators are
+// traversed with.
+void
+SoChildCuller::cullRun(const int first)
+{
+  const SoType septype = SoSeparator::getClassTypeId();
+  int last = first;
+  while (last < this->numchildren && this->children[last]->getTypeId() == septype) last++;
+
+  this->runstart = first;
+  this->runend = SbMax(last, first + 1);
+  this->culled.truncate(0);
+  for (int i = first; i < this->runend; i++) this->culled.append(FALSE);
+
+  SoState * state = this->action->getState();
+  if ((last - first < SOCHILDCULLER_MINRUN) ||
+      state->isCacheOpen() ||
+      SoCullElement::completelyInside(state)) return;
+
+  // collect the boxes the children would use in SoSeparatorP::doCull()
+  this->boxes.truncate(0);
+  this->boxindex.truncate(0);
+  for (int i = first; i < last; i++) {
+    SoSeparator * sep = static_cast<SoSeparator *>(this->children[i]);
+    if (sep->renderCulling.getValue() == SoSeparator::OFF) continue;
+    SoBoundingBoxCache * bboxcache = PRIVATE(sep)->bboxcache;
+    if (bboxcache && bboxcache->isValid(state)) {
+      const SbBox3f & bbox = bboxcache->getProjectedBox();
+      if (!bbox.isEmpty()) {
+        this->boxes.append(bbox);
+        this->boxindex.append(i - first);
+      }
+    }
+  }
+  const int numboxes = this->boxes.getLength();
+  if (numboxes == 0) return;
+
+  this->boxoutside.truncate(0);
+  for (int i = 0; i < numboxes; i++) this->boxoutside.append(FALSE);
+  SoCullElement::cullTestBoxes(state, this->boxes.getArrayPtr(), numboxes,
+                               &this->boxoutside[0]);
+  for (int i = 0; i < numboxes; i++) {
+    if (this->boxoutside[i]) this->culled[this->boxindex[i]] = TRUE;
+  }
+}
+
+// *************************************************************************
+
 #undef PRIVATE
 #undef PUBLIC
 #undef GLCACHE_DEBUG
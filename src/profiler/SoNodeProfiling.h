@@ -42,6 +42,7 @@
 
 #include "misc/SoDBP.h" // for global envvar COIN_PROFILER
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerTrace.h"
 
 /*
   The SoNodeProfiling class contains instrumentation code for scene
@@ -57,17 +58,27 @@
   If you combine doing both, then you get a lot of double-booking of
   timings and negative timing offsets, which causes mayhem in the
   statistics, and was a mess to figure out.
+
+  When tracing is active, the same calls also record begin and end
+  events in the SoProfilerTrace timeline. This does not depend on the
+  profiler element being enabled.
 */
 
 class SoNodeProfiling {
 public:
   SoNodeProfiling(void)
-    : pretime(SbTime::zero()), entryindex(-1)
+    : pretime(SbTime::zero()), entryindex(-1), traced(FALSE)
   {
   }
 
   void preTraversal(SoAction * action)
   {
+    if (SoProfilerTrace::isActive()) {
+      const SoFullPath * fullpath =
+        static_cast<const SoFullPath *>(action->getCurPath());
+      SoProfilerTrace::beginNode(fullpath->getTail());
+      this->traced = TRUE;
+    }
     if (!SoNodeProfiling::isActive(action)) return;
 
     SoState * state = action->getState();
@@ -88,6 +99,7 @@ public:
 
   void postTraversal(SoAction * action)
   {
+    if (this->traced) SoProfilerTrace::end();
     if (!SoNodeProfiling::isActive(action)) return;
 
     if (action->isOfType(SoGLRenderAction::getClassTypeId()) &&
@@ -134,6 +146,7 @@ public:
 private:
   SbTime pretime;
   int entryindex;
+  SbBool traced;
 
 };
 
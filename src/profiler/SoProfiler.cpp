@@ -50,6 +50,20 @@
   scrolling graph of action traversal timings, and a scene graph
   navigator for closer scene graph inspection.
 
+  <h2>Tracing traversals</h2>
+
+  For a timeline of the traversals rather than accumulated statistics,
+  enable tracing with the \c trace keyword of \ref COIN_PROFILER, or
+  with SoProfiler::enableTracing(). Every action application and node
+  traversal is then recorded, with a monotonic clock, into a
+  per-thread ring buffer. SoProfiler::writeTrace() writes the recorded
+  events in the Chrome trace event format, which can be loaded into
+  chrome://tracing or similar trace viewers.
+
+  Tracing does not depend on profiling being enabled, and does not
+  gather the per-path statistics that normal profiling does, so it
+  distorts the timings less.
+
   <h2>Read the profiling data</h2>
 
   The SoProfilerStats node can be used to fetch the profiling data in the
@@ -71,6 +85,7 @@
 
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerTrace.h"
 
 #include <string>
 #include <vector>
@@ -228,6 +243,63 @@ SoProfiler::isEnabled(void)
   return profiler::enabled;
 }
 
+/*!
+  Starts or stops recording traversal trace events. Each thread
+  records into its own ring buffer, which keeps the most recent
+  262144 events. Events already recorded are kept when tracing is
+  stopped.
+
+  Tracing can be used without initializing the profiling subsystem.
+
+  \sa writeTrace(), clearTrace()
+  \since Coin 4.1
+*/
+void
+SoProfiler::enableTracing(SbBool enable)
+{
+  SoProfilerTrace::setActive(enable);
+}
+
+/*!
+  Returns whether traversal trace events are being recorded.
+
+  \since Coin 4.1
+*/
+SbBool
+SoProfiler::isTracingEnabled(void)
+{
+  return SoProfilerTrace::isActive();
+}
+
+/*!
+  Discards all recorded trace events. This should not be called while
+  actions are being applied.
+
+  \since Coin 4.1
+*/
+void
+SoProfiler::clearTrace(void)
+{
+  SoProfilerTrace::clear();
+}
+
+/*!
+  Writes the recorded trace events to \a filename in the Chrome trace
+  event JSON format. Action applications are in the "action"
+  category and node traversals in the "node" category, and each
+  thread gets its own track. This should not be called while actions
+  are being applied.
+
+  Returns \c FALSE if the file could not be written.
+
+  \since Coin 4.1
+*/
+SbBool
+SoProfiler::writeTrace(const char * filename)
+{
+  return SoProfilerTrace::write(filename);
+}
+
 SbBool
 SoProfilerP::shouldContinuousRender(void)
 {
@@ -300,6 +372,7 @@ SoProfilerP::parseCoinProfilerVariable(void)
   // variable COIN_PROFILER
   // - on
   // - syncgl - implies on
+  // - trace[=filename] - does not imply on
   // - [nocaching - implies on] // todo
 
   const char * env = coin_getenv(SoDBP::EnvVars::COIN_PROFILER);
@@ -324,6 +397,13 @@ SoProfilerP::parseCoinProfilerVariable(void)
         profiler::enabled = TRUE;
         profiler::rendering::syncgl = TRUE;
       }
+      else if ((*it).compare(0, 5, "trace") == 0 &&
+               ((*it).size() == 5 || (*it)[5] == '=')) {
+        SoProfilerTrace::setActive(TRUE);
+        if ((*it).size() > 6) {
+          SoProfilerTrace::writeAtExit((*it).substr(6).data());
+        }
+      }
       else {
         SoDebugError::postWarning("SoProfilerP::parseCoinProfilerVariable",
                                   "invalid token '%s'", (*it).data());
@@ -586,3 +666,57 @@ SoProfilerP::dumpToConsole(const SbProfilingData & data)
   SoProfilingReportGenerator::freeCriteria(sortsettings);
   SoProfilingReportGenerator::freeCriteria(printsettings);
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <Inventor/SbString.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+BOOST_AUTO_TEST_CASE(traceExport)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoSeparator * sep = new SoSeparator;
+  sep->addChild(new SoCube);
+  root->addChild(sep);
+
+  SoProfiler::clearTrace();
+  SoProfiler::enableTracing(TRUE);
+  BOOST_CHECK(SoProfiler::isTracingEnabled());
+  SoGetBoundingBoxAction bboxaction(SbViewportRegion(100, 100));
+  bboxaction.apply(root);
+  SoProfiler::enableTracing(FALSE);
+  root->unref();
+
+  const char * filename = "SoProfiler_traceExport.json";
+  BOOST_REQUIRE(SoProfiler::writeTrace(filename));
+  SoProfiler::clearTrace();
+
+  FILE * fp = fopen(filename, "r");
+  BOOST_REQUIRE(fp != NULL);
+  SbString json;
+  char buf[1024];
+  size_t num;
+  while ((num = fread(buf, 1, sizeof(buf) - 1, fp)) > 0) {
+    buf[num] = '\0';
+    json += buf;
+  }
+  fclose(fp);
+  (void)remove(filename);
+
+  BOOST_CHECK(json.find("{\"traceEvents\":[") == 0);
+  BOOST_CHECK(json.find("\"name\":\"SoGetBoundingBoxAction\",\"cat\":\"action\",\"ph\":\"B\"") > 0);
+  BOOST_CHECK(json.find("\"name\":\"Cube\",\"cat\":\"node\",\"ph\":\"B\"") > 0);
+
+  // one action and three nodes, each with a begin and an end event
+  SbIntList begins, ends;
+  json.findAll("\"ph\":\"B\"", begins);
+  json.findAll("\"ph\":\"E\"", ends);
+  BOOST_CHECK_EQUAL(begins.getLength(), 4);
+  BOOST_CHECK_EQUAL(ends.getLength(), 4);
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,425 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "profiler/SoProfilerTrace.h"
+
+#ifdef HAVE_WINDOWS_H
+#include <windows.h>
+#endif // HAVE_WINDOWS_H
+
+#ifdef HAVE_TIME_H
+#include <ctime>
+#endif // HAVE_TIME_H
+
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/SbName.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/actions/SoAction.h>
+#include <Inventor/nodes/SoNode.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/C/threads/thread.h>
+#include <Inventor/C/threads/storage.h>
+
+#include "tidbitsp.h"
+#include "threads/threadsutilp.h"
+
+// Use compiler-supported thread-local storage for the per-thread
+// buffer pointer when available, as cc_storage_get() takes a lock.
+#if !defined(HAVE_THREADS)
+#define SOPROFILERTRACE_TLS
+#elif defined(_MSC_VER)
+#define SOPROFILERTRACE_TLS __declspec(thread)
+#elif defined(__GNUC__)
+#define SOPROFILERTRACE_TLS __thread
+#endif
+
+// *************************************************************************
+
+namespace {
+
+  namespace trace {
+
+    enum EventType {
+      BEGIN_ACTION,
+      BEGIN_NODE,
+      END,
+      COUNTER
+    };
+
+    struct Event {
+      uint64_t ticks;
+      const char * name;
+      int type;
+      uint32_t value;
+    };
+
+    struct Buffer {
+      Event * events;
+      uint64_t count;
+      unsigned long threadid;
+    };
+
+    // number of events kept per thread, must be a power of two
+    static const uint64_t BUFFER_SIZE = 1 << 18;
+
+    static SbList<Buffer *> * buffers = NULL;
+    static void * mutex = NULL;
+    static char * atexitfilename = NULL;
+
+#ifdef SOPROFILERTRACE_TLS
+    static SOPROFILERTRACE_TLS Buffer * threadbuffer = NULL;
+#else // !SOPROFILERTRACE_TLS
+    static cc_storage * threadbuffer = NULL;
+
+    void
+    init_storage(void * ptr)
+    {
+      *static_cast<Buffer **>(ptr) = NULL;
+    }
+#endif // !SOPROFILERTRACE_TLS
+
+    // Returns a monotonic timestamp, in ticks of get_ticks_per_usec().
+    uint64_t
+    get_ticks(void)
+    {
+#if defined(HAVE_QUERYPERFORMANCECOUNTER)
+      LARGE_INTEGER counter;
+      (void) QueryPerformanceCounter(&counter);
+      return static_cast<uint64_t>(counter.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+      struct timespec ts;
+      (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+      return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+      return static_cast<uint64_t>(SbTime::getTimeOfDay().getValue() * 1.0e9);
+#endif
+    }
+
+    double
+    get_ticks_per_usec(void)
+    {
+#if defined(HAVE_QUERYPERFORMANCECOUNTER)
+      LARGE_INTEGER frequency;
+      (void) QueryPerformanceFrequency(&frequency);
+      return static_cast<double>(frequency.QuadPart) / 1.0e6;
+#else
+      return 1000.0;
+#endif
+    }
+
+    Buffer *
+    get_buffer(void)
+    {
+#ifdef SOPROFILERTRACE_TLS
+      Buffer * buffer = threadbuffer;
+#else // !SOPROFILERTRACE_TLS
+      Buffer ** ptr = static_cast<Buffer **>(cc_storage_get(threadbuffer));
+      Buffer * buffer = *ptr;
+#endif // !SOPROFILERTRACE_TLS
+      if (buffer == NULL) {
+        buffer = new Buffer;
+        buffer->events = new Event[BUFFER_SIZE];
+        buffer->count = 0;
+        buffer->threadid = cc_thread_id();
+        CC_MUTEX_LOCK(mutex);
+        buffers->append(buffer);
+        CC_MUTEX_UNLOCK(mutex);
+#ifdef SOPROFILERTRACE_TLS
+        threadbuffer = buffer;
+#else // !SOPROFILERTRACE_TLS
+        *ptr = buffer;
+#endif // !SOPROFILERTRACE_TLS
+      }
+      return buffer;
+    }
+
+    inline void
+    record(const int type, const char * name, const uint32_t value = 0)
+    {
+      Buffer * buffer = get_buffer();
+      Event & event = buffer->events[buffer->count & (BUFFER_SIZE - 1)];
+      event.ticks = get_ticks();
+      event.name = name;
+      event.type = type;
+      event.value = value;
+      buffer->count++;
+    }
+
+    void
+    write_event(FILE * fp, SbBool & first, const char * name, const char * category,
+                const char phase, const double ts, const int tid)
+    {
+      // names are type names, so they need no escaping
+      (void) fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+                     "\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                     first ? "" : ",", name, category, phase, ts, tid);
+      first = FALSE;
+    }
+
+    void
+    atexit_write(void)
+    {
+      SoProfilerTrace::setActive(FALSE);
+      if (atexitfilename) {
+        (void) SoProfilerTrace::write(atexitfilename);
+        free(atexitfilename);
+        atexitfilename = NULL;
+      }
+    }
+
+    void
+    cleanup(void)
+    {
+      SoProfilerTrace::setActive(FALSE);
+      if (buffers) {
+        for (int i = 0; i < buffers->getLength(); i++) {
+          delete[] (*buffers)[i]->events;
+          delete (*buffers)[i];
+        }
+        delete buffers;
+        buffers = NULL;
+      }
+#ifndef SOPROFILERTRACE_TLS
+      cc_storage_destruct(threadbuffer);
+      threadbuffer = NULL;
+#endif // !SOPROFILERTRACE_TLS
+      CC_MUTEX_DESTRUCT(mutex);
+    }
+
+  } // namespace trace
+
+} // namespace
+
+// *************************************************************************
+
+SbBool SoProfilerTrace::active = FALSE;
+
+/*
+  Starts or stops recording trace events. Recorded events are kept
+  when recording is stopped.
+*/
+void
+SoProfilerTrace::setActive(SbBool onoff)
+{
+  if (onoff && !trace::buffers) {
+    CC_MUTEX_CONSTRUCT(trace::mutex);
+#ifndef SOPROFILERTRACE_TLS
+    trace::threadbuffer =
+      cc_storage_construct_etc(sizeof(trace::Buffer *), trace::init_storage, NULL);
+#endif // !SOPROFILERTRACE_TLS
+    trace::buffers = new SbList<trace::Buffer *>;
+    coin_atexit(static_cast<coin_atexit_f *>(trace::cleanup), CC_ATEXIT_NORMAL_LOWPRIORITY);
+  }
+  SoProfilerTrace::active = onoff;
+}
+
+/*
+  Records the start of an application of \a action. Must be matched
+  by a call to end().
+*/
+void
+SoProfilerTrace::beginAction(const SoAction * action)
+{
+  trace::record(trace::BEGIN_ACTION, action->getTypeId().getName().getString());
+}
+
+/*
+  Records the start of the traversal of \a node. Must be matched by a
+  call to end().
+*/
+void
+SoProfilerTrace::beginNode(const SoNode * node)
+{
+  trace::record(trace::BEGIN_NODE, node->getTypeId().getName().getString());
+}
+
+/*
+  Records the end of the innermost action application or node
+  traversal on the calling thread.
+*/
+void
+SoProfilerTrace::end(void)
+{
+  trace::record(trace::END, NULL);
+}
+
+/*
+  Records the value of the counter \a name, which must be a string
+  that stays valid until the events have been written.
+*/
+void
+SoProfilerTrace::counter(const char * name, const uint32_t value)
+{
+  trace::record(trace::COUNTER, name, value);
+}
+
+/*
+  Discards all recorded events. Should not be called while actions
+  are being applied.
+*/
+void
+SoProfilerTrace::clear(void)
+{
+  if (!trace::buffers) return;
+  CC_MUTEX_LOCK(trace::mutex);
+  for (int i = 0; i < trace::buffers->getLength(); i++) {
+    (*trace::buffers)[i]->count = 0;
+  }
+  CC_MUTEX_UNLOCK(trace::mutex);
+}
+
+/*
+  Writes the recorded events to \a fp in the Chrome trace event JSON
+  format. Each thread that recorded events gets its own track. Should
+  not be called while actions are being applied. Returns FALSE on
+  write errors.
+*/
+SbBool
+SoProfilerTrace::write(FILE * fp)
+{
+  (void) fputs("{\"traceEvents\":[", fp);
+  SbBool first = TRUE;
+
+  if (trace::buffers) {
+    CC_MUTEX_LOCK(trace::mutex);
+    const int numbuffers = trace::buffers->getLength();
+
+    // timestamps are written relative to the oldest event kept
+    uint64_t start = 0;
+    SbBool hasstart = FALSE;
+    int i;
+    for (i = 0; i < numbuffers; i++) {
+      const trace::Buffer * buffer = (*trace::buffers)[i];
+      if (buffer->count == 0) continue;
+      const uint64_t oldest = (buffer->count > trace::BUFFER_SIZE) ?
+        buffer->count - trace::BUFFER_SIZE : 0;
+      const uint64_t ticks =
+        buffer->events[oldest & (trace::BUFFER_SIZE - 1)].ticks;
+      if (!hasstart || ticks < start) {
+        start = ticks;
+        hasstart = TRUE;
+      }
+    }
+    const double ticksperusec = trace::get_ticks_per_usec();
+
+    for (i = 0; i < numbuffers; i++) {
+      const trace::Buffer * buffer = (*trace::buffers)[i];
+      if (buffer->count == 0) continue;
+      const int tid = i + 1;
+
+      (void) fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"tid\":%d,\"args\":{\"name\":\"thread %lu\"}}",
+                     first ? "" : ",", tid, buffer->threadid);
+      first = FALSE;
+
+      // keep track of the open events, so that end events whose begin
+      // event has been overwritten can be skipped, and events still
+      // open can be closed
+      SbList<const char *> open;
+      double ts = 0.0;
+      uint64_t idx = (buffer->count > trace::BUFFER_SIZE) ?
+        buffer->count - trace::BUFFER_SIZE : 0;
+      for (; idx < buffer->count; idx++) {
+        const trace::Event & event = buffer->events[idx & (trace::BUFFER_SIZE - 1)];
+        ts = static_cast<double>(event.ticks - start) / ticksperusec;
+        if (event.type == trace::COUNTER) {
+          (void) fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"statistics\",\"ph\":\"C\","
+                         "\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%u}}",
+                         event.name, ts, tid, event.value);
+        }
+        else if (event.type == trace::END) {
+          if (open.getLength() == 0) continue;
+          const char * category = open.pop();
+          trace::write_event(fp, first, "", category, 'E', ts, tid);
+        }
+        else {
+          const char * category =
+            (event.type == trace::BEGIN_ACTION) ? "action" : "node";
+          open.push(category);
+          trace::write_event(fp, first, event.name, category, 'B', ts, tid);
+        }
+      }
+      while (open.getLength() > 0) {
+        trace::write_event(fp, first, "", open.pop(), 'E', ts, tid);
+      }
+    }
+    CC_MUTEX_UNLOCK(trace::mutex);
+  }
+
+  (void) fputs("\n],\"displayTimeUnit\":\"ns\"}\n", fp);
+  return ferror(fp) == 0;
+}
+
+/*
+  Writes the recorded events to the file \a filename. Returns FALSE
+  if the file could not be written.
+*/
+SbBool
+SoProfilerTrace::write(const char * filename)
+{
+  FILE * fp = fopen(filename, "w");
+  if (!fp) {
+    SoDebugError::postWarning("SoProfilerTrace::write",
+                              "Unable to open file '%s' for writing.", filename);
+    return FALSE;
+  }
+  SbBool ok = SoProfilerTrace::write(fp);
+  if (fclose(fp) != 0) ok = FALSE;
+  if (!ok) {
+    SoDebugError::postWarning("SoProfilerTrace::write",
+                              "Error when writing to file '%s'.", filename);
+  }
+  return ok;
+}
+
+/*
+  Makes the recorded events be written to \a filename when Coin is
+  cleaned up by SoDB::finish().
+*/
+void
+SoProfilerTrace::writeAtExit(const char * filename)
+{
+  if (trace::atexitfilename == NULL) {
+    coin_atexit(static_cast<coin_atexit_f *>(trace::atexit_write), CC_ATEXIT_NORMAL);
+  }
+  free(trace::atexitfilename);
+  trace::atexitfilename = strdup(filename);
+}
+
+#undef SOPROFILERTRACE_TLS
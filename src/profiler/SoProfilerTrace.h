@@ -0,0 +1,81 @@
+#ifndef COIN_SOPROFILERTRACE_H
+#define COIN_SOPROFILERTRACE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <cstdio>
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/system/inttypes.h>
+
+class SoAction;
+class SoNode;
+
+/*
+  The SoProfilerTrace class records a timeline of action and node
+  traversals, for inspection in a trace viewer like chrome://tracing.
+
+  Unlike the SbProfilingData statistics, no per-path bookkeeping is
+  done while traversing. Each thread appends begin and end events,
+  stamped with a monotonic clock, to its own ring buffer, so recording
+  an event needs neither a lock nor a lookup. When a buffer is full,
+  the oldest events are overwritten.
+
+  Events are recorded from SoNodeProfiling, which means that nodes are
+  traced wherever the profiler would time them.
+*/
+
+class SoProfilerTrace {
+public:
+  static SbBool isActive(void) { return SoProfilerTrace::active; }
+  static void setActive(SbBool active);
+
+  static void beginAction(const SoAction * action);
+  static void beginNode(const SoNode * node);
+  static void end(void);
+  static void counter(const char * name, const uint32_t value);
+
+  static void clear(void);
+  static SbBool write(FILE * fp);
+  static SbBool write(const char * filename);
+  static void writeAtExit(const char * filename);
+
+private:
+  static SbBool active;
+};
+
+#endif // !COIN_SOPROFILERTRACE_H
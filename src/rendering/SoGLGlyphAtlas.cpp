@@ -0,0 +1,325 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoGLGlyphAtlas
+  \brief The SoGLGlyphAtlas class packs 2D glyph bitmaps into a shared texture.
+
+  There is one atlas per OpenGL context. Glyphs are uploaded the first
+  time they are requested, and are placed in the texture using a
+  simple shelf packer. The atlas is never compacted; when it is full,
+  all glyphs are evicted and the atlas is filled again from scratch.
+  Eviction changes the atlas id, so callers caching texture
+  coordinates must check getId() after each getGlyph() call. A glyph
+  that does not fit in an empty atlas makes getGlyph() return \c
+  FALSE, and the caller should fall back to some other way of
+  rendering it.
+
+  The texture is stored as GL_ALPHA, so glyphs can be drawn with
+  GL_MODULATE to get the current color with the glyph coverage as
+  alpha value.
+*/
+
+#include "rendering/SoGLGlyphAtlas.h"
+
+#include <cstring>
+#include <cassert>
+
+#include <Inventor/misc/SoContextHandler.h>
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/C/tidbits.h>
+#include <Inventor/errors/SoDebugError.h>
+
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+
+// the atlas size is well below the minimum GL_MAX_TEXTURE_SIZE
+// guaranteed by OpenGL 1.1, so no need to query for it.
+static const int ATLAS_SIZE = 1024;
+// empty texels between glyphs, to avoid bleeding when texture
+// coordinates are rounded.
+static const int ATLAS_PADDING = 1;
+
+static SbHash<uint32_t, SoGLGlyphAtlas *> * glyphatlas_hash = NULL;
+static uint32_t glyphatlas_idcounter = 0;
+
+/*!
+  Returns the atlas for the context \a contextid, creating it if
+  needed. The context must be current.
+*/
+SoGLGlyphAtlas *
+SoGLGlyphAtlas::getInstance(const uint32_t contextid)
+{
+  SoGLGlyphAtlas * atlas = NULL;
+  CC_GLOBAL_LOCK;
+  if (glyphatlas_hash == NULL) {
+    glyphatlas_hash = new SbHash<uint32_t, SoGLGlyphAtlas *>;
+    coin_atexit((coin_atexit_f *)SoGLGlyphAtlas::cleanup, CC_ATEXIT_NORMAL);
+  }
+  if (!glyphatlas_hash->get(contextid, atlas)) {
+    atlas = new SoGLGlyphAtlas(contextid);
+    glyphatlas_hash->put(contextid, atlas);
+  }
+  CC_GLOBAL_UNLOCK;
+  return atlas;
+}
+
+/*!
+  Constructor. Use getInstance() to get hold of an atlas.
+*/
+SoGLGlyphAtlas::SoGLGlyphAtlas(const uint32_t contextid)
+  : contextid(contextid),
+    texture(0),
+    shelfx(0),
+    shelfy(0),
+    shelfheight(0)
+{
+  this->id = ++glyphatlas_idcounter;
+  SoContextHandler::addContextDestructionCallback(context_destruction_cb, this);
+}
+
+/*!
+  Destructor.
+*/
+SoGLGlyphAtlas::~SoGLGlyphAtlas()
+{
+  SoContextHandler::removeContextDestructionCallback(context_destruction_cb, this);
+}
+
+/*!
+  Returns a unique id for this atlas. The id changes if the atlas is
+  recreated for the same context or when glyphs are evicted, so it
+  can be used by callers to validate cached texture coordinates.
+*/
+uint32_t
+SoGLGlyphAtlas::getId(void) const
+{
+  return this->id;
+}
+
+/*!
+  Binds the atlas texture, creating it if needed.
+*/
+void
+SoGLGlyphAtlas::bindTexture(void)
+{
+  const cc_glglue * glue = cc_glglue_instance(this->contextid);
+  if (this->texture == 0) {
+    cc_glglue_glGenTextures(glue, 1, &this->texture);
+    cc_glglue_glBindTexture(glue, GL_TEXTURE_2D, this->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    this->clearTexture();
+  }
+  else {
+    cc_glglue_glBindTexture(glue, GL_TEXTURE_2D, this->texture);
+  }
+}
+
+//
+// (Re)specifies the bound atlas texture with all texels set to zero.
+//
+void
+SoGLGlyphAtlas::clearTexture(void)
+{
+  unsigned char * zero = new unsigned char[ATLAS_SIZE * ATLAS_SIZE];
+  memset(zero, 0, ATLAS_SIZE * ATLAS_SIZE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_SIZE, ATLAS_SIZE, 0,
+               GL_ALPHA, GL_UNSIGNED_BYTE, zero);
+  delete[] zero;
+}
+
+//
+// Throws out all glyphs and starts filling the atlas from scratch.
+// The atlas gets a new id, so that cached texture coordinates are
+// invalidated.
+//
+void
+SoGLGlyphAtlas::evict(void)
+{
+#if COIN_DEBUG
+  SoDebugError::postInfo("SoGLGlyphAtlas::evict",
+                         "atlas for context %u is full, evicting %u glyphs",
+                         this->contextid, this->entries.getNumElements());
+#endif // COIN_DEBUG
+  this->entries.clear();
+  this->shelfx = 0;
+  this->shelfy = 0;
+  this->shelfheight = 0;
+  CC_GLOBAL_LOCK;
+  this->id = ++glyphatlas_idcounter;
+  CC_GLOBAL_UNLOCK;
+  // clear the padding texels as well, so stale glyphs can't bleed
+  // into new ones
+  this->clearTexture();
+}
+
+/*!
+  Finds the texture coordinates for \a glyph, uploading the glyph
+  bitmap to the atlas the first time it is requested. \a spec and \a
+  character identify the glyph.
+
+  The atlas texture must be bound using bindTexture() before calling
+  this method. If there is no room left, all glyphs are evicted
+  first, which changes getId(). Returns \c FALSE if the glyph has no
+  bitmap or if it is too large to fit in the atlas.
+*/
+SbBool
+SoGLGlyphAtlas::getGlyph(const cc_font_specification * spec,
+                         const uint32_t character,
+                         const cc_glyph2d * glyph,
+                         SbVec2f & texmin, SbVec2f & texmax)
+{
+  SbString key;
+  key.sprintf("%s|%s|%d|%u",
+              cc_string_get_text(&spec->name),
+              cc_string_get_text(&spec->style),
+              (int) spec->size, character);
+
+  Entry entry;
+  if (this->entries.get(key, entry)) {
+    texmin = entry.texmin;
+    texmax = entry.texmax;
+    return TRUE;
+  }
+
+  int size[2];
+  int offset[2];
+  const unsigned char * bitmap = cc_glyph2d_getbitmap(glyph, size, offset);
+  if (bitmap == NULL || size[0] <= 0 || size[1] <= 0) return FALSE;
+
+  int x, y;
+  if (!this->allocate(size[0], size[1], x, y)) {
+    if (this->entries.getNumElements() == 0) return FALSE;
+    this->evict();
+    if (!this->allocate(size[0], size[1], x, y)) return FALSE;
+  }
+
+  const int numpixels = size[0] * size[1];
+  const unsigned char * src = bitmap;
+  unsigned char * expanded = NULL;
+  if (cc_glyph2d_getmono(glyph)) {
+    // one bit per pixel, rows padded to whole bytes, MSB first
+    const int pitch = (size[0] + 7) / 8;
+    expanded = new unsigned char[numpixels];
+    for (int j = 0; j < size[1]; j++) {
+      const unsigned char * row = bitmap + j * pitch;
+      for (int i = 0; i < size[0]; i++) {
+        expanded[j * size[0] + i] = (row[i >> 3] & (0x80 >> (i & 7))) ? 255 : 0;
+      }
+    }
+    src = expanded;
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  cc_glglue_glTexSubImage2D(cc_glglue_instance(this->contextid),
+                            GL_TEXTURE_2D, 0, x, y, size[0], size[1],
+                            GL_ALPHA, GL_UNSIGNED_BYTE, src);
+  delete[] expanded;
+
+  entry.texmin.setValue(float(x) / float(ATLAS_SIZE),
+                        float(y) / float(ATLAS_SIZE));
+  entry.texmax.setValue(float(x + size[0]) / float(ATLAS_SIZE),
+                        float(y + size[1]) / float(ATLAS_SIZE));
+  this->entries.put(key, entry);
+
+  texmin = entry.texmin;
+  texmax = entry.texmax;
+  return TRUE;
+}
+
+//
+// Shelf packing. Glyphs are placed left to right on the current
+// shelf, and a new shelf is started above the tallest glyph when the
+// row is full.
+//
+SbBool
+SoGLGlyphAtlas::allocate(const int width, const int height, int & x, int & y)
+{
+  const int w = width + ATLAS_PADDING;
+  const int h = height + ATLAS_PADDING;
+  if (w > ATLAS_SIZE || h > ATLAS_SIZE) return FALSE;
+
+  if (this->shelfx + w > ATLAS_SIZE) {
+    this->shelfy += this->shelfheight;
+    this->shelfx = 0;
+    this->shelfheight = 0;
+  }
+  if (this->shelfy + h > ATLAS_SIZE) return FALSE;
+
+  x = this->shelfx;
+  y = this->shelfy;
+  this->shelfx += w;
+  if (h > this->shelfheight) this->shelfheight = h;
+  return TRUE;
+}
+
+//
+// Callback from SoContextHandler
+//
+void
+SoGLGlyphAtlas::context_destruction_cb(uint32_t contextid, void * userdata)
+{
+  SoGLGlyphAtlas * thisp = (SoGLGlyphAtlas *) userdata;
+  if (thisp->contextid != contextid) return;
+
+  if (thisp->texture) {
+    cc_glglue_glDeleteTextures(cc_glglue_instance(contextid), 1, &thisp->texture);
+  }
+  CC_GLOBAL_LOCK;
+  glyphatlas_hash->erase(contextid);
+  CC_GLOBAL_UNLOCK;
+  delete thisp;
+}
+
+//
+// atexit cleanup function. The GL contexts are gone at this point,
+// so the textures are just leaked.
+//
+void
+SoGLGlyphAtlas::cleanup(void)
+{
+  for (SbHash<uint32_t, SoGLGlyphAtlas *>::const_iterator iter =
+         glyphatlas_hash->const_begin();
+       iter != glyphatlas_hash->const_end();
+       ++iter) {
+    delete iter->obj;
+  }
+  delete glyphatlas_hash;
+  glyphatlas_hash = NULL;
+  glyphatlas_idcounter = 0;
+}
@@ -0,0 +1,82 @@
+#ifndef COIN_SOGLGLYPHATLAS_H
+#define COIN_SOGLGLYPHATLAS_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/system/gl.h>
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbString.h>
+
+#include "misc/SbHash.h"
+#include "fonts/glyph2d.h"
+
+class SoGLGlyphAtlas {
+public:
+  static SoGLGlyphAtlas * getInstance(const uint32_t contextid);
+
+  uint32_t getId(void) const;
+  SbBool getGlyph(const cc_font_specification * spec,
+                  const uint32_t character,
+                  const cc_glyph2d * glyph,
+                  SbVec2f & texmin, SbVec2f & texmax);
+  void bindTexture(void);
+
+private:
+  SoGLGlyphAtlas(const uint32_t contextid);
+  ~SoGLGlyphAtlas();
+
+  struct Entry {
+    SbVec2f texmin;
+    SbVec2f texmax;
+  };
+
+  SbBool allocate(const int width, const int height, int & x, int & y);
+  void clearTexture(void);
+  void evict(void);
+  static void context_destruction_cb(uint32_t contextid, void * userdata);
+  static void cleanup(void);
+
+  uint32_t id;
+  uint32_t contextid;
+  GLuint texture;
+  int shelfx;
+  int shelfy;
+  int shelfheight;
+  SbHash<SbString, Entry> entries;
+};
+
+#endif // !COIN_SOGLGLYPHATLAS_H
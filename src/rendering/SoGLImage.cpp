@@ -220,6 +220,7 @@
 
 #include "tidbitsp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLRenderStatistics.h"
 #include "elements/SoTextureScaleQualityElement.h"
 #include "glue/GLUWrapper.h"
 #include "glue/glp.h"
@@ -1080,6 +1081,7 @@ SoGLImage::setData(const SbImage *image,
       PRIVATE(this)->dlists.append(SoGLImageP::dldata(dl));
       PRIVATE(this)->image = NULL; // data is temporary, and only for current context
       dl->call(createinstate);
+      SoGLRenderStatistics::count(SoGLRenderAction::TEXTURE_UPLOADS);
 
       SbBool compress =
         (PRIVATE(this)->flags & COMPRESSED) &&
@@ -1783,6 +1785,7 @@ SoGLImageP::reallyCreateTexture(SoState *state,
     coin_glglue_get_internal_texture_format(glw, numComponents, compress);
   GLenum dataFormat = coin_glglue_get_texture_format(glw, numComponents);
 
+  SoGLRenderStatistics::count(SoGLRenderAction::TEXTURE_UPLOADS);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
   //FIXME: Check cc_glglue capability as well? (kintel 20011129)
@@ -0,0 +1,449 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include "rendering/SoGLLODBudget.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbVec2s.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoShape.h>
+
+#include "coindefs.h" // COIN_UNUSED_ARG()
+
+// Implemented in SoGLRenderAction.cpp.
+extern SoGLLODBudget * SoGLRenderAction_getLODBudget(const SoGLRenderAction * action);
+
+// Entries for LOD nodes which have not been rendered for this many
+// frames are removed.
+static const uint32_t SOGLLODBUDGET_MAX_AGE = 64;
+
+// *************************************************************************
+
+SoGLLODBudget::Key::operator unsigned long(void) const
+{
+  return SbHashFunc(this->node) ^ (static_cast<unsigned long>(this->ordinal) * 2654435761u);
+}
+
+// *************************************************************************
+
+SoGLLODBudget::SoGLLODBudget(void)
+  : trianglebudget(0),
+    timebudget(0.0f),
+    hysteresis(0.1f),
+    currentpass(-1),
+    frame(0),
+    timetriangles(0.0)
+{
+}
+
+SoGLLODBudget::~SoGLLODBudget()
+{
+  SbList<const SoNode *> keys;
+  this->nodeinfo.makeKeyList(keys);
+  for (int i = 0; i < keys.getLength(); i++) {
+    NodeInfo * info = NULL;
+    this->nodeinfo.get(keys[i], info);
+    delete info;
+  }
+}
+
+SbBool
+SoGLLODBudget::isActive(void) const
+{
+  return this->trianglebudget > 0 || this->timebudget > 0.0f;
+}
+
+/*
+  Called by LOD nodes while rendering. \a idx is the child the node
+  would traverse on its own, and \a importance its projected screen
+  area in pixels. If \a importance is negative, the screen area of
+  the bounding box of all children is used. Returns the child to
+  traverse. Any render cache being built is invalidated when a budget
+  is active.
+*/
+int
+SoGLLODBudget::select(SoGLRenderAction * action, SoGroup * lod,
+                      const int idx, const float importance)
+{
+  SoGLLODBudget * budget = SoGLRenderAction_getLODBudget(action);
+  if (budget == NULL || idx < 0 || lod->getNumChildren() < 2) return idx;
+  // the level picked depends on the budget and on the rendering time
+  // of earlier frames, not only on the state, so render caches must
+  // not be built around it
+  SoCacheElement::invalidate(action->getState());
+  return budget->choose(action, lod, idx, importance);
+}
+
+int
+SoGLLODBudget::choose(SoGLRenderAction * action, SoGroup * lod,
+                      const int idx, const float importance)
+{
+  // the same LOD node can be rendered several times in a frame
+  // through multiple parents, so instances are told apart by the
+  // order they are rendered in
+  const int pass = action->getCurPass();
+  if (pass != this->currentpass) {
+    this->ordinals.clear();
+    this->currentpass = pass;
+  }
+  int ordinal = 0;
+  this->ordinals.get(lod, ordinal);
+  this->ordinals.put(lod, ordinal + 1);
+
+  const Key key(lod, ordinal);
+  int used = idx;
+  int prev;
+  if (this->selection.get(key, prev) && prev > idx) {
+    used = SbMin(prev, lod->getNumChildren() - 1);
+  }
+
+  if (pass == 0) {
+    Candidate candidate;
+    candidate.key = key;
+    candidate.info = this->getNodeInfo(action, lod);
+    candidate.importance = importance;
+    if (importance < 0.0f) {
+      SbVec2s size;
+      SoShape::getScreenSize(action->getState(), candidate.info->bbox, size);
+      candidate.importance = float(size[0]) * float(size[1]);
+    }
+    candidate.desired = idx;
+    candidate.used = used;
+    candidate.chosen = idx;
+    this->candidates.append(candidate);
+  }
+  return used;
+}
+
+namespace {
+
+// Counts the triangles of each child of an LOD node, and finds their
+// bounding box in the coordinate system of the LOD node. The path to
+// the LOD node is traversed first, so that the children get the state
+// inherited from the nodes above it (coordinates, complexity, ...),
+// but shapes are only counted below the LOD node.
+class SoGLLODBudgetCounter {
+public:
+  SoGLLODBudgetCounter(const SoNode * lod, SbList<uint32_t> & triangles)
+    : lod(lod), counting(FALSE), triangles(triangles) { }
+
+  static SoCallbackAction::Response pre_lod_cb(void * closure, SoCallbackAction * action,
+                                               const SoNode * node);
+  static SoCallbackAction::Response pre_shape_cb(void * closure, SoCallbackAction * action,
+                                                 const SoNode * node);
+  static void triangle_cb(void * closure, SoCallbackAction * action,
+                          const SoPrimitiveVertex * v1,
+                          const SoPrimitiveVertex * v2,
+                          const SoPrimitiveVertex * v3);
+  static void line_cb(void * closure, SoCallbackAction * action,
+                      const SoPrimitiveVertex * v1,
+                      const SoPrimitiveVertex * v2);
+  static void point_cb(void * closure, SoCallbackAction * action,
+                       const SoPrimitiveVertex * v);
+
+  void extendBy(SoCallbackAction * action, const SoPrimitiveVertex * v);
+
+  const SoNode * lod;
+  SbBool counting;
+  SbList<uint32_t> & triangles;
+  SbMatrix tolod;
+  SbBox3f bbox;
+};
+
+SoCallbackAction::Response
+SoGLLODBudgetCounter::pre_lod_cb(void * closure, SoCallbackAction * action,
+                                 const SoNode * node)
+{
+  SoGLLODBudgetCounter * thisp = static_cast<SoGLLODBudgetCounter *>(closure);
+  // other instances of the node may be traversed off the path
+  if (node != thisp->lod || action->getCurPathCode() == SoAction::OFF_PATH) {
+    return SoCallbackAction::CONTINUE;
+  }
+  const SoGroup * lod = static_cast<const SoGroup *>(node);
+  SoState * state = action->getState();
+  thisp->tolod = action->getModelMatrix().inverse();
+  thisp->counting = TRUE;
+  for (int i = 0; i < lod->getNumChildren(); i++) {
+    thisp->triangles.append(0);
+    state->push();
+    action->switchToNodeTraversal(lod->getChild(i));
+    state->pop();
+  }
+  thisp->counting = FALSE;
+  return SoCallbackAction::PRUNE;
+}
+
+SoCallbackAction::Response
+SoGLLODBudgetCounter::pre_shape_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG(action),
+                                   const SoNode * COIN_UNUSED_ARG(node))
+{
+  SoGLLODBudgetCounter * thisp = static_cast<SoGLLODBudgetCounter *>(closure);
+  return thisp->counting ? SoCallbackAction::CONTINUE : SoCallbackAction::PRUNE;
+}
+
+void
+SoGLLODBudgetCounter::triangle_cb(void * closure, SoCallbackAction * action,
+                                  const SoPrimitiveVertex * v1,
+                                  const SoPrimitiveVertex * v2,
+                                  const SoPrimitiveVertex * v3)
+{
+  SoGLLODBudgetCounter * thisp = static_cast<SoGLLODBudgetCounter *>(closure);
+  const int last = thisp->triangles.getLength() - 1;
+  thisp->triangles[last]++;
+  thisp->extendBy(action, v1);
+  thisp->extendBy(action, v2);
+  thisp->extendBy(action, v3);
+}
+
+void
+SoGLLODBudgetCounter::line_cb(void * closure, SoCallbackAction * action,
+                              const SoPrimitiveVertex * v1,
+                              const SoPrimitiveVertex * v2)
+{
+  SoGLLODBudgetCounter * thisp = static_cast<SoGLLODBudgetCounter *>(closure);
+  thisp->extendBy(action, v1);
+  thisp->extendBy(action, v2);
+}
+
+void
+SoGLLODBudgetCounter::point_cb(void * closure, SoCallbackAction * action,
+                               const SoPrimitiveVertex * v)
+{
+  SoGLLODBudgetCounter * thisp = static_cast<SoGLLODBudgetCounter *>(closure);
+  thisp->extendBy(action, v);
+}
+
+void
+SoGLLODBudgetCounter::extendBy(SoCallbackAction * action, const SoPrimitiveVertex * v)
+{
+  SbMatrix m = action->getModelMatrix();
+  m.multRight(this->tolod);
+  SbVec3f p;
+  m.multVecMatrix(v->getPoint(), p);
+  this->bbox.extendBy(p);
+}
+
+} // anonymous namespace
+
+// Returns the triangle count of each child and the bounding box of
+// \a lod, recalculating them when the node has changed.
+SoGLLODBudget::NodeInfo *
+SoGLLODBudget::getNodeInfo(SoGLRenderAction * action, SoGroup * lod)
+{
+  NodeInfo * info = NULL;
+  if (!this->nodeinfo.get(lod, info)) {
+    info = new NodeInfo;
+    info->nodeid = 0;
+    this->nodeinfo.put(lod, info);
+  }
+  info->lastframe = this->frame;
+
+  const int numchildren = lod->getNumChildren();
+  if (info->nodeid != lod->getNodeId() ||
+      info->triangles.getLength() != numchildren) {
+    info->triangles.truncate(0);
+    SoGLLODBudgetCounter counter(lod, info->triangles);
+
+    SoCallbackAction cbaction(SoViewportRegionElement::get(action->getState()));
+    cbaction.addPreCallback(lod->getTypeId(), SoGLLODBudgetCounter::pre_lod_cb, &counter);
+    cbaction.addPreCallback(SoShape::getClassTypeId(), SoGLLODBudgetCounter::pre_shape_cb, &counter);
+    cbaction.addTriangleCallback(SoShape::getClassTypeId(), SoGLLODBudgetCounter::triangle_cb, &counter);
+    cbaction.addLineSegmentCallback(SoShape::getClassTypeId(), SoGLLODBudgetCounter::line_cb, &counter);
+    cbaction.addPointCallback(SoShape::getClassTypeId(), SoGLLODBudgetCounter::point_cb, &counter);
+
+    SoPath * path = action->getCurPath()->copy();
+    path->ref();
+    cbaction.apply(path);
+    path->unref();
+
+    // in case the LOD node was not reached
+    while (info->triangles.getLength() < numchildren) info->triangles.append(0);
+    info->bbox = counter.bbox;
+    info->nodeid = lod->getNodeId();
+  }
+  return info;
+}
+
+/*
+  Called by the render action after each frame, with the time spent
+  in the render traversal. Selects the levels to use for the next
+  frame.
+*/
+void
+SoGLLODBudget::endFrame(const double traversaltime)
+{
+  this->solve(this->getBudget(traversaltime));
+
+  this->selection.clear();
+  for (int i = 0; i < this->candidates.getLength(); i++) {
+    const Candidate & candidate = this->candidates[i];
+    this->selection.put(candidate.key, candidate.chosen);
+  }
+  this->candidates.truncate(0);
+  this->ordinals.clear();
+  this->currentpass = -1;
+
+  this->frame++;
+  if ((this->frame % SOGLLODBUDGET_MAX_AGE) == 0) this->prune();
+}
+
+// Returns the number of triangles the LOD nodes may use in the next
+// frame.
+double
+SoGLLODBudget::getBudget(const double traversaltime)
+{
+  double budget = this->trianglebudget > 0 ? double(this->trianglebudget) : DBL_MAX;
+
+  if (this->timebudget > 0.0f && traversaltime > 0.0) {
+    double used = 0.0;
+    for (int i = 0; i < this->candidates.getLength(); i++) {
+      const Candidate & candidate = this->candidates[i];
+      used += candidate.info->triangles[candidate.used];
+    }
+    // scale the triangles rendered in this frame by how far off the
+    // time budget we were, and keep the previous estimate while
+    // within the hysteresis band to avoid oscillating
+    const double ratio = this->timebudget / traversaltime;
+    if (this->timetriangles == 0.0 ||
+        ratio < 1.0 - this->hysteresis || ratio > 1.0 + this->hysteresis) {
+      this->timetriangles = SbMax(used, 1.0) * SbClamp(ratio, 0.5, 2.0);
+    }
+    budget = SbMin(budget, this->timetriangles);
+  }
+  return budget;
+}
+
+namespace {
+
+class SoGLLODBudgetStep {
+public:
+  SoGLLODBudgetStep(const float cost, const int candidate)
+    : cost(cost), candidate(candidate) { }
+  // std::priority_queue keeps the largest element on top
+  bool operator<(const SoGLLODBudgetStep & step) const {
+    return this->cost > step.cost;
+  }
+  float cost;
+  int candidate;
+};
+
+} // anonymous namespace
+
+// Greedily coarsens the candidates which lose the least screen area
+// per triangle saved until the frame fits \a budget.
+void
+SoGLLODBudget::solve(const double budget)
+{
+  const int num = this->candidates.getLength();
+  double total = 0.0;
+  for (int i = 0; i < num; i++) {
+    const Candidate & candidate = this->candidates[i];
+    total += candidate.info->triangles[candidate.chosen];
+  }
+
+  std::vector<SoGLLODBudgetStep> heap;
+  for (int i = 0; total > budget && i < num; i++) {
+    const Candidate & candidate = this->candidates[i];
+    const SbList<uint32_t> & triangles = candidate.info->triangles;
+    const int level = candidate.chosen;
+    if (level + 1 < triangles.getLength() && triangles[level + 1] < triangles[level]) {
+      heap.push_back(SoGLLODBudgetStep(candidate.importance / float(triangles[level] - triangles[level + 1]), i));
+    }
+  }
+  std::make_heap(heap.begin(), heap.end());
+
+  while (total > budget && !heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end());
+    const int i = heap.back().candidate;
+    heap.pop_back();
+
+    Candidate & candidate = this->candidates[i];
+    const SbList<uint32_t> & triangles = candidate.info->triangles;
+    const int level = candidate.chosen++;
+    total -= double(triangles[level] - triangles[level + 1]);
+
+    if (level + 2 < triangles.getLength() && triangles[level + 2] < triangles[level + 1]) {
+      heap.push_back(SoGLLODBudgetStep(candidate.importance / float(triangles[level + 1] - triangles[level + 2]), i));
+      std::push_heap(heap.begin(), heap.end());
+    }
+  }
+
+  // Nodes which would get more detail than in the previous frame only
+  // do so while the frame stays below the budget by the hysteresis
+  // fraction. Otherwise nodes would pop back and forth when the frame
+  // is close to the budget.
+  const double limit = budget * (1.0 - this->hysteresis);
+  if (total <= limit) return;
+
+  std::vector<SoGLLODBudgetStep> refined;
+  for (int i = 0; i < num; i++) {
+    const Candidate & candidate = this->candidates[i];
+    if (candidate.used > candidate.chosen) {
+      refined.push_back(SoGLLODBudgetStep(candidate.importance, i));
+    }
+  }
+  std::sort(refined.begin(), refined.end());
+  // sorted with the largest importance first, so keep the least
+  // important nodes at the previous level first
+  for (int i = int(refined.size()) - 1; i >= 0 && total > limit; i--) {
+    Candidate & candidate = this->candidates[refined[i].candidate];
+    const SbList<uint32_t> & triangles = candidate.info->triangles;
+    total -= double(triangles[candidate.chosen]) - double(triangles[candidate.used]);
+    candidate.chosen = candidate.used;
+  }
+}
+
+// Removes the entries for LOD nodes which are no longer rendered.
+void
+SoGLLODBudget::prune(void)
+{
+  SbList<const SoNode *> keys;
+  this->nodeinfo.makeKeyList(keys);
+  for (int i = 0; i < keys.getLength(); i++) {
+    NodeInfo * info = NULL;
+    this->nodeinfo.get(keys[i], info);
+    if (this->frame - info->lastframe > SOGLLODBUDGET_MAX_AGE) {
+      this->nodeinfo.erase(keys[i]);
+      delete info;
+    }
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef COIN_SOGLLODBUDGET_H
+#define COIN_SOGLLODBUDGET_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/lists/SbList.h>
+
+#include "misc/SbHash.h"
+
+class SoGLRenderAction;
+class SoGroup;
+class SoNode;
+class SoState;
+
+/*
+  Selects levels for the LOD nodes rendered by an SoGLRenderAction
+  which has a triangle or time budget set.
+
+  The LOD nodes register themselves through select() while rendering,
+  with the child they would choose on their own. At the end of the
+  frame, nodes are coarsened in order of least projected screen area
+  per triangle saved until the frame fits the budget, and the result
+  is used for the next frame. A node is never rendered with more
+  detail than it chooses itself.
+*/
+
+class SoGLLODBudget {
+public:
+  SoGLLODBudget(void);
+  ~SoGLLODBudget();
+
+  uint32_t trianglebudget;
+  float timebudget;
+  float hysteresis;
+
+  SbBool isActive(void) const;
+  void endFrame(const double traversaltime);
+
+  static int select(SoGLRenderAction * action, SoGroup * lod,
+                    const int idx, const float importance = -1.0f);
+
+private:
+  class Key {
+  public:
+    Key(void) : node(NULL), ordinal(0) { }
+    Key(const SoNode * node, const int ordinal) : node(node), ordinal(ordinal) { }
+    operator unsigned long(void) const;
+    int operator==(const Key & key) const {
+      return this->node == key.node && this->ordinal == key.ordinal;
+    }
+    const SoNode * node;
+    int ordinal;
+  };
+
+  class NodeInfo {
+  public:
+    uint32_t nodeid;
+    uint32_t lastframe;
+    SbBox3f bbox;
+    SbList<uint32_t> triangles;
+  };
+
+  class Candidate {
+  public:
+    Key key;
+    NodeInfo * info;
+    float importance;
+    int desired;
+    int used;
+    int chosen;
+  };
+
+  int choose(SoGLRenderAction * action, SoGroup * lod,
+             const int idx, const float importance);
+  NodeInfo * getNodeInfo(SoGLRenderAction * action, SoGroup * lod);
+  double getBudget(const double traversaltime);
+  void solve(const double budget);
+  void prune(void);
+
+  SbList<Candidate> candidates;
+  SbHash<Key, int> selection;
+  SbHash<const SoNode *, int> ordinals;
+  SbHash<const SoNode *, NodeInfo *> nodeinfo;
+  int currentpass;
+  uint32_t frame;
+  double timetriangles;
+};
+
+#endif // !COIN_SOGLLODBUDGET_H
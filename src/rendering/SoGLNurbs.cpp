@@ -56,6 +56,7 @@
 #include <Inventor/threads/SbStorage.h>
 #include "tidbitsp.h"
 #include "glue/glp.h"
+#include "caches/SoNurbsSurfaceCache.h"
 
 #include <cstdlib>
 
@@ -70,6 +71,26 @@ sogl_calculate_nurbs_normals()
   return calculatenurbsnormals ? TRUE : FALSE;
 }
 
+/*
+  Returns TRUE if NURBS surfaces should be tessellated by
+  SoNurbsSurfaceCache instead of by GLU. Trimmed surfaces are always
+  tessellated by GLU. Set the environment variable
+  COIN_GLU_NURBS_TESSELLATOR to 1 to use GLU for all surfaces.
+*/
+SbBool
+sogl_use_builtin_nurbs_tessellator(SoState * state)
+{
+  static int builtin = -1;
+  if (builtin == -1) {
+    const char * env = coin_getenv("COIN_GLU_NURBS_TESSELLATOR");
+    builtin = (env && atoi(env) > 0) ? 0 : 1;
+  }
+  if (!builtin) return FALSE;
+  return
+    !state->isElementEnabled(SoProfileElement::getClassStackIndex()) ||
+    (SoProfileElement::get(state).getLength() == 0);
+}
+
 namespace {
   SbStorage * sogl_coordstorage = NULL;
   SbStorage * sogl_texcoordstorage = NULL;
@@ -1397,3 +1418,167 @@ sogl_render_nurbs_curve(SoAction * action, SoShape * shape,
     cc_string_clean(&str);
   }
 }
+
+namespace {
+
+  // The largest distance allowed between the tessellated and the
+  // exact surface, in object space. For SCREEN_SPACE complexity this
+  // is the pixel tolerance of the GLU path converted to object space,
+  // so it depends on the view.
+  float
+  sogl_nurbs_tolerance(SoAction * action, SoShape * shape)
+  {
+    SoState * state = action->getState();
+    SbBox3f box;
+    SbVec3f center;
+    shape->computeBBox(action, box, center);
+    float diag = 1.0f;
+    if (!box.isEmpty()) {
+      float dx, dy, dz;
+      box.getSize(dx, dy, dz);
+      diag = float(sqrt(dx*dx + dy*dy + dz*dz));
+      if (diag == 0.0f) diag = 1.0f;
+    }
+
+    const float complexity = SbClamp(SoComplexityElement::get(state), 0.0f, 1.0f);
+    if (SoComplexityTypeElement::get(state) == SoComplexityTypeElement::SCREEN_SPACE &&
+        state->isElementEnabled(SoViewportRegionElement::getClassStackIndex()) &&
+        state->isElementEnabled(SoProjectionMatrixElement::getClassStackIndex())) {
+      float pixels;
+      if      (complexity < 0.10f) pixels = 10.0f;
+      else if (complexity < 0.20f) pixels = 8.0f;
+      else if (complexity < 0.30f) pixels = 6.0f;
+      else if (complexity < 0.40f) pixels = 4.0f;
+      else if (complexity < 0.50f) pixels = 2.0f;
+      else if (complexity < 0.70f) pixels = 1.0f;
+      else if (complexity < 0.80f) pixels = 0.5f;
+      else if (complexity < 0.90f) pixels = 0.25f;
+      else                         pixels = 0.125f;
+
+      SbVec2s size;
+      SoShape::getScreenSize(state, box, size);
+      const float maxpix = SbMax(float(SbMax(size[0], size[1])), 1.0f);
+      return diag * pixels / maxpix;
+    }
+    return diag * 0.005f / SbMax(complexity * complexity, 0.0001f);
+  }
+
+} // anonymous namespace
+
+/*
+  Tessellates the NURBS surface into the cache, unless the cache is
+  still valid for the surface and the current complexity. The
+  parameters are the same as for sogl_render_nurbs_surface(). A new
+  cache replaces and unrefs the old one, so the caller must hold a
+  lock protecting cache when several threads may traverse the node.
+
+  Returns FALSE if the surface should be tessellated by GLU instead,
+  which is the case for trimmed surfaces and data the built-in
+  evaluator can not handle.
+*/
+SbBool
+sogl_tessellate_nurbs_surface(SoAction * action, SoShape * shape,
+                              SoNurbsSurfaceCache *& cache,
+                              const int numuctrlpts, const int numvctrlpts,
+                              const float * uknotvec, const float * vknotvec,
+                              const int numuknot, const int numvknot,
+                              const int numsctrlpts, const int numtctrlpts,
+                              const float * sknotvec, const float * tknotvec,
+                              const int numsknot, const int numtknot,
+                              const int numcoordindex, const int32_t * coordindex,
+                              const int numtexcoordindex, const int32_t * texcoordindex)
+{
+  SoState * state = action->getState();
+  if (!sogl_use_builtin_nurbs_tessellator(state)) return FALSE;
+
+  const float tolerance = sogl_nurbs_tolerance(action, shape);
+  if (cache && cache->isValid(state) && cache->matches(shape->getNodeId(), tolerance)) {
+    return cache->getNumU() > 0;
+  }
+
+  SbBool storeinvalid = SoCacheElement::setInvalid(FALSE);
+  state->push(); // need to push for cache dependencies
+  SoNurbsSurfaceCache * newcache = new SoNurbsSurfaceCache(state);
+  newcache->ref();
+  SoCacheElement::set(state, newcache);
+
+  const SoCoordinateElement * coords = SoCoordinateElement::getInstance(state);
+  const int dim = coords->is3D() ? 3 : 4;
+  const int numcoords = coords->getNum();
+  const float * ptr = coords->is3D() ?
+    reinterpret_cast<const float *>(coords->getArrayPtr3()) :
+    reinterpret_cast<const float *>(coords->getArrayPtr4());
+  const int numctrlpts = numuctrlpts * numvctrlpts;
+
+  // copy indexed control points into a linear array
+  SbList <float> indexedcoords;
+  if (numcoordindex && coordindex) {
+    if (numcoordindex < numctrlpts) ptr = NULL;
+    for (int i = 0; ptr && i < numctrlpts; i++) {
+      if (coordindex[i] < 0 || coordindex[i] >= numcoords) {
+        ptr = NULL;
+        break;
+      }
+      for (int j = 0; j < dim; j++) indexedcoords.append(ptr[coordindex[i]*dim+j]);
+    }
+    if (ptr) ptr = indexedcoords.getArrayPtr();
+  }
+  else if (numcoords < numctrlpts) {
+    ptr = NULL;
+  }
+
+  const float * texptr = NULL;
+  int texdim = 0;
+  SbList <float> indexedtexcoords;
+  if (numsctrlpts && numtctrlpts && numsknot && numtknot &&
+      state->isElementEnabled(SoMultiTextureCoordinateElement::getClassStackIndex())) {
+    const SoMultiTextureCoordinateElement * tc =
+      SoMultiTextureCoordinateElement::getInstance(state);
+    const int numtexctrlpts = numsctrlpts * numtctrlpts;
+    if (tc->getType() == SoMultiTextureCoordinateElement::EXPLICIT && tc->getNum()) {
+      texdim = tc->is2D() ? 2 : 4;
+      texptr = tc->is2D() ?
+        reinterpret_cast<const float *>(tc->getArrayPtr2()) :
+        reinterpret_cast<const float *>(tc->getArrayPtr4());
+      if (numtexcoordindex && texcoordindex) {
+        if (numtexcoordindex < numtexctrlpts) texptr = NULL;
+        for (int i = 0; texptr && i < numtexctrlpts; i++) {
+          if (texcoordindex[i] < 0 || texcoordindex[i] >= tc->getNum()) {
+            texptr = NULL;
+            break;
+          }
+          for (int j = 0; j < texdim; j++) {
+            indexedtexcoords.append(texptr[texcoordindex[i]*texdim+j]);
+          }
+        }
+        if (texptr) texptr = indexedtexcoords.getArrayPtr();
+      }
+      else if (tc->getNum() < numtexctrlpts) {
+        texptr = NULL;
+      }
+    }
+  }
+
+  if (ptr) {
+    newcache->generate(shape->getNodeId(), tolerance,
+                       numuctrlpts, numvctrlpts,
+                       uknotvec, numuknot, vknotvec, numvknot,
+                       ptr, dim,
+                       numsctrlpts, numtctrlpts,
+                       sknotvec, numsknot, tknotvec, numtknot,
+                       texptr, texdim);
+  }
+  else {
+    // remember the failure, so that GLU is used until the node or
+    // the coordinates change
+    newcache->generate(shape->getNodeId(), tolerance,
+                       0, 0, NULL, 0, NULL, 0, NULL, 0);
+  }
+
+  state->pop();
+  SoCacheElement::setInvalid(storeinvalid);
+
+  if (cache) cache->unref();
+  cache = newcache;
+  return cache->getNumU() > 0;
+}
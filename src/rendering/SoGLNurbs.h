@@ -41,9 +41,25 @@
 
 class SoAction;
 class SoShape;
+class SoState;
+class SoNurbsSurfaceCache;
 
 SbBool sogl_calculate_nurbs_normals();
 
+SbBool sogl_use_builtin_nurbs_tessellator(SoState * state);
+
+SbBool
+sogl_tessellate_nurbs_surface(SoAction * action, SoShape * shape,
+                              SoNurbsSurfaceCache *& cache,
+                              const int numuctrlpts, const int numvctrlpts,
+                              const float * uknotvec, const float * vknotvec,
+                              const int numuknot, const int numvknot,
+                              const int numsctrlpts, const int numtctrlpts,
+                              const float * sknotvec, const float * tknotvec,
+                              const int numsknot, const int numtknot,
+                              const int numcoordindex = 0, const int32_t * coordindex = NULL,
+                              const int numtexcoordindex = 0, const int32_t * texcoordindex = NULL);
+
 void
 sogl_render_nurbs_surface(SoAction * action, SoShape * shape,
                           void * nurbsrenderer,
@@ -0,0 +1,101 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include "rendering/SoGLRenderStatistics.h"
+
+#include <Inventor/threads/SbStorage.h>
+
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+
+// number of threads which have counters set
+int SoGLRenderStatistics::numcollecting = 0;
+
+typedef struct {
+  uint32_t * counters;
+} soglrenderstatistics_data;
+
+static SbStorage * soglrenderstatistics_storage = NULL;
+static void * soglrenderstatistics_mutex = NULL;
+
+static void
+soglrenderstatistics_construct_data(void * closure)
+{
+  soglrenderstatistics_data * data = static_cast<soglrenderstatistics_data *>(closure);
+  data->counters = NULL;
+}
+
+void
+SoGLRenderStatistics::initClass(void)
+{
+  soglrenderstatistics_storage =
+    new SbStorage(sizeof(soglrenderstatistics_data),
+                  soglrenderstatistics_construct_data, NULL);
+  CC_MUTEX_CONSTRUCT(soglrenderstatistics_mutex);
+  coin_atexit(SoGLRenderStatistics::cleanup, CC_ATEXIT_NORMAL);
+}
+
+void
+SoGLRenderStatistics::cleanup(void)
+{
+  delete soglrenderstatistics_storage;
+  soglrenderstatistics_storage = NULL;
+  CC_MUTEX_DESTRUCT(soglrenderstatistics_mutex);
+  SoGLRenderStatistics::numcollecting = 0;
+}
+
+// Returns the counters of the calling thread, or NULL if statistics
+// are not collected in this thread.
+uint32_t *
+SoGLRenderStatistics::getCounters(void)
+{
+  soglrenderstatistics_data * data =
+    static_cast<soglrenderstatistics_data *>(soglrenderstatistics_storage->get());
+  return data->counters;
+}
+
+// Sets the counters for the calling thread, or NULL to stop counting
+// in this thread. Returns the previous counters.
+uint32_t *
+SoGLRenderStatistics::setCounters(uint32_t * counters)
+{
+  soglrenderstatistics_data * data =
+    static_cast<soglrenderstatistics_data *>(soglrenderstatistics_storage->get());
+  uint32_t * prev = data->counters;
+  data->counters = counters;
+  if ((prev == NULL) != (counters == NULL)) {
+    CC_MUTEX_LOCK(soglrenderstatistics_mutex);
+    SoGLRenderStatistics::numcollecting += counters ? 1 : -1;
+    CC_MUTEX_UNLOCK(soglrenderstatistics_mutex);
+  }
+  return prev;
+}
@@ -0,0 +1,70 @@
+#ifndef COIN_SOGLRENDERSTATISTICS_H
+#define COIN_SOGLRENDERSTATISTICS_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/actions/SoGLRenderAction.h>
+
+/*
+  Counts render statistics for the SoGLRenderAction being applied in
+  the calling thread. The counters are kept per thread, since much of
+  the counting code, like the draw call wrappers in gl.cpp, has no
+  access to the action. The per thread counters are only looked up
+  while some thread collects statistics, so counting costs a single
+  test otherwise.
+*/
+
+class SoGLRenderStatistics {
+public:
+  static void count(const SoGLRenderAction::Statistic statistic, const uint32_t num = 1)
+  {
+    if (SoGLRenderStatistics::numcollecting > 0) {
+      uint32_t * counters = SoGLRenderStatistics::getCounters();
+      if (counters) counters[statistic] += num;
+    }
+  }
+
+  static void initClass(void);
+  static uint32_t * getCounters(void);
+  static uint32_t * setCounters(uint32_t * counters);
+
+private:
+  static void cleanup(void);
+  static int numcollecting;
+};
+
+#endif // !COIN_SOGLRENDERSTATISTICS_H
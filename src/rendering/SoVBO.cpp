@@ -54,6 +54,7 @@
 #include <Inventor/errors/SoDebugError.h>
 
 #include "rendering/SoVertexArrayIndexer.h"
+#include "rendering/SoGLRenderStatistics.h"
 #include "threads/threadsutilp.h"
 #include "glue/glp.h"
 #include "tidbitsp.h"
@@ -81,7 +82,8 @@ SoVBO::SoVBO(const GLenum target, const GLenum usage)
     datasize(0),
     dataid(0),
     didalloc(FALSE),
-    vbohash(5)
+    vbohash(5),
+    dirtyhash(5)
 {
   SoContextHandler::addContextDestructionCallback(context_destruction_cb, this);
 }
@@ -215,8 +217,9 @@ SoVBO::allocBufferData(intptr_t size, SbUniqueId dataid)
     SoGLCacheContextElement::scheduleDeleteCallback(iter->key, SoVBO::vbo_delete, ptr);
   }
 
-  // clear hash table
+  // clear hash tables
   this->vbohash.clear();
+  this->dirtyhash.clear();
 
   if (this->didalloc && this->datasize == size) {
     return (void*)this->data;
@@ -254,8 +257,9 @@ SoVBO::setBufferData(const GLvoid * data, intptr_t size, SbUniqueId dataid)
   }
 
 
-  // clear hash table
+  // clear hash tables
   this->vbohash.clear();
+  this->dirtyhash.clear();
 
   // clean up old buffer (if any)
   if (this->didalloc) {
@@ -269,6 +273,49 @@ SoVBO::setBufferData(const GLvoid * data, intptr_t size, SbUniqueId dataid)
   this->didalloc = FALSE;
 }
 
+/*!
+  Updates \a numbytes bytes starting at \a offset in the buffer
+  data. \a data points to the complete new data, which must be of the
+  same \a size as the current buffer data. Buffers already created for
+  a context will only have the modified range uploaded the next time
+  they are bound.
+
+  Returns \c FALSE if the buffer can't be updated this way (no
+  buffer data, the size has changed or the data was allocated using
+  allocBufferData()). setBufferData() must be used in that case.
+*/
+SbBool
+SoVBO::updateBufferData(const GLvoid * data, intptr_t size,
+                        intptr_t offset, intptr_t numbytes,
+                        SbUniqueId dataid)
+{
+  if (this->didalloc || (this->data == NULL) ||
+      (this->datasize != size) || (offset < 0) ||
+      (numbytes < 0) || (offset + numbytes > size)) {
+    return FALSE;
+  }
+  for(
+      SbHash<uint32_t, GLuint>::const_iterator iter =
+       this->vbohash.const_begin();
+      iter!=this->vbohash.const_end();
+      ++iter
+      ) {
+    DirtyRange range;
+    if (this->dirtyhash.get(iter->key, range)) {
+      if (offset < range.start) range.start = offset;
+      if (offset + numbytes > range.end) range.end = offset + numbytes;
+    }
+    else {
+      range.start = offset;
+      range.end = offset + numbytes;
+    }
+    this->dirtyhash.put(iter->key, range);
+  }
+  this->data = data;
+  this->dataid = dataid;
+  return TRUE;
+}
+
 /*!
   Returns the buffer data id.
 
@@ -315,10 +362,29 @@ SoVBO::bindBuffer(uint32_t contextid)
                            this->data,
                            this->usage);
     this->vbohash.put(contextid, buffer);
+    SoGLRenderStatistics::count(SoGLRenderAction::VBOS_CREATED);
+    SoGLRenderStatistics::count(SoGLRenderAction::VBO_UPLOADS);
+    SoGLRenderStatistics::count(SoGLRenderAction::VBO_UPLOADED_BYTES,
+                                (uint32_t) this->datasize);
   }
   else {
     // buffer already exists, bind it
     cc_glglue_glBindBuffer(glue, this->target, buffer);
+
+    // upload the part of the data modified since the last bind (if any)
+    DirtyRange range;
+    if (this->dirtyhash.get(contextid, range)) {
+      if (range.end > range.start) {
+        cc_glglue_glBufferSubData(glue, this->target,
+                                  range.start,
+                                  range.end - range.start,
+                                  ((const char *) this->data) + range.start);
+        SoGLRenderStatistics::count(SoGLRenderAction::VBO_UPLOADS);
+        SoGLRenderStatistics::count(SoGLRenderAction::VBO_UPLOADED_BYTES,
+                                    (uint32_t) (range.end - range.start));
+      }
+      this->dirtyhash.erase(contextid);
+    }
   }
 
 #if COIN_DEBUG
@@ -352,6 +418,7 @@ SoVBO::context_destruction_cb(uint32_t context, void * userdata)
     const cc_glglue * glue = cc_glglue_instance((int) context);
     cc_glglue_glDeleteBuffers(glue, 1, &buffer);
     thisp->vbohash.erase(context);
+    thisp->dirtyhash.erase(context);
   }
 }
 
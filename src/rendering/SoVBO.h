@@ -54,6 +54,9 @@ class SoVBO {
 
   void setBufferData(const GLvoid * data, intptr_t size, SbUniqueId dataid = 0);
   void * allocBufferData(intptr_t size, SbUniqueId dataid = 0);
+  SbBool updateBufferData(const GLvoid * data, intptr_t size,
+                          intptr_t offset, intptr_t numbytes,
+                          SbUniqueId dataid = 0);
   SbUniqueId getBufferDataId(void) const;
   void getBufferData(const GLvoid *& data, intptr_t & size);
   void bindBuffer(uint32_t contextid);
@@ -75,6 +78,11 @@ class SoVBO {
   friend struct vbo_schedule;
   static void vbo_delete(void * closure, uint32_t contextid);
 
+  struct DirtyRange {
+    intptr_t start;
+    intptr_t end;
+  };
+
   GLenum target;
   GLenum usage;
   const GLvoid * data;
@@ -83,6 +91,7 @@ class SoVBO {
   SbBool didalloc;
 
   SbHash<uint32_t, GLuint> vbohash;
+  SbHash<uint32_t, DirtyRange> dirtyhash;
 };
 
 #endif // COIN_VERTEXARRAYINDEXER_H
@@ -42,6 +42,8 @@
 #include <cassert>
 #include <cstring>
 #include <cstdio>
+#include <cmath>
+#include <cstdlib>
 
 #include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
@@ -55,6 +57,8 @@
 #pragma warning(disable:4786)
 #endif // VC6.0
 
+static int vertexcache_optimize = -1;
+
 /*!
   Constructor
 */
@@ -231,7 +235,12 @@ SoVertexArrayIndexer::close(void)
     }
   }
   if (this->target == GL_TRIANGLES) {
-    this->sort_triangles();
+    if (SoVertexArrayIndexer::shouldOptimizeVertexCache()) {
+      this->optimize_triangles();
+    }
+    else {
+      this->sort_triangles();
+    }
   }
   else if (this->target == GL_LINES) {
     this->sort_lines();
@@ -438,6 +447,202 @@ SoVertexArrayIndexer::sort_triangles(void)
   }
 }
 
+// The post-transform vertex cache simulated by optimize_triangles(),
+// and the scoring constants from Tom Forsyth's "Linear-Speed Vertex
+// Cache Optimisation".
+#define VERTEXCACHE_SIZE 32
+static const float vertexcache_decay_power = 1.5f;
+static const float vertexcache_last_tri_score = 0.75f;
+static const float vertexcache_valence_boost_scale = 2.0f;
+static const float vertexcache_valence_boost_power = 0.5f;
+
+// score for a vertex at position cachepos in the cache (-1 if not in
+// the cache), used by numtris triangles not yet added
+static float
+vertexcache_score(const int cachepos, const int numtris)
+{
+  if (numtris == 0) return -1.0f;
+
+  float score = 0.0f;
+  if (cachepos >= 0) {
+    if (cachepos < 3) {
+      // the vertices of the last triangle get a fixed score, so that
+      // it doesn't matter which of them is used first
+      score = vertexcache_last_tri_score;
+    }
+    else {
+      const float scaler = 1.0f / (VERTEXCACHE_SIZE - 3);
+      score = static_cast<float>(pow(1.0f - (cachepos - 3) * scaler,
+                                     vertexcache_decay_power));
+    }
+  }
+  // boost vertices with few triangles left, to avoid leaving single
+  // triangles behind
+  score += vertexcache_valence_boost_scale *
+    static_cast<float>(pow(static_cast<float>(numtris),
+                           -vertexcache_valence_boost_power));
+  return score;
+}
+
+//
+// reorder triangles to get more hits in the GPU vertex cache
+//
+void
+SoVertexArrayIndexer::optimize_triangles(void)
+{
+  const int numtri = this->indexarray.getLength() / 3;
+  if (numtri < 2) return;
+
+  int32_t * indices = (int32_t*) this->indexarray.getArrayPtr();
+  int i, j, k;
+
+  int numvertices = 0;
+  for (i = 0; i < numtri * 3; i++) {
+    if (indices[i] < 0) {
+      this->sort_triangles();
+      return;
+    }
+    if (indices[i] >= numvertices) numvertices = indices[i] + 1;
+  }
+
+  // the triangles using each vertex, as one array with an offset per
+  // vertex. numtris is the number of triangles not yet added for
+  // each vertex, and these triangles are kept first in the list.
+  int * trioffset = new int[numvertices + 1];
+  int * numtris = new int[numvertices];
+  memset(numtris, 0, numvertices * sizeof(int));
+  for (i = 0; i < numtri * 3; i++) numtris[indices[i]]++;
+  trioffset[0] = 0;
+  for (i = 0; i < numvertices; i++) trioffset[i+1] = trioffset[i] + numtris[i];
+  int * vertextris = new int[numtri * 3];
+  memset(numtris, 0, numvertices * sizeof(int));
+  for (i = 0; i < numtri * 3; i++) {
+    const int v = indices[i];
+    vertextris[trioffset[v] + numtris[v]++] = i / 3;
+  }
+
+  int * cachepos = new int[numvertices];
+  float * vertexscore = new float[numvertices];
+  for (i = 0; i < numvertices; i++) {
+    cachepos[i] = -1;
+    vertexscore[i] = vertexcache_score(-1, numtris[i]);
+  }
+  float * triscore = new float[numtri];
+  unsigned char * added = new unsigned char[numtri];
+  for (i = 0; i < numtri; i++) {
+    triscore[i] = vertexscore[indices[i*3]] + vertexscore[indices[i*3+1]] + vertexscore[indices[i*3+2]];
+    added[i] = 0;
+  }
+
+  int besttri = 0;
+  for (i = 1; i < numtri; i++) {
+    if (triscore[i] > triscore[besttri]) besttri = i;
+  }
+
+  int32_t * result = new int32_t[numtri * 3];
+  int numresult = 0;
+  int cache[VERTEXCACHE_SIZE + 3];
+  int cachesize = 0;
+  int nextunadded = 0;
+
+  while (besttri >= 0) {
+    const int32_t * tri = indices + besttri * 3;
+    added[besttri] = 1;
+
+    int newcache[VERTEXCACHE_SIZE + 3];
+    int newcachesize = 0;
+    for (k = 0; k < 3; k++) {
+      const int v = tri[k];
+      result[numresult++] = v;
+
+      // remove triangle from the triangles not yet added for the vertex
+      int * vtris = vertextris + trioffset[v];
+      const int n = numtris[v];
+      for (j = 0; j < n; j++) {
+        if (vtris[j] == besttri) {
+          vtris[j] = vtris[n-1];
+          vtris[n-1] = besttri;
+          break;
+        }
+      }
+      numtris[v]--;
+
+      // the vertices of the triangle are moved to the front of the cache
+      for (j = 0; j < newcachesize && newcache[j] != v; j++) { }
+      if (j == newcachesize) newcache[newcachesize++] = v;
+    }
+    for (i = 0; i < cachesize; i++) {
+      const int v = cache[i];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) newcache[newcachesize++] = v;
+    }
+
+    // update the score of all vertices in the cache, and the
+    // vertices which fell out of the cache
+    for (i = 0; i < newcachesize; i++) {
+      const int v = newcache[i];
+      cachepos[v] = (i < VERTEXCACHE_SIZE) ? i : -1;
+      vertexscore[v] = vertexcache_score(cachepos[v], numtris[v]);
+    }
+
+    // update the score for the triangles using these vertices, and
+    // find the best triangle to add next
+    besttri = -1;
+    float bestscore = -1.0f;
+    for (i = 0; i < newcachesize; i++) {
+      const int v = newcache[i];
+      const int * vtris = vertextris + trioffset[v];
+      for (j = 0; j < numtris[v]; j++) {
+        const int t = vtris[j];
+        const int32_t * ti = indices + t * 3;
+        const float score = vertexscore[ti[0]] + vertexscore[ti[1]] + vertexscore[ti[2]];
+        triscore[t] = score;
+        if (score > bestscore) {
+          bestscore = score;
+          besttri = t;
+        }
+      }
+    }
+    cachesize = SbMin(newcachesize, VERTEXCACHE_SIZE);
+    memcpy(cache, newcache, cachesize * sizeof(int));
+
+    if (besttri < 0) {
+      // no triangles left using the vertices in the cache, continue
+      // with the first triangle not yet added
+      while (nextunadded < numtri && added[nextunadded]) nextunadded++;
+      if (nextunadded < numtri) besttri = nextunadded;
+    }
+  }
+  assert(numresult == numtri * 3);
+  memcpy(indices, result, numtri * 3 * sizeof(int32_t));
+
+  delete[] result;
+  delete[] added;
+  delete[] triscore;
+  delete[] vertexscore;
+  delete[] cachepos;
+  delete[] vertextris;
+  delete[] numtris;
+  delete[] trioffset;
+}
+
+#undef VERTEXCACHE_SIZE
+
+/*!
+  Returns \c TRUE if triangles should be reordered to optimize the use
+  of the GPU vertex cache. This is disabled by default, and can be
+  enabled by setting the COIN_OPTIMIZE_VERTEX_CACHE environment
+  variable to 1.
+*/
+SbBool
+SoVertexArrayIndexer::shouldOptimizeVertexCache(void)
+{
+  if (vertexcache_optimize < 0) {
+    const char * env = coin_getenv("COIN_OPTIMIZE_VERTEX_CACHE");
+    vertexcache_optimize = env ? atoi(env) : 0;
+  }
+  return vertexcache_optimize != 0;
+}
+
 //
 // sort lines to optimize rendering
 //
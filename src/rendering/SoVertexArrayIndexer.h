@@ -74,10 +74,13 @@ public:
   const GLint * getIndices(void) const;
   GLint * getWriteableIndices(void);
 
+  static SbBool shouldOptimizeVertexCache(void);
+
 private:
   void addIndex(int32_t i);
   void sort_triangles(void);
   void sort_lines(void);
+  void optimize_triangles(void);
   SoVertexArrayIndexer * getNext(void);
 
   GLenum target;
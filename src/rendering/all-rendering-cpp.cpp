@@ -35,8 +35,11 @@
 #include "SoGLBigImage.cpp"
 #include "SoGLCubeMapImage.cpp"
 #include "SoGLDriverDatabase.cpp"
+#include "SoGLGlyphAtlas.cpp"
 #include "SoGLImage.cpp"
+#include "SoGLLODBudget.cpp"
 #include "SoGLNurbs.cpp"
+#include "SoGLRenderStatistics.cpp"
 #include "SoOffscreenCGData.cpp"
 #include "SoOffscreenGLXData.cpp"
 #include "SoOffscreenRenderer.cpp"
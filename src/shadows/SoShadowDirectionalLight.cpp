@@ -52,6 +52,14 @@
   setting your own shadow caster scene graph in the shadowMapScene
   field.
 
+  For large scenes seen from a low viewpoint, a single shadow map
+  spread over the whole view volume gives too little precision close
+  to the camera. Setting \a numCascades to a value > 1 will split the
+  view volume into several depth slices (cascades), each with its own
+  shadow map. The slices nearest the camera are the smallest, so
+  nearby shadows are rendered with much higher precision. Each
+  cascade uses one texture unit while rendering.
+
   The example scene graph below demonstrates how you can use this node
   to create shadows on a large number of objects, and still get decent
   precision when zooming in. To further reduce the volume covered by
@@ -131,6 +139,19 @@
   calculating the resulting shadow volume.
 */
 
+/*!
+  \var SoSFInt32 SoShadowDirectionalLight::numCascades
+
+  The number of shadow maps (cascades) the view volume will be split
+  into. The split distances are a blend of a logarithmic and a uniform
+  distribution between the near plane of the view volume and \a
+  maxShadowDistance, or the far plane when \a maxShadowDistance is not
+  set or lies beyond it. Values are clamped to the range [1, 4].
+  Default value is 1.
+
+  \since Coin 4.1
+*/
+
 // *************************************************************************
 
 #include <Inventor/annex/FXViz/nodes/SoShadowDirectionalLight.h>
@@ -155,6 +176,7 @@ SoShadowDirectionalLight::SoShadowDirectionalLight(void)
   SO_NODE_ADD_FIELD(maxShadowDistance, (-1.0f));
   SO_NODE_ADD_FIELD(bboxCenter, (0.0f, 0.0f, 0.0f));
   SO_NODE_ADD_FIELD(bboxSize, (-1.0f, -1.0f, -1.0f));
+  SO_NODE_ADD_FIELD(numCascades, (1));
 }
 
 /*!
@@ -192,4 +214,14 @@ BOOST_AUTO_TEST_CASE(initialized)
   node->unref();
 }
 
+BOOST_AUTO_TEST_CASE(defaultNumCascades)
+{
+  SoShadowDirectionalLight * node = new SoShadowDirectionalLight;
+  node->ref();
+  BOOST_CHECK_EQUAL(node->numCascades.getValue(), 1);
+  BOOST_CHECK_MESSAGE(node->numCascades.isDefault(),
+                      "numCascades should not be written by default");
+  node->unref();
+}
+
 #endif // COIN_TEST_SUITE
@@ -172,7 +172,19 @@
 /*!
   \var SoSFBool SoShadowGroup::shadowCachingEnabled
 
-  Not used yet. Provided for TGS Inventor compatibility.
+  When TRUE, the shadow map of an SoShadowDirectionalLight is fitted
+  to a volume somewhat larger (1.25 times) than what is currently
+  visible, and the shadow camera fields are only written when the
+  visible volume moves outside that box or gets much smaller than it.
+  The shadow map is then reused while the camera moves around, which
+  trades some shadow map precision for a large reduction in rendering
+  time for mostly static scenes. When FALSE, the shadow map is fitted
+  exactly to the visible volume every frame. Default value is TRUE.
+
+  The margin can be changed with the environment variable
+  COIN_SHADOW_CACHE_GROW_FACTOR. Setting it to 1.0 makes the cached
+  shadow map fit exactly, so it is only reused while the visible
+  volume stays the same.
 */
 
 /*!
@@ -271,12 +283,28 @@
 // use to increase precision by one bit at the cost of some extra processing
 #define USE_NEGATIVE 1
 
+// the maximum number of cascades for an SoShadowDirectionalLight
+#define MAX_CASCADES 4
+
+// blend factor between logarithmic (1.0) and uniform (0.0) cascade splits
+#define CASCADE_SPLIT_LAMBDA 0.5f
+
+// when shadow caching is enabled, the shadow camera of a directional
+// light is fitted to a box this many times larger than the visible
+// volume (can be overridden with COIN_SHADOW_CACHE_GROW_FACTOR)
+#define CACHE_GROW_FACTOR 1.25f
+
+// the shadow camera is refitted when the visible volume gets
+// CACHE_MAX_SHRINK times smaller than the fitted box
+#define CACHE_MAX_SHRINK 2.0f
+
 // *************************************************************************
 
 #include <FXViz/nodes/SoShadowGroup.h>
 #include "coindefs.h"
 
 #include <cmath>
+#include <cstdlib>
 
 #include <Inventor/nodes/SoSpotLight.h>
 #include <Inventor/nodes/SoPointLight.h>
@@ -334,6 +362,7 @@
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/SbMatrix.h>
 #include <Inventor/C/glue/gl.h>
+#include <Inventor/C/tidbits.h>
 
 #include "nodes/SoSubNodeP.h"
 #include "shaders/SoShader.h"
@@ -352,7 +381,9 @@ public:
                      SoNode * scene,
                      SoNode * bboxscene,
                      const int gausskernelsize,
-                     const float gaussstandarddeviation)
+                     const float gaussstandarddeviation,
+                     const int cascadeindex,
+                     const int numcascades)
   {
     const cc_glglue * glue = cc_glglue_instance(SoGLCacheContextElement::get(state));
 
@@ -383,6 +414,8 @@ public:
     this->vsm_nearval = NULL;
     this->gaussmap = NULL;
     this->texunit = -1;
+    this->cascadeindex = cascadeindex;
+    this->numcascades = numcascades;
     this->bboxnode = new SoSeparator;
     this->bboxnode->ref();
 
@@ -398,6 +431,9 @@ public:
     this->fragment_lightplane = new SoShaderParameter4f;
     this->fragment_lightplane->ref();
 
+    this->fragment_cascadefar = new SoShaderParameter1f;
+    this->fragment_cascadefar->ref();
+
     this->maxshadowdistance = new SoShaderParameter1f;
     this->maxshadowdistance->ref();
 
@@ -499,6 +535,7 @@ public:
     if (this->shadowmapid) this->shadowmapid->unref();
     if (this->fragment_nearval) this->fragment_nearval->unref();
     if (this->fragment_lightplane) this->fragment_lightplane->unref();
+    if (this->fragment_cascadefar) this->fragment_cascadefar->unref();
     if (this->light) this->light->unref();
     if (this->path) this->path->unref();
     if (this->gaussmap) this->gaussmap->unref();
@@ -572,6 +609,8 @@ public:
     return 1;
   }
   SbBox3f toCameraSpace(const SbXfBox3f & worldbox) const;
+  SbBox3f getCascadeBox(const SbViewVolume & vv, const float farv, const SbXfBox3f & worldbox);
+  SbBool isFittedBoxValid(const SbBox3f & visiblebox) const;
   static void shadowmap_glcallback(void * closure, SoAction * action);
   static void shadowmap_post_glcallback(void * closure, SoAction * action);
   void createVSMProgram(void);
@@ -589,6 +628,9 @@ public:
   float nearval;
   int texunit;
   int lightid;
+  int cascadeindex;
+  int numcascades;
+  SbBox3f fittedbox;
 
   SoSeparator * bboxnode;
   SoShaderProgram * vsm_program;
@@ -598,6 +640,7 @@ public:
   SoShaderParameter1f * fragment_farval;
   SoShaderParameter1f * fragment_nearval;
   SoShaderParameter4f * fragment_lightplane;
+  SoShaderParameter1f * fragment_cascadefar;
   SoShaderGenerator vsm_vertex_generator;
   SoShaderGenerator vsm_fragment_generator;
   SoShaderParameter1f * maxshadowdistance;
@@ -694,6 +737,13 @@ public:
       perpixelother = TRUE;
     }
   }
+  static int getNumShadowMaps(SoLight * light) {
+    if (light->isOfType(SoShadowDirectionalLight::getClassTypeId())) {
+      SoShadowDirectionalLight * sl = static_cast<SoShadowDirectionalLight*> (light);
+      return SbClamp(static_cast<int>(sl->numCascades.getValue()), 1, MAX_CASCADES);
+    }
+    return 1;
+  }
   void deleteShadowLights(void) {
     for (int i = 0; i < this->shadowlights.getLength(); i++) {
       delete this->shadowlights[i];
@@ -1009,18 +1059,30 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
     int maxlights = maxunits - this->numtexunitsinscene;
     SbList <SoTempPath*> & pl = this->lightpaths;
 
+    // a light needs one shadow map (and texture unit) per cascade
     int numlights = 0;
+    SbBool layoutchanged = FALSE;
     for (i = 0; i < pl.getLength(); i++) {
       SoLight * light = (SoLight*)((SoFullPath*)(pl[i]))->getTail();
-      if (light->on.getValue() && (numlights < maxlights)) numlights++;
+      const int nummaps = getNumShadowMaps(light);
+      if (light->on.getValue() && (numlights + nummaps <= maxlights)) {
+        for (int c = 0; c < nummaps; c++) {
+          if (numlights < this->shadowlights.getLength()) {
+            SoShadowLightCache * cache = this->shadowlights[numlights];
+            if (cache->light != light || cache->numcascades != nummaps) layoutchanged = TRUE;
+          }
+          numlights++;
+        }
+      }
     }
-    if (numlights != this->shadowlights.getLength()) {
+    if (layoutchanged || (numlights != this->shadowlights.getLength())) {
       // just delete and recreate all if the number of spot lights have changed
       this->deleteShadowLights();
       int id = lightidoffset;
       for (i = 0; i < pl.getLength(); i++) {
         SoLight * light = (SoLight*)((SoFullPath*)pl[i])->getTail();
-        if (light->on.getValue() && (this->shadowlights.getLength() < maxlights)) {
+        const int nummaps = getNumShadowMaps(light);
+        if (light->on.getValue() && (this->shadowlights.getLength() + nummaps <= maxlights)) {
           SoNode * scene = PUBLIC(this);
           SoNode * bboxscene = PUBLIC(this);
           if (light->isOfType(SoShadowSpotLight::getClassTypeId())) {
@@ -1035,14 +1097,19 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
               scene = sl->shadowMapScene.getValue();
             }
           }
-          SoShadowLightCache * cache = new SoShadowLightCache(state, pl[i],
-                                                              PUBLIC(this),
-                                                              scene,
-                                                              bboxscene,
-                                                              gaussmatrixsize,
-                                                              gaussstandarddeviation);
-          cache->lightid = id++;
-          this->shadowlights.append(cache);
+          for (int c = 0; c < nummaps; c++) {
+            SoShadowLightCache * cache = new SoShadowLightCache(state, pl[i],
+                                                                PUBLIC(this),
+                                                                scene,
+                                                                bboxscene,
+                                                                gaussmatrixsize,
+                                                                gaussstandarddeviation,
+                                                                c, nummaps);
+            // all cascades of a light share the same OpenGL light
+            cache->lightid = id;
+            this->shadowlights.append(cache);
+          }
+          id++;
         }
       }
     }
@@ -1052,25 +1119,29 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
     for (i = 0; i < pl.getLength(); i++) {
       SoPath * path = pl[i];
       SoLight * light = (SoLight*) ((SoFullPath*)path)->getTail();
-      if (light->on.getValue() && (i2 < maxlights)) {
-        SoShadowLightCache * cache = this->shadowlights[i2];
-        int unit = (maxunits - 1) - i2;
-        int lightid = id++;
-        if (unit != cache->texunit || lightid != cache->lightid) {
-          if (this->vertexshadercache) this->vertexshadercache->invalidate();
-          if (this->fragmentshadercache) this->fragmentshadercache->invalidate();
-          cache->texunit = unit;
-          cache->lightid = lightid;
-        }
-        if (*(cache->path) != *path) {
-          cache->path->unref();
-          cache->path = path->copy();
-        }
-        if (cache->light->isOfType(SoSpotLight::getClassTypeId())) {
-          this->matrixaction.apply(path);
-          this->updateSpotCamera(state, cache, this->matrixaction.getMatrix());
+      const int nummaps = getNumShadowMaps(light);
+      if (light->on.getValue() && (i2 + nummaps <= maxlights)) {
+        const int lightid = id++;
+        for (int c = 0; c < nummaps; c++) {
+          SoShadowLightCache * cache = this->shadowlights[i2];
+          int unit = (maxunits - 1) - i2;
+          if (unit != cache->texunit || lightid != cache->lightid) {
+            if (this->vertexshadercache) this->vertexshadercache->invalidate();
+            if (this->fragmentshadercache) this->fragmentshadercache->invalidate();
+            cache->texunit = unit;
+            cache->lightid = lightid;
+          }
+          if (*(cache->path) != *path) {
+            cache->path->unref();
+            cache->path = path->copy();
+            cache->path->ref();
+          }
+          if (cache->light->isOfType(SoSpotLight::getClassTypeId())) {
+            this->matrixaction.apply(path);
+            this->updateSpotCamera(state, cache, this->matrixaction.getMatrix());
+          }
+          i2++;
         }
-        i2++;
       }
     }
     this->shadowlightsvalid = TRUE;
@@ -1118,6 +1189,87 @@ SoShadowGroupP::calcBBox(SoShadowLightCache * cache)
   return this->bboxaction.getXfBoundingBox();
 }
 
+// returns the distance from the eye where cascade number idx starts
+static float
+cascade_split(const float nearval, const float farval, const int idx, const int num)
+{
+  if (idx <= 0) return nearval;
+  if (idx >= num) return farval;
+
+  const float t = float(idx) / float(num);
+  const float uniformsplit = nearval + (farval - nearval) * t;
+  if (nearval <= 0.0f) return uniformsplit;
+  const float logsplit = nearval * float(pow(double(farval / nearval), double(t)));
+  return CASCADE_SPLIT_LAMBDA * logsplit + (1.0f - CASCADE_SPLIT_LAMBDA) * uniformsplit;
+}
+
+// returns how much larger than the visible volume the shadow camera
+// of a cached directional light is fitted (1.0 means an exact fit)
+static float
+shadow_cache_grow_factor(void)
+{
+  static float factor = -1.0f;
+  if (factor < 0.0f) {
+    const char * env = coin_getenv("COIN_SHADOW_CACHE_GROW_FACTOR");
+    factor = env ? SbMax(float(atof(env)), 1.0f) : CACHE_GROW_FACTOR;
+  }
+  return factor;
+}
+
+// Calculates the part of the scene bounding box covered by this
+// cascade's depth slice of the view volume, when the volume is split
+// between its near plane and the shadow far distance farv. Also
+// updates the fragment shader distance used for selecting the
+// cascade.
+SbBox3f
+SoShadowLightCache::getCascadeBox(const SbViewVolume & vv, const float farv, const SbXfBox3f & worldbox)
+{
+  const float nearv = vv.getNearDist();
+  const float d0 = cascade_split(nearv, farv, this->cascadeindex, this->numcascades);
+  const float d1 = cascade_split(nearv, farv, this->cascadeindex + 1, this->numcascades);
+
+  if (this->fragment_cascadefar->value.getValue() != d1) {
+    this->fragment_cascadefar->value = d1;
+  }
+
+  SbBox3f slice;
+  for (int i = 0; i < 4; i++) {
+    const SbVec2f corner(float(i & 1), float((i >> 1) & 1));
+    slice.extendBy(vv.getPlanePoint(d0, corner));
+    slice.extendBy(vv.getPlanePoint(d1, corner));
+  }
+  const SbBox3f scenebox = worldbox.project();
+  for (int k = 0; k < 3; k++) {
+    slice.getMin()[k] = SbMax(slice.getMin()[k], scenebox.getMin()[k]);
+    slice.getMax()[k] = SbMin(slice.getMax()[k], scenebox.getMax()[k]);
+    if (slice.getMin()[k] > slice.getMax()[k]) {
+      slice.makeEmpty();
+      break;
+    }
+  }
+  return slice;
+}
+
+// Returns TRUE if the shadow camera fitted to fittedbox can still be
+// used for the currently visible volume.
+SbBool
+SoShadowLightCache::isFittedBoxValid(const SbBox3f & visiblebox) const
+{
+  if (this->fittedbox.isEmpty()) return FALSE;
+  if (shadow_cache_grow_factor() <= 1.0f) {
+    // no slack, only reuse an identical fit
+    return visiblebox == this->fittedbox;
+  }
+  for (int k = 0; k < 3; k++) {
+    if (visiblebox.getMin()[k] < this->fittedbox.getMin()[k] ||
+        visiblebox.getMax()[k] > this->fittedbox.getMax()[k]) return FALSE;
+  }
+  // refit when zooming in to avoid losing too much precision
+  return
+    visiblebox.getSize().length() * CACHE_MAX_SHRINK >=
+    this->fittedbox.getSize().length();
+}
+
 SbBox3f
 SoShadowLightCache::toCameraSpace(const SbXfBox3f & worldbox) const
 {
@@ -1145,14 +1297,18 @@ SoShadowGroupP::updateSpotCamera(SoState * COIN_UNUSED_ARG(state), SoShadowLight
   transform.multDirMatrix(dir, dir);
   (void) dir.normalize();
   float cutoff = light->cutOffAngle.getValue();
-  cam->position.setValue(pos);
+  // only touch the camera fields when needed, since any change will
+  // trigger a new rendering of the shadow map
+  if (cam->position.getValue() != pos) cam->position.setValue(pos);
   // the maximum heightAngle we can render with a camera is < PI/2,.
   // The max cutoff is therefore PI/4. Some slack is needed, and 0.78
   // is about the maximum angle we can do.
   if (cutoff > 0.78f) cutoff = 0.78f;
 
-  cam->orientation.setValue(SbRotation(SbVec3f(0.0f, 0.0f, -1.0f), dir));
-  static_cast<SoPerspectiveCamera*> (cam)->heightAngle.setValue(cutoff * 2.0f);
+  const SbRotation rot(SbVec3f(0.0f, 0.0f, -1.0f), dir);
+  if (cam->orientation.getValue() != rot) cam->orientation.setValue(rot);
+  SoSFFloat & heightangle = static_cast<SoPerspectiveCamera*> (cam)->heightAngle;
+  if (heightangle.getValue() != cutoff * 2.0f) heightangle.setValue(cutoff * 2.0f);
   SoShadowGroup::VisibilityFlag visflag = (SoShadowGroup::VisibilityFlag) PUBLIC(this)->visibilityFlag.getValue();
 
   float visnear = PUBLIC(this)->visibilityNearRadius.getValue();
@@ -1246,15 +1402,22 @@ SoShadowGroupP::updateDirectionalCamera(SoState * state, SoShadowLightCache * ca
   dir.normalize();
   transform.multDirMatrix(dir, dir);
   dir.normalize();
-  cam->orientation.setValue(SbRotation(SbVec3f(0.0f, 0.0f, -1.0f), dir));
+  const SbRotation rot(SbVec3f(0.0f, 0.0f, -1.0f), dir);
+  if (cam->orientation.getValue() != rot) {
+    cam->orientation.setValue(rot);
+    cache->fittedbox.makeEmpty();
+  }
 
-  SbViewVolume vv = SoViewVolumeElement::get(state);
+  const SbViewVolume & fullvv = SoViewVolumeElement::get(state);
+  SbViewVolume vv = fullvv;
+  float shadowfar = fullvv.getNearDist() + fullvv.getDepth();
   const SbXfBox3f & worldbox = this->calcBBox(cache);
   SbBool visible = TRUE;
   if (maxdist > 0.0f) {
     float nearv = vv.getNearDist();
     if (maxdist < nearv) visible = FALSE;
     else {
+      if (maxdist < shadowfar) shadowfar = maxdist;
       maxdist -= nearv;
       float depth = vv.getDepth();
       if (maxdist > depth) maxdist = depth;
@@ -1263,27 +1426,48 @@ SoShadowGroupP::updateDirectionalCamera(SoState * state, SoShadowLightCache * ca
   }
   SbBox3f isect;
   if (visible) {
-    isect = vv.intersectionBox(worldbox);
+    if (cache->numcascades > 1) isect = cache->getCascadeBox(fullvv, shadowfar, worldbox);
+    else isect = vv.intersectionBox(worldbox);
     if (isect.isEmpty()) visible = FALSE;
   }
   if (!visible) {
     if (cache->depthmap->scene.getValue() == cache->depthmapscene) {
       cache->depthmap->scene = new SoInfo;
     }
+    cache->fittedbox.makeEmpty();
     return;
   }
   if (cache->depthmap->scene.getValue() != cache->depthmapscene) {
     cache->depthmap->scene = cache->depthmapscene;
   }
-  cam->viewBoundingBox(isect, 1.0f, 1.0f);
+
+  if (!PUBLIC(this)->shadowCachingEnabled.getValue()) {
+    cam->viewBoundingBox(isect, 1.0f, 1.0f);
+  }
+  else if (!cache->isFittedBoxValid(isect)) {
+    // fit to a larger box so that the shadow map can be reused while
+    // the camera moves around inside it
+    SbVec3f center = isect.getCenter();
+    SbVec3f halfsize = isect.getSize() * (0.5f * shadow_cache_grow_factor());
+    const SbBox3f scenebox = worldbox.project();
+    SbBox3f fitbox(center - halfsize, center + halfsize);
+    for (int k = 0; k < 3; k++) {
+      fitbox.getMin()[k] = SbMax(fitbox.getMin()[k], scenebox.getMin()[k]);
+      fitbox.getMax()[k] = SbMin(fitbox.getMax()[k], scenebox.getMax()[k]);
+    }
+    cache->fittedbox = fitbox;
+    cam->viewBoundingBox(fitbox, 1.0f, 1.0f);
+  }
 
   SbBox3f box = cache->toCameraSpace(worldbox);
 
   // Bounding box was calculated in camera space, so we need to "flip"
   // the box (because camera is pointing in the (0,0,-1) direction
   // from origo. Add a little slack (multiply by 1.01)
-  cam->nearDistance = -box.getMax()[2]*1.01f;
-  cam->farDistance = -box.getMin()[2]*1.01f;
+  const float newnear = -box.getMax()[2]*1.01f;
+  const float newfar = -box.getMin()[2]*1.01f;
+  if (cam->nearDistance.getValue() != newnear) cam->nearDistance = newnear;
+  if (cam->farDistance.getValue() != newfar) cam->farDistance = newfar;
 
   SbPlane plane(dir, cam->position.getValue());
   // move to eye space
@@ -1436,7 +1620,7 @@ SoShadowGroupP::setVertexShader(SoState * state)
     str.sprintf("varying vec4 shadowCoord%d;", i);
     gen.addDeclaration(str, FALSE);
 
-    if (!perpixelspot) {
+    if (!perpixelspot && this->shadowlights[i]->cascadeindex == 0) {
       str.sprintf("varying vec3 spotVertexColor%d;", i);
       gen.addDeclaration(str, FALSE);
     }
@@ -1514,7 +1698,7 @@ SoShadowGroupP::setVertexShader(SoState * state)
     str.sprintf("shadowCoord%d = gl_TextureMatrix[%d] * pos;\n", i, cache->texunit); // in light space
     gen.addMainStatement(str);
 
-    if (!perpixelspot) {
+    if (!perpixelspot && cache->cascadeindex == 0) {
       spotlight = TRUE;
       addSpotLight(gen, cache->lightid);
       str.sprintf("spotVertexColor%d = \n"
@@ -1636,10 +1820,14 @@ SoShadowGroupP::setFragmentShader(SoState * state)
     str.sprintf("varying vec4 shadowCoord%d;", i);
     gen.addDeclaration(str, FALSE);
 
-    if (!perpixelspot) {
+    if (!perpixelspot && this->shadowlights[i]->cascadeindex == 0) {
       str.sprintf("varying vec3 spotVertexColor%d;", i);
       gen.addDeclaration(str, FALSE);
     }
+    if (this->shadowlights[i]->numcascades > 1) {
+      str.sprintf("uniform float cascadefar%d;", i);
+      gen.addDeclaration(str, FALSE);
+    }
     if (this->shadowlights[i]->light->isOfType(SoDirectionalLight::getClassTypeId())) {
       str.sprintf("uniform vec4 lightplane%d;", i);
       gen.addDeclaration(str, FALSE);
@@ -1689,6 +1877,8 @@ SoShadowGroupP::setFragmentShader(SoState * state)
     SbBool dirlight = FALSE;
     for (i = 0; i < numshadowlights; i++) {
       SoShadowLightCache * cache = this->shadowlights[i];
+      // the following cascades are handled together with the first one
+      if (cache->cascadeindex > 0) continue;
       SbBool dirshadow = FALSE;
       SbString str;
       SbBool normalspot = FALSE;
@@ -1712,8 +1902,10 @@ SoShadowGroupP::setFragmentShader(SoState * state)
         dirlight = TRUE;
       }
       if (dirshadow) {
-        str.sprintf("dist = dot(ecPosition3.xyz, lightplane%d.xyz) - lightplane%d.w;\n", i,i);
-        gen.addMainStatement(str);
+        if (cache->numcascades == 1) {
+          str.sprintf("dist = dot(ecPosition3.xyz, lightplane%d.xyz) - lightplane%d.w;\n", i,i);
+          gen.addMainStatement(str);
+        }
         addDirectionalLight(gen, cache->lightid);
       }
       else {
@@ -1724,20 +1916,36 @@ SoShadowGroupP::setFragmentShader(SoState * state)
           addDirSpotLight(gen, cache->lightid, TRUE);
         }
       }
-      str.sprintf("coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n", i , i);
-      gen.addMainStatement(str);
-      str.sprintf("map = texture2D(shadowMap%d, coord.xy);\n", i);
-      gen.addMainStatement(str);
+      if (cache->numcascades > 1) {
+        gen.addMainStatement("shadeFactor = 1.0;\n");
+      }
+      for (int c = 0; c < cache->numcascades; c++) {
+        // select the cascade based on the eye space depth of the fragment
+        const int j = i + c;
+        if (cache->numcascades > 1) {
+          str.sprintf("%s (-ecPosition3.z < cascadefar%d) {\n"
+                      "dist = dot(ecPosition3.xyz, lightplane%d.xyz) - lightplane%d.w;\n",
+                      c == 0 ? "if" : "else if", j, j, j);
+          gen.addMainStatement(str);
+        }
+        str.sprintf("coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n", j , j);
+        gen.addMainStatement(str);
+        str.sprintf("map = texture2D(shadowMap%d, coord.xy);\n", j);
+        gen.addMainStatement(str);
 #ifdef USE_NEGATIVE
-      gen.addMainStatement("map = (map + vec4(1.0)) * 0.5;\n");
+        gen.addMainStatement("map = (map + vec4(1.0)) * 0.5;\n");
 #endif // USE_NEGATIVE
 #ifdef DISTRIBUTE_FACTOR
-      gen.addMainStatement("map.xy += map.zw / DISTRIBUTE_FACTOR;\n");
+        gen.addMainStatement("map.xy += map.zw / DISTRIBUTE_FACTOR;\n");
 #endif
-      str.sprintf("shadeFactor = ((map.x < 0.9999) && (shadowCoord%d.z > -1.0 %s) "
-                  "? VsmLookup(map, (dist - nearval%d) / (farval%d - nearval%d), EPSILON, THRESHOLD) : 1.0;\n",
-                  i, insidetest.getString(),i,i,i);
-      gen.addMainStatement(str);
+        str.sprintf("shadeFactor = ((map.x < 0.9999) && (shadowCoord%d.z > -1.0 %s) "
+                    "? VsmLookup(map, (dist - nearval%d) / (farval%d - nearval%d), EPSILON, THRESHOLD) : 1.0;\n",
+                    j, insidetest.getString(),j,j,j);
+        gen.addMainStatement(str);
+        if (cache->numcascades > 1) {
+          gen.addMainStatement("}\n");
+        }
+      }
 
       if (dirshadow) {
         SoShadowDirectionalLight * sl = static_cast<SoShadowDirectionalLight*> (light);
@@ -1796,9 +2004,12 @@ SoShadowGroupP::setFragmentShader(SoState * state)
 
   else {
     for (i = 0; i < numshadowlights; i++) {
+      SoShadowLightCache * cache = this->shadowlights[i];
+      // the following cascades are handled together with the first one
+      if (cache->cascadeindex > 0) continue;
       SbString insidetest = "&& coord.x >= 0.0 && coord.x <= 1.0 && coord.y >= 0.0 && coord.y <= 1.0)";
 
-      SoLight * light = this->shadowlights[i]->light;
+      SoLight * light = cache->light;
       if (light->isOfType(SoSpotLight::getClassTypeId())) {
         SoSpotLight * sl = static_cast<SoSpotLight*> (light);
         if (sl->dropOffRate.getValue() >= 0.0f) {
@@ -1806,18 +2017,32 @@ SoShadowGroupP::setFragmentShader(SoState * state)
         }
       }
       SbString str;
-      str.sprintf("dist = length(vec3(gl_LightSource[%d].position) - ecPosition3);\n"
-                  "coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n"
-                  "map = texture2D(shadowMap%d, coord.xy);\n"
+      if (cache->numcascades > 1) {
+        gen.addMainStatement("shadeFactor = 1.0;\n");
+      }
+      for (int c = 0; c < cache->numcascades; c++) {
+        const int j = i + c;
+        if (cache->numcascades > 1) {
+          str.sprintf("%s (-ecPosition3.z < cascadefar%d) {\n", c == 0 ? "if" : "else if", j);
+          gen.addMainStatement(str);
+        }
+        str.sprintf("dist = length(vec3(gl_LightSource[%d].position) - ecPosition3);\n"
+                    "coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n"
+                    "map = texture2D(shadowMap%d, coord.xy);\n"
 #ifdef USE_NEGATIVE
-                  "map = (map + vec4(1.0)) * 0.5;\n"
+                    "map = (map + vec4(1.0)) * 0.5;\n"
 #endif // USE_NEGATIVE
 #ifdef DISTRIBUTE_FACTOR
-                  "map.xy += map.zw / DISTRIBUTE_FACTOR;\n"
+                    "map.xy += map.zw / DISTRIBUTE_FACTOR;\n"
 #endif
-                  "shadeFactor = (shadowCoord%d.z > -1.0%s ? VsmLookup(map, (dist - nearval%d)/(farval%d-nearval%d), EPSILON, THRESHOLD) : 1.0;\n"
-                  "color += shadeFactor * spotVertexColor%d;\n",
-                  lights.getLength()+i, i , i, i, i,insidetest.getString(), i,i,i,i);
+                    "shadeFactor = (shadowCoord%d.z > -1.0%s ? VsmLookup(map, (dist - nearval%d)/(farval%d-nearval%d), EPSILON, THRESHOLD) : 1.0;\n",
+                    cache->lightid, j , j, j, j,insidetest.getString(), j,j,j);
+        gen.addMainStatement(str);
+        if (cache->numcascades > 1) {
+          gen.addMainStatement("}\n");
+        }
+      }
+      str.sprintf("color += shadeFactor * spotVertexColor%d;\n", i);
       gen.addMainStatement(str);
     }
   }
@@ -1958,7 +2183,7 @@ SoShadowGroupP::setFragmentShader(SoState * state)
     if (cache->light->isOfType(SoShadowDirectionalLight::getClassTypeId())) {
       SbString str;
       SoShadowDirectionalLight * sl = static_cast<SoShadowDirectionalLight*> (cache->light);
-      if (sl->maxShadowDistance.getValue() > 0.0f) {
+      if (sl->maxShadowDistance.getValue() > 0.0f && cache->cascadeindex == 0) {
         SoShaderParameter1f * maxdist = cache->maxshadowdistance;
         maxdist->value.connectFrom(&sl->maxShadowDistance);
         str.sprintf("maxshadowdistance%d", i);
@@ -1978,6 +2203,15 @@ SoShadowGroupP::setFragmentShader(SoState * state)
       }
       this->fragmentshader->parameter.set1Value(this->fragmentshader->parameter.getNum(), lightplane);
     }
+    if (cache->numcascades > 1) {
+      SoShaderParameter1f * cascadefar = cache->fragment_cascadefar;
+      SbString str;
+      str.sprintf("cascadefar%d", i);
+      if (cascadefar->name.getValue() != str) {
+        cascadefar->name = str;
+      }
+      this->fragmentshader->parameter.set1Value(this->fragmentshader->parameter.getNum(), cascadefar);
+    }
   }
 
   this->shadowlightsvalid = TRUE;
@@ -2344,6 +2578,9 @@ SoShadowLightCache::shadowmap_post_glcallback(void * COIN_UNUSED_ARG(closure), S
 #undef PUBLIC
 #undef DISTRIBUTE_FACTOR
 #undef USE_NEGATIVE
+#undef MAX_CASCADES
+#undef CASCADE_SPLIT_LAMBDA
+#undef CACHE_MAX_SHRINK
 
 #ifdef COIN_TEST_SUITE
 
@@ -77,12 +77,14 @@
 #include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/elements/SoComplexityTypeElement.h>
 #include <Inventor/system/gl.h>
+#include <Inventor/threads/SbMutex.h>
 
 #include "coindefs.h" // COIN_OBSOLETED()
 #include "glue/GLUWrapper.h"
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGLNurbs.h"
 #include "rendering/SoGL.h"
+#include "tidbitsp.h"
 
 /*!
   \var SoSFInt32 SoIndexedNurbsSurface::numUControlPoints
@@ -135,10 +137,12 @@ public:
     this->owner = m;
     this->nurbsrenderer = NULL;
     this->offscreenctx = NULL;
+    this->cache = NULL;
   }
 
   ~SoIndexedNurbsSurfaceP()
   {
+    if (this->cache) this->cache->unref();
     if (this->offscreenctx) { cc_glglue_context_destruct(this->offscreenctx); }
     if (this->nurbsrenderer) {
       GLUWrapper()->gluDeleteNurbsRenderer(this->nurbsrenderer);
@@ -147,13 +151,39 @@ public:
 
   void * offscreenctx;
   void * nurbsrenderer;
+  SoNurbsSurfaceCache * cache;
 
   void doNurbs(SoAction * action, const SbBool glrender);
+  SoNurbsSurfaceCache * tessellate(SoAction * action);
+  void unrefCache(SoNurbsSurfaceCache * cache);
+
+  // class-wide, like the primitive vertex cache lock in SoShape
+  static SbMutex * mutex;
+
+#ifdef COIN_THREADSAFE
+  void lock(void) { SoIndexedNurbsSurfaceP::mutex->lock(); }
+  void unlock(void) { SoIndexedNurbsSurfaceP::mutex->unlock(); }
+#else // ! COIN_THREADSAFE
+  void lock(void) { }
+  void unlock(void) { }
+#endif // ! COIN_THREADSAFE
+
+  static void cleanup(void);
 
 private:
   SoIndexedNurbsSurface * owner;
 };
 
+SbMutex * SoIndexedNurbsSurfaceP::mutex = NULL;
+
+// called by atexit
+void
+SoIndexedNurbsSurfaceP::cleanup(void)
+{
+  delete SoIndexedNurbsSurfaceP::mutex;
+  SoIndexedNurbsSurfaceP::mutex = NULL;
+}
+
 #define PRIVATE(p) (p->pimpl)
 #define PUBLIC(p) (p->owner)
 
@@ -197,6 +227,11 @@ void
 SoIndexedNurbsSurface::initClass(void)
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoIndexedNurbsSurface, SO_FROM_INVENTOR_1);
+
+#ifdef COIN_THREADSAFE
+  SoIndexedNurbsSurfaceP::mutex = new SbMutex;
+#endif // COIN_THREADSAFE
+  coin_atexit((coin_atexit_f *)SoIndexedNurbsSurfaceP::cleanup, CC_ATEXIT_NORMAL);
 }
 
 /*!
@@ -249,14 +284,21 @@ SoIndexedNurbsSurface::GLRender(SoGLRenderAction * action)
   SoMaterialBundle mb(action);
   mb.sendFirst();
 
-  SbBool calcnormals = sogl_calculate_nurbs_normals();
-
-  if (!calcnormals) {
-    glEnable(GL_AUTO_NORMAL);
+  SoNurbsSurfaceCache * cache = PRIVATE(this)->tessellate(action);
+  if (cache) {
+    cache->render();
+    PRIVATE(this)->unrefCache(cache);
   }
-  PRIVATE(this)->doNurbs(action, TRUE);
-  if (!calcnormals) {
-    glDisable(GL_AUTO_NORMAL);
+  else {
+    SbBool calcnormals = sogl_calculate_nurbs_normals();
+
+    if (!calcnormals) {
+      glEnable(GL_AUTO_NORMAL);
+    }
+    PRIVATE(this)->doNurbs(action, TRUE);
+    if (!calcnormals) {
+      glDisable(GL_AUTO_NORMAL);
+    }
   }
 
   SoState * state = action->getState();
@@ -272,7 +314,8 @@ void
 SoIndexedNurbsSurface::rayPick(SoRayPickAction * action)
 {
   if (!this->shouldRayPick(action)) return;
-  if (GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
+  if (sogl_use_builtin_nurbs_tessellator(action->getState()) ||
+      GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
     SoShape::rayPick(action); // do normal generatePrimitives() pick
   }
   else {
@@ -314,7 +357,12 @@ SoIndexedNurbsSurface::sendPrimitive(SoAction * ,  SoPrimitiveVertex *)
 void
 SoIndexedNurbsSurface::generatePrimitives(SoAction * action)
 {
-  if (GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
+  SoNurbsSurfaceCache * cache = PRIVATE(this)->tessellate(action);
+  if (cache) {
+    SoNurbsP<SoIndexedNurbsSurface>::generateMesh(this, action, cache);
+    PRIVATE(this)->unrefCache(cache);
+  }
+  else if (GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
 
     // We've found that the SGI GLU NURBS renderer makes some OpenGL
     // calls even when in tessellate mode. So we need to set up an
@@ -346,6 +394,60 @@ SoIndexedNurbsSurface::createTriangleDetail(SoRayPickAction * /* action */,
 
 typedef SoNurbsP<SoIndexedNurbsSurface>::coin_nurbs_cbdata coin_ins_cbdata;
 
+//
+// tessellate the surface into the mesh cache. Returns the cache,
+// referenced by the caller, or NULL if the GLU tessellator should be
+// used instead.
+//
+SoNurbsSurfaceCache *
+SoIndexedNurbsSurfaceP::tessellate(SoAction * action)
+{
+  if (!sogl_use_builtin_nurbs_tessellator(action->getState())) return NULL;
+
+  SbBool texindex =
+    PUBLIC(this)->textureCoordIndex.getNum() &&
+    PUBLIC(this)->textureCoordIndex[0] >= 0;
+
+  // lock since the cache is shared among all threads, and replaced
+  // when it is no longer valid. The caller gets its own reference, so
+  // that another thread can replace the cache while it is in use.
+  this->lock();
+  const SbBool ok =
+    sogl_tessellate_nurbs_surface(action, PUBLIC(this), this->cache,
+                                  PUBLIC(this)->numUControlPoints.getValue(),
+                                  PUBLIC(this)->numVControlPoints.getValue(),
+                                  PUBLIC(this)->uKnotVector.getValues(0),
+                                  PUBLIC(this)->vKnotVector.getValues(0),
+                                  PUBLIC(this)->uKnotVector.getNum(),
+                                  PUBLIC(this)->vKnotVector.getNum(),
+                                  PUBLIC(this)->numSControlPoints.getValue(),
+                                  PUBLIC(this)->numTControlPoints.getValue(),
+                                  PUBLIC(this)->sKnotVector.getValues(0),
+                                  PUBLIC(this)->tKnotVector.getValues(0),
+                                  PUBLIC(this)->sKnotVector.getNum(),
+                                  PUBLIC(this)->tKnotVector.getNum(),
+                                  PUBLIC(this)->coordIndex.getNum(),
+                                  PUBLIC(this)->coordIndex.getValues(0),
+                                  texindex ? PUBLIC(this)->textureCoordIndex.getNum() : 0,
+                                  texindex ? PUBLIC(this)->textureCoordIndex.getValues(0) : NULL);
+  SoNurbsSurfaceCache * cache = ok ? this->cache : NULL;
+  if (cache) cache->ref();
+  this->unlock();
+  return cache;
+}
+
+//
+// release a cache returned by tessellate(). The reference count is
+// not atomic, so this must be done under the lock as well.
+//
+void
+SoIndexedNurbsSurfaceP::unrefCache(SoNurbsSurfaceCache * cache)
+{
+  this->lock();
+  cache->unref();
+  this->unlock();
+}
+
 void
 SoIndexedNurbsSurfaceP::doNurbs(SoAction * action, const SbBool glrender)
 {
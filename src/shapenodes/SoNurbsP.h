@@ -4,6 +4,8 @@
 
 #include <Inventor/SoPrimitiveVertex.h>
 
+#include "caches/SoNurbsSurfaceCache.h"
+
 class SoAction;
 
 template<class Master>
@@ -33,6 +35,9 @@ class SoNurbsP
   static void APIENTRY tessVertex(float * vertex, void * data);
   static void APIENTRY tessEnd(void * data);
 
+  static void generateMesh(Master * master, SoAction * action,
+                           const SoNurbsSurfaceCache * cache);
+
 };
 
 template<class Master>
@@ -78,6 +83,36 @@ SoNurbsP<Master>::tessEnd(void * data)
   cbdata->thisp->endShape();
 }
 
+// generates primitives from a surface tessellated by SoNurbsSurfaceCache
+template<class Master>
+void
+SoNurbsP<Master>::generateMesh(Master * master, SoAction * action,
+                               const SoNurbsSurfaceCache * cache)
+{
+  const int numu = cache->getNumU();
+  const int numv = cache->getNumV();
+  const SbVec3f * coords = cache->getCoords();
+  const SbVec3f * normals = cache->getNormals();
+  const SbVec4f * texcoords = cache->getTexCoords();
+
+  SoPrimitiveVertex vertex;
+  vertex.setMaterialIndex(0);
+  vertex.setDetail(NULL);
+  for (int l = 0; l < numv - 1; l++) {
+    master->beginShape(action, SoShape::TRIANGLE_STRIP, NULL);
+    for (int k = 0; k < numu; k++) {
+      for (int i = 1; i >= 0; i--) {
+        const int idx = (l + i) * numu + k;
+        vertex.setPoint(coords[idx]);
+        vertex.setNormal(normals[idx]);
+        vertex.setTextureCoords(texcoords[idx]);
+        master->shapeVertex(&vertex);
+      }
+    }
+    master->endShape();
+  }
+}
+
 //This function has specializations in implementation files, so be careful about reuse
 template<class Master>
 void APIENTRY
@@ -55,6 +55,14 @@
   Coordinate3 sets control points to have an equal weight of 1.0 (nonrational).
   Use Coordinate4 to specify x, y, z and weight values (rational).
 
+  Untrimmed surfaces are tessellated into a mesh which is cached in
+  the node, and only recomputed when the node, the coordinates or the
+  complexity change. The rows of a large surface are evaluated in
+  parallel, but different surfaces are tessellated one at a time, as
+  the scene graph is traversed sequentially. Set the environment
+  variable COIN_GLU_NURBS_TESSELLATOR to 1 to have GLU tessellate all
+  surfaces instead, as trimmed surfaces always are.
+
   A basic usage example:
 
   \code
@@ -121,11 +129,13 @@
 #include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/elements/SoComplexityTypeElement.h>
 #include <Inventor/system/gl.h>
+#include <Inventor/threads/SbMutex.h>
 
 #include "glue/GLUWrapper.h"
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGLNurbs.h"
 #include "rendering/SoGL.h"
+#include "tidbitsp.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 
 /*!
@@ -170,10 +180,12 @@ public:
     this->owner = m;
     this->nurbsrenderer = NULL;
     this->offscreenctx = NULL;
+    this->cache = NULL;
   }
 
   ~SoNurbsSurfaceP()
   {
+    if (this->cache) this->cache->unref();
     if (this->nurbsrenderer) {
       GLUWrapper()->gluDeleteNurbsRenderer(this->nurbsrenderer);
     }
@@ -182,13 +194,39 @@ public:
 
   void * offscreenctx;
   void * nurbsrenderer;
+  SoNurbsSurfaceCache * cache;
 
   void doNurbs(SoAction * action, const SbBool glrender);
+  SoNurbsSurfaceCache * tessellate(SoAction * action);
+  void unrefCache(SoNurbsSurfaceCache * cache);
+
+  // class-wide, like the primitive vertex cache lock in SoShape
+  static SbMutex * mutex;
+
+#ifdef COIN_THREADSAFE
+  void lock(void) { SoNurbsSurfaceP::mutex->lock(); }
+  void unlock(void) { SoNurbsSurfaceP::mutex->unlock(); }
+#else // ! COIN_THREADSAFE
+  void lock(void) { }
+  void unlock(void) { }
+#endif // ! COIN_THREADSAFE
+
+  static void cleanup(void);
 
 private:
   SoNurbsSurface * owner;
 };
 
+SbMutex * SoNurbsSurfaceP::mutex = NULL;
+
+// called by atexit
+void
+SoNurbsSurfaceP::cleanup(void)
+{
+  delete SoNurbsSurfaceP::mutex;
+  SoNurbsSurfaceP::mutex = NULL;
+}
+
 #define PRIVATE(p) (p->pimpl)
 #define PUBLIC(p) (p->owner)
 
@@ -230,6 +268,11 @@ void
 SoNurbsSurface::initClass(void)
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoNurbsSurface, SO_FROM_INVENTOR_1);
+
+#ifdef COIN_THREADSAFE
+  SoNurbsSurfaceP::mutex = new SbMutex;
+#endif // COIN_THREADSAFE
+  coin_atexit((coin_atexit_f *)SoNurbsSurfaceP::cleanup, CC_ATEXIT_NORMAL);
 }
 
 // Documented in superclass.
@@ -242,14 +285,21 @@ SoNurbsSurface::GLRender(SoGLRenderAction * action)
   SoMaterialBundle mb(action);
   mb.sendFirst();
 
-  SbBool calcnormals = sogl_calculate_nurbs_normals();
-
-  if (!calcnormals) {
-    glEnable(GL_AUTO_NORMAL);
+  SoNurbsSurfaceCache * cache = PRIVATE(this)->tessellate(action);
+  if (cache) {
+    cache->render();
+    PRIVATE(this)->unrefCache(cache);
   }
-  PRIVATE(this)->doNurbs(action, TRUE);
-  if (!calcnormals) {
-    glDisable(GL_AUTO_NORMAL);
+  else {
+    SbBool calcnormals = sogl_calculate_nurbs_normals();
+
+    if (!calcnormals) {
+      glEnable(GL_AUTO_NORMAL);
+    }
+    PRIVATE(this)->doNurbs(action, TRUE);
+    if (!calcnormals) {
+      glDisable(GL_AUTO_NORMAL);
+    }
   }
 
   SoState * state = action->getState();
@@ -309,7 +359,8 @@ SoNurbsSurface::rayPick(SoRayPickAction * action)
 {
   if (!this->shouldRayPick(action)) return;
 
-  if (GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
+  if (sogl_use_builtin_nurbs_tessellator(action->getState()) ||
+      GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
     SoShape::rayPick(action); // do normal generatePrimitives() pick
   }
   else {
@@ -351,7 +402,12 @@ SoNurbsSurface::sendPrimitive(SoAction *,  SoPrimitiveVertex *)
 void
 SoNurbsSurface::generatePrimitives(SoAction * action)
 {
-  if (GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
+  SoNurbsSurfaceCache * cache = PRIVATE(this)->tessellate(action);
+  if (cache) {
+    SoNurbsP<SoNurbsSurface>::generateMesh(this, action, cache);
+    PRIVATE(this)->unrefCache(cache);
+  }
+  else if (GLUWrapper()->versionMatchesAtLeast(1, 3, 0)) {
 
     // We've found that the SGI GLU NURBS renderer makes some OpenGL
     // calls even when in tessellate mode. So we need to set up an
@@ -383,6 +439,52 @@ SoNurbsSurface::createTriangleDetail(SoRayPickAction * /* action */,
 
 typedef SoNurbsP<SoNurbsSurface>::coin_nurbs_cbdata coin_ns_cbdata;
 
+//
+// tessellate the surface into the mesh cache. Returns the cache,
+// referenced by the caller, or NULL if the GLU tessellator should be
+// used instead.
+//
+SoNurbsSurfaceCache *
+SoNurbsSurfaceP::tessellate(SoAction * action)
+{
+  if (!sogl_use_builtin_nurbs_tessellator(action->getState())) return NULL;
+
+  // lock since the cache is shared among all threads, and replaced
+  // when it is no longer valid. The caller gets its own reference, so
+  // that another thread can replace the cache while it is in use.
+  this->lock();
+  const SbBool ok =
+    sogl_tessellate_nurbs_surface(action, PUBLIC(this), this->cache,
+                                  PUBLIC(this)->numUControlPoints.getValue(),
+                                  PUBLIC(this)->numVControlPoints.getValue(),
+                                  PUBLIC(this)->uKnotVector.getValues(0),
+                                  PUBLIC(this)->vKnotVector.getValues(0),
+                                  PUBLIC(this)->uKnotVector.getNum(),
+                                  PUBLIC(this)->vKnotVector.getNum(),
+                                  PUBLIC(this)->numSControlPoints.getValue(),
+                                  PUBLIC(this)->numTControlPoints.getValue(),
+                                  PUBLIC(this)->sKnotVector.getValues(0),
+                                  PUBLIC(this)->tKnotVector.getValues(0),
+                                  PUBLIC(this)->sKnotVector.getNum(),
+                                  PUBLIC(this)->tKnotVector.getNum());
+  SoNurbsSurfaceCache * cache = ok ? this->cache : NULL;
+  if (cache) cache->ref();
+  this->unlock();
+  return cache;
+}
+
+//
+// release a cache returned by tessellate(). The reference count is
+// not atomic, so this must be done under the lock as well.
+//
+void
+SoNurbsSurfaceP::unrefCache(SoNurbsSurfaceCache * cache)
+{
+  this->lock();
+  cache->unref();
+  this->unlock();
+}
+
 //
 // render or generate the NURBS surface
 //
@@ -466,3 +568,87 @@ SoNurbsSurfaceP::doNurbs(SoAction * action, const SbBool glrender)
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <cmath>
+
+namespace {
+  struct NurbsSurfaceTestData {
+    int numtriangles;
+    float maxerror;
+  };
+
+  void
+  nurbs_surface_test_triangle_cb(void * closure, SoCallbackAction *,
+                                 const SoPrimitiveVertex * v1,
+                                 const SoPrimitiveVertex * v2,
+                                 const SoPrimitiveVertex * v3)
+  {
+    NurbsSurfaceTestData * data = static_cast<NurbsSurfaceTestData *>(closure);
+    const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+    for (int i = 0; i < 3; i++) {
+      const SbVec3f & p = v[i]->getPoint();
+      const float err = static_cast<float>(fabs(p[2] - p[0] * p[0]));
+      if (err > data->maxerror) data->maxerror = err;
+    }
+    data->numtriangles++;
+  }
+
+  NurbsSurfaceTestData
+  nurbs_surface_test_tessellate(SoNode * root)
+  {
+    NurbsSurfaceTestData data = { 0, 0.0f };
+    SoCallbackAction cba;
+    cba.addTriangleCallback(SoNurbsSurface::getClassTypeId(),
+                            nurbs_surface_test_triangle_cb, &data);
+    cba.apply(root);
+    return data;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parabolicCylinder)
+{
+  // a quadratic Bezier patch in u, linear in v, describing z = x*x
+  // for x in [0, 1]
+  static const float pts[][3] = {
+    { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.0f, 0.0f }, { 1.0f, 0.0f, 1.0f },
+    { 0.0f, 1.0f, 0.0f }, { 0.5f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }
+  };
+  static const float uknots[] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+  static const float vknots[] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 0.2f;
+  root->addChild(complexity);
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setValues(0, 6, pts);
+  root->addChild(coords);
+  SoNurbsSurface * surface = new SoNurbsSurface;
+  surface->numUControlPoints = 3;
+  surface->numVControlPoints = 2;
+  surface->uKnotVector.setValues(0, 6, uknots);
+  surface->vKnotVector.setValues(0, 4, vknots);
+  root->addChild(surface);
+
+  NurbsSurfaceTestData coarse = nurbs_surface_test_tessellate(root);
+  BOOST_CHECK_MESSAGE(coarse.numtriangles > 0, "no triangles generated");
+  BOOST_CHECK_MESSAGE(coarse.maxerror < 1e-4f, "vertices not on the surface");
+
+  complexity->value = 1.0f;
+  NurbsSurfaceTestData fine = nurbs_surface_test_tessellate(root);
+  BOOST_CHECK_MESSAGE(fine.numtriangles > coarse.numtriangles,
+                      "higher complexity should refine the mesh");
+  BOOST_CHECK_MESSAGE(fine.maxerror < 1e-4f, "vertices not on the surface");
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
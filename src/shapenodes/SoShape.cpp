@@ -120,6 +120,7 @@
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
 #include "rendering/SoVBO.h"
+#include "rendering/SoGLRenderStatistics.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 
 // SoShape.cpp grew too big, so I had to move some code into new
@@ -588,6 +589,9 @@ SoShape::shouldGLRender(SoGLRenderAction * action)
     return FALSE;
   }
 
+  // the shape is rendered by one of the paths below
+  SoGLRenderStatistics::count(SoGLRenderAction::SHAPES_RENDERED);
+
   // test if we should sort triangles before rendering
   if (transparent && (shapestyleflags & SoShapeStyleElement::TRANSP_SORTED_TRIANGLES)) {
     // lock since pvcache is shared among all threads
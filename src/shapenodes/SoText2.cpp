@@ -101,6 +101,7 @@
 #include "coindefs.h"
 
 #include <climits>
+#include <cstdlib>
 #include <cstring>
 
 #ifdef HAVE_CONFIG_H
@@ -112,6 +113,7 @@
 #include <Inventor/SbPlane.h>
 #include <Inventor/SbString.h>
 #include <Inventor/SoPickedPoint.h>
+#include <Inventor/C/tidbits.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoGetPrimitiveCountAction.h>
 #include <Inventor/actions/SoRayPickAction.h>
@@ -141,6 +143,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "caches/SoGlyphCache.h"
+#include "rendering/SoGLGlyphAtlas.h"
 
 // The "lean and mean" define is a workaround for a Cygwin bug: when
 // windows.h is included _after_ one of the X11 or GLX headers above
@@ -214,11 +217,22 @@
 
 class SoText2P {
 public:
-  SoText2P(SoText2 * textnode) : maxwidth(0), master(textnode)
+  SoText2P(SoText2 * textnode) : maxwidth(0), atlasid(0), atlasfailed(FALSE), master(textnode)
   {
     this->bbox.makeEmpty();
   }
 
+  // a glyph in the glyph atlas, positioned relative to the start of
+  // its line
+  struct AtlasGlyph {
+    int line;
+    SbVec2s pos;
+    SbVec2s size;
+    SbVec2f texmin;
+    SbVec2f texmax;
+    SbBool mono;
+  };
+
   SbBool getQuad(SoState * state, SbVec3f & v0, SbVec3f & v1,
                  SbVec3f & v2, SbVec3f & v3);
   void flushGlyphCache();
@@ -226,7 +240,10 @@ public:
   SbBool shouldBuildGlyphCache(SoState * state);
   void dumpBuffer(unsigned char * buffer, SbVec2s size, SbVec2s pos, SbBool mono);
   void computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center);
+  SbBool buildAtlasGlyphs(SoGLGlyphAtlas * atlas, const cc_font_specification * fontspec);
+  SbBool collectAtlasGlyphs(SoGLGlyphAtlas * atlas, const cc_font_specification * fontspec);
   static void setRasterPos3f(GLfloat x, GLfloat y, GLfloat z);
+  static SbBool useGlyphAtlas(void);
 
 
   SbList <int> stringwidth;
@@ -234,6 +251,10 @@ public:
   SbList< SbList<SbVec2s> > positions;
   SbBox2s bbox;
 
+  SbList<AtlasGlyph> atlasglyphs;
+  uint32_t atlasid;
+  SbBool atlasfailed;
+
   SoGlyphCache * cache;
   SoFieldSensor * spacingsensor;
   SoFieldSensor * stringsensor;
@@ -414,122 +435,198 @@ SoText2::GLRender(SoGLRenderAction * action)
     // disable textures for all units
     SoGLMultiTextureEnabledElement::disableAll(state);
 
-    glPushAttrib(GL_ENABLE_BIT | GL_PIXEL_MODE_BIT | GL_COLOR_BUFFER_BIT);
+    glPushAttrib(GL_ENABLE_BIT | GL_PIXEL_MODE_BIT | GL_COLOR_BUFFER_BIT |
+                 GL_TEXTURE_BIT | GL_CURRENT_BIT);
     glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
 
     SbBool drawPixelBuffer = FALSE;
 
-    for (int i = 0; i < nrlines; i++) {
-      SbString str = this->string[i];
-      switch (this->justification.getValue()) {
-      case SoText2::LEFT:
-        xpos = 0;
-        break;
-      case SoText2::RIGHT:
-        xpos = PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i];
-        break;
-      case SoText2::CENTER:
-        xpos = (PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i]) / 2;
-        break;
+    // Use the per-context glyph atlas when possible, so that all
+    // glyphs in the node can be drawn as textured quads in a single
+    // batch instead of one glBitmap()/glDrawPixels() call per glyph.
+    SoGLGlyphAtlas * atlas = NULL;
+    if (SoText2P::useGlyphAtlas() && !PRIVATE(this)->atlasfailed) {
+      atlas = SoGLGlyphAtlas::getInstance(SoGLCacheContextElement::get(state));
+      atlas->bindTexture();
+      if (!PRIVATE(this)->buildAtlasGlyphs(atlas, fontspec)) atlas = NULL;
+    }
+
+    if (atlas) {
+      SbList <int> lineoffset;
+      for (int i = 0; i < nrlines; i++) {
+        switch (this->justification.getValue()) {
+        case SoText2::RIGHT:
+          lineoffset.append(PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i]);
+          break;
+        case SoText2::CENTER:
+          lineoffset.append((PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i]) / 2);
+          break;
+        default:
+          lineoffset.append(0);
+          break;
+        }
+      }
+
+      glEnable(GL_TEXTURE_2D);
+      glDisable(GL_TEXTURE_GEN_S);
+      glDisable(GL_TEXTURE_GEN_T);
+      glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+      glEnable(GL_ALPHA_TEST);
+      glAlphaFunc(GL_GREATER, 0.3f);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glMatrixMode(GL_TEXTURE);
+      glPushMatrix();
+      glLoadIdentity();
+
+      glColor4f(diffuse[0], diffuse[1], diffuse[2],
+                1.0f - SoLazyElement::getTransparency(state, 0));
+
+      // place the glyphs on the same pixels as the glBitmap() and
+      // glDrawPixels() code below would
+      const float z = -nilpoint[2];
+      const float grayx = (float) floor(textscreenoffsetx + 0.5f) - bbmin[0];
+      const float grayy = (float) floor(nilpoint[1] + 0.5f);
+      const float monoy = (float) ((int) nilpoint[1]);
+
+      glBegin(GL_QUADS);
+      for (int i = 0; i < PRIVATE(this)->atlasglyphs.getLength(); i++) {
+        const SoText2P::AtlasGlyph & g = PRIVATE(this)->atlasglyphs[i];
+        const int px = g.pos[0] + lineoffset[g.line];
+        float x0, y0;
+        if (g.mono) {
+          x0 = (float) floor(px + textscreenoffsetx);
+          y0 = g.pos[1] + monoy;
+        }
+        else {
+          x0 = px + grayx;
+          y0 = g.pos[1] + grayy;
+        }
+        const float x1 = x0 + g.size[0];
+        const float y1 = y0 + g.size[1];
+        glTexCoord2f(g.texmin[0], g.texmin[1]); glVertex3f(x0, y0, z);
+        glTexCoord2f(g.texmax[0], g.texmin[1]); glVertex3f(x1, y0, z);
+        glTexCoord2f(g.texmax[0], g.texmax[1]); glVertex3f(x1, y1, z);
+        glTexCoord2f(g.texmin[0], g.texmax[1]); glVertex3f(x0, y1, z);
       }
+      glEnd();
+
+      glPopMatrix();
+      glMatrixMode(GL_PROJECTION);
+    }
+    else {
+      for (int i = 0; i < nrlines; i++) {
+        SbString str = this->string[i];
+        switch (this->justification.getValue()) {
+        case SoText2::LEFT:
+          xpos = 0;
+          break;
+        case SoText2::RIGHT:
+          xpos = PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i];
+          break;
+        case SoText2::CENTER:
+          xpos = (PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i]) / 2;
+          break;
+        }
 
-      int kerningx = 0;
-      int kerningy = 0;
-      int advancex = 0;
-      int advancey = 0;
+        int kerningx = 0;
+        int kerningy = 0;
+        int advancex = 0;
+        int advancey = 0;
 
-      const char * p = str.getString();
-      size_t length = cc_string_utf8_validate_length(p);
+        const char * p = str.getString();
+        size_t length = cc_string_utf8_validate_length(p);
 
-      for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
-        uint32_t glyphidx = 0;
+        for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
+          uint32_t glyphidx = 0;
 
-        glyphidx = cc_string_utf8_get_char(p);
-        p = cc_string_utf8_next_char(p);
+          glyphidx = cc_string_utf8_get_char(p);
+          p = cc_string_utf8_next_char(p);
 
-        cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
+          cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
 
-        buffer = cc_glyph2d_getbitmap(glyph, bitmapsize, bitmappos);
+          buffer = cc_glyph2d_getbitmap(glyph, bitmapsize, bitmappos);
 
-        ix = bitmapsize[0];
-        iy = bitmapsize[1];
+          ix = bitmapsize[0];
+          iy = bitmapsize[1];
 
-        // Advance & Kerning
-        if (strcharidx > 0)
-          cc_glyph2d_getkerning(prevglyph, glyph, &kerningx, &kerningy);
-        cc_glyph2d_getadvance(glyph, &advancex, &advancey);
+          // Advance & Kerning
+          if (strcharidx > 0)
+            cc_glyph2d_getkerning(prevglyph, glyph, &kerningx, &kerningy);
+          cc_glyph2d_getadvance(glyph, &advancex, &advancey);
 
-        rasterx = xpos + kerningx + bitmappos[0];
-        rastery = ypos + (bitmappos[1] - bitmapsize[1]);
+          rasterx = xpos + kerningx + bitmappos[0];
+          rastery = ypos + (bitmappos[1] - bitmapsize[1]);
 
-        if (buffer) {
-          if (cc_glyph2d_getmono(glyph)) {
-            SoText2P::setRasterPos3f((float)rasterx + textscreenoffsetx, (float)rastery + (int)nilpoint[1], -nilpoint[2]);
-            glBitmap(ix,iy,0,0,0,0,(const GLubyte *)buffer);
-          }
-          else {
-            if (!drawPixelBuffer) {
-              int numpixels = bbsize[0] * bbsize[1];
-              if (numpixels > PRIVATE(this)->pixel_buffer_size) {
-                delete[] PRIVATE(this)->pixel_buffer;
-                PRIVATE(this)->pixel_buffer = new unsigned char[numpixels*4];
-                PRIVATE(this)->pixel_buffer_size = numpixels;
-              }
-              memset(PRIVATE(this)->pixel_buffer, 0, numpixels * 4);
-              drawPixelBuffer = TRUE;
+          if (buffer) {
+            if (cc_glyph2d_getmono(glyph)) {
+              SoText2P::setRasterPos3f((float)rasterx + textscreenoffsetx, (float)rastery + (int)nilpoint[1], -nilpoint[2]);
+              glBitmap(ix,iy,0,0,0,0,(const GLubyte *)buffer);
             }
-
-            int memx = rasterx - bbmin[0];
-            int memy = bbsize[1] - (bbmax[1] - rastery - 1) - 1;
-
-            if (memx >= 0 && memx + bitmapsize[0] <= bbsize[0] &&
-                memy >= 0 && memy + bitmapsize[1] <= bbsize[1]) {
-
-              unsigned char * dst = PRIVATE(this)->pixel_buffer + (memy * bbsize[0] + memx) * 4;
-              const unsigned char * src = buffer;
-              int nextlineoffset = (bbsize[0] - bitmapsize[0]) * 4;
-
-              // Ouch. This must lead to pretty slow rendering
-              for (int y = 0; y < iy; y++) {
-                for (int x = 0; x < ix; x++) {
-                  *dst++ = red; *dst++ = green; *dst++ = blue;
-                  // alpha from the gray level pixel value, blended with current value (because glyph bitmaps can overlap)
-                  int srcval = *src;
-                  int oldval = *dst;
-                  *dst = ((oldval * (256 - srcval) + alpha * srcval) >> 8);
-                  src++; dst++;
+            else {
+              if (!drawPixelBuffer) {
+                int numpixels = bbsize[0] * bbsize[1];
+                if (numpixels > PRIVATE(this)->pixel_buffer_size) {
+                  delete[] PRIVATE(this)->pixel_buffer;
+                  PRIVATE(this)->pixel_buffer = new unsigned char[numpixels*4];
+                  PRIVATE(this)->pixel_buffer_size = numpixels;
                 }
-                dst += nextlineoffset;
+                memset(PRIVATE(this)->pixel_buffer, 0, numpixels * 4);
+                drawPixelBuffer = TRUE;
               }
-            } else {
-              static SbBool once = TRUE;
-              if (once) {
-                SoDebugError::post("SoText2::GLRender",
-                                   "Unable to copy glyph to memory buffer. Position [%d,%d], size [%d,%d], buffer size [%d,%d]",
-                                   memx, memy, bitmapsize[0], bitmapsize[1], bbsize[0], bbsize[1]);
-                once = FALSE;
+
+              int memx = rasterx - bbmin[0];
+              int memy = bbsize[1] - (bbmax[1] - rastery - 1) - 1;
+
+              if (memx >= 0 && memx + bitmapsize[0] <= bbsize[0] &&
+                  memy >= 0 && memy + bitmapsize[1] <= bbsize[1]) {
+
+                unsigned char * dst = PRIVATE(this)->pixel_buffer + (memy * bbsize[0] + memx) * 4;
+                const unsigned char * src = buffer;
+                int nextlineoffset = (bbsize[0] - bitmapsize[0]) * 4;
+
+                // Ouch. This must lead to pretty slow rendering
+                for (int y = 0; y < iy; y++) {
+                  for (int x = 0; x < ix; x++) {
+                    *dst++ = red; *dst++ = green; *dst++ = blue;
+                    // alpha from the gray level pixel value, blended with current value (because glyph bitmaps can overlap)
+                    int srcval = *src;
+                    int oldval = *dst;
+                    *dst = ((oldval * (256 - srcval) + alpha * srcval) >> 8);
+                    src++; dst++;
+                  }
+                  dst += nextlineoffset;
+                }
+              } else {
+                static SbBool once = TRUE;
+                if (once) {
+                  SoDebugError::post("SoText2::GLRender",
+                                     "Unable to copy glyph to memory buffer. Position [%d,%d], size [%d,%d], buffer size [%d,%d]",
+                                     memx, memy, bitmapsize[0], bitmapsize[1], bbsize[0], bbsize[1]);
+                  once = FALSE;
+                }
               }
             }
           }
-        }
 
-        xpos += (advancex + kerningx);
+          xpos += (advancex + kerningx);
 
-        if (prevglyph) {
-          // should be safe to unref here. SoGlyphCache will have a
-          // ref'ed instance
-          cc_glyph2d_unref(prevglyph);
+          if (prevglyph) {
+            // should be safe to unref here. SoGlyphCache will have a
+            // ref'ed instance
+            cc_glyph2d_unref(prevglyph);
+          }
+          prevglyph = glyph;
         }
-        prevglyph = glyph;
-      }
 
-      ypos -= (int)(((int) fontsize) * this->spacing.getValue());
-    }
+        ypos -= (int)(((int) fontsize) * this->spacing.getValue());
+      }
 
-    if (prevglyph) {
-      // should be safe to unref here. SoGlyphCache will have a ref'ed
-      // instance
-      cc_glyph2d_unref(prevglyph);
+      if (prevglyph) {
+        // should be safe to unref here. SoGlyphCache will have a ref'ed
+        // instance
+        cc_glyph2d_unref(prevglyph);
+      }
     }
 
     if (drawPixelBuffer) {
@@ -702,6 +799,9 @@ SoText2P::flushGlyphCache()
   this->maxwidth=0;
   this->positions.truncate(0);
   this->bbox.makeEmpty();
+  this->atlasglyphs.truncate(0);
+  this->atlasid = 0;
+  this->atlasfailed = FALSE;
 }
 
 // Calculates a quad around the text in 3D.
@@ -967,6 +1067,84 @@ SoText2P::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
   center = box.getCenter();
 }
 
+// Looks up all glyphs in the atlas, uploading them if needed. The
+// result is kept until the glyph cache is rebuilt or the atlas id
+// changes. Returns FALSE if the string does not fit in the atlas.
+SbBool
+SoText2P::buildAtlasGlyphs(SoGLGlyphAtlas * atlas, const cc_font_specification * fontspec)
+{
+  if (this->atlasid == atlas->getId()) return TRUE;
+
+  // The atlas evicts all glyphs when it is full, which invalidates
+  // the texture coordinates collected so far. Start over once, with
+  // an empty atlas; if the id changes again, the string is too large
+  // to fit.
+  for (int attempt = 0; attempt < 2; attempt++) {
+    const uint32_t startid = atlas->getId();
+    if (!this->collectAtlasGlyphs(atlas, fontspec)) break;
+    if (atlas->getId() == startid) {
+      this->atlasid = startid;
+      return TRUE;
+    }
+  }
+  this->atlasglyphs.truncate(0);
+  this->atlasfailed = TRUE;
+  return FALSE;
+}
+
+// Helper for buildAtlasGlyphs(). Returns FALSE if a glyph could not be
+// put in the atlas.
+SbBool
+SoText2P::collectAtlasGlyphs(SoGLGlyphAtlas * atlas, const cc_font_specification * fontspec)
+{
+  this->atlasglyphs.truncate(0);
+  const int nrlines = PUBLIC(this)->string.getNum();
+  for (int i = 0; i < nrlines && i < this->positions.getLength(); i++) {
+    const char * p = PUBLIC(this)->string[i].getString();
+    size_t length = cc_string_utf8_validate_length(p);
+
+    for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
+      uint32_t glyphidx = cc_string_utf8_get_char(p);
+      p = cc_string_utf8_next_char(p);
+
+      // should be safe to unref right away. SoGlyphCache will have a
+      // ref'ed instance
+      cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
+      int bitmapsize[2];
+      int bitmappos[2];
+      const unsigned char * buffer = cc_glyph2d_getbitmap(glyph, bitmapsize, bitmappos);
+
+      if (buffer && bitmapsize[0] > 0 && bitmapsize[1] > 0) {
+        AtlasGlyph g;
+        if (!atlas->getGlyph(fontspec, glyphidx, glyph, g.texmin, g.texmax)) {
+          cc_glyph2d_unref(glyph);
+          return FALSE;
+        }
+        g.line = i;
+        g.pos = this->positions[i][strcharidx];
+        g.size.setValue(bitmapsize[0], bitmapsize[1]);
+        g.mono = cc_glyph2d_getmono(glyph);
+        this->atlasglyphs.append(g);
+      }
+      cc_glyph2d_unref(glyph);
+    }
+  }
+  return TRUE;
+}
+
+// Returns FALSE if the glyph atlas has been disabled with the
+// COIN_TEXT2_NO_GLYPH_ATLAS environment variable.
+SbBool
+SoText2P::useGlyphAtlas(void)
+{
+  static int useatlas = -1;
+  if (useatlas == -1) {
+    const char * env = coin_getenv("COIN_TEXT2_NO_GLYPH_ATLAS");
+    useatlas = (env && (atoi(env) > 0)) ? 0 : 1;
+  }
+  return useatlas ? TRUE : FALSE;
+}
+
 // Sets the raster position for GL raster operations.
 // Handles the special case where the x/y coordinates are negative
 void
@@ -173,6 +173,8 @@
 #include "nodes/SoSubNodeP.h"
 #include "fonts/glyph3d.h"
 #include "caches/SoGlyphCache.h"
+#include "caches/SoTessellationCache.h"
+#include "tidbitsp.h"
 
 // *************************************************************************
 
@@ -264,6 +266,11 @@ public:
   void render(SoState * state, const cc_font_specification * fontspec, unsigned int part);
   void generate(SoAction * action, const cc_font_specification * fontspec, unsigned int part);
 
+  const SoTessellationCache::Geometry *
+  getProfileSides(SoState * state, const uint32_t character,
+                  const cc_glyph3d * glyph, const cc_font_specification * fontspec,
+                  const float nearz, const int firstprofile, const float creaseangle);
+
   SbList <float> widths;
   void setUpGlyphs(SoState * state, SoText3 * textnode);
   SbBox3f maxglyphbbox;
@@ -271,6 +278,13 @@ public:
 
   SoGlyphCache * cache;
 
+  // profiled glyph sides, shared by all SoText3 nodes
+  static SoTessellationCache * tesscache;
+  static void cleanup(void) {
+    delete tesscache;
+    tesscache = NULL;
+  }
+
   void lock(void) {
 #ifdef COIN_THREADSAFE
     this->mutex.lock();
@@ -293,6 +307,8 @@ private:
   SoText3 * master;
 };
 
+SoTessellationCache * SoText3P::tesscache = NULL;
+
 #define PRIVATE(p) ((p)->pimpl)
 #define PUBLIC(p) ((p)->master)
 
@@ -341,6 +357,9 @@ void
 SoText3::initClass(void)
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoText3, SO_FROM_INVENTOR_2_1);
+
+  SoText3P::tesscache = new SoTessellationCache(256);
+  coin_atexit((coin_atexit_f *)SoText3P::cleanup, CC_ATEXIT_NORMAL);
 }
 
 // doc in parent
@@ -593,6 +612,134 @@ SoText3::createTriangleDetail(SoRayPickAction * COIN_UNUSED_ARG(action),
   return v1->getDetail()->copy();
 }
 
+// Returns the triangles and normals of the sides of a glyph swept
+// along the current profiles, relative to the glyph origin. The
+// triangles only depend on the glyph, the font, the profiles and the
+// crease angle, so they are computed once and shared through the
+// tessellation cache. The returned geometry must be unreferenced by
+// the caller.
+const SoTessellationCache::Geometry *
+SoText3P::getProfileSides(SoState * state, const uint32_t character,
+                          const cc_glyph3d * glyph, const cc_font_specification * fontspec,
+                          const float nearz, const int firstprofile, const float creaseangle)
+{
+  const SoNodeList & profilenodes = SoProfileElement::get(state);
+  const int numprofiles = profilenodes.getLength();
+  const int startprofile = SbMax(firstprofile, 0);
+  int32_t profnum;
+  SbVec2f * profcoords;
+
+  SoTessellationCache::Key key;
+  key.add(static_cast<int32_t>(character));
+  key.add(cc_string_get_text(&fontspec->name));
+  key.add(cc_string_get_text(&fontspec->style));
+  key.add(fontspec->complexity);
+  key.add(fontspec->size);
+  key.add(nearz);
+  key.add(creaseangle);
+  for (int j = startprofile; j < numprofiles; j++) {
+    SoProfile * pn = (SoProfile *) profilenodes[j];
+    pn->getVertices(state, profnum, profcoords);
+    key.add(profnum ? profcoords[0].getValue() : NULL, profnum * 2);
+  }
+
+  const SoTessellationCache::Geometry * found = tesscache->find(key);
+  if (found) return found;
+
+  SoTessellationCache::Geometry * sides = new SoTessellationCache::Geometry;
+  SbList <SbVec3f> & vertexlist = sides->coords;
+  const SbVec2f * coords = (SbVec2f *) cc_glyph3d_getcoords(glyph);
+  const int * indices = cc_glyph3d_getedgeindices(glyph);
+  int ind = 0;
+
+  this->normalgenerator->reset(FALSE);
+
+  while (*indices >= 0) {
+
+    int i0 = *indices++;
+    int i1 = *indices++;
+    SbVec3f va(coords[i0][0], coords[i0][1], nearz);
+    SbVec3f vb(coords[i1][0], coords[i1][1], nearz);
+    const int * ccw = (int *) cc_glyph3d_getnextccwedge(glyph, ind);
+    const int * cw  = (int *) cc_glyph3d_getnextcwedge(glyph, ind);
+    SbVec3f vleft(coords[*(ccw+1)][0], coords[*(ccw+1)][1], nearz);
+    SbVec3f vright(coords[*cw][0], coords[*cw][1], nearz);
+    ind++;
+
+    va[0] = va[0] * fontspec->size;
+    va[1] = va[1] * fontspec->size;
+    vb[0] = vb[0] * fontspec->size;
+    vb[1] = vb[1] * fontspec->size;
+    vleft[0] = vleft[0] * fontspec->size;
+    vleft[1] = vleft[1] * fontspec->size;
+    vright[0] = vright[0] * fontspec->size;
+    vright[1] = vright[1] * fontspec->size;
+
+    // create two 'normal' vectors pointing out from the edges
+    SbVec3f normala(vleft[0] - va[0], vleft[1] - va[1], 0.0f);
+    normala = normala.cross(SbVec3f(0.0f, 0.0f,  -1.0f));
+    if (normala.length() > 0)
+      normala.normalize();
+
+    SbVec3f normalb(vb[0] - vright[0], vb[1] - vright[1], 0.0f);
+    normalb = normalb.cross(SbVec3f(0.0f, 0.0f,  -1.0f));
+    if (normalb.length() > 0)
+      normalb.normalize();
+
+    SbVec3f vc,vd;
+    SbVec2f starta(va[0], va[1]);
+    SbVec2f startb(vb[0], vb[1]);
+
+    for (int j = startprofile; j < numprofiles; j++) {
+      SoProfile * pn = (SoProfile *) profilenodes[j];
+      pn->getVertices(state, profnum, profcoords);
+
+      for (int k=1; k<profnum; k++) {
+
+        // Calc points for two next faces
+        vd[0] = starta[0] + (profcoords[k][1] * normalb[0]);
+        vd[1] = starta[1] + (profcoords[k][1] * normalb[1]);
+        vd[2] = -profcoords[k][0];
+        vc[0] = startb[0] + (profcoords[k][1] * normala[0]);
+        vc[1] = startb[1] + (profcoords[k][1] * normala[1]);
+        vc[2] = -profcoords[k][0];
+
+        // The windows tessellation sometimes return
+        // illegal/empty tris. A test must be done to
+        // prevent stdout from being flooded with
+        // normalize() warnings from inside the normal
+        // generator.
+
+        if ((va != vd) && (va != vb) && (vd != vb)) {
+          vertexlist.append(va);
+          vertexlist.append(vd);
+          vertexlist.append(vb);
+          this->normalgenerator->triangle(va,vd,vb);
+        }
+
+        if ((vb != vd) && (vb != vc) && (vd != vc)) {
+          vertexlist.append(vb);
+          vertexlist.append(vd);
+          vertexlist.append(vc);
+          this->normalgenerator->triangle(vb,vd,vc);
+        }
+
+        va = vd;
+        vb = vc;
+
+      }
+    }
+
+  }
+
+  this->normalgenerator->generate(creaseangle);
+  const SbVec3f * normals = this->normalgenerator->getNormals();
+  for (int i = 0; i < vertexlist.getLength(); i++) {
+    sides->normals.append(normals[i]);
+  }
+  return tesscache->insert(key, sides);
+}
+
 void
 SoText3P::render(SoState * state, const cc_font_specification * fontspec,
                  unsigned int part)
@@ -839,97 +986,12 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
         else {  // profile
           assert(validprofile && firstprofile >= 0);
 
-          const int * indices = cc_glyph3d_getedgeindices(glyph);
-          int ind = 0;
-          SbVec3f normala, normalb;
-
-          SbList <SbVec3f> vertexlist;
-          this->normalgenerator->reset(FALSE);
-
-          while (*indices >= 0) {
-
-            int i0 = *indices++;
-            int i1 = *indices++;
-            SbVec3f va(coords[i0][0], coords[i0][1], nearz);
-            SbVec3f vb(coords[i1][0], coords[i1][1], nearz);
-            const int * ccw = (int *) cc_glyph3d_getnextccwedge(glyph, ind);
-            const int * cw  = (int *) cc_glyph3d_getnextcwedge(glyph, ind);
-            SbVec3f vleft(coords[*(ccw+1)][0], coords[*(ccw+1)][1], nearz);
-            SbVec3f vright(coords[*cw][0], coords[*cw][1], nearz);
-            ind++;
-
-            va[0] = va[0] * fontspec->size;
-            va[1] = va[1] * fontspec->size;
-            vb[0] = vb[0] * fontspec->size;
-            vb[1] = vb[1] * fontspec->size;
-            vleft[0] = vleft[0] * fontspec->size;
-            vleft[1] = vleft[1] * fontspec->size;
-            vright[0] = vright[0] * fontspec->size;
-            vright[1] = vright[1] * fontspec->size;
-
-            // create two 'normal' vectors pointing out from the edges
-            SbVec3f normala(vleft[0] - va[0], vleft[1] - va[1], 0.0f);
-            normala = normala.cross(SbVec3f(0.0f, 0.0f,  -1.0f));
-            if (normala.length() > 0)
-              normala.normalize();
-
-            SbVec3f normalb(vb[0] - vright[0], vb[1] - vright[1], 0.0f);
-            normalb = normalb.cross(SbVec3f(0.0f, 0.0f,  -1.0f));
-            if (normalb.length() > 0)
-              normalb.normalize();
-
-            SoProfile * pn = (SoProfile *) profilenodes[firstprofile];
-            pn->getVertices(state, profnum, profcoords);
-
-            SbVec3f vc,vd;
-            SbVec2f starta(va[0], va[1]);
-            SbVec2f startb(vb[0], vb[1]);
-
-            for (int j=firstprofile; j<numprofiles; j++) {
-              SoProfile * pn = (SoProfile *) profilenodes[j];
-              pn->getVertices(state, profnum, profcoords);
-
-              for (int k=1; k<profnum; k++) {
-
-                // Calc points for two next faces
-                vd[0] = starta[0] + (profcoords[k][1] * normalb[0]);
-                vd[1] = starta[1] + (profcoords[k][1] * normalb[1]);
-                vd[2] = -profcoords[k][0];
-                vc[0] = startb[0] + (profcoords[k][1] * normala[0]);
-                vc[1] = startb[1] + (profcoords[k][1] * normala[1]);
-                vc[2] = -profcoords[k][0];
-
-                // The windows tessellation sometimes return
-                // illegal/empty tris. A test must be done to
-                // prevent stdout from being flooded with
-                // normalize() warnings from inside the normal
-                // generator.
-
-                if ((va != vd) && (va != vb) && (vd != vb)) {
-                  vertexlist.append(va);
-                  vertexlist.append(vd);
-                  vertexlist.append(vb);
-                  normalgenerator->triangle(va,vd,vb);
-                }
-
-                if ((vb != vd) && (vb != vc) && (vd != vc)) {
-                  vertexlist.append(vb);
-                  vertexlist.append(vd);
-                  vertexlist.append(vc);
-                  normalgenerator->triangle(vb,vd,vc);
-                }
-
-                va = vd;
-                vb = vc;
-
-              }
-            }
-
-          }
-
-          normalgenerator->generate(creaseangle);
-          const SbVec3f * normals = normalgenerator->getNormals();
-          const int size = vertexlist.getLength();
+          const SoTessellationCache::Geometry * sides =
+            this->getProfileSides(state, glyphidx, glyph, fontspec,
+                                  nearz, firstprofile, creaseangle);
+          const SbVec3f * vertexlist = sides->coords.getArrayPtr();
+          const SbVec3f * normals = sides->normals.getArrayPtr();
+          const int size = sides->coords.getLength();
 
           // NOTE: We add the xpos and ypos to each vertex at this
           // point because Linux systems seems to accumulate an error
@@ -964,7 +1026,7 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
           }
           glEnd();
 
-          vertexlist.truncate(0);
+          tesscache->unref(sides);
 
         }
 
@@ -1291,98 +1353,12 @@ SoText3P::generate(SoAction * action, const cc_font_specification * fontspec,
         }
         else {  // profile
 
-          const int *indices = cc_glyph3d_getedgeindices(glyph);
-          int ind = 0;
-          SbVec3f normala, normalb;
-
-          SbList <SbVec3f> vertexlist;
-          this->normalgenerator->reset(FALSE);
-
-          while (*indices >= 0) {
-
-            int i0 = *indices++;
-            int i1 = *indices++;
-            SbVec3f va(coords[i0][0], coords[i0][1], nearz);
-            SbVec3f vb(coords[i1][0], coords[i1][1], nearz);
-            const int *ccw = (int *) cc_glyph3d_getnextccwedge(glyph, ind);
-            const int *cw  = (int *) cc_glyph3d_getnextcwedge(glyph, ind);
-            SbVec3f vleft(coords[*(ccw+1)][0], coords[*(ccw+1)][1], nearz);
-            SbVec3f vright(coords[*cw][0], coords[*cw][1], nearz);
-            ind++;
-
-            va[0] = va[0] * fontspec->size;
-            va[1] = va[1] * fontspec->size;
-            vb[0] = vb[0] * fontspec->size;
-            vb[1] = vb[1] * fontspec->size;
-            vleft[0] = vleft[0] * fontspec->size;
-            vleft[1] = vleft[1] * fontspec->size;
-            vright[0] = vright[0] * fontspec->size;
-            vright[1] = vright[1] * fontspec->size;
-
-            // create two 'normal' vectors pointing out from the edges
-            SbVec3f normala(vleft[0] - va[0], vleft[1] - va[1], 0.0f);
-            normala = normala.cross(SbVec3f(0.0f, 0.0f,  -1.0f));
-            if (normala.length() > 0)
-              normala.normalize();
-
-            SbVec3f normalb(vb[0] - vright[0], vb[1] - vright[1], 0.0f);
-            normalb = normalb.cross(SbVec3f(0.0f, 0.0f,  -1.0f));
-            if (normalb.length() > 0)
-              normalb.normalize();
-
-            SoProfile *pn = (SoProfile *)profilenodes[firstprofile];
-            pn->getVertices(state, profnum, profcoords);
-
-            SbVec3f vc,vd;
-            SbVec2f starta(va[0], va[1]);
-            SbVec2f startb(vb[0], vb[1]);
-
-            for (int j=firstprofile; j<numprofiles; j++) {
-              SoProfile *pn = (SoProfile *)profilenodes[j];
-              pn->getVertices(state, profnum, profcoords);
-
-              for (int k=1; k<profnum; k++) {
-
-                // Calc points for two next faces
-                vd[0] = starta[0] + (profcoords[k][1] * normalb[0]);
-                vd[1] = starta[1] + (profcoords[k][1] * normalb[1]);
-                vd[2] = -profcoords[k][0];
-                vc[0] = startb[0] + (profcoords[k][1] * normala[0]);
-                vc[1] = startb[1] + (profcoords[k][1] * normala[1]);
-                vc[2] = -profcoords[k][0];
-
-                // The windows tessellation sometimes return
-                // illegal/empty tris. A test must be done to prevent
-                // stdout from being flooded with normalize() warnings
-                // from inside the normal generator.
-
-                if ((va != vd) && (va != vb) && (vd != vb)) {
-                  vertexlist.append(va);
-                  vertexlist.append(vd);
-                  vertexlist.append(vb);
-                  normalgenerator->triangle(va,vd,vb);
-                }
-
-                if ((vb != vd) && (vb != vc) && (vd != vc)) {
-                  vertexlist.append(vb);
-                  vertexlist.append(vd);
-                  vertexlist.append(vc);
-                  normalgenerator->triangle(vb,vd,vc);
-                }
-
-                va = vd;
-                vb = vc;
-
-              }
-
-            }
-
-          }
-
-
-          normalgenerator->generate(creaseangle);
-          const SbVec3f * normals = normalgenerator->getNormals();
-          const int size = vertexlist.getLength();
+          const SoTessellationCache::Geometry * sides =
+            this->getProfileSides(state, glyphidx, glyph, fontspec,
+                                  nearz, firstprofile, creaseangle);
+          const SbVec3f * vertexlist = sides->coords.getArrayPtr();
+          const SbVec3f * normals = sides->normals.getArrayPtr();
+          const int size = sides->coords.getLength();
 
           PUBLIC(this)->beginShape(action, SoShape::TRIANGLES, NULL);
           for (int z = 0;z < size;z += 3) {
@@ -1406,7 +1382,7 @@ SoText3P::generate(SoAction * action, const cc_font_specification * fontspec,
 
           }
           PUBLIC(this)->endShape();
-          vertexlist.truncate(0);
+          tesscache->unref(sides);
 
         }
       }
@@ -1517,3 +1493,102 @@ SoText3P::setUpGlyphs(SoState * state, SoText3 * textnode)
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/nodes/SoLinearProfile.h>
+#include <Inventor/nodes/SoProfileCoordinate2.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+namespace {
+  void
+  text3_test_triangle_cb(void * closure, SoCallbackAction *,
+                         const SoPrimitiveVertex * v1,
+                         const SoPrimitiveVertex * v2,
+                         const SoPrimitiveVertex * v3)
+  {
+    SbList<SbVec3f> * vertices = static_cast<SbList<SbVec3f> *>(closure);
+    const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+    for (int i = 0; i < 3; i++) {
+      vertices->append(v[i]->getPoint());
+      vertices->append(v[i]->getNormal());
+    }
+  }
+
+  // the points and normals of the triangles of the sides of the text
+  SbList<SbVec3f>
+  text3_test_sides(SoNode * root)
+  {
+    SbList<SbVec3f> vertices;
+    SoCallbackAction cba;
+    cba.addTriangleCallback(SoText3::getClassTypeId(),
+                            text3_test_triangle_cb, &vertices);
+    cba.apply(root);
+    return vertices;
+  }
+
+  SoSeparator *
+  text3_test_scene(const float depth)
+  {
+    // a bevelled edge followed by a straight side
+    const float profile[][2] = { { 0.0f, 0.0f }, { 0.1f, 0.05f }, { depth, 0.05f } };
+    static const int32_t index[] = { 0, 1, 2 };
+
+    SoSeparator * root = new SoSeparator;
+    SoProfileCoordinate2 * coords = new SoProfileCoordinate2;
+    coords->point.setValues(0, 3, profile);
+    root->addChild(coords);
+    SoLinearProfile * linear = new SoLinearProfile;
+    linear->index.setValues(0, 3, index);
+    root->addChild(linear);
+    SoText3 * text = new SoText3;
+    text->string = "Coin";
+    text->parts = SoText3::SIDES;
+    root->addChild(text);
+    return root;
+  }
+
+  SbBool
+  text3_test_equal(const SbList<SbVec3f> & a, const SbList<SbVec3f> & b)
+  {
+    if (a.getLength() != b.getLength()) return FALSE;
+    for (int i = 0; i < a.getLength(); i++) {
+      if (a[i] != b[i]) return FALSE;
+    }
+    return TRUE;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(sharedProfileSides)
+{
+  SoSeparator * root = text3_test_scene(0.5f);
+  root->ref();
+  const SbList<SbVec3f> first = text3_test_sides(root);
+  BOOST_REQUIRE_MESSAGE(first.getLength() > 0, "no triangles generated for the sides");
+
+  // the second time the sides come from the tessellation cache
+  BOOST_CHECK_MESSAGE(text3_test_equal(first, text3_test_sides(root)),
+                      "sides differ when generated twice");
+
+  // other nodes with the same input share the cached sides
+  SoSeparator * same = text3_test_scene(0.5f);
+  same->ref();
+  BOOST_CHECK_MESSAGE(text3_test_equal(first, text3_test_sides(same)),
+                      "sides differ between nodes with the same profile");
+
+  // but a different profile must not hit the same cache entry
+  SoSeparator * other = text3_test_scene(1.0f);
+  other->ref();
+  const SbList<SbVec3f> deeper = text3_test_sides(other);
+  BOOST_CHECK_EQUAL(deeper.getLength(), first.getLength());
+  BOOST_CHECK_MESSAGE(!text3_test_equal(first, deeper),
+                      "sides are the same for different profiles");
+
+  root->unref();
+  same->unref();
+  other->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -283,11 +283,17 @@ SoVertexShape::generateAndReadLockNormalCache(SoState * const state)
   
   SbBool storeinvalid = SoCacheElement::setInvalid(FALSE);
   
-  if (PRIVATE(this)->normalcache) PRIVATE(this)->normalcache->unref();
+  // keep the old cache until the new normals have been generated,
+  // so that the new cache can be updated from it if only some of the
+  // coordinates have changed
+  SoNormalCache * prevcache = PRIVATE(this)->normalcache;
   state->push(); // need to push for cache dependencies
   PRIVATE(this)->normalcache = new SoNormalCache(state);
   PRIVATE(this)->normalcache->ref();
   SoCacheElement::set(state, PRIVATE(this)->normalcache);
+  const SbUniqueId coordnodeid =
+    SoCoordinateElement::getInstance(state)->getNodeId();
+  PRIVATE(this)->normalcache->setPreviousCache(prevcache, coordnodeid);
   //
   // See if the node supports the Coin-way of generating normals
   //
@@ -297,7 +303,9 @@ SoVertexShape::generateAndReadLockNormalCache(SoState * const state)
       // FIXME: set generator in normal cache
     }
   }
+  PRIVATE(this)->normalcache->setPreviousCache(NULL, coordnodeid);
   state->pop(); // don't forget this pop
+  if (prevcache) prevcache->unref();
   
   SoCacheElement::setInvalid(storeinvalid);
   this->writeUnlockNormalCache();
@@ -0,0 +1,343 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+  Internal helper for splitting a loop over several threads. The
+  range [0, num) is cut into chunks, and the chunks are handed out to
+  the calling thread and to the worker threads of a shared cc_sched
+  instance. The calling thread takes part in the work, and jobs which
+  have not been started when the caller runs out of chunks are
+  unscheduled again, so calling cc_parallel_for() from within a job
+  will not deadlock.
+
+  The number of threads is the number of processors on the system,
+  or the value of the COIN_PARALLEL_THREADS environment variable if
+  set. When Coin is built without thread support, or only one thread
+  is available, the function is just called once for the whole range.
+
+  cc_parallel_task_start() runs a single function in the background
+  on the same worker threads, for pipelining work with the calling
+  thread.
+*/
+
+#include "threads/parallelp.h"
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <cstdlib>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#ifdef HAVE_WINDOWS_H
+#include <windows.h>
+#endif /* HAVE_WINDOWS_H */
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/C/threads/common.h>
+
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/mutex.h>
+#include <Inventor/C/threads/condvar.h>
+#include <Inventor/C/threads/sched.h>
+#endif /* HAVE_THREADS */
+
+#include "tidbitsp.h"
+#ifdef HAVE_THREADS
+#include "threads/mutexp.h"
+#endif /* HAVE_THREADS */
+
+/* ********************************************************************** */
+
+static int parallel_numthreads = -1;
+
+#ifdef HAVE_THREADS
+static cc_sched * parallel_sched = NULL;
+
+typedef struct {
+  cc_parallel_f * func;
+  void * closure;
+  int num;
+  int chunk;
+  int next;
+  int finished;
+  cc_mutex * mutex;
+  cc_condvar * condvar;
+} parallel_job;
+
+static void
+parallel_cleanup(void)
+{
+  if (parallel_sched) {
+    cc_sched_destruct(parallel_sched);
+    parallel_sched = NULL;
+  }
+  parallel_numthreads = -1;
+}
+
+/* claims the next chunk of the range, returns FALSE when done */
+static SbBool
+parallel_claim(parallel_job * job, int * begin, int * end)
+{
+  SbBool ok = FALSE;
+  cc_mutex_lock(job->mutex);
+  if (job->next < job->num) {
+    *begin = job->next;
+    job->next += job->chunk;
+    if (job->next > job->num) job->next = job->num;
+    *end = job->next;
+    ok = TRUE;
+  }
+  cc_mutex_unlock(job->mutex);
+  return ok;
+}
+
+static void
+parallel_run(parallel_job * job)
+{
+  int begin, end;
+  while (parallel_claim(job, &begin, &end)) {
+    job->func(job->closure, begin, end);
+  }
+}
+
+static void
+parallel_worker(void * closure)
+{
+  parallel_job * job = (parallel_job *) closure;
+  parallel_run(job);
+  cc_mutex_lock(job->mutex);
+  job->finished++;
+  cc_condvar_wake_all(job->condvar);
+  cc_mutex_unlock(job->mutex);
+}
+
+static cc_sched *
+parallel_get_sched(const int numthreads)
+{
+  cc_mutex_global_lock();
+  if (parallel_sched == NULL) {
+    parallel_sched = cc_sched_construct(numthreads - 1);
+    coin_atexit((coin_atexit_f *) parallel_cleanup, CC_ATEXIT_STATIC_DATA);
+  }
+  cc_mutex_global_unlock();
+  return parallel_sched;
+}
+#endif /* HAVE_THREADS */
+
+struct cc_parallel_task {
+  cc_parallel_task_f * func;
+  void * closure;
+#ifdef HAVE_THREADS
+  uint32_t schedid;
+  int finished;
+  cc_mutex * mutex;
+  cc_condvar * condvar;
+#endif /* HAVE_THREADS */
+};
+
+#ifdef HAVE_THREADS
+static void
+parallel_task_worker(void * closure)
+{
+  cc_parallel_task * task = (cc_parallel_task *) closure;
+  task->func(task->closure);
+  cc_mutex_lock(task->mutex);
+  task->finished = 1;
+  cc_condvar_wake_all(task->condvar);
+  cc_mutex_unlock(task->mutex);
+}
+#endif /* HAVE_THREADS */
+
+/* ********************************************************************** */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+  Returns the number of threads cc_parallel_for() will use.
+*/
+int
+cc_parallel_get_num_threads(void)
+{
+  if (parallel_numthreads < 0) {
+    int num = 1;
+    const char * env = coin_getenv("COIN_PARALLEL_THREADS");
+    if (env) {
+      num = atoi(env);
+    }
+    else {
+#if defined(HAVE_WINDOWS_H)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      num = (int) info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+      num = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    if (num < 1) num = 1;
+    if (num > 64) num = 64;
+    if (cc_thread_implementation() == CC_NO_THREADS) num = 1;
+    parallel_numthreads = num;
+  }
+  return parallel_numthreads;
+}
+
+/*
+  Calls \a func for consecutive, non-overlapping subranges covering
+  [0, \a num), possibly from several threads at the same time. Each
+  subrange will contain at least \a minchunk elements, except
+  possibly the last one. Returns when all subranges have been
+  processed.
+*/
+void
+cc_parallel_for(int num, int minchunk, cc_parallel_f * func, void * closure)
+{
+  if (num <= 0) return;
+  if (minchunk < 1) minchunk = 1;
+
+  const int numthreads = cc_parallel_get_num_threads();
+  if (numthreads <= 1 || num <= minchunk) {
+    func(closure, 0, num);
+    return;
+  }
+
+#ifdef HAVE_THREADS
+  cc_sched * sched = parallel_get_sched(numthreads);
+
+  /* a few chunks per thread to even out the load */
+  int chunk = (num + numthreads * 4 - 1) / (numthreads * 4);
+  if (chunk < minchunk) chunk = minchunk;
+  const int numchunks = (num + chunk - 1) / chunk;
+  int numjobs = numthreads - 1;
+  if (numjobs > numchunks - 1) numjobs = numchunks - 1;
+
+  parallel_job job;
+  job.func = func;
+  job.closure = closure;
+  job.num = num;
+  job.chunk = chunk;
+  job.next = 0;
+  job.finished = 0;
+  job.mutex = cc_mutex_construct();
+  job.condvar = cc_condvar_construct();
+
+  uint32_t schedids[64];
+  int i;
+  for (i = 0; i < numjobs; i++) {
+    schedids[i] = cc_sched_schedule(sched, parallel_worker, &job, 0.0f);
+  }
+
+  parallel_run(&job);
+
+  /* jobs that never got started can just be dropped */
+  int numstarted = numjobs;
+  for (i = 0; i < numjobs; i++) {
+    if (cc_sched_unschedule(sched, schedids[i])) numstarted--;
+  }
+
+  cc_mutex_lock(job.mutex);
+  while (job.finished < numstarted) {
+    cc_condvar_wait(job.condvar, job.mutex);
+  }
+  cc_mutex_unlock(job.mutex);
+
+  cc_condvar_destruct(job.condvar);
+  cc_mutex_destruct(job.mutex);
+#else /* ! HAVE_THREADS */
+  func(closure, 0, num);
+#endif /* ! HAVE_THREADS */
+}
+
+/*
+  Starts calling \a func with \a closure on one of the worker threads,
+  and returns a handle which must be passed to
+  cc_parallel_task_wait(). When only one thread is available, \a func
+  is called before this function returns.
+*/
+cc_parallel_task *
+cc_parallel_task_start(cc_parallel_task_f * func, void * closure)
+{
+  cc_parallel_task * task = (cc_parallel_task *) malloc(sizeof(cc_parallel_task));
+  task->func = func;
+  task->closure = closure;
+
+  const int numthreads = cc_parallel_get_num_threads();
+#ifdef HAVE_THREADS
+  task->mutex = NULL;
+  task->condvar = NULL;
+  if (numthreads > 1) {
+    cc_sched * sched = parallel_get_sched(numthreads);
+    task->finished = 0;
+    task->mutex = cc_mutex_construct();
+    task->condvar = cc_condvar_construct();
+    task->schedid = cc_sched_schedule(sched, parallel_task_worker, task, 0.0f);
+    return task;
+  }
+#endif /* HAVE_THREADS */
+  func(closure);
+  return task;
+}
+
+/*
+  Waits for \a task to finish, and frees it. If the task hasn't been
+  started by a worker thread yet, it is run by the calling thread.
+*/
+void
+cc_parallel_task_wait(cc_parallel_task * task)
+{
+#ifdef HAVE_THREADS
+  if (task->mutex) {
+    if (cc_sched_unschedule(parallel_sched, task->schedid)) {
+      task->func(task->closure);
+    }
+    else {
+      cc_mutex_lock(task->mutex);
+      while (!task->finished) {
+        cc_condvar_wait(task->condvar, task->mutex);
+      }
+      cc_mutex_unlock(task->mutex);
+    }
+    cc_condvar_destruct(task->condvar);
+    cc_mutex_destruct(task->mutex);
+  }
+#endif /* HAVE_THREADS */
+  free(task);
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
@@ -68,6 +68,7 @@
 #include <Inventor/lists/SbList.h>
 
 #include "engines/SoSubNodeEngineP.h"
+#include "vrml97/SoVRMLInterpolatorP.h"
 
 #ifndef DOXYGEN_SKIP_THIS
 
@@ -113,22 +114,24 @@ SoVRMLCoordinateInterpolator::evaluate(void)
   if (!this->value_changed.isEnabled()) return;
 
   float interp;
-  int i, idx = this->getKeyValueIndex(interp, this->keyValue.getNum());
+  int idx = this->getKeyValueIndex(interp, this->keyValue.getNum());
   if (idx < 0) return;
 
-  PRIVATE(this)->tmplist.truncate(0);
   const int numkeys = this->key.getNum();
   const int numcoords = this->keyValue.getNum() / numkeys;
 
-  const SbVec3f * c0 = this->keyValue.getValues(idx*numcoords);
-  const SbVec3f * c1 = c0;
-  if (interp > 0.0f) c1 = this->keyValue.getValues((idx+1)*numcoords);
+  SbList <SbVec3f> & tmplist = PRIVATE(this)->tmplist;
+  while (tmplist.getLength() < numcoords) tmplist.append(SbVec3f(0.0f, 0.0f, 0.0f));
 
-  for (i = 0; i < numcoords; i++) {
-    PRIVATE(this)->tmplist.append(c0[i] + (c1[i]-c0[i]) * interp);
+  if (numcoords > 0) {
+    const SbVec3f * c0 = this->keyValue.getValues(idx*numcoords);
+    const SbVec3f * c1 = c0;
+    if (interp > 0.0f) c1 = this->keyValue.getValues((idx+1)*numcoords);
+    SoVRMLInterpolatorP::lerp(c0[0].getValue(), c1[0].getValue(), interp,
+                              &tmplist[0][0], numcoords * 3);
   }
 
-  const SbVec3f * coords = PRIVATE(this)->tmplist.getArrayPtr();
+  const SbVec3f * coords = tmplist.getArrayPtr();
 
   SO_ENGINE_OUTPUT(value_changed, SoMFVec3f, setNum(numcoords));
   SO_ENGINE_OUTPUT(value_changed, SoMFVec3f, setValues(0, numcoords, coords));
@@ -201,6 +201,23 @@
   Figure 6.5
   </center>
 
+  Coin renders grids with more than 128x128 quads in chunks of 32x32
+  quads. Chunks outside the view volume are culled. Every other chunk
+  is drawn with the fewest height samples (every 2nd, 4th, ... up to
+  every 32nd) that keep the projected error below a tolerance.
+  Neighbouring chunks are stitched together, so no cracks appear
+  between them. Chunked rendering generates smooth normals, so grids
+  where the creaseAngle field would give creases are drawn at full
+  resolution, as are grids with normals or colors per quad, or with
+  transparency per vertex.
+
+  The screen space tolerance is 2 pixels by default. Set it with the
+  COIN_ELEVATIONGRID_LOD_ERROR environment variable. Set
+  COIN_ELEVATIONGRID_LOD to 0 to always draw the full grid.
+
+  To ray pick, Coin only tests the grid cells that the ray crosses,
+  instead of generating every triangle of the grid.
+
 */
 
 
@@ -273,11 +290,15 @@
 #include "coindefs.h"
 
 #include <cfloat>
+#include <cmath>
 
+#include <Inventor/SbLine.h>
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoGetPrimitiveCountAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
 #include <Inventor/bundles/SoMaterialBundle.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/elements/SoGLMultiTextureEnabledElement.h>
 #include <Inventor/elements/SoGLLazyElement.h>
 #include <Inventor/elements/SoLazyElement.h>
@@ -290,12 +311,16 @@
 #include <Inventor/details/SoFaceDetail.h>
 #include <Inventor/details/SoPointDetail.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
 #include <Inventor/system/gl.h>
+#include <Inventor/C/tidbits.h>
 #ifdef HAVE_THREADS
 #include <Inventor/threads/SbRWMutex.h>
 #endif // HAVE_THREADS
 
 #include "nodes/SoSubNodeP.h"
+#include "rendering/SoGL.h"
+#include "vrml97/SoVRMLElevationGridLOD.h"
 
 // *************************************************************************
 
@@ -303,15 +328,51 @@ class SoVRMLElevationGridP {
 public:
   SoVRMLElevationGridP(void)
     : dirty(TRUE),
-      ngen(TRUE)
+      ngen(TRUE),
+      lod(NULL),
+      loddirty(TRUE),
+      maxfaceangle(-1.0f)
 #ifdef COIN_THREADSAFE
       , mutex(SbRWMutex::READ_PRECEDENCE)
 #endif // COIN_THREADSAFE
   { }
+  ~SoVRMLElevationGridP() {
+    delete this->lod;
+  }
+
+  // state for generating the quads of the grid, shared by
+  // generatePrimitives() and rayPick()
+  class Quads {
+  public:
+    const float * h;
+    int xdim;
+    float xspace, zspace;
+    SoVRMLElevationGrid::Binding nbind, mbind;
+    const SbVec3f * normals;
+    SbBool normalcache;
+    const SbVec2f * tcoords;
+    SoPrimitiveVertex vertex;
+    SoPointDetail pointDetail;
+    SoFaceDetail faceDetail;
+  };
+
+  SbBool beginQuads(SoVRMLElevationGrid * master, SoAction * action, Quads & quads);
+  void shapeQuad(SoVRMLElevationGrid * master, Quads & quads, const int x, const int z);
+  void endQuads(SoVRMLElevationGrid * master, Quads & quads);
+
+  SbBool renderChunked(SoVRMLElevationGrid * master, SoGLRenderAction * action,
+                       const SoVRMLElevationGrid::Binding nbind,
+                       const SoVRMLElevationGrid::Binding mbind,
+                       const SbBool dotex);
 
   SbBool dirty;
   SoNormalGenerator ngen;
   SoVRMLElevationGrid::Binding nbind;
+  SoVRMLElevationGridLOD * lod;
+  SbBool loddirty;
+  // the largest angle between quads sharing a vertex, or -1 if not
+  // calculated yet
+  float maxfaceangle;
 
 #ifdef COIN_THREADSAFE
   SbRWMutex mutex;
@@ -319,14 +380,78 @@ public:
   void readUnlockNormalCache(void) { this->mutex.readUnlock(); }
   void writeLockNormalCache(void) { this->mutex.writeLock(); }
   void writeUnlockNormalCache(void) { this->mutex.writeUnlock(); }
+  void lockLOD(void) { this->mutex.writeLock(); }
+  void unlockLOD(void) { this->mutex.writeUnlock(); }
 #else // ! COIN_THREADSAFE
   void readLockNormalCache(void) { }
   void readUnlockNormalCache(void) { }
   void writeLockNormalCache(void) { }
   void writeUnlockNormalCache(void) { }
+  void lockLOD(void) { }
+  void unlockLOD(void) { }
 #endif // ! COIN_THREADSAFE
 };
 
+// Returns the largest screen space error in pixels allowed for
+// chunked rendering, or a negative value if chunked rendering is
+// disabled.
+static float
+sovrmlelevationgrid_lod_error(void)
+{
+  static float lod_error = -2.0f;
+  if (lod_error < -1.5f) {
+    const char * env = coin_getenv("COIN_ELEVATIONGRID_LOD");
+    if (env && atoi(env) == 0) {
+      lod_error = -1.0f;
+    }
+    else {
+      env = coin_getenv("COIN_ELEVATIONGRID_LOD_ERROR");
+      lod_error = env ? static_cast<float>(atof(env)) : 2.0f;
+      if (lod_error < 0.0f) lod_error = 0.0f;
+    }
+  }
+  return lod_error;
+}
+
+// the smallest number of quads rendered in chunks
+static const int SOVRMLELEVATIONGRID_LOD_MINQUADS = 128 * 128;
+
+// Returns the largest angle between the normals of two quads sharing
+// a vertex. Normals generated with a creaseAngle at least this large
+// have no creases.
+static float
+sovrmlelevationgrid_max_face_angle(const int xdim, const int zdim,
+                                   const float xspace, const float zspace,
+                                   const float * h)
+{
+  const int nx = xdim - 1;
+  SbVec3f * prevrow = new SbVec3f[nx];
+  SbVec3f * row = new SbVec3f[nx];
+  float mindot = 1.0f;
+  for (int z = 0; z < zdim - 1; z++) {
+    for (int x = 0; x < nx; x++) {
+      // the cross product of the diagonals
+      const SbVec3f d0(xspace, h[(z+1)*xdim+x+1] - h[z*xdim+x], zspace);
+      const SbVec3f d1(-xspace, h[(z+1)*xdim+x] - h[z*xdim+x+1], zspace);
+      SbVec3f n = d0.cross(d1);
+      (void) n.normalize();
+      row[x] = n;
+
+      // compare with the neighbours already visited
+      if (x > 0) mindot = SbMin(mindot, n.dot(row[x-1]));
+      if (z > 0) {
+        for (int i = SbMax(x-1, 0); i <= SbMin(x+1, nx-1); i++) {
+          mindot = SbMin(mindot, n.dot(prevrow[i]));
+        }
+      }
+    }
+    SbSwap(row, prevrow);
+  }
+  delete[] prevrow;
+  delete[] row;
+  return static_cast<float>(acos(SbClamp(mindot, -1.0f, 1.0f)));
+}
+
 #define PRIVATE(obj) ((obj)->pimpl)
 
 // *************************************************************************
@@ -421,6 +546,11 @@ SoVRMLElevationGrid::GLRender(SoGLRenderAction * action)
 
   mb.sendFirst();
 
+  if (PRIVATE(this)->renderChunked(this, action, nbind, mbind, dotex)) {
+    state->pop();
+    return;
+  }
+
   SbBool normalcache = FALSE;
   const SbVec3f * normals = NULL;
   if (nbind != OVERALL) {
@@ -632,8 +762,113 @@ SoVRMLElevationGrid::GLRender(SoGLRenderAction * action)
 void
 SoVRMLElevationGrid::rayPick(SoRayPickAction * action)
 {
-  // FIXME: implement optimized version
-  inherited::rayPick(action);
+  if (!this->shouldRayPick(action)) return;
+  this->computeObjectSpaceRay(action);
+
+  SoVRMLElevationGridP::Quads quads;
+  if (!PRIVATE(this)->beginQuads(this, action, quads)) return;
+
+  // Walk the grid cells crossed by the ray in the xz plane, in the
+  // order the ray crosses them, and only send the quads which are hit
+  // to the shape, to get the same picked points and details as
+  // generatePrimitives() would give.
+  const int xdim = this->xDimension.getValue();
+  const int zdim = this->zDimension.getValue();
+  const float xspace = quads.xspace;
+  const float zspace = quads.zspace;
+  const float size[3] = { (xdim-1) * xspace, 0.0f, (zdim-1) * zspace };
+  const SbLine & line = action->getLine();
+  const SbVec3f & p = line.getPosition();
+  const SbVec3f & d = line.getDirection();
+
+  // clip the ray against the grid rectangle
+  float t0 = -FLT_MAX, t1 = FLT_MAX;
+  SbBool inside = TRUE;
+  for (int axis = 0; axis < 3; axis += 2) {
+    if (d[axis] == 0.0f) {
+      if (p[axis] < 0.0f || p[axis] > size[axis]) inside = FALSE;
+    }
+    else {
+      float ta = -p[axis] / d[axis];
+      float tb = (size[axis] - p[axis]) / d[axis];
+      if (ta > tb) SbSwap(ta, tb);
+      t0 = SbMax(t0, ta);
+      t1 = SbMin(t1, tb);
+    }
+  }
+  if (t0 == -FLT_MAX) t0 = t1 = 0.0f; // parallel to the y axis
+  if (!inside || t0 > t1) {
+    PRIVATE(this)->endQuads(this, quads);
+    return;
+  }
+
+  const SbVec3f start = p + d * t0;
+  int x = SbClamp(static_cast<int>(floor(start[0] / xspace)), 0, xdim-2);
+  int z = SbClamp(static_cast<int>(floor(start[2] / zspace)), 0, zdim-2);
+  const int stepx = (d[0] > 0.0f) ? 1 : ((d[0] < 0.0f) ? -1 : 0);
+  const int stepz = (d[2] > 0.0f) ? 1 : ((d[2] < 0.0f) ? -1 : 0);
+  // the ray parameter at the next cell boundary along x and z, and
+  // the distance between cell boundaries
+  float tx = FLT_MAX, tz = FLT_MAX, dtx = FLT_MAX, dtz = FLT_MAX;
+  if (stepx) {
+    tx = ((x + (stepx > 0 ? 1 : 0)) * xspace - p[0]) / d[0];
+    dtx = xspace / float(fabs(d[0]));
+  }
+  if (stepz) {
+    tz = ((z + (stepz > 0 ? 1 : 0)) * zspace - p[2]) / d[2];
+    dtz = zspace / float(fabs(d[2]));
+  }
+
+  const float * h = quads.h;
+  const SbBool pickall = action->isPickAll();
+  float t = t0;
+  while (TRUE) {
+    const float tnext = SbMin(SbMin(tx, tz), t1);
+
+    // skip the cell if the ray passes above or below it
+    const float h0 = h[z*xdim+x], h1 = h[z*xdim+x+1];
+    const float h2 = h[(z+1)*xdim+x], h3 = h[(z+1)*xdim+x+1];
+    const float minh = SbMin(SbMin(h0, h1), SbMin(h2, h3));
+    const float maxh = SbMax(SbMax(h0, h1), SbMax(h2, h3));
+    const float ya = p[1] + d[1] * t;
+    const float yb = p[1] + d[1] * tnext;
+    const float eps = 1.0e-4f *
+      (1.0f + float(fabs(minh)) + float(fabs(maxh)) + float(fabs(ya)) + float(fabs(yb)));
+    if ((t0 == t1) || (SbMax(ya, yb) >= minh - eps && SbMin(ya, yb) <= maxh + eps)) {
+      const float cx = x * xspace, cz = z * zspace;
+      const SbVec3f v0(cx, h2, cz + zspace);
+      const SbVec3f v1(cx + xspace, h3, cz + zspace);
+      const SbVec3f v2(cx + xspace, h1, cz);
+      const SbVec3f v3(cx, h0, cz);
+      SbVec3f isect, barycentric;
+      SbBool front;
+      const SbBool hit =
+        (action->intersect(v0, v1, v2, isect, barycentric, front) &&
+         action->isBetweenPlanes(isect)) ||
+        (action->intersect(v0, v2, v3, isect, barycentric, front) &&
+         action->isBetweenPlanes(isect));
+      if (hit) {
+        PRIVATE(this)->shapeQuad(this, quads, x, z);
+        // the cells are visited in order along the ray
+        if (!pickall) break;
+      }
+    }
+
+    if (tnext >= t1) break;
+    if (tx < tz) {
+      x += stepx;
+      t = tx;
+      tx += dtx;
+      if (x < 0 || x > xdim-2) break;
+    }
+    else {
+      z += stepz;
+      t = tz;
+      tz += dtz;
+      if (z < 0 || z > zdim-2) break;
+    }
+  }
+  PRIVATE(this)->endQuads(this, quads);
 }
 
 // Doc in parent
@@ -677,14 +912,36 @@ SoVRMLElevationGrid::computeBBox(SoAction * COIN_UNUSED_ARG(action),
 void
 SoVRMLElevationGrid::generatePrimitives(SoAction * action)
 {
+  SoVRMLElevationGridP::Quads quads;
+  if (!PRIVATE(this)->beginQuads(this, action, quads)) return;
+
   const int xdim = this->xDimension.getValue();
   const int zdim = this->zDimension.getValue();
-  if (xdim < 2 || zdim < 2) return;
+  for (int z = 0; z < zdim-1; z++) {
+    for (int x = 0; x < xdim-1; x++) {
+      PRIVATE(this)->shapeQuad(this, quads, x, z);
+    }
+  }
+  PRIVATE(this)->endQuads(this, quads);
+}
+
+//
+// Sets up quads for generating the quads of the grid, and begins the
+// shape. Returns FALSE if the grid is empty or invalid. endQuads()
+// must be called when TRUE is returned.
+//
+SbBool
+SoVRMLElevationGridP::beginQuads(SoVRMLElevationGrid * master, SoAction * action,
+                                 Quads & quads)
+{
+  const int xdim = master->xDimension.getValue();
+  const int zdim = master->zDimension.getValue();
+  if (xdim < 2 || zdim < 2) return FALSE;
 
-  if (this->height.getNum() != xdim*zdim) {
+  if (master->height.getNum() != xdim*zdim) {
     SoDebugError::postWarning("SoVRMLElevationGrid::generatePrimitives",
                               "Wrong number of height values.");
-    return;
+    return FALSE;
   }
 
   SoState * state = action->getState();
@@ -692,169 +949,194 @@ SoVRMLElevationGrid::generatePrimitives(SoAction * action)
   SbBool donorm = SoLazyElement::getLightModel(state) !=
     SoLazyElement::BASE_COLOR;
 
-  Binding nbind = this->findNormalBinding();
-  Binding mbind = this->findMaterialBinding();
+  quads.nbind = master->findNormalBinding();
+  quads.mbind = master->findMaterialBinding();
 
-  if (!donorm) nbind = OVERALL;
+  if (!donorm) quads.nbind = SoVRMLElevationGrid::OVERALL;
 
-  const SbVec2f * tcoords = NULL;
+  quads.tcoords = NULL;
   SoVRMLTextureCoordinate * tnode = (SoVRMLTextureCoordinate*)
-    this->texCoord.getValue();
+    master->texCoord.getValue();
 
-  if (tnode) tcoords = tnode->point.getValues(0);
+  if (tnode) quads.tcoords = tnode->point.getValues(0);
 
-  SbBool normalcache = FALSE;
-  const SbVec3f * normals = NULL;
-  if (nbind != OVERALL) {
-    SoVRMLNormal * nnode = (SoVRMLNormal*) this->normal.getValue();
-    if (nnode) normals = nnode->vector.getValues(0);
-    if (normals == NULL) {
+  quads.normalcache = FALSE;
+  quads.normals = NULL;
+  if (quads.nbind != SoVRMLElevationGrid::OVERALL) {
+    SoVRMLNormal * nnode = (SoVRMLNormal*) master->normal.getValue();
+    if (nnode) quads.normals = nnode->vector.getValues(0);
+    if (quads.normals == NULL) {
       // updateNormalCache will readLock the normal cache. We unlock
-      // at the end of this function.
-      normals = this->updateNormalCache(nbind);
-      normalcache = TRUE;
+      // in endQuads().
+      quads.normals = master->updateNormalCache(quads.nbind);
+      quads.normalcache = TRUE;
     }
   }
 
-  const float * h = this->height.getValues(0);
-  const float * nexth = h + xdim;
+  quads.h = master->height.getValues(0);
+  quads.xdim = xdim;
+  quads.zspace = master->zSpacing.getValue();
+  quads.xspace = master->xSpacing.getValue();
 
-  float currz = 0.0f;
+  quads.vertex.setDetail(&quads.pointDetail);
+  quads.vertex.setNormal(quads.normals ? quads.normals[0] : SbVec3f(0, 1, 0));
 
-  const float zspace = this->zSpacing.getValue();
-  const float xspace = this->xSpacing.getValue();
+  master->beginShape(action, SoShape::QUADS, &quads.faceDetail);
+  return TRUE;
+}
+
+//
+// Sends the quad between grid points (x, z) and (x+1, z+1) to the
+// shape.
+//
+void
+SoVRMLElevationGridP::shapeQuad(SoVRMLElevationGrid * master, Quads & quads,
+                                const int x, const int z)
+{
+  const int xdim = quads.xdim;
+  const float * h = quads.h + z * xdim;
+  const float * nexth = h + xdim;
+  const float currx = x * quads.xspace;
+  const float currz = z * quads.zspace;
+  const int quad = z * (xdim-1) + x;
+  SoPrimitiveVertex & vertex = quads.vertex;
+  SoPointDetail & pointDetail = quads.pointDetail;
+
+  quads.faceDetail.setFaceIndex(quad);
+
+  // the four corners, in the order they are sent
+  const int indices[4] = {
+    x+(z+1)*xdim, x+1+(z+1)*xdim, x+1+z*xdim, x+z*xdim
+  };
+  const SbVec3f points[4] = {
+    SbVec3f(currx, nexth[x], currz+quads.zspace),
+    SbVec3f(currx+quads.xspace, nexth[x+1], currz+quads.zspace),
+    SbVec3f(currx+quads.xspace, h[x+1], currz),
+    SbVec3f(currx, h[x], currz)
+  };
+
+  for (int i = 0; i < 4; i++) {
+    const int idx = indices[i];
+    if (quads.mbind == SoVRMLElevationGrid::PER_VERTEX) {
+      pointDetail.setMaterialIndex(idx);
+      vertex.setMaterialIndex(idx);
+    }
+    else if (quads.mbind == SoVRMLElevationGrid::PER_QUAD && i == 0) {
+      pointDetail.setMaterialIndex(z);
+      vertex.setMaterialIndex(z);
+    }
+    if (quads.nbind == SoVRMLElevationGrid::PER_VERTEX) {
+      pointDetail.setNormalIndex(idx);
+      // the normal cache has one normal per quad corner
+      vertex.setNormal(quads.normalcache ?
+                       quads.normals[quad*4 + i] : quads.normals[idx]);
+    }
+    else if (quads.nbind == SoVRMLElevationGrid::PER_QUAD && i == 0) {
+      pointDetail.setNormalIndex(z);
+      vertex.setNormal(quads.normals[quad]);
+    }
+    if (i < 3) pointDetail.setTextureCoordIndex(idx);
+    pointDetail.setCoordinateIndex(idx);
+    if (quads.tcoords) vertex.setTextureCoords(quads.tcoords[idx]);
+    vertex.setPoint(points[i]);
+    master->shapeVertex(&vertex);
+  }
+}
 
-  SoPrimitiveVertex vertex;
-  SoPointDetail pointDetail;
-  SoFaceDetail faceDetail;
+//
+// Ends the shape begun in beginQuads().
+//
+void
+SoVRMLElevationGridP::endQuads(SoVRMLElevationGrid * master, Quads & quads)
+{
+  master->endShape();
 
-  vertex.setDetail(&pointDetail);
+  if (quads.normalcache) this->readUnlockNormalCache();
+}
 
-  SbVec3f dummynormal(0, 1, 0);
-  const SbVec3f * currnormal = &dummynormal;
-  if (normals) currnormal = normals;
-  vertex.setNormal(*currnormal);
+//
+// Renders large grids in chunks with view dependent level of detail.
+// Returns FALSE if the grid should be rendered at full resolution
+// instead.
+//
+SbBool
+SoVRMLElevationGridP::renderChunked(SoVRMLElevationGrid * master,
+                                    SoGLRenderAction * action,
+                                    const SoVRMLElevationGrid::Binding nbind,
+                                    const SoVRMLElevationGrid::Binding mbind,
+                                    const SbBool dotex)
+{
+  const int xdim = master->xDimension.getValue();
+  const int zdim = master->zDimension.getValue();
+  const float pixelerror = sovrmlelevationgrid_lod_error();
+  if (pixelerror < 0.0f ||
+      (xdim-1)*(zdim-1) < SOVRMLELEVATIONGRID_LOD_MINQUADS) return FALSE;
 
-  this->beginShape(action, QUADS, &faceDetail);
+  SoState * state = action->getState();
+  if (!SoGLDriverDatabase::isSupported(sogl_glue_instance(state), SO_GL_VERTEX_ARRAY)) {
+    return FALSE;
+  }
 
-  int idx;
-  int cnt = 0;
+  const int numvertices = xdim*zdim;
+  const SbVec3f * normals = NULL;
+  if (nbind == SoVRMLElevationGrid::PER_QUAD) return FALSE;
+  if (nbind == SoVRMLElevationGrid::PER_VERTEX) {
+    SoVRMLNormal * nnode = (SoVRMLNormal*) master->normal.getValue();
+    if (nnode && nnode->vector.getNum()) {
+      if (nnode->vector.getNum() < numvertices) return FALSE;
+      normals = nnode->vector.getValues(0);
+    }
+  }
 
-  for (int z = 0; z < zdim-1; z++) {
-    float currx = 0.0f;
-    for (int x = 0; x < xdim-1; x++) {
+  const SbVec2f * tcoords = NULL;
+  SoVRMLTextureCoordinate * tnode = (SoVRMLTextureCoordinate*)
+    master->texCoord.getValue();
+  if (dotex && tnode) {
+    if (tnode->point.getNum() < numvertices) return FALSE;
+    tcoords = tnode->point.getValues(0);
+  }
 
-      // vertex 1
-      idx = x+(z+1)*xdim;
-      SbVec3f v0(currx, nexth[x], currz+zspace);
-      if (mbind == PER_VERTEX) {
-        pointDetail.setMaterialIndex(idx);
-        vertex.setMaterialIndex(idx);
-      }
-      else if (mbind == PER_QUAD) {
-        pointDetail.setMaterialIndex(cnt);
-        vertex.setMaterialIndex(cnt);
-      }
-      if (nbind == PER_VERTEX) {
-        pointDetail.setNormalIndex(idx);
-        if (normalcache) {
-          vertex.setNormal(*currnormal);
-          currnormal++;
-        }
-        else {
-          vertex.setNormal(normals[idx]);
-        }
-      }
-      else if (nbind == PER_QUAD) {
-        pointDetail.setNormalIndex(cnt);
-        vertex.setNormal(*currnormal);
-        currnormal++;
-      }
-      pointDetail.setTextureCoordIndex(idx);
-      pointDetail.setCoordinateIndex(idx);
-      if (tcoords) vertex.setTextureCoords(tcoords[idx]);
-      vertex.setPoint(v0);
-      this->shapeVertex(&vertex);
-
-      // vertex 2
-      SbVec3f v1(currx+xspace, nexth[x+1], currz+zspace);
-      idx++;
-      if (mbind == PER_VERTEX) {
-        pointDetail.setMaterialIndex(idx);
-        vertex.setMaterialIndex(idx);
-      }
-      if (nbind == PER_VERTEX) {
-        pointDetail.setNormalIndex(idx);
-        if (normalcache) {
-          vertex.setNormal(*currnormal);
-          currnormal++;
-        }
-        else {
-          vertex.setNormal(normals[idx]);
-        }
-      }
-      pointDetail.setTextureCoordIndex(idx);
-      pointDetail.setCoordinateIndex(idx);
-      if (tcoords) vertex.setTextureCoords(tcoords[idx]);
-      vertex.setPoint(v1);
-      this->shapeVertex(&vertex);
-
-      // vertex 3
-      SbVec3f v2(currx+xspace, h[x+1], currz);
-      idx -= xdim;
-      if (mbind == PER_VERTEX) {
-        pointDetail.setMaterialIndex(idx);
-        vertex.setMaterialIndex(idx);
-      }
-      if (nbind == PER_VERTEX) {
-        pointDetail.setNormalIndex(idx);
-        if (normalcache) {
-          vertex.setNormal(*currnormal);
-          currnormal++;
-        }
-        else {
-          vertex.setNormal(normals[idx]);
-        }
-      }
-      pointDetail.setTextureCoordIndex(idx);
-      pointDetail.setCoordinateIndex(idx);
-      if (tcoords) vertex.setTextureCoords(tcoords[idx]);
-      vertex.setPoint(v2);
-      this->shapeVertex(&vertex);
-
-      // vertex 4
-      SbVec3f v3(currx, h[x], currz);
-      idx--;
-      if (mbind == PER_VERTEX) {
-        pointDetail.setMaterialIndex(idx);
-        vertex.setMaterialIndex(idx);
-      }
-      if (nbind == PER_VERTEX) {
-        pointDetail.setNormalIndex(idx);
-        if (normalcache) {
-          vertex.setNormal(*currnormal);
-          currnormal++;
-        }
-        else {
-          vertex.setNormal(normals[idx]);
-        }
-      }
-      pointDetail.setCoordinateIndex(idx);
-      if (tcoords) vertex.setTextureCoords(tcoords[idx]);
-      vertex.setPoint(v3);
-      this->shapeVertex(&vertex);
+  const SbColor * colors = NULL;
+  if (mbind == SoVRMLElevationGrid::PER_QUAD) return FALSE;
+  if (mbind == SoVRMLElevationGrid::PER_VERTEX) {
+    const SoLazyElement * lelem = SoLazyElement::getInstance(state);
+    if (lelem->isPacked() || lelem->getNumTransparencies() > 1 ||
+        lelem->getNumDiffuse() < numvertices) return FALSE;
+    colors = lelem->getDiffusePointer();
+  }
 
-      currx += xspace;
-      faceDetail.incFaceIndex();
+  this->lockLOD();
+  // the chunks always get smooth normals, so grids where the
+  // creaseAngle gives creases are drawn at full resolution
+  if (nbind != SoVRMLElevationGrid::OVERALL && normals == NULL) {
+    if (this->maxfaceangle < 0.0f) {
+      this->maxfaceangle =
+        sovrmlelevationgrid_max_face_angle(xdim, zdim,
+                                           master->xSpacing.getValue(),
+                                           master->zSpacing.getValue(),
+                                           master->height.getValues(0));
+    }
+    if (master->creaseAngle.getValue() < this->maxfaceangle) {
+      this->unlockLOD();
+      return FALSE;
     }
-    h += xdim;
-    nexth += xdim;
-    currz += zspace;
-    cnt++;
   }
-  this->endShape();
+  if (this->lod == NULL) this->lod = new SoVRMLElevationGridLOD;
+  if (this->loddirty) {
+    this->lod->build(xdim, zdim,
+                     master->xSpacing.getValue(), master->zSpacing.getValue(),
+                     master->height.getValues(0));
+    this->loddirty = FALSE;
+  }
+  if (this->lod->select(state, pixelerror) > 0) {
+    this->lod->render(action, normals, tcoords, colors, master->ccw.getValue(), dotex);
+  }
+  this->unlockLOD();
 
-  if (normalcache) PRIVATE(this)->readUnlockNormalCache();
+  // the levels depend on the camera, like for the LOD nodes
+  SoGLCacheContextElement::shouldAutoCache(state,
+                                           SoGLCacheContextElement::DONT_AUTO_CACHE);
+  return TRUE;
 }
 
 //
@@ -889,6 +1171,7 @@ void
 SoVRMLElevationGrid::notify(SoNotList * list)
 {
   SoField * f = list->getLastField();
+  PRIVATE(this)->lockLOD();
   if (f == &this->height ||
       f == &this->creaseAngle ||
       f == &this->ccw ||
@@ -897,7 +1180,12 @@ SoVRMLElevationGrid::notify(SoNotList * list)
       f == &this->xSpacing ||
       f == &this->zSpacing) {
     PRIVATE(this)->dirty = TRUE;
+    PRIVATE(this)->loddirty = TRUE;
+    PRIVATE(this)->maxfaceangle = -1.0f;
   }
+  // the chunks store normals, texture coordinates and colors
+  if (PRIVATE(this)->lod) PRIVATE(this)->lod->invalidateVertexData();
+  PRIVATE(this)->unlockLOD();
   inherited::notify(list);
 }
 
@@ -966,4 +1254,165 @@ SoVRMLElevationGrid::updateNormalCache(Binding & nbind)
 
 #undef PRIVATE
 
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/details/SoFaceDetail.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/VRMLnodes/SoVRMLShape.h>
+#include <Inventor/lists/SoPickedPointList.h>
+#include <cmath>
+
+namespace {
+
+struct ElevationGridTriangles {
+  SbList<SbVec3f> points;
+};
+
+void
+elevationgrid_triangle_cb(void * userdata, SoCallbackAction *,
+                          const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2,
+                          const SoPrimitiveVertex * v3)
+{
+  ElevationGridTriangles * triangles = static_cast<ElevationGridTriangles *>(userdata);
+  triangles->points.append(v1->getPoint());
+  triangles->points.append(v2->getPoint());
+  triangles->points.append(v3->getPoint());
+}
+
+// ray - triangle intersection in double precision, returning the ray
+// parameter, or -1 if there is no intersection
+double
+elevationgrid_intersect(const SbVec3f & start, const SbVec3f & dir,
+                        const SbVec3f & v0, const SbVec3f & v1, const SbVec3f & v2)
+{
+  double e1[3], e2[3], s[3], pv[3], qv[3], d[3];
+  for (int i = 0; i < 3; i++) {
+    e1[i] = double(v1[i]) - v0[i];
+    e2[i] = double(v2[i]) - v0[i];
+    s[i] = double(start[i]) - v0[i];
+    d[i] = dir[i];
+  }
+  pv[0] = d[1]*e2[2] - d[2]*e2[1];
+  pv[1] = d[2]*e2[0] - d[0]*e2[2];
+  pv[2] = d[0]*e2[1] - d[1]*e2[0];
+  const double det = e1[0]*pv[0] + e1[1]*pv[1] + e1[2]*pv[2];
+  if (fabs(det) < 1e-12) return -1.0;
+  const double u = (s[0]*pv[0] + s[1]*pv[1] + s[2]*pv[2]) / det;
+  if (u < 0.0 || u > 1.0) return -1.0;
+  qv[0] = s[1]*e1[2] - s[2]*e1[1];
+  qv[1] = s[2]*e1[0] - s[0]*e1[2];
+  qv[2] = s[0]*e1[1] - s[1]*e1[0];
+  const double v = (d[0]*qv[0] + d[1]*qv[1] + d[2]*qv[2]) / det;
+  if (v < 0.0 || u + v > 1.0) return -1.0;
+  return (e2[0]*qv[0] + e2[1]*qv[1] + e2[2]*qv[2]) / det;
+}
+
+float
+elevationgrid_random(unsigned int & seed)
+{
+  seed = seed * 1103515245u + 12345u;
+  return float((seed >> 8) & 0xffff) / 65536.0f;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(rayPick)
+{
+  const int xdim = 70, zdim = 50;
+  const float xspacing = 0.5f, zspacing = 0.75f;
+  unsigned int seed = 1;
+
+  SoVRMLElevationGrid * grid = new SoVRMLElevationGrid;
+  grid->xDimension = xdim;
+  grid->zDimension = zdim;
+  grid->xSpacing = xspacing;
+  grid->zSpacing = zspacing;
+  grid->height.setNum(xdim * zdim);
+  float * h = grid->height.startEditing();
+  for (int i = 0; i < xdim * zdim; i++) h[i] = 2.0f * elevationgrid_random(seed);
+  grid->height.finishEditing();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoVRMLShape * shape = new SoVRMLShape;
+  shape->geometry = grid;
+  root->addChild(shape);
+
+  // all the triangles of the grid, two per quad, in quad order
+  ElevationGridTriangles triangles;
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoVRMLElevationGrid::getClassTypeId(),
+                          elevationgrid_triangle_cb, &triangles);
+  cba.apply(root);
+  const int numtriangles = triangles.points.getLength() / 3;
+  BOOST_REQUIRE_EQUAL(numtriangles, (xdim-1) * (zdim-1) * 2);
+
+  const SbViewportRegion vp(100, 100);
+  int numhits = 0, numwrong = 0;
+  for (int ray = 0; ray < 300; ray++) {
+    // rays from above the grid, some straight down, and some starting
+    // outside the grid rectangle
+    const SbVec3f start(-5.0f + 45.0f * elevationgrid_random(seed), 5.0f,
+                        -5.0f + 47.0f * elevationgrid_random(seed));
+    SbVec3f dir(0.0f, -1.0f, 0.0f);
+    if (ray % 10) {
+      dir.setValue(6.0f * elevationgrid_random(seed) - 3.0f, -1.0f,
+                   6.0f * elevationgrid_random(seed) - 3.0f);
+    }
+    dir.normalize();
+
+    // the closest and all hits, from the triangles
+    double closest = -1.0;
+    int closestquad = -1;
+    int numall = 0;
+    for (int i = 0; i < numtriangles; i++) {
+      const double t = elevationgrid_intersect(start, dir, triangles.points[i*3],
+                                               triangles.points[i*3+1],
+                                               triangles.points[i*3+2]);
+      if (t < 0.0) continue;
+      numall++;
+      if (closest < 0.0 || t < closest) {
+        closest = t;
+        closestquad = i / 2;
+      }
+    }
+
+    SoRayPickAction rpa(vp);
+    rpa.setRay(start, dir);
+    rpa.apply(root);
+    const SoPickedPoint * pp = rpa.getPickedPoint();
+    if (closest < 0.0) {
+      if (pp != NULL) numwrong++;
+      continue;
+    }
+    numhits++;
+    if (pp == NULL) {
+      numwrong++;
+      continue;
+    }
+    const SbVec3f expected = start + dir * float(closest);
+    const SbVec3f & point = pp->getPoint();
+    if ((point - expected).length() > 1e-3f) numwrong++;
+    const SoFaceDetail * detail = static_cast<const SoFaceDetail *>(pp->getDetail());
+    if (detail == NULL || detail->getFaceIndex() != closestquad) numwrong++;
+
+    SoRayPickAction rpaall(vp);
+    rpaall.setRay(start, dir);
+    rpaall.setPickAll(TRUE);
+    rpaall.apply(root);
+    if (rpaall.getPickedPointList().getLength() != numall) numwrong++;
+  }
+  BOOST_CHECK_MESSAGE(numhits > 100, "too few rays hit the grid");
+  BOOST_CHECK_MESSAGE(numwrong == 0, "picked points differ from the triangles of the grid");
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_VRML97
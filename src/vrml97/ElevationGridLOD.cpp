@@ -0,0 +1,882 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <config.h>
+
+#ifdef HAVE_VRML97
+
+/*
+  SoVRMLElevationGridLOD implements the chunked level of detail
+  rendering used by SoVRMLElevationGrid for large grids. See the
+  header file for an overview.
+
+  A chunk rendered at level l uses the samples 0, 2^l, 2*2^l, ... and
+  the last sample along each axis. The samples next to the chunk
+  border form an inner ring, which is stitched to the four chunk
+  edges. Each edge is sampled at the coarser of the levels of the two
+  chunks sharing it, so neighbouring chunks always agree on the
+  vertices of the shared edge.
+*/
+
+#include "vrml97/SoVRMLElevationGridLOD.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbViewVolume.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCullElement.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoViewVolumeElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/system/gl.h>
+#include <Inventor/C/glue/gl.h>
+
+#include "rendering/SoGL.h"
+#include "rendering/SoVBO.h"
+
+// the maximum number of chunks which keep their vertex data
+static const int SOELEVGRID_MAXCACHED = 1024;
+
+// number of floats per vertex: position, normal and texture coordinate
+static const int SOELEVGRID_VERTEXSIZE = 8;
+
+class SoVRMLElevationGridLOD::Chunk {
+public:
+  Chunk(void)
+    : errorsvalid(FALSE), level(0), vertices(NULL), colors(NULL),
+      vertexvbo(NULL), colorvbo(NULL), indexvbo(NULL),
+      indexkey(0), lastframe(0)
+  { }
+  ~Chunk() { this->releaseVertexData(); }
+
+  void releaseVertexData(void) {
+    delete[] this->vertices;
+    delete[] this->colors;
+    delete this->vertexvbo;
+    delete this->colorvbo;
+    delete this->indexvbo;
+    this->vertices = NULL;
+    this->colors = NULL;
+    this->vertexvbo = NULL;
+    this->colorvbo = NULL;
+    this->indexvbo = NULL;
+    this->indexkey = 0;
+    this->indices.truncate(0);
+  }
+
+  int x0, z0, nx, nz;
+  SbBox3f box;
+  SbBool errorsvalid;
+  float error[NUMLEVELS];
+  // the selected level, or -1 if the chunk was culled
+  int level;
+
+  float * vertices;
+  float * colors;
+  SoVBO * vertexvbo;
+  SoVBO * colorvbo;
+  SoVBO * indexvbo;
+  SbList<GLushort> indices;
+  uint32_t indexkey;
+  uint32_t lastframe;
+};
+
+// *************************************************************************
+
+// Stores the sample positions along a chunk side of length len for
+// the given step. Returns the number of samples.
+static int
+soelevgrid_samples(const int len, const int step, int * samples)
+{
+  int n = 0;
+  for (int t = 0; t < len; t += step) samples[n++] = t;
+  samples[n++] = len;
+  return n;
+}
+
+// Finds the cell [a, b] of the samples for step containing t.
+static void
+soelevgrid_cell(const int len, const int step, const int t, int & a, int & b)
+{
+  a = (t / step) * step;
+  if (a >= len) a = ((len - 1) / step) * step;
+  b = a + step;
+  if (b > len) b = len;
+}
+
+// Adds the triangle p0, p1, p2 (chunk local x and z pairs) to
+// indices, counterclockwise when seen from above, the same
+// orientation as the full resolution quads.
+static void
+soelevgrid_triangle(SbList<int> & indices, const int nx,
+                    const int * p0, const int * p1, const int * p2)
+{
+  const int cross =
+    (p1[0] - p0[0]) * (p2[1] - p0[1]) - (p1[1] - p0[1]) * (p2[0] - p0[0]);
+  if (cross == 0) return;
+  if (cross > 0) {
+    const int * tmp = p1;
+    p1 = p2;
+    p2 = tmp;
+  }
+  indices.append(p0[1] * (nx + 1) + p0[0]);
+  indices.append(p1[1] * (nx + 1) + p1[0]);
+  indices.append(p2[1] * (nx + 1) + p2[0]);
+}
+
+// Triangulates the strip between the polylines a and b, which run in
+// the same direction along axis (0 for x, 1 for z).
+static void
+soelevgrid_stitch(SbList<int> & indices, const int nx, const int axis,
+                  const int (*a)[2], const int na,
+                  const int (*b)[2], const int nb)
+{
+  int ai = 0, bi = 0;
+  while (ai < na - 1 || bi < nb - 1) {
+    if (bi < nb - 1 && (ai == na - 1 || b[bi + 1][axis] <= a[ai + 1][axis])) {
+      soelevgrid_triangle(indices, nx, a[ai], b[bi], b[bi + 1]);
+      bi++;
+    }
+    else {
+      soelevgrid_triangle(indices, nx, a[ai], b[bi], a[ai + 1]);
+      ai++;
+    }
+  }
+}
+
+// Fills line with the points (samples[i], fixed) for axis 0, or
+// (fixed, samples[i]) for axis 1.
+static void
+soelevgrid_line(int (*line)[2], const int axis, const int fixed,
+                const int * samples, const int num)
+{
+  for (int i = 0; i < num; i++) {
+    line[i][axis] = samples[i];
+    line[i][1 - axis] = fixed;
+  }
+}
+
+static int
+soelevgrid_compare_frames(const void * a, const void * b)
+{
+  const uint32_t fa = *static_cast<const uint32_t *>(a);
+  const uint32_t fb = *static_cast<const uint32_t *>(b);
+  return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+}
+
+// *************************************************************************
+
+SoVRMLElevationGridLOD::SoVRMLElevationGridLOD(void)
+  : xdim(0), zdim(0), xspacing(1.0f), zspacing(1.0f), heights(NULL),
+    chunksx(0), chunksz(0), chunks(NULL), frame(0)
+{
+}
+
+SoVRMLElevationGridLOD::~SoVRMLElevationGridLOD()
+{
+  this->clear();
+}
+
+void
+SoVRMLElevationGridLOD::clear(void)
+{
+  delete[] this->chunks;
+  this->chunks = NULL;
+  this->chunksx = this->chunksz = 0;
+  for (int i = 0; i < this->quadtree.getLength(); i++) {
+    delete[] this->quadtree[i];
+  }
+  this->quadtree.truncate(0);
+  this->quadtreedims.truncate(0);
+  this->cached.truncate(0);
+}
+
+/*
+  Splits the grid into chunks, and builds the quadtree of chunk
+  bounding boxes. heights must stay valid until the next build().
+*/
+void
+SoVRMLElevationGridLOD::build(const int xdim, const int zdim,
+                              const float xspacing, const float zspacing,
+                              const float * heights)
+{
+  this->clear();
+  this->xdim = xdim;
+  this->zdim = zdim;
+  this->xspacing = xspacing;
+  this->zspacing = zspacing;
+  this->heights = heights;
+  if (xdim < 2 || zdim < 2) return;
+
+  this->chunksx = (xdim - 1 + CHUNKSIZE - 1) / CHUNKSIZE;
+  this->chunksz = (zdim - 1 + CHUNKSIZE - 1) / CHUNKSIZE;
+  this->chunks = new Chunk[this->chunksx * this->chunksz];
+
+  for (int cz = 0; cz < this->chunksz; cz++) {
+    for (int cx = 0; cx < this->chunksx; cx++) {
+      Chunk & chunk = this->chunks[cz * this->chunksx + cx];
+      chunk.x0 = cx * CHUNKSIZE;
+      chunk.z0 = cz * CHUNKSIZE;
+      chunk.nx = SbMin(static_cast<int>(CHUNKSIZE), xdim - 1 - chunk.x0);
+      chunk.nz = SbMin(static_cast<int>(CHUNKSIZE), zdim - 1 - chunk.z0);
+
+      float miny = FLT_MAX, maxy = -FLT_MAX;
+      for (int z = 0; z <= chunk.nz; z++) {
+        const float * h = heights + (chunk.z0 + z) * xdim + chunk.x0;
+        for (int x = 0; x <= chunk.nx; x++) {
+          if (h[x] < miny) miny = h[x];
+          if (h[x] > maxy) maxy = h[x];
+        }
+      }
+      chunk.box.setBounds(chunk.x0 * xspacing, miny, chunk.z0 * zspacing,
+                          (chunk.x0 + chunk.nx) * xspacing, maxy,
+                          (chunk.z0 + chunk.nz) * zspacing);
+    }
+  }
+
+  // merge 2x2 boxes until a single box remains
+  int w = this->chunksx, h = this->chunksz;
+  while (w > 1 || h > 1) {
+    const int pw = (w + 1) / 2, ph = (h + 1) / 2;
+    SbBox3f * boxes = new SbBox3f[pw * ph];
+    for (int z = 0; z < h; z++) {
+      for (int x = 0; x < w; x++) {
+        const SbBox3f & child = this->quadtree.getLength() ?
+          this->quadtree[this->quadtree.getLength() - 1][z * w + x] :
+          this->chunks[z * w + x].box;
+        boxes[(z / 2) * pw + x / 2].extendBy(child);
+      }
+    }
+    this->quadtree.append(boxes);
+    this->quadtreedims.append(pw);
+    this->quadtreedims.append(ph);
+    w = pw;
+    h = ph;
+  }
+}
+
+/*
+  Releases the vertex data of all chunks. Must be called when the
+  normals, texture coordinates or colors change.
+*/
+void
+SoVRMLElevationGridLOD::invalidateVertexData(void)
+{
+  for (int i = 0; i < this->cached.getLength(); i++) {
+    this->chunks[this->cached[i]].releaseVertexData();
+  }
+  this->cached.truncate(0);
+}
+
+int
+SoVRMLElevationGridLOD::getNumChunks(void) const
+{
+  return this->chunksx * this->chunksz;
+}
+
+void
+SoVRMLElevationGridLOD::getChunk(const int chunk, int & x0, int & z0, int & nx, int & nz) const
+{
+  const Chunk & c = this->chunks[chunk];
+  x0 = c.x0;
+  z0 = c.z0;
+  nx = c.nx;
+  nz = c.nz;
+}
+
+int
+SoVRMLElevationGridLOD::getLevel(const int chunk) const
+{
+  return this->chunks[chunk].level;
+}
+
+void
+SoVRMLElevationGridLOD::setLevel(const int chunk, const int level)
+{
+  this->chunks[chunk].level = level;
+}
+
+/*
+  Returns the largest vertical distance between the full resolution
+  grid and the chunk rendered at level. The error never decreases
+  with the level.
+*/
+float
+SoVRMLElevationGridLOD::getError(const int chunk, const int level)
+{
+  Chunk & c = this->chunks[chunk];
+  if (!c.errorsvalid) this->computeErrors(c);
+  return c.error[level];
+}
+
+void
+SoVRMLElevationGridLOD::computeErrors(Chunk & chunk)
+{
+  const int xdim = this->xdim;
+  const float * base = this->heights + chunk.z0 * xdim + chunk.x0;
+
+  chunk.error[0] = 0.0f;
+  for (int level = 1; level < NUMLEVELS; level++) {
+    const int step = 1 << level;
+    float maxerr = chunk.error[level - 1];
+    for (int z = 0; z <= chunk.nz; z++) {
+      int za, zb;
+      soelevgrid_cell(chunk.nz, step, z, za, zb);
+      const float w = float(z - za) / float(zb - za);
+      for (int x = 0; x <= chunk.nx; x++) {
+        int xa, xb;
+        soelevgrid_cell(chunk.nx, step, x, xa, xb);
+        const float u = float(x - xa) / float(xb - xa);
+        const float h00 = base[za * xdim + xa];
+        const float h10 = base[za * xdim + xb];
+        const float h01 = base[zb * xdim + xa];
+        const float h11 = base[zb * xdim + xb];
+        // the quads are split along the (xa, zb) - (xb, za) diagonal
+        const float h = (u + w >= 1.0f) ?
+          h11 * (u + w - 1.0f) + h01 * (1.0f - u) + h10 * (1.0f - w) :
+          h00 * (1.0f - u - w) + h10 * u + h01 * w;
+        const float err = static_cast<float>(std::fabs(base[z * xdim + x] - h));
+        if (err > maxerr) maxerr = err;
+      }
+    }
+    chunk.error[level] = maxerr;
+  }
+  chunk.errorsvalid = TRUE;
+}
+
+/*
+  Culls the chunks against the view volume, and selects the level of
+  each visible chunk so that its error projects to at most pixelerror
+  pixels. Culled chunks get level -1. Returns the number of visible
+  chunks.
+*/
+int
+SoVRMLElevationGridLOD::select(SoState * state, const float pixelerror)
+{
+  const int numchunks = this->getNumChunks();
+  int i;
+  for (i = 0; i < numchunks; i++) this->chunks[i].level = -1;
+  if (numchunks == 0) return 0;
+
+  // walk down the quadtree, testing the children of the boxes which
+  // are not culled
+  SbList<int> candidates, next;
+  SbList<SbBox3f> boxes;
+  int level = this->quadtree.getLength() - 1;
+  const int toplength = (level >= 0) ?
+    this->quadtreedims[2 * level] * this->quadtreedims[2 * level + 1] : numchunks;
+  for (i = 0; i < toplength; i++) candidates.append(i);
+
+  while (TRUE) {
+    const int num = candidates.getLength();
+    boxes.truncate(0);
+    for (i = 0; i < num; i++) {
+      boxes.append(level >= 0 ? this->quadtree[level][candidates[i]] :
+                   this->chunks[candidates[i]].box);
+    }
+    SbBool * outside = new SbBool[num > 0 ? num : 1];
+    if (num > 0) SoCullElement::cullTestBoxes(state, boxes.getArrayPtr(), num, outside);
+
+    if (level < 0) {
+      for (i = 0; i < num; i++) {
+        if (!outside[i]) this->chunks[candidates[i]].level = 0;
+      }
+      delete[] outside;
+      break;
+    }
+
+    const int w = this->quadtreedims[2 * level];
+    const int cw = (level > 0) ? this->quadtreedims[2 * (level - 1)] : this->chunksx;
+    const int ch = (level > 0) ? this->quadtreedims[2 * (level - 1) + 1] : this->chunksz;
+    next.truncate(0);
+    for (i = 0; i < num; i++) {
+      if (outside[i]) continue;
+      const int x = candidates[i] % w;
+      const int z = candidates[i] / w;
+      for (int dz = 0; dz < 2; dz++) {
+        for (int dx = 0; dx < 2; dx++) {
+          const int cx = 2 * x + dx, cz = 2 * z + dz;
+          if (cx < cw && cz < ch) next.append(cz * cw + cx);
+        }
+      }
+    }
+    delete[] outside;
+    candidates = next;
+    level--;
+  }
+
+  const SbViewVolume & vv = SoViewVolumeElement::get(state);
+  const SbMatrix & mm = SoModelMatrixElement::get(state);
+  const SbViewportRegion & vp = SoViewportRegionElement::get(state);
+  const float height = vv.getHeight();
+  const SbBool perspective = vv.getProjectionType() == SbViewVolume::PERSPECTIVE;
+  // pixels per unit of world space distance, at unit distance from
+  // the eye for perspective projections
+  float pixelsize = 0.0f;
+  if (height > 0.0f) {
+    pixelsize = float(vp.getViewportSizePixels()[1]) / height;
+    if (perspective) pixelsize *= vv.getNearDist();
+  }
+
+  const SbVec3f & eye = vv.getProjectionPoint();
+  SbVec3f objeye, up;
+  mm.inverse().multVecMatrix(eye, objeye);
+  mm.multDirMatrix(SbVec3f(0.0f, 1.0f, 0.0f), up);
+  const float errorscale = up.length() * pixelsize;
+
+  int numvisible = 0;
+  for (i = 0; i < numchunks; i++) {
+    Chunk & chunk = this->chunks[i];
+    if (chunk.level < 0) continue;
+    numvisible++;
+    if (errorscale <= 0.0f) continue;
+
+    float scale = errorscale;
+    if (perspective) {
+      // distance from the eye to the closest point of the chunk box
+      const SbVec3f & bmin = chunk.box.getMin();
+      const SbVec3f & bmax = chunk.box.getMax();
+      SbVec3f closest;
+      for (int j = 0; j < 3; j++) {
+        closest[j] = SbClamp(objeye[j], bmin[j], bmax[j]);
+      }
+      SbVec3f world;
+      mm.multVecMatrix(closest, world);
+      const float dist = (world - eye).length();
+      if (dist <= vv.getNearDist()) continue;
+      scale /= dist;
+    }
+    for (int l = NUMLEVELS - 1; l > 0; l--) {
+      if (this->getError(i, l) * scale <= pixelerror) {
+        chunk.level = l;
+        break;
+      }
+    }
+  }
+  return numvisible;
+}
+
+// Returns the level used for side (0: -z, 1: +x, 2: +z, 3: -x) of
+// chunk, the coarser of the levels of the two chunks sharing the side.
+int
+SoVRMLElevationGridLOD::getEdgeStep(const int chunk, const int side) const
+{
+  const int level = this->chunks[chunk].level;
+  const int cx = chunk % this->chunksx;
+  const int cz = chunk / this->chunksx;
+  int neighbour = -1;
+  switch (side) {
+  case 0: if (cz > 0) neighbour = chunk - this->chunksx; break;
+  case 1: if (cx < this->chunksx - 1) neighbour = chunk + 1; break;
+  case 2: if (cz < this->chunksz - 1) neighbour = chunk + this->chunksx; break;
+  case 3: if (cx > 0) neighbour = chunk - 1; break;
+  }
+  if (neighbour >= 0 && this->chunks[neighbour].level > level) {
+    return this->chunks[neighbour].level;
+  }
+  return level;
+}
+
+/*
+  Appends the triangles of chunk at its current level to indices, as
+  indices into the (nx+1) x (nz+1) full resolution vertices of the
+  chunk, stored row by row.
+*/
+void
+SoVRMLElevationGridLOD::triangulate(const int chunk, SbList<int> & indices) const
+{
+  const Chunk & c = this->chunks[chunk];
+  const int nx = c.nx, nz = c.nz;
+  const int step = 1 << SbMax(c.level, 0);
+
+  int xs[CHUNKSIZE + 1], zs[CHUNKSIZE + 1], tmp[CHUNKSIZE + 1];
+  const int numx = soelevgrid_samples(nx, step, xs);
+  const int numz = soelevgrid_samples(nz, step, zs);
+
+  // the four edges, sampled at the edge levels
+  int edges[4][CHUNKSIZE + 1][2];
+  int numedge[4];
+  for (int side = 0; side < 4; side++) {
+    const int edgestep = 1 << this->getEdgeStep(chunk, side);
+    const int axis = (side == 0 || side == 2) ? 0 : 1;
+    const int n = soelevgrid_samples(axis == 0 ? nx : nz, edgestep, tmp);
+    const int fixed = (side == 0 || side == 3) ? 0 : (axis == 0 ? nz : nx);
+    soelevgrid_line(edges[side], axis, fixed, tmp, n);
+    numedge[side] = n;
+  }
+
+  if (numz == 2) {
+    // a single row of quads, so the -x and +x edges are single
+    // segments as well
+    soelevgrid_stitch(indices, nx, 0, edges[0], numedge[0], edges[2], numedge[2]);
+    return;
+  }
+  if (numx == 2) {
+    soelevgrid_stitch(indices, nx, 1, edges[3], numedge[3], edges[1], numedge[1]);
+    return;
+  }
+
+  // the interior quads
+  for (int j = 1; j < numz - 2; j++) {
+    for (int i = 1; i < numx - 2; i++) {
+      const int v0[2] = { xs[i], zs[j + 1] };
+      const int v1[2] = { xs[i + 1], zs[j + 1] };
+      const int v2[2] = { xs[i + 1], zs[j] };
+      const int v3[2] = { xs[i], zs[j] };
+      soelevgrid_triangle(indices, nx, v0, v1, v2);
+      soelevgrid_triangle(indices, nx, v0, v2, v3);
+    }
+  }
+
+  // stitch the inner ring to the edges
+  int inner[CHUNKSIZE + 1][2];
+  soelevgrid_line(inner, 0, zs[1], xs + 1, numx - 2);
+  soelevgrid_stitch(indices, nx, 0, inner, numx - 2, edges[0], numedge[0]);
+  soelevgrid_line(inner, 0, zs[numz - 2], xs + 1, numx - 2);
+  soelevgrid_stitch(indices, nx, 0, inner, numx - 2, edges[2], numedge[2]);
+  soelevgrid_line(inner, 1, xs[1], zs + 1, numz - 2);
+  soelevgrid_stitch(indices, nx, 1, inner, numz - 2, edges[3], numedge[3]);
+  soelevgrid_line(inner, 1, xs[numx - 2], zs + 1, numz - 2);
+  soelevgrid_stitch(indices, nx, 1, inner, numz - 2, edges[1], numedge[1]);
+}
+
+void
+SoVRMLElevationGridLOD::computeVertexData(Chunk & chunk, const SbVec3f * normals,
+                                          const SbVec2f * tcoords, const SbColor * colors,
+                                          const SbBool ccw)
+{
+  const int xdim = this->xdim, zdim = this->zdim;
+  const float * h = this->heights;
+  const int numvertices = (chunk.nx + 1) * (chunk.nz + 1);
+  chunk.vertices = new float[numvertices * SOELEVGRID_VERTEXSIZE];
+  if (colors) chunk.colors = new float[numvertices * 3];
+
+  float * dst = chunk.vertices;
+  float * cdst = chunk.colors;
+  for (int z = chunk.z0; z <= chunk.z0 + chunk.nz; z++) {
+    for (int x = chunk.x0; x <= chunk.x0 + chunk.nx; x++) {
+      const int idx = z * xdim + x;
+      dst[0] = x * this->xspacing;
+      dst[1] = h[idx];
+      dst[2] = z * this->zspacing;
+
+      SbVec3f n;
+      if (normals) {
+        n = normals[idx];
+      }
+      else {
+        // smooth normals from the height differences
+        const int xa = SbMax(x - 1, 0), xb = SbMin(x + 1, xdim - 1);
+        const int za = SbMax(z - 1, 0), zb = SbMin(z + 1, zdim - 1);
+        const float dx = (h[z * xdim + xb] - h[z * xdim + xa]) / ((xb - xa) * this->xspacing);
+        const float dz = (h[zb * xdim + x] - h[za * xdim + x]) / ((zb - za) * this->zspacing);
+        n.setValue(-dx, 1.0f, -dz);
+        n.normalize();
+        if (!ccw) n.negate();
+      }
+      dst[3] = n[0];
+      dst[4] = n[1];
+      dst[5] = n[2];
+
+      if (tcoords) {
+        dst[6] = tcoords[idx][0];
+        dst[7] = tcoords[idx][1];
+      }
+      else {
+        dst[6] = float(x) / float(xdim - 1);
+        dst[7] = float(z) / float(zdim - 1);
+      }
+      dst += SOELEVGRID_VERTEXSIZE;
+
+      if (cdst) {
+        cdst[0] = colors[idx][0];
+        cdst[1] = colors[idx][1];
+        cdst[2] = colors[idx][2];
+        cdst += 3;
+      }
+    }
+  }
+}
+
+// Releases the vertex data of the least recently rendered chunks when
+// too many chunks have vertex data.
+void
+SoVRMLElevationGridLOD::releaseVertexData(void)
+{
+  if (this->cached.getLength() <= SOELEVGRID_MAXCACHED) return;
+
+  // release the chunks rendered longest ago, but never the chunks
+  // rendered in this frame
+  const int num = this->cached.getLength();
+  uint32_t * frames = new uint32_t[num];
+  int i;
+  for (i = 0; i < num; i++) frames[i] = this->chunks[this->cached[i]].lastframe;
+  qsort(frames, num, sizeof(uint32_t), soelevgrid_compare_frames);
+  const uint32_t limit = frames[num - SOELEVGRID_MAXCACHED - 1];
+  delete[] frames;
+
+  for (i = 0; i < this->cached.getLength(); ) {
+    Chunk & chunk = this->chunks[this->cached[i]];
+    if (chunk.lastframe <= limit && chunk.lastframe != this->frame) {
+      chunk.releaseVertexData();
+      this->cached.removeFast(i);
+    }
+    else i++;
+  }
+}
+
+/*
+  Renders the visible chunks at the levels selected by select(), using
+  vertex arrays, or vertex buffer objects when the chunk is large
+  enough. normals, tcoords and colors are the per vertex values of the
+  whole grid, or NULL to use generated normals, default texture
+  coordinates and no per vertex colors. Vertex arrays must be
+  supported by the GL driver.
+*/
+void
+SoVRMLElevationGridLOD::render(SoGLRenderAction * action,
+                               const SbVec3f * normals, const SbVec2f * tcoords,
+                               const SbColor * colors, const SbBool ccw, const SbBool dotex)
+{
+  SoState * state = action->getState();
+  const cc_glglue * glue = sogl_glue_instance(state);
+  const uint32_t contextid = action->getCacheContext();
+  const SbBool canvbo =
+    SoGLDriverDatabase::isSupported(glue, SO_GL_VBO_IN_DISPLAYLIST) ||
+    !SoCacheElement::anyOpen(state);
+  const GLsizei stride = SOELEVGRID_VERTEXSIZE * sizeof(float);
+
+  this->frame++;
+
+  if (dotex && SoGLDriverDatabase::isSupported(glue, SO_GL_MULTITEXTURE)) {
+    cc_glglue_glClientActiveTexture(glue, GL_TEXTURE0);
+  }
+  cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+  cc_glglue_glEnableClientState(glue, GL_NORMAL_ARRAY);
+  if (dotex) cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  if (colors) cc_glglue_glEnableClientState(glue, GL_COLOR_ARRAY);
+
+  SbList<int> indices;
+  SbBool didbind = FALSE;
+  const int numchunks = this->getNumChunks();
+  for (int i = 0; i < numchunks; i++) {
+    Chunk & chunk = this->chunks[i];
+    if (chunk.level < 0) continue;
+
+    if (chunk.vertices && colors && !chunk.colors) chunk.releaseVertexData();
+    if (chunk.vertices == NULL) {
+      this->computeVertexData(chunk, normals, tcoords, colors, ccw);
+      if (this->cached.find(i) < 0) this->cached.append(i);
+    }
+    chunk.lastframe = this->frame;
+
+    uint32_t key = 1 + chunk.level;
+    for (int side = 0; side < 4; side++) {
+      key = key * NUMLEVELS + this->getEdgeStep(i, side);
+    }
+    if (key != chunk.indexkey) {
+      indices.truncate(0);
+      this->triangulate(i, indices);
+      chunk.indices.truncate(0);
+      for (int j = 0; j < indices.getLength(); j++) {
+        chunk.indices.append(static_cast<GLushort>(indices[j]));
+      }
+      chunk.indexkey = key;
+      if (chunk.indexvbo) {
+        chunk.indexvbo->setBufferData(chunk.indices.getArrayPtr(),
+                                      chunk.indices.getLength() * sizeof(GLushort));
+      }
+    }
+    if (chunk.indices.getLength() == 0) continue;
+
+    const int numvertices = (chunk.nx + 1) * (chunk.nz + 1);
+    const SbBool dovbo = canvbo && SoVBO::shouldCreateVBO(state, contextid, numvertices);
+    const char * vertices = reinterpret_cast<const char *>(chunk.vertices);
+    const char * vcolors = reinterpret_cast<const char *>(chunk.colors);
+    if (dovbo) {
+      if (chunk.vertexvbo == NULL) {
+        chunk.vertexvbo = new SoVBO;
+        chunk.vertexvbo->setBufferData(chunk.vertices, numvertices * stride);
+        chunk.indexvbo = new SoVBO(GL_ELEMENT_ARRAY_BUFFER);
+        chunk.indexvbo->setBufferData(chunk.indices.getArrayPtr(),
+                                      chunk.indices.getLength() * sizeof(GLushort));
+      }
+      if (colors && chunk.colorvbo == NULL) {
+        chunk.colorvbo = new SoVBO;
+        chunk.colorvbo->setBufferData(chunk.colors, numvertices * 3 * sizeof(float));
+      }
+      vertices = NULL;
+      vcolors = NULL;
+      if (colors) {
+        chunk.colorvbo->bindBuffer(contextid);
+        cc_glglue_glColorPointer(glue, 3, GL_FLOAT, 0, vcolors);
+      }
+      chunk.vertexvbo->bindBuffer(contextid);
+      didbind = TRUE;
+    }
+    else {
+      if (didbind) {
+        cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+        didbind = FALSE;
+      }
+      if (colors) cc_glglue_glColorPointer(glue, 3, GL_FLOAT, 0, vcolors);
+    }
+    cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, stride, vertices);
+    cc_glglue_glNormalPointer(glue, GL_FLOAT, stride, vertices ? vertices + 3 * sizeof(float) :
+                              reinterpret_cast<const char *>(3 * sizeof(float)));
+    if (dotex) {
+      cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, stride, vertices ? vertices + 6 * sizeof(float) :
+                                  reinterpret_cast<const char *>(6 * sizeof(float)));
+    }
+
+    if (dovbo) {
+      chunk.indexvbo->bindBuffer(contextid);
+      cc_glglue_glDrawElements(glue, GL_TRIANGLES, chunk.indices.getLength(),
+                               GL_UNSIGNED_SHORT, NULL);
+      cc_glglue_glBindBuffer(glue, GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    else {
+      cc_glglue_glDrawElements(glue, GL_TRIANGLES, chunk.indices.getLength(),
+                               GL_UNSIGNED_SHORT, chunk.indices.getArrayPtr());
+    }
+  }
+  if (didbind) cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+
+  cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+  cc_glglue_glDisableClientState(glue, GL_NORMAL_ARRAY);
+  if (dotex) cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  if (colors) cc_glglue_glDisableClientState(glue, GL_COLOR_ARRAY);
+
+  this->releaseVertexData();
+}
+
+#ifdef COIN_TEST_SUITE
+
+#include <vector>
+
+namespace {
+
+// Triangulates chunk, and marks the grid vertices it uses in
+// used. Returns the doubled area covered by the triangles, in grid
+// units, or -1 if the triangles do not all have the same orientation.
+int
+elevgridlod_triangulate(const SoVRMLElevationGridLOD & lod, const int chunk,
+                        const int xdim, std::vector<char> & used)
+{
+  int x0, z0, nx, nz;
+  lod.getChunk(chunk, x0, z0, nx, nz);
+  SbList<int> indices;
+  lod.triangulate(chunk, indices);
+
+  int area = 0;
+  for (int i = 0; i < indices.getLength(); i += 3) {
+    int x[3], z[3];
+    for (int j = 0; j < 3; j++) {
+      x[j] = x0 + indices[i + j] % (nx + 1);
+      z[j] = z0 + indices[i + j] / (nx + 1);
+      used[z[j] * xdim + x[j]] = 1;
+    }
+    const int cross = (x[1] - x[0]) * (z[2] - z[0]) - (z[1] - z[0]) * (x[2] - x[0]);
+    if (cross >= 0) return -1;
+    area -= cross;
+  }
+  return area;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(crackFreeChunkEdges)
+{
+  // 3 x 2 chunks, the last ones smaller than CHUNKSIZE
+  const int size = SoVRMLElevationGridLOD::CHUNKSIZE;
+  const int xdim = 2 * size + 9, zdim = size + 17;
+  std::vector<float> heights(xdim * zdim);
+  for (int i = 0; i < xdim * zdim; i++) {
+    heights[i] = float((i * 7919) % 13);
+  }
+
+  SoVRMLElevationGridLOD lod;
+  lod.build(xdim, zdim, 1.0f, 1.0f, &heights[0]);
+  const int numchunks = lod.getNumChunks();
+  BOOST_REQUIRE_EQUAL(numchunks, 6);
+
+  // try a few different level combinations of neighbouring chunks
+  for (int offset = 0; offset < SoVRMLElevationGridLOD::NUMLEVELS; offset++) {
+    for (int i = 0; i < numchunks; i++) {
+      lod.setLevel(i, (i * 5 + offset) % SoVRMLElevationGridLOD::NUMLEVELS);
+    }
+
+    std::vector< std::vector<char> > used(numchunks);
+    for (int i = 0; i < numchunks; i++) {
+      int x0, z0, nx, nz;
+      lod.getChunk(i, x0, z0, nx, nz);
+      used[i].resize(xdim * zdim, 0);
+      // the triangles must cover the whole chunk
+      BOOST_CHECK_EQUAL(elevgridlod_triangulate(lod, i, xdim, used[i]), 2 * nx * nz);
+    }
+
+    const int chunksx = 3;
+    for (int i = 0; i < numchunks; i++) {
+      int x0, z0, nx, nz;
+      lod.getChunk(i, x0, z0, nx, nz);
+      if (i % chunksx < chunksx - 1) {
+        // the edge shared with the chunk to the right
+        const int x = x0 + nx;
+        for (int z = z0; z <= z0 + nz; z++) {
+          BOOST_CHECK_MESSAGE(used[i][z * xdim + x] == used[i + 1][z * xdim + x],
+                              "vertex (" << x << ", " << z << ") used by only one of the chunks "
+                              << i << " and " << i + 1);
+        }
+      }
+      if (i + chunksx < numchunks) {
+        // the edge shared with the chunk below
+        const int z = z0 + nz;
+        for (int x = x0; x <= x0 + nx; x++) {
+          BOOST_CHECK_MESSAGE(used[i][z * xdim + x] == used[i + chunksx][z * xdim + x],
+                              "vertex (" << x << ", " << z << ") used by only one of the chunks "
+                              << i << " and " << i + chunksx);
+        }
+      }
+    }
+  }
+}
+
+#endif // COIN_TEST_SUITE
+
+#endif // HAVE_VRML97
@@ -363,6 +363,8 @@
 #include "rendering/SoGL.h"
 #include "misc/SbHash.h"
 #include "caches/SoVBOCache.h"
+#include "caches/SoTessellationCache.h"
+#include "tidbitsp.h"
 
 // *************************************************************************
 
@@ -418,31 +420,30 @@ public:
 
   SoVRMLExtrusionP(SoVRMLExtrusion * master)
     :master(master),
-     coord(32),
-     tcoord(32),
-     idx(32),
      gen(TRUE),
+     geometry(NULL),
      dirty(TRUE),
      vbocache(NULL)
 #ifdef COIN_THREADSAFE
      , rwmutex(SbRWMutex::READ_PRECEDENCE)
 #endif // COIN_THREADSAFE
   {
-    this->tess.setCallback(tess_callback, this);
   }
   ~SoVRMLExtrusionP() {
     if (this->vbocache) this->vbocache->unref();
+    if (this->geometry && tesscache) tesscache->unref(this->geometry);
   }
 
   SoVRMLExtrusion * master;
-  SbList <SbVec3f> coord;
-  SbList <SbVec2f> tcoord;
-  SbList <int32_t> idx;
   SoNormalGenerator gen;
   SbTesselator tess;
   static void tess_callback(void *, void *, void *, void *);
-  void generateCoords(void);
-  void generateNormals(void);
+  void updateGeometry(void);
+  void generateCoords(SoTessellationCache::Geometry & geometry);
+  void generateNormals(SoTessellationCache::Geometry & geometry);
+  // the coordinates, texture coordinates, face indices and normals,
+  // shared with all other extrusions with the same field values
+  const SoTessellationCache::Geometry * geometry;
   SbBool dirty;
   SoVBOCache * vbocache;
 
@@ -467,8 +468,16 @@ public:
   void writeLock(void) { }
   void writeUnlock(void) { }
 #endif // !COIN_THREADSAFE
+
+  static SoTessellationCache * tesscache;
+  static void cleanup(void) {
+    delete tesscache;
+    tesscache = NULL;
+  }
 };
 
+SoTessellationCache * SoVRMLExtrusionP::tesscache = NULL;
+
 #define PRIVATE(obj) (obj)->pimpl
 #define PUBLIC(obj) obj->master
 
@@ -485,6 +494,9 @@ void
 SoVRMLExtrusion::initClass(void) // static
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoVRMLExtrusion, SO_VRML97_NODE_TYPE);
+
+  SoVRMLExtrusionP::tesscache = new SoTessellationCache(64);
+  coin_atexit((coin_atexit_f *)SoVRMLExtrusionP::cleanup, CC_ATEXIT_NORMAL);
 }
 
 /*!
@@ -552,12 +564,12 @@ SoVRMLExtrusion::GLRender(SoGLRenderAction * action)
       (SoMultiTextureCoordinateElement::getType(state) !=
        SoMultiTextureCoordinateElement::TEXGEN)) {
     SoGLMultiTextureCoordinateElement::setTexGen(state, this, NULL);
-    SoMultiTextureCoordinateElement::set2(state, this, PRIVATE(this)->tcoord.getLength(),
-                                          PRIVATE(this)->tcoord.getArrayPtr());
+    SoMultiTextureCoordinateElement::set2(state, this, PRIVATE(this)->geometry->texcoords.getLength(),
+                                          PRIVATE(this)->geometry->texcoords.getArrayPtr());
   }
   const uint32_t contextid = SoGLCacheContextElement::get(state);
   const cc_glglue * glue = cc_glglue_instance(contextid);
-  SbBool vbo = SoVBO::shouldCreateVBO(state, contextid, PRIVATE(this)->coord.getLength());
+  SbBool vbo = SoVBO::shouldCreateVBO(state, contextid, PRIVATE(this)->geometry->coords.getLength());
 
   if (vbo) PRIVATE(this)->updateVBO(action);
 
@@ -621,9 +633,9 @@ SoVRMLExtrusion::GLRender(SoGLRenderAction * action)
     }
   }
   else {
-    const SbVec3f * normals = PRIVATE(this)->gen.getNormals();
+    const SbVec3f * normals = PRIVATE(this)->geometry->normals.getArrayPtr();
 
-    SoCoordinateElement::set3(state, this, PRIVATE(this)->coord.getLength(), PRIVATE(this)->coord.getArrayPtr());
+    SoCoordinateElement::set3(state, this, PRIVATE(this)->geometry->coords.getLength(), PRIVATE(this)->geometry->coords.getArrayPtr());
     const SoCoordinateElement * coords = SoCoordinateElement::getInstance(state);
 
     if (doTextures) {
@@ -633,8 +645,8 @@ SoVRMLExtrusion::GLRender(SoGLRenderAction * action)
         if (enabled[i] && (SoMultiTextureCoordinateElement::getType(state, i) !=
                            SoMultiTextureCoordinateElement::FUNCTION)) {
           SoMultiTextureCoordinateElement::set2(state, this, i,
-                                                PRIVATE(this)->tcoord.getLength(),
-                                                PRIVATE(this)->tcoord.getArrayPtr());
+                                                PRIVATE(this)->geometry->texcoords.getLength(),
+                                                PRIVATE(this)->geometry->texcoords.getArrayPtr());
         }
       }
     }
@@ -655,14 +667,14 @@ SoVRMLExtrusion::GLRender(SoGLRenderAction * action)
     }
 
     sogl_render_faceset((SoGLCoordinateElement *) coords,
-                        PRIVATE(this)->idx.getArrayPtr(),
-                        PRIVATE(this)->idx.getLength(),
+                        PRIVATE(this)->geometry->indices.getArrayPtr(),
+                        PRIVATE(this)->geometry->indices.getLength(),
                         normals,
                         NULL,
                         &mb,
                         NULL,
                         &tb,
-                        PRIVATE(this)->idx.getArrayPtr(),
+                        PRIVATE(this)->geometry->indices.getArrayPtr(),
                         &vab,
                         3, /* SoIndexedFaceSet::PER_VERTEX */
                         0,
@@ -676,7 +688,7 @@ SoVRMLExtrusion::GLRender(SoGLRenderAction * action)
   state->pop();
 
   // send approx number of triangles for autocache handling
-  sogl_autocache_update(state, PRIVATE(this)->idx.getLength() / 4,
+  sogl_autocache_update(state, PRIVATE(this)->geometry->indices.getLength() / 4,
                         vbo);
 }
 
@@ -686,7 +698,7 @@ SoVRMLExtrusion::getPrimitiveCount(SoGetPrimitiveCountAction * action)
 {
   PRIVATE(this)->readLock();
   this->updateCache();
-  action->addNumTriangles(PRIVATE(this)->idx.getLength() / 4);
+  action->addNumTriangles(PRIVATE(this)->geometry->indices.getLength() / 4);
   PRIVATE(this)->readUnlock();
 }
 
@@ -700,8 +712,8 @@ SoVRMLExtrusion::computeBBox(SoAction * COIN_UNUSED_ARG(action),
 
   this->updateCache();
 
-  int num = PRIVATE(this)->coord.getLength();
-  const SbVec3f * coords = PRIVATE(this)->coord.getArrayPtr();
+  int num = PRIVATE(this)->geometry->coords.getLength();
+  const SbVec3f * coords = PRIVATE(this)->geometry->coords.getArrayPtr();
 
   box.makeEmpty();
   while (num--) {
@@ -718,11 +730,11 @@ SoVRMLExtrusion::generatePrimitives(SoAction * action)
   PRIVATE(this)->readLock();
   this->updateCache();
 
-  const SbVec3f * normals = PRIVATE(this)->gen.getNormals();
-  const SbVec2f * tcoords = PRIVATE(this)->tcoord.getArrayPtr();
-  const SbVec3f * coords = PRIVATE(this)->coord.getArrayPtr();
-  const int32_t * iptr = PRIVATE(this)->idx.getArrayPtr();
-  const int32_t * endptr = iptr + PRIVATE(this)->idx.getLength();
+  const SbVec3f * normals = PRIVATE(this)->geometry->normals.getArrayPtr();
+  const SbVec2f * tcoords = PRIVATE(this)->geometry->texcoords.getArrayPtr();
+  const SbVec3f * coords = PRIVATE(this)->geometry->coords.getArrayPtr();
+  const int32_t * iptr = PRIVATE(this)->geometry->indices.getArrayPtr();
+  const int32_t * endptr = iptr + PRIVATE(this)->geometry->indices.getLength();
 
   SoState * state = action->getState();
   state->push();
@@ -733,8 +745,8 @@ SoVRMLExtrusion::generatePrimitives(SoAction * action)
     if (enabled[i] && (SoMultiTextureCoordinateElement::getType(state, i) !=
                        SoMultiTextureCoordinateElement::FUNCTION)) {
       SoMultiTextureCoordinateElement::set2(state, this, i,
-                                            PRIVATE(this)->tcoord.getLength(),
-                                            PRIVATE(this)->tcoord.getArrayPtr());
+                                            PRIVATE(this)->geometry->texcoords.getLength(),
+                                            PRIVATE(this)->geometry->texcoords.getArrayPtr());
     }
   }
   SoShapeHintsElement::set(state, this,
@@ -799,14 +811,49 @@ SoVRMLExtrusion::updateCache(void)
   if (PRIVATE(this)->dirty) {
     PRIVATE(this)->readUnlock();
     PRIVATE(this)->writeLock();
-    PRIVATE(this)->generateCoords();
-    PRIVATE(this)->generateNormals();
+    PRIVATE(this)->updateGeometry();
     PRIVATE(this)->dirty = FALSE;
     PRIVATE(this)->writeUnlock();
     PRIVATE(this)->readLock();
   }
 }
 
+// looks up the geometry for the current field values in the shared
+// tessellation cache, and generates it if it isn't found.
+void
+SoVRMLExtrusionP::updateGeometry(void)
+{
+  SoTessellationCache::Key key;
+  key.add(static_cast<int32_t>(PUBLIC(this)->beginCap.getValue()));
+  key.add(static_cast<int32_t>(PUBLIC(this)->endCap.getValue()));
+  key.add(static_cast<int32_t>(PUBLIC(this)->ccw.getValue()));
+  key.add(static_cast<int32_t>(PUBLIC(this)->convex.getValue()));
+  key.add(PUBLIC(this)->creaseAngle.getValue());
+
+  const int numcross = PUBLIC(this)->crossSection.getNum();
+  key.add(numcross ? PUBLIC(this)->crossSection.getValues(0)->getValue() : NULL, numcross * 2);
+  const int numspine = PUBLIC(this)->spine.getNum();
+  key.add(numspine ? PUBLIC(this)->spine.getValues(0)->getValue() : NULL, numspine * 3);
+  const int numscale = PUBLIC(this)->scale.getNum();
+  key.add(numscale ? PUBLIC(this)->scale.getValues(0)->getValue() : NULL, numscale * 2);
+  const int numorient = PUBLIC(this)->orientation.getNum();
+  const SbRotation * orient = PUBLIC(this)->orientation.getValues(0);
+  key.add(static_cast<int32_t>(numorient));
+  for (int i = 0; i < numorient; i++) {
+    key.add(orient[i].getValue(), 4);
+  }
+
+  const SoTessellationCache::Geometry * found = tesscache->find(key);
+  if (found == NULL) {
+    SoTessellationCache::Geometry * geometry = new SoTessellationCache::Geometry;
+    this->generateCoords(*geometry);
+    this->generateNormals(*geometry);
+    found = tesscache->insert(key, geometry);
+  }
+  if (this->geometry) tesscache->unref(this->geometry);
+  this->geometry = found;
+}
+
 void
 SoVRMLExtrusionP::updateVBO(SoAction * action)
 {
@@ -850,11 +897,11 @@ SoVRMLExtrusionP::generateVBO(SoAction * action, SoTextureCoordinateBundle & tb)
 
   SbBool istexfunc = tb.isFunction();
 
-  const SbVec3f * normals = this->gen.getNormals();
-  const SbVec2f * tcoords = this->tcoord.getArrayPtr();
-  const SbVec3f * coords = this->coord.getArrayPtr();
-  const int32_t * iptr = this->idx.getArrayPtr();
-  const int32_t * endptr = iptr + this->idx.getLength();
+  const SbVec3f * normals = this->geometry->normals.getArrayPtr();
+  const SbVec2f * tcoords = this->geometry->texcoords.getArrayPtr();
+  const SbVec3f * coords = this->geometry->coords.getArrayPtr();
+  const int32_t * iptr = this->geometry->indices.getArrayPtr();
+  const int32_t * endptr = iptr + this->geometry->indices.getLength();
 
   this->vbohash.clear();
   this->vbocoord.truncate(0);
@@ -1024,11 +1071,13 @@ calculate_z_axis(const SbVec3f * spine, const int i,
 // generates extruded coordinates
 //
 void
-SoVRMLExtrusionP::generateCoords(void)
+SoVRMLExtrusionP::generateCoords(SoTessellationCache::Geometry & geometry)
 {
-  this->coord.truncate(0);
-  this->tcoord.truncate(0);
-  this->idx.truncate(0);
+  this->tess.setCallback(tess_callback, &geometry.indices);
+
+  geometry.coords.truncate(0);
+  geometry.texcoords.truncate(0);
+  geometry.indices.truncate(0);
 
   if (PUBLIC(this)->crossSection.getNum() == 0 ||
       PUBLIC(this)->spine.getNum() == 0) return;
@@ -1174,10 +1223,10 @@ SoVRMLExtrusionP::generateCoords(void)
       c[2] = cross[j][1];
 
       matrix.multVecMatrix(c, c);
-      this->coord.append(c);
+      geometry.coords.append(c);
       tc[0] = currentcrosslen / crosslen;
       tc[1] = currentspinelen / spinelen;
-      this->tcoord.append(tc);
+      geometry.texcoords.append(tc);
 
       if (j < numcross-1) {
         currentcrosslen += (cross[j+1]-cross[j]).length();
@@ -1190,25 +1239,25 @@ SoVRMLExtrusionP::generateCoords(void)
 
 #define ADD_POINT(i0, j0) \
   do { \
-    this->idx.append((i0)*numcross+(j0)); \
+    geometry.indices.append((i0)*numcross+(j0)); \
   } while (0)
 
   // this macro makes the code below more readable
 #define ADD_TRIANGLE(i0, j0, i1, j1, i2, j2) \
   do { \
-    this->idx.append((i0)*numcross+(j0)); \
-    this->idx.append((i2)*numcross+(j2)); \
-    this->idx.append((i1)*numcross+(j1)); \
-    this->idx.append(-1); \
+    geometry.indices.append((i0)*numcross+(j0)); \
+    geometry.indices.append((i2)*numcross+(j2)); \
+    geometry.indices.append((i1)*numcross+(j1)); \
+    geometry.indices.append(-1); \
   } while (0)
 
 #define ADD_QUAD(i0, j0, i1, j1, i2, j2, i3, j3)   \
   do { \
-    this->idx.append((i0)*numcross+(j0)); \
-    this->idx.append((i3)*numcross+(j3)); \
-    this->idx.append((i2)*numcross+(j2)); \
-    this->idx.append((i1)*numcross+(j1)); \
-    this->idx.append(-1); \
+    geometry.indices.append((i0)*numcross+(j0)); \
+    geometry.indices.append((i3)*numcross+(j3)); \
+    geometry.indices.append((i2)*numcross+(j2)); \
+    geometry.indices.append((i1)*numcross+(j1)); \
+    geometry.indices.append(-1); \
   } while (0)
 
   // create walls
@@ -1234,11 +1283,11 @@ SoVRMLExtrusionP::generateCoords(void)
       c -= crossbox.getMin();
       c[0] /= crossboxsize[0];
       c[1] /= crossboxsize[1];
-      this->tcoord.append(c);
+      geometry.texcoords.append(c);
     }
     // just duplicated begincap coords to simplify texture coordinate handling
     for (i = 0; i < numcross; i++) {
-      this->coord.append(coord[i]);
+      geometry.coords.append(geometry.coords[i]);
     }
 
     if (PUBLIC(this)->convex.getValue()) {
@@ -1265,7 +1314,7 @@ SoVRMLExtrusionP::generateCoords(void)
   if (PUBLIC(this)->endCap.getValue() && !closed) {
     // just duplicate endcap coords to simplify texture coordinate handling
     for (i = 0; i < numcross; i++) {
-      this->coord.append(coord[(numspine-1)*numcross+i]);
+      geometry.coords.append(geometry.coords[(numspine-1)*numcross+i]);
     }
     // create texcoords
     for (i = 0; i < numcross; i++) {
@@ -1275,7 +1324,7 @@ SoVRMLExtrusionP::generateCoords(void)
       c[1] /= crossboxsize[1];
       // the endCap texcoords should be flipped in the T dimension
       c[1] = 1.0f - c[1];
-      this->tcoord.append(c);
+      geometry.texcoords.append(c);
     }
 
 	int offset = PUBLIC(this)->beginCap.getValue() ? 1 : 0;
@@ -1310,12 +1359,12 @@ SoVRMLExtrusionP::generateCoords(void)
 // generates per-verex normals for the extrusion.
 //
 void
-SoVRMLExtrusionP::generateNormals(void)
+SoVRMLExtrusionP::generateNormals(SoTessellationCache::Geometry & geometry)
 {
   this->gen.reset(PUBLIC(this)->ccw.getValue());
-  const SbVec3f * c = this->coord.getArrayPtr();
-  const int32_t * iptr = this->idx.getArrayPtr();
-  const int32_t * endptr = iptr + this->idx.getLength();
+  const SbVec3f * c = geometry.coords.getArrayPtr();
+  const int32_t * iptr = geometry.indices.getArrayPtr();
+  const int32_t * endptr = iptr + geometry.indices.getLength();
 
   while (iptr < endptr) {
     this->gen.beginPolygon();
@@ -1327,6 +1376,12 @@ SoVRMLExtrusionP::generateNormals(void)
     this->gen.endPolygon();
   }
   this->gen.generate(PUBLIC(this)->creaseAngle.getValue());
+
+  const SbVec3f * normals = this->gen.getNormals();
+  const int numnormals = this->gen.getNumNormals();
+  for (int i = 0; i < numnormals; i++) {
+    geometry.normals.append(normals[i]);
+  }
 }
 
 //
@@ -1335,14 +1390,78 @@ SoVRMLExtrusionP::generateNormals(void)
 void
 SoVRMLExtrusionP::tess_callback(void * v0, void * v1, void * v2, void * data)
 {
-  SoVRMLExtrusionP * thisp = (SoVRMLExtrusionP*) data;
-  thisp->idx.append((int32_t)((uintptr_t)v0));
-  thisp->idx.append((int32_t)((uintptr_t)v1));
-  thisp->idx.append((int32_t)((uintptr_t)v2));
-  thisp->idx.append(-1);
+  SbList <int32_t> * indices = (SbList <int32_t> *) data;
+  indices->append((int32_t)((uintptr_t)v0));
+  indices->append((int32_t)((uintptr_t)v1));
+  indices->append((int32_t)((uintptr_t)v2));
+  indices->append(-1);
 }
 
 #undef PUBLIC
 #undef PRIVATE
 
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
+
+namespace {
+
+SbBox3f
+extrusion_bbox(SoNode * node)
+{
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(node);
+  return bba.getBoundingBox();
+}
+
+int
+extrusion_triangles(SoNode * node)
+{
+  SoGetPrimitiveCountAction pca;
+  pca.apply(node);
+  return pca.getTriangleCount();
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(sharedGeometry)
+{
+  SoVRMLExtrusion * e1 = new SoVRMLExtrusion;
+  SoVRMLExtrusion * e2 = new SoVRMLExtrusion;
+  e1->ref();
+  e2->ref();
+
+  // identical extrusions share their geometry
+  BOOST_CHECK(extrusion_bbox(e1).getMin() == extrusion_bbox(e2).getMin());
+  BOOST_CHECK(extrusion_bbox(e1).getMax() == extrusion_bbox(e2).getMax());
+  BOOST_CHECK_EQUAL(extrusion_triangles(e1), extrusion_triangles(e2));
+
+  // changing one of them must not affect the other
+  const SbBox3f box = extrusion_bbox(e1);
+  const int numtriangles = extrusion_triangles(e1);
+  e2->spine.set1Value(1, SbVec3f(0.0f, 3.0f, 0.0f));
+  e2->spine.set1Value(2, SbVec3f(1.0f, 4.0f, 0.0f));
+  BOOST_CHECK(extrusion_bbox(e1).getMin() == box.getMin());
+  BOOST_CHECK(extrusion_bbox(e1).getMax() == box.getMax());
+  BOOST_CHECK_EQUAL(extrusion_triangles(e1), numtriangles);
+  BOOST_CHECK(extrusion_bbox(e2).getMax()[1] > 3.9f);
+  BOOST_CHECK(extrusion_triangles(e2) > numtriangles);
+
+  // and changing it back gives the original geometry again
+  e2->spine.setNum(2);
+  e2->spine.set1Value(1, SbVec3f(0.0f, 1.0f, 0.0f));
+  BOOST_CHECK(extrusion_bbox(e2).getMax() == box.getMax());
+  BOOST_CHECK_EQUAL(extrusion_triangles(e2), numtriangles);
+
+  // the geometry stays valid when the node sharing it goes away
+  e1->unref();
+  BOOST_CHECK(extrusion_bbox(e2).getMin() == box.getMin());
+  BOOST_CHECK_EQUAL(extrusion_triangles(e2), numtriangles);
+  e2->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_VRML97
@@ -83,6 +83,15 @@
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
 
 #include "engines/SoSubNodeEngineP.h"
+#include "vrml97/SoVRMLInterpolatorP.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SOVRMLINTERPOLATOR_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SOVRMLINTERPOLATOR_NEON
+#endif
 
 SO_NODEENGINE_ABSTRACT_SOURCE(SoVRMLInterpolator);
 
@@ -127,24 +136,160 @@ SoVRMLInterpolator::getKeyValueIndex(float & interp, int numvalues)
   if (n == 0 || numvalues == 0) return -1;
 
   const float * t = this->key.getValues(0); 
-  for (int i = 0; i < SbMin(n, numvalues); i++) {
+  const int num = SbMin(n, numvalues);
+
+  // binary search for the first key larger than fraction, the keys
+  // are non-decreasing
+  int lo = 0, hi = num;
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (fraction < t[mid]) hi = mid;
+    else lo = mid + 1;
+  }
+  const int i = lo;
+
+  if (i == 0) {
+    interp = 0.0f;
+    return 0;
+  }
+  if (i == num) {
+    interp = 0.0f;
+    return num-1;
+  }
+  float delta = t[i] - t[i-1];
+  if (delta > 0.0f) {
+    interp = (fraction - t[i-1]) / delta;
+  }
+  else interp = 0.0f;
+  return i-1;
+}
+
+// *************************************************************************
+
+// Sets dst[i] = v0[i] + (v1[i] - v0[i]) * t for num floats, four at a
+// time with SSE or NEON where available. The operations are the same
+// as for SbVec3f, so the results do not depend on the instruction set.
+void
+SoVRMLInterpolatorP::lerp(const float * v0, const float * v1, const float t,
+                          float * dst, const int num)
+{
+  int i = 0;
+#if defined(SOVRMLINTERPOLATOR_SSE)
+  const __m128 tt = _mm_set1_ps(t);
+  for (; i + 4 <= num; i += 4) {
+    const __m128 a = _mm_loadu_ps(v0 + i);
+    const __m128 b = _mm_loadu_ps(v1 + i);
+    _mm_storeu_ps(dst + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tt)));
+  }
+#elif defined(SOVRMLINTERPOLATOR_NEON)
+  const float32x4_t tt = vdupq_n_f32(t);
+  for (; i + 4 <= num; i += 4) {
+    const float32x4_t a = vld1q_f32(v0 + i);
+    const float32x4_t b = vld1q_f32(v1 + i);
+    vst1q_f32(dst + i, vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), tt)));
+  }
+#endif
+  for (; i < num; i++) {
+    dst[i] = v0[i] + (v1[i] - v0[i]) * t;
+  }
+}
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/VRMLnodes/SoVRMLScalarInterpolator.h>
+#include <Inventor/VRMLnodes/SoVRMLCoordinateInterpolator.h>
+#include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/SbVec3f.h>
+
+namespace {
+
+// the key lookup done with a linear scan
+int
+interpolator_reference_index(const float * t, const int num, const float fraction,
+                             float & interp)
+{
+  for (int i = 0; i < num; i++) {
     if (fraction < t[i]) {
-      if (i == 0) {
-        interp = 0.0f;
-        return 0;
-      }
-      else {
-        float delta = t[i] - t[i-1];
-        if (delta > 0.0f) {
-          interp = (fraction - t[i-1]) / delta;
-        }
-        else interp = 0.0f;
-      }
+      interp = 0.0f;
+      if (i == 0) return 0;
+      const float delta = t[i] - t[i-1];
+      if (delta > 0.0f) interp = (fraction - t[i-1]) / delta;
       return i-1;
     }
   }
   interp = 0.0f;
-  return SbMin(numvalues,n)-1;
+  return num-1;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(keyLookup)
+{
+  SoVRMLScalarInterpolator * interpolator = new SoVRMLScalarInterpolator;
+  interpolator->ref();
+  const int numkeys = 1000;
+  for (int i = 0; i < numkeys; i++) {
+    // include some repeated keys
+    interpolator->key.set1Value(i, static_cast<float>(i - (i % 7 == 0 ? 1 : 0)) / numkeys);
+    interpolator->keyValue.set1Value(i, static_cast<float>((i * 37) % 101));
+  }
+  SoSFFloat value;
+  value.connectFrom(&interpolator->value_changed);
+
+  const float * t = interpolator->key.getValues(0);
+  const float * v = interpolator->keyValue.getValues(0);
+  // forward in small steps, then some jumps back and forth
+  SbBool ok = TRUE;
+  for (int i = -10; i < 3000 && ok; i++) {
+    const float fraction = (i < 2200) ?
+      static_cast<float>(i) / 2000.0f : static_cast<float>((i * 7919) % 2100) / 2000.0f;
+    interpolator->set_fraction = fraction;
+    float interp;
+    const int idx = interpolator_reference_index(t, numkeys, fraction, interp);
+    float expected = v[idx];
+    if (interp > 0.0f) expected = expected + (v[idx+1] - expected) * interp;
+    ok = (value.getValue() == expected);
+  }
+  BOOST_CHECK_MESSAGE(ok, "key lookup differs from linear search");
+
+  value.disconnect();
+  interpolator->unref();
 }
 
+BOOST_AUTO_TEST_CASE(coordinateLerp)
+{
+  SoVRMLCoordinateInterpolator * interpolator = new SoVRMLCoordinateInterpolator;
+  interpolator->ref();
+  const int numcoords = 11; // not a multiple of the SIMD width
+  interpolator->key.set1Value(0, 0.0f);
+  interpolator->key.set1Value(1, 1.0f);
+  for (int i = 0; i < numcoords; i++) {
+    interpolator->keyValue.set1Value(i, SbVec3f(static_cast<float>(i), 1.0f, -2.0f));
+    interpolator->keyValue.set1Value(numcoords + i, SbVec3f(0.5f, static_cast<float>(i * i), 3.0f));
+  }
+  SoMFVec3f value;
+  value.connectFrom(&interpolator->value_changed);
+
+  const SbVec3f * c = interpolator->keyValue.getValues(0);
+  const float fractions[] = { -1.0f, 0.0f, 0.3f, 0.71f, 1.0f, 2.0f };
+  SbBool ok = TRUE;
+  for (int f = 0; f < 6 && ok; f++) {
+    interpolator->set_fraction = fractions[f];
+    ok = (value.getNum() == numcoords);
+    const float interp = SbClamp(fractions[f], 0.0f, 1.0f);
+    for (int i = 0; i < numcoords && ok; i++) {
+      const SbVec3f expected = (interp < 1.0f) ?
+        c[i] + (c[numcoords + i] - c[i]) * interp : c[numcoords + i];
+      ok = (value[i] == expected);
+    }
+  }
+  BOOST_CHECK_MESSAGE(ok, "interpolated coordinates differ from SbVec3f arithmetic");
+
+  value.disconnect();
+  interpolator->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_VRML97
@@ -0,0 +1,116 @@
+#ifndef COIN_SOVRMLELEVATIONGRIDLOD_H
+#define COIN_SOVRMLELEVATIONGRIDLOD_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbColor.h>
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+class SoGLRenderAction;
+class SoState;
+class SoVBO;
+
+/*
+  Chunked level of detail rendering for large SoVRMLElevationGrid
+  height fields (geomipmapping).
+
+  The grid is split into chunks of CHUNKSIZE x CHUNKSIZE quads, each
+  of which can be rendered with every 2^level'th height sample. The
+  chunks are organized in a quadtree of bounding boxes for view
+  frustum culling, and each visible chunk gets the coarsest level
+  whose geometric error projects to less than a given number of
+  pixels. Edges shared by two chunks are sampled at the coarser of the
+  two levels and stitched to the chunk interiors, so that the chunks
+  meet without cracks or T-junctions.
+
+  The error of each level and the vertex data of the chunks are
+  computed the first time a chunk is visible, and the vertex data of
+  chunks which have not been visible for a while is released again.
+*/
+
+class SoVRMLElevationGridLOD {
+public:
+  enum { CHUNKSIZE = 32, NUMLEVELS = 6 };
+
+  SoVRMLElevationGridLOD(void);
+  ~SoVRMLElevationGridLOD();
+
+  void build(const int xdim, const int zdim,
+             const float xspacing, const float zspacing,
+             const float * heights);
+  void invalidateVertexData(void);
+
+  int getNumChunks(void) const;
+  void getChunk(const int chunk, int & x0, int & z0, int & nx, int & nz) const;
+  int getLevel(const int chunk) const;
+  void setLevel(const int chunk, const int level);
+  float getError(const int chunk, const int level);
+
+  int select(SoState * state, const float pixelerror);
+  void triangulate(const int chunk, SbList<int> & indices) const;
+
+  void render(SoGLRenderAction * action,
+              const SbVec3f * normals, const SbVec2f * tcoords,
+              const SbColor * colors, const SbBool ccw, const SbBool dotex);
+
+private:
+  class Chunk;
+
+  void computeErrors(Chunk & chunk);
+  void computeVertexData(Chunk & chunk, const SbVec3f * normals,
+                         const SbVec2f * tcoords, const SbColor * colors,
+                         const SbBool ccw);
+  int getEdgeStep(const int chunk, const int side) const;
+  void releaseVertexData(void);
+  void clear(void);
+
+  int xdim, zdim;
+  float xspacing, zspacing;
+  const float * heights;
+  int chunksx, chunksz;
+  Chunk * chunks;
+  // boxes of the quadtree levels above the chunks, finest level first
+  SbList<SbBox3f *> quadtree;
+  SbList<int> quadtreedims;
+  SbList<int> cached;
+  uint32_t frame;
+};
+
+#endif // !COIN_SOVRMLELEVATIONGRIDLOD_H
@@ -53,6 +53,7 @@
 #include "vrml97/DirectionalLight.cpp"
 #include "vrml97/DragSensor.cpp"
 #include "vrml97/ElevationGrid.cpp"
+#include "vrml97/ElevationGridLOD.cpp"
 #include "vrml97/Extrusion.cpp"
 #include "vrml97/Fog.cpp"
 #include "vrml97/FontStyle.cpp"
@@ -0,0 +1,1032 @@
+/**************************************************************************\
+* Copyright (c) Kongsberg Oil & Gas Technologies AS
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*
+* Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+  CoinBenchmarks measures the performance of the core actions on a set
+  of synthetic scenes, and of the SbMatrix transforms on a large point
+  array, and writes the results as JSON, so that they can be compared
+  between builds to catch performance regressions.
+
+  The "compressed" scene writes a large scene to gzip and bzip2
+  compressed files and reads them back, to measure the parallel
+  compression and the decompression read-ahead. Run it with different
+  --threads values to compare against the single threaded code.
+
+  Usage: CoinBenchmarks [options]
+
+    --output <file>    write the JSON results to <file> instead of stdout
+    --filter <string>  only run the benchmarks whose name contains <string>
+    --scale <float>    scale the size of the scenes (default 1.0)
+    --min-time <sec>   minimum time spent measuring each benchmark (default 0.5)
+    --threads <n>      number of threads used by Coin (sets COIN_PARALLEL_THREADS
+                       and COIN_COMPRESSION_THREADS, default is the number of
+                       processors)
+    --tmpdir <dir>     directory for the compressed files (default .)
+    --list             list the benchmark names and exit
+
+  Benchmarks are named <scene>/<operation>. Each is run once to warm
+  up, and then repeatedly until the minimum time has passed. The
+  minimum, median and mean time of one run is reported in
+  milliseconds.
+
+  Bounding box and render caching is turned off in the scenes, so that
+  the traversals themselves are measured.
+*/
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/SbTesselator.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/engines/SoEngineOutput.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoRotation.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoText2.h>
+#include <Inventor/nodes/SoText3.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/VRMLnodes/SoVRMLCoordinateInterpolator.h>
+#include <Inventor/VRMLnodes/SoVRMLOrientationInterpolator.h>
+#include <Inventor/VRMLnodes/SoVRMLPositionInterpolator.h>
+#include <Inventor/VRMLnodes/SoVRMLScalarInterpolator.h>
+#include <Inventor/C/tidbits.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// *************************************************************************
+
+namespace {
+
+  struct Options {
+    const char * output;
+    const char * filter;
+    float scale;
+    double mintime;
+    int threads;
+    const char * tmpdir;
+    SbBool list;
+  };
+
+  struct Scene {
+    const char * name;
+    SoSeparator * root;
+    // the scene written with SoWriteAction, for the read benchmark
+    char * buffer;
+    size_t buffersize;
+    // first calculator in the engine chain, if any
+    SoCalculator * engine;
+  };
+
+  typedef SbBool BenchmarkFunc(Scene & scene);
+
+  struct Benchmark {
+    const char * name;
+    BenchmarkFunc * func;
+  };
+
+  const SbViewportRegion viewport(512, 512);
+
+  SoOffscreenRenderer * renderer = NULL;
+
+  // directory for the files written by the compression benchmarks
+  const char * tmpdir = ".";
+
+  int
+  scaled(const Options & options, const int count)
+  {
+    const int n = static_cast<int>(count * options.scale);
+    return (n < 2) ? 2 : n;
+  }
+
+  SoSeparator *
+  new_separator(void)
+  {
+    SoSeparator * sep = new SoSeparator;
+    sep->renderCaching = SoSeparator::OFF;
+    sep->boundingBoxCaching = SoSeparator::OFF;
+    return sep;
+  }
+
+  // ***********************************************************************
+  // scene generators
+
+  // separators nested inside each other, with a transform and a
+  // shape on each level
+  SoSeparator *
+  create_deep(const Options & options)
+  {
+    SoSeparator * root = new_separator();
+    SoSeparator * parent = root;
+    const int depth = scaled(options, 1000);
+    for (int i = 0; i < depth; i++) {
+      SoSeparator * sep = new_separator();
+      SoTransform * transform = new SoTransform;
+      transform->translation.setValue(0.1f, 0.0f, 0.0f);
+      transform->rotation.setValue(SbVec3f(0.0f, 0.0f, 1.0f), 0.01f);
+      sep->addChild(transform);
+      sep->addChild(new SoCube);
+      parent->addChild(sep);
+      parent = sep;
+    }
+    return root;
+  }
+
+  // a single group with a large number of small subgraphs
+  SoSeparator *
+  create_wide(const Options & options)
+  {
+    SoSeparator * root = new_separator();
+    const int num = scaled(options, 20000);
+    const int side = static_cast<int>(sqrt(static_cast<double>(num))) + 1;
+    for (int i = 0; i < num; i++) {
+      SoSeparator * sep = new_separator();
+      SoTranslation * translation = new SoTranslation;
+      translation->translation.setValue(static_cast<float>(i % side) * 3.0f,
+                                        static_cast<float>(i / side) * 3.0f,
+                                        0.0f);
+      sep->addChild(translation);
+      sep->addChild(new SoCube);
+      root->addChild(sep);
+    }
+    return root;
+  }
+
+  // one large indexed face set, a grid of quads on a wavy surface
+  SoSeparator *
+  create_faceset(const Options & options, const int baseside = 400)
+  {
+    SoSeparator * root = new_separator();
+    const int side = static_cast<int>(baseside * sqrt(static_cast<double>(options.scale))) + 2;
+
+    SoCoordinate3 * coords = new SoCoordinate3;
+    coords->point.setNum(side * side);
+    SbVec3f * points = coords->point.startEditing();
+    for (int y = 0; y < side; y++) {
+      for (int x = 0; x < side; x++) {
+        points[y * side + x].setValue(static_cast<float>(x),
+                                      static_cast<float>(y),
+                                      static_cast<float>(sin(x * 0.1) * cos(y * 0.1)));
+      }
+    }
+    coords->point.finishEditing();
+
+    SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+    faceset->coordIndex.setNum((side - 1) * (side - 1) * 5);
+    int32_t * indices = faceset->coordIndex.startEditing();
+    for (int y = 0; y < side - 1; y++) {
+      for (int x = 0; x < side - 1; x++) {
+        const int32_t i = y * side + x;
+        *indices++ = i;
+        *indices++ = i + 1;
+        *indices++ = i + side + 1;
+        *indices++ = i + side;
+        *indices++ = -1;
+      }
+    }
+    faceset->coordIndex.finishEditing();
+
+    root->addChild(coords);
+    root->addChild(faceset);
+    return root;
+  }
+
+  // a large number of 2D and 3D text nodes
+  SoSeparator *
+  create_text(const Options & options)
+  {
+    SoSeparator * root = new_separator();
+    const int num = scaled(options, 500);
+    for (int i = 0; i < num; i++) {
+      SoSeparator * sep = new_separator();
+      SoTranslation * translation = new SoTranslation;
+      translation->translation.setValue(static_cast<float>(i % 20) * 10.0f,
+                                        static_cast<float>(i / 20) * 4.0f,
+                                        0.0f);
+      sep->addChild(translation);
+      if (i % 2) {
+        SoText3 * text = new SoText3;
+        text->string.setValue("Coin3D benchmark");
+        text->parts = SoText3::ALL;
+        sep->addChild(text);
+      }
+      else {
+        SoText2 * text = new SoText2;
+        text->string.setValue("Coin3D benchmark");
+        sep->addChild(text);
+      }
+      root->addChild(sep);
+    }
+    return root;
+  }
+
+  // a face set with a million points, which is about 70 MB when
+  // written as uncompressed text
+  SoSeparator *
+  create_compressed(const Options & options)
+  {
+    return create_faceset(options, 1000);
+  }
+
+  // a chain of calculator engines, each driving the position of a
+  // shape and the input of the next engine
+  SoSeparator *
+  create_engines(const Options & options, SoCalculator *& first)
+  {
+    SoSeparator * root = new_separator();
+    const int num = scaled(options, 1000);
+    SoCalculator * prev = NULL;
+    for (int i = 0; i < num; i++) {
+      SoCalculator * calc = new SoCalculator;
+      calc->expression.setValue("oa = a + 1; oA = vec3f(oa, 0, 0)");
+      if (prev) calc->a.connectFrom(&prev->oa);
+      else first = calc;
+
+      SoSeparator * sep = new_separator();
+      SoTranslation * translation = new SoTranslation;
+      translation->translation.connectFrom(&calc->oA);
+      sep->addChild(translation);
+      sep->addChild(new SoCube);
+      root->addChild(sep);
+      prev = calc;
+    }
+    return root;
+  }
+
+  // a large array of points, for the SbMatrix benchmarks
+  SoSeparator *
+  create_points(const Options & options)
+  {
+    SoSeparator * root = new_separator();
+    SoCoordinate3 * coords = new SoCoordinate3;
+    const int num = scaled(options, 1000000);
+    coords->point.setNum(num);
+    SbVec3f * points = coords->point.startEditing();
+    for (int i = 0; i < num; i++) {
+      points[i].setValue(static_cast<float>(i % 100),
+                         static_cast<float>((i / 100) % 100),
+                         static_cast<float>(i / 10000));
+    }
+    coords->point.finishEditing();
+    root->addChild(coords);
+    return root;
+  }
+
+  // VRML97 interpolators with many keys, each driving a field in the
+  // scene. The children of the root are, in order, a cube, a
+  // translation, a rotation and a coordinate node.
+  SoSeparator *
+  create_interpolators(const Options & options)
+  {
+    SoSeparator * root = new_separator();
+    const int numkeys = scaled(options, 5000);
+
+    SoVRMLScalarInterpolator * scalar = new SoVRMLScalarInterpolator;
+    SoVRMLPositionInterpolator * position = new SoVRMLPositionInterpolator;
+    SoVRMLOrientationInterpolator * orientation = new SoVRMLOrientationInterpolator;
+    scalar->key.setNum(numkeys);
+    scalar->keyValue.setNum(numkeys);
+    position->key.setNum(numkeys);
+    position->keyValue.setNum(numkeys);
+    orientation->key.setNum(numkeys);
+    orientation->keyValue.setNum(numkeys);
+    for (int i = 0; i < numkeys; i++) {
+      const float t = static_cast<float>(i) / static_cast<float>(numkeys - 1);
+      const float v = static_cast<float>(i % 10);
+      scalar->key.set1Value(i, t);
+      scalar->keyValue.set1Value(i, v);
+      position->key.set1Value(i, t);
+      position->keyValue.set1Value(i, SbVec3f(v, 0.0f, -v));
+      orientation->key.set1Value(i, t);
+      orientation->keyValue.set1Value(i, SbRotation(SbVec3f(0.0f, 1.0f, 0.0f), v * 0.1f));
+    }
+
+    SoCube * cube = new SoCube;
+    cube->width.connectFrom(&scalar->value_changed);
+    root->addChild(cube);
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.connectFrom(&position->value_changed);
+    root->addChild(translation);
+    SoRotation * rotation = new SoRotation;
+    rotation->rotation.connectFrom(&orientation->value_changed);
+    root->addChild(rotation);
+
+    // few keys, but many coordinates per key
+    const int numcoordkeys = 20;
+    const int numcoords = scaled(options, 100000);
+    SoVRMLCoordinateInterpolator * coordinate = new SoVRMLCoordinateInterpolator;
+    coordinate->key.setNum(numcoordkeys);
+    coordinate->keyValue.setNum(numcoordkeys * numcoords);
+    SbVec3f * values = coordinate->keyValue.startEditing();
+    for (int i = 0; i < numcoordkeys; i++) {
+      coordinate->key.set1Value(i, static_cast<float>(i) / static_cast<float>(numcoordkeys - 1));
+      for (int j = 0; j < numcoords; j++) {
+        values[i * numcoords + j].setValue(static_cast<float>(j % 100),
+                                           static_cast<float>(i),
+                                           static_cast<float>(j / 100));
+      }
+    }
+    coordinate->keyValue.finishEditing();
+    SoCoordinate3 * coords = new SoCoordinate3;
+    coords->point.connectFrom(&coordinate->value_changed);
+    root->addChild(coords);
+    return root;
+  }
+
+  // polygons for SbTesselator. The first coordinate node is a star
+  // shaped concave polygon, and the second is a square with a grid of
+  // holes, with the outer contour first and then 16 points per hole.
+  SoSeparator *
+  create_polygons(const Options & options)
+  {
+    SoSeparator * root = new_separator();
+
+    SoCoordinate3 * star = new SoCoordinate3;
+    const int numstar = scaled(options, 20000);
+    star->point.setNum(numstar);
+    SbVec3f * points = star->point.startEditing();
+    for (int i = 0; i < numstar; i++) {
+      const float angle = 2.0f * float(M_PI) * i / numstar;
+      const float radius = (i & 1) ? 1.0f : 0.5f + 0.3f * float(i % 7) / 7.0f;
+      points[i].setValue(radius * cosf(angle), radius * sinf(angle), 0.0f);
+    }
+    star->point.finishEditing();
+    root->addChild(star);
+
+    SoCoordinate3 * holes = new SoCoordinate3;
+    const int grid = static_cast<int>(sqrtf(static_cast<float>(scaled(options, 400))));
+    holes->point.setNum(4 + grid * grid * 16);
+    points = holes->point.startEditing();
+    points[0].setValue(0.0f, 0.0f, 0.0f);
+    points[1].setValue(float(grid), 0.0f, 0.0f);
+    points[2].setValue(float(grid), float(grid), 0.0f);
+    points[3].setValue(0.0f, float(grid), 0.0f);
+    for (int i = 0; i < grid * grid; i++) {
+      for (int j = 0; j < 16; j++) {
+        const float angle = 2.0f * float(M_PI) * j / 16.0f;
+        points[4 + i * 16 + j].setValue(float(i % grid) + 0.5f + 0.3f * cosf(angle),
+                                        float(i / grid) + 0.5f + 0.3f * sinf(angle),
+                                        0.0f);
+      }
+    }
+    holes->point.finishEditing();
+    root->addChild(holes);
+    return root;
+  }
+
+  // ***********************************************************************
+  // benchmarks
+
+  SbBool
+  bench_bbox(Scene & scene)
+  {
+    SoGetBoundingBoxAction action(viewport);
+    action.apply(scene.root);
+    return TRUE;
+  }
+
+  SbBool
+  bench_pick(Scene & scene)
+  {
+    SoGetBoundingBoxAction bboxaction(viewport);
+    bboxaction.apply(scene.root);
+    const SbBox3f box = bboxaction.getBoundingBox();
+    SbVec3f center = box.getCenter();
+    SbVec3f start(center[0], center[1], box.getMax()[2] + 1.0f);
+
+    SoRayPickAction action(viewport);
+    action.setRay(start, SbVec3f(0.0f, 0.0f, -1.0f));
+    action.setPickAll(TRUE);
+    action.apply(scene.root);
+    return TRUE;
+  }
+
+  SbBool
+  bench_search(Scene & scene)
+  {
+    SoSearchAction action;
+    action.setType(SoShape::getClassTypeId());
+    action.setInterest(SoSearchAction::ALL);
+    action.apply(scene.root);
+    return TRUE;
+  }
+
+  SbBool
+  bench_search_indexed(Scene & scene)
+  {
+    // the index is built by the warm-up run
+    SoSearchAction::setIndexed(scene.root, TRUE);
+    return bench_search(scene);
+  }
+
+  void
+  count_triangle(void * closure, SoCallbackAction *, const SoPrimitiveVertex *,
+                 const SoPrimitiveVertex *, const SoPrimitiveVertex *)
+  {
+    (*static_cast<int *>(closure))++;
+  }
+
+  SbBool
+  bench_callback(Scene & scene)
+  {
+    int numtriangles = 0;
+    SoCallbackAction action(viewport);
+    action.addTriangleCallback(SoShape::getClassTypeId(), count_triangle, &numtriangles);
+    action.apply(scene.root);
+    return TRUE;
+  }
+
+  void *
+  buffer_realloc(void * bufptr, size_t size)
+  {
+    return realloc(bufptr, size);
+  }
+
+  SbBool
+  bench_write(Scene & scene)
+  {
+    SoOutput out;
+    out.setBuffer(malloc(1024), 1024, buffer_realloc);
+    SoWriteAction action(&out);
+    action.apply(scene.root);
+
+    void * buffer;
+    size_t size;
+    out.getBuffer(buffer, size);
+    // keep the first written buffer for the read benchmark
+    if (scene.buffer == NULL) {
+      scene.buffer = static_cast<char *>(buffer);
+      scene.buffersize = size;
+    }
+    else {
+      free(buffer);
+    }
+    return TRUE;
+  }
+
+  SbBool
+  bench_read(Scene & scene)
+  {
+    if (scene.buffer == NULL) (void) bench_write(scene);
+
+    SoInput in;
+    in.setBuffer(scene.buffer, scene.buffersize);
+    SoSeparator * root = SoDB::readAll(&in);
+    if (root == NULL) return FALSE;
+    root->ref();
+    root->unref();
+    return TRUE;
+  }
+
+  SbBool
+  bench_glrender(Scene & scene)
+  {
+    if (renderer == NULL) renderer = new SoOffscreenRenderer(viewport);
+
+    SoSeparator * root = new SoSeparator;
+    root->ref();
+    SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+    root->addChild(camera);
+    root->addChild(new SoDirectionalLight);
+    root->addChild(scene.root);
+    camera->viewAll(root, viewport);
+
+    const SbBool ok = renderer->render(root);
+    root->unref();
+    return ok;
+  }
+
+  SbBool
+  bench_evaluate(Scene & scene)
+  {
+    if (scene.engine == NULL) return FALSE;
+    scene.engine->a.setValue(scene.engine->a[0] + 1.0f);
+    // reading the last field pulls the new value through the chain
+    SoSeparator * last = static_cast<SoSeparator *>
+      (scene.root->getChild(scene.root->getNumChildren() - 1));
+    SoTranslation * translation = static_cast<SoTranslation *>(last->getChild(0));
+    (void) translation->translation.getValue();
+    return TRUE;
+  }
+
+  // steps the interpolator driving the given field of the given child
+  // of the root through the whole key range, reading the field after
+  // each step
+  SbBool
+  interpolate(Scene & scene, const int child, const char * fieldname, const int steps)
+  {
+    SoField * field = scene.root->getChild(child)->getField(fieldname);
+    SoEngineOutput * output;
+    if (field == NULL || !field->getConnectedEngine(output)) return FALSE;
+    SoVRMLInterpolator * interpolator =
+      static_cast<SoVRMLInterpolator *>(output->getNodeContainer());
+    for (int i = 0; i <= steps; i++) {
+      interpolator->set_fraction.setValue(static_cast<float>(i) / static_cast<float>(steps));
+      field->evaluate();
+    }
+    return TRUE;
+  }
+
+  SbBool
+  bench_scalar(Scene & scene)
+  {
+    return interpolate(scene, 0, "width", 1000);
+  }
+
+  SbBool
+  bench_position(Scene & scene)
+  {
+    return interpolate(scene, 1, "translation", 1000);
+  }
+
+  SbBool
+  bench_orientation(Scene & scene)
+  {
+    return interpolate(scene, 2, "rotation", 1000);
+  }
+
+  SbBool
+  bench_coordinate(Scene & scene)
+  {
+    return interpolate(scene, 3, "point", 10);
+  }
+
+  // compression benchmarks, writing the scene to a compressed file
+  // and reading it back
+
+  SbString
+  compressed_filename(Scene & scene, const char * method)
+  {
+    SbString filename;
+    filename.sprintf("%s/CoinBenchmarks-%s.iv.%s", tmpdir, scene.name,
+                     (strcmp(method, "GZIP") == 0) ? "gz" : "bz2");
+    return filename;
+  }
+
+  SbBool
+  write_compressed(Scene & scene, const char * method)
+  {
+    const SbString filename = compressed_filename(scene, method);
+    SoOutput out;
+    // the compression is set up when the file is opened
+    if (!out.setCompression(method) || !out.openFile(filename.getString())) return FALSE;
+    SoWriteAction action(&out);
+    action.apply(scene.root);
+    out.closeFile();
+    return TRUE;
+  }
+
+  SbBool
+  read_compressed(Scene & scene, const char * method)
+  {
+    const SbString filename = compressed_filename(scene, method);
+    SoInput in;
+    if (!in.openFile(filename.getString(), TRUE)) {
+      // the warm-up run writes the file if the write benchmark was
+      // filtered out
+      if (!write_compressed(scene, method) ||
+          !in.openFile(filename.getString(), TRUE)) return FALSE;
+    }
+    SoSeparator * root = SoDB::readAll(&in);
+    if (root == NULL) return FALSE;
+    root->ref();
+    root->unref();
+    return TRUE;
+  }
+
+  SbBool
+  bench_write_gzip(Scene & scene)
+  {
+    return write_compressed(scene, "GZIP");
+  }
+
+  SbBool
+  bench_read_gzip(Scene & scene)
+  {
+    return read_compressed(scene, "GZIP");
+  }
+
+  SbBool
+  bench_write_bzip2(Scene & scene)
+  {
+    return write_compressed(scene, "BZIP2");
+  }
+
+  SbBool
+  bench_read_bzip2(Scene & scene)
+  {
+    return read_compressed(scene, "BZIP2");
+  }
+
+  void
+  remove_compressed(Scene & scene)
+  {
+    (void) remove(compressed_filename(scene, "GZIP").getString());
+    (void) remove(compressed_filename(scene, "BZIP2").getString());
+  }
+
+  // SbMatrix benchmarks, comparing the batch transforms against
+  // transforming one vector at a time
+
+  const SbVec3f *
+  get_points(Scene & scene, int & num)
+  {
+    SoCoordinate3 * coords = static_cast<SoCoordinate3 *>(scene.root->getChild(0));
+    num = coords->point.getNum();
+    return coords->point.getValues(0);
+  }
+
+  SbMatrix
+  get_matrix(void)
+  {
+    SbMatrix m;
+    m.setTransform(SbVec3f(1.0f, 2.0f, 3.0f),
+                   SbRotation(SbVec3f(1.0f, 1.0f, 0.0f), 0.5f),
+                   SbVec3f(2.0f, 2.0f, 2.0f));
+    return m;
+  }
+
+  SbList<SbVec3f> transformed;
+
+  SbVec3f *
+  get_result(const int num)
+  {
+    while (transformed.getLength() < num) transformed.append(SbVec3f(0.0f, 0.0f, 0.0f));
+    return &transformed[0];
+  }
+
+  SbBool
+  bench_multvec(Scene & scene)
+  {
+    int num;
+    const SbVec3f * points = get_points(scene, num);
+    SbVec3f * result = get_result(num);
+    const SbMatrix m = get_matrix();
+    for (int i = 0; i < num; i++) m.multVecMatrix(points[i], result[i]);
+    return TRUE;
+  }
+
+  SbBool
+  bench_multvec_batch(Scene & scene)
+  {
+    int num;
+    const SbVec3f * points = get_points(scene, num);
+    get_matrix().multVecMatrix(points, get_result(num), num);
+    return TRUE;
+  }
+
+  SbBool
+  bench_multdir(Scene & scene)
+  {
+    int num;
+    const SbVec3f * points = get_points(scene, num);
+    SbVec3f * result = get_result(num);
+    const SbMatrix m = get_matrix();
+    for (int i = 0; i < num; i++) m.multDirMatrix(points[i], result[i]);
+    return TRUE;
+  }
+
+  SbBool
+  bench_multdir_batch(Scene & scene)
+  {
+    int num;
+    const SbVec3f * points = get_points(scene, num);
+    get_matrix().multDirMatrix(points, get_result(num), num);
+    return TRUE;
+  }
+
+  SbBool
+  bench_multright(Scene & scene)
+  {
+    int num;
+    (void) get_points(scene, num);
+    // a rotation, so the product stays well-conditioned
+    SbMatrix m;
+    m.setRotate(SbRotation(SbVec3f(0.0f, 1.0f, 1.0f), 0.01f));
+    SbMatrix product = m;
+    for (int i = 0; i < num; i++) product.multRight(m);
+    return product[3][3] != 0.0f;
+  }
+
+  // SbTesselator benchmarks
+
+  int numtriangles = 0;
+
+  void
+  count_triangle(void *, void *, void *, void *)
+  {
+    numtriangles++;
+  }
+
+  SbBool
+  tessellate(Scene & scene, const int child, const int contoursize)
+  {
+    SoCoordinate3 * coords = static_cast<SoCoordinate3 *>(scene.root->getChild(child));
+    const int num = coords->point.getNum();
+    const SbVec3f * points = coords->point.getValues(0);
+
+    numtriangles = 0;
+    SbTesselator tessellator(count_triangle, NULL);
+    tessellator.beginPolygon();
+    for (int i = 0; i < num; i++) {
+      if (contoursize && i >= 4 && (i - 4) % contoursize == 0) tessellator.nextContour();
+      tessellator.addVertex(points[i], NULL);
+    }
+    tessellator.endPolygon();
+
+    // n - 2 triangles for a simple polygon, and two more per hole
+    const int numholes = contoursize ? (num - 4) / contoursize : 0;
+    return numtriangles == num - 2 + numholes * 2;
+  }
+
+  SbBool
+  bench_star(Scene & scene)
+  {
+    return tessellate(scene, 0, 0);
+  }
+
+  SbBool
+  bench_holes(Scene & scene)
+  {
+    return tessellate(scene, 1, 16);
+  }
+
+  const Benchmark matrixbenchmarks[] = {
+    { "multvec", bench_multvec },
+    { "multvec-batch", bench_multvec_batch },
+    { "multdir", bench_multdir },
+    { "multdir-batch", bench_multdir_batch },
+    { "multright", bench_multright }
+  };
+
+  const Benchmark tessellatorbenchmarks[] = {
+    { "star", bench_star },
+    { "holes", bench_holes }
+  };
+
+  const Benchmark compressionbenchmarks[] = {
+    { "write-gzip", bench_write_gzip },
+    { "read-gzip", bench_read_gzip },
+    { "write-bzip2", bench_write_bzip2 },
+    { "read-bzip2", bench_read_bzip2 }
+  };
+
+  const Benchmark interpolatorbenchmarks[] = {
+    { "scalar", bench_scalar },
+    { "position", bench_position },
+    { "orientation", bench_orientation },
+    { "coordinate", bench_coordinate }
+  };
+
+  const Benchmark actionbenchmarks[] = {
+    { "bbox", bench_bbox },
+    { "pick", bench_pick },
+    { "search", bench_search },
+    { "search-indexed", bench_search_indexed },
+    { "callback", bench_callback },
+    { "write", bench_write },
+    { "read", bench_read },
+    { "glrender", bench_glrender }
+  };
+
+  // ***********************************************************************
+
+  int
+  compare_doubles(const void * a, const void * b)
+  {
+    const double da = *static_cast<const double *>(a);
+    const double db = *static_cast<const double *>(b);
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+  }
+
+  SbBool
+  matches(const Options & options, const SbString & name)
+  {
+    return (options.filter == NULL) || (name.find(options.filter) != -1);
+  }
+
+  void
+  run_benchmark(const Options & options, FILE * out, SbBool & first,
+                Scene & scene, const Benchmark & benchmark)
+  {
+    SbString name;
+    name.sprintf("%s/%s", scene.name, benchmark.name);
+    if (!matches(options, name)) return;
+
+    if (options.list) {
+      fprintf(out, "%s\n", name.getString());
+      return;
+    }
+
+    fprintf(out, "%s\n    {\"name\": \"%s\", ", first ? "" : ",", name.getString());
+    first = FALSE;
+
+    // warm up, and find out if the benchmark can run at all
+    if (!benchmark.func(scene)) {
+      fprintf(out, "\"skipped\": true}");
+      fprintf(stderr, "%-20s skipped\n", name.getString());
+      return;
+    }
+
+    SbList<double> times;
+    const SbTime start = SbTime::getTimeOfDay();
+    do {
+      const SbTime before = SbTime::getTimeOfDay();
+      (void) benchmark.func(scene);
+      times.append((SbTime::getTimeOfDay() - before).getValue() * 1000.0);
+    } while ((times.getLength() < 3 || (SbTime::getTimeOfDay() - start).getValue() < options.mintime) &&
+             times.getLength() < 1000 && options.mintime > 0.0);
+
+    const int num = times.getLength();
+    double * sorted = new double[num];
+    double sum = 0.0;
+    for (int i = 0; i < num; i++) {
+      sorted[i] = times[i];
+      sum += times[i];
+    }
+    qsort(sorted, num, sizeof(double), compare_doubles);
+    const double median = (num % 2) ?
+      sorted[num / 2] : (sorted[num / 2 - 1] + sorted[num / 2]) * 0.5;
+
+    fprintf(out, "\"iterations\": %d, \"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f}",
+            num, sorted[0], median, sum / num);
+    fprintf(stderr, "%-20s %10.3f ms (median of %d)\n", name.getString(), median, num);
+    delete[] sorted;
+  }
+
+  void
+  run_scene(const Options & options, FILE * out, SbBool & first,
+            const char * name, SoSeparator * root, SoCalculator * engine = NULL,
+            const Benchmark * benchmarks = actionbenchmarks,
+            const size_t numbenchmarks = sizeof(actionbenchmarks) / sizeof(actionbenchmarks[0]))
+  {
+    Scene scene;
+    scene.name = name;
+    scene.root = root;
+    scene.root->ref();
+    scene.buffer = NULL;
+    scene.buffersize = 0;
+    scene.engine = engine;
+
+    for (size_t i = 0; i < numbenchmarks; i++) {
+      run_benchmark(options, out, first, scene, benchmarks[i]);
+    }
+    if (engine) {
+      const Benchmark evaluate = { "evaluate", bench_evaluate };
+      run_benchmark(options, out, first, scene, evaluate);
+    }
+
+    free(scene.buffer);
+    if (benchmarks == compressionbenchmarks) remove_compressed(scene);
+    SoSearchAction::setIndexed(scene.root, FALSE);
+    scene.root->unref();
+  }
+
+  void
+  usage(const char * argv0)
+  {
+    fprintf(stderr,
+            "Usage: %s [--output <file>] [--filter <string>] [--scale <float>]\n"
+            "       [--min-time <seconds>] [--threads <n>] [--tmpdir <dir>] [--list]\n",
+            argv0);
+  }
+
+} // namespace
+
+// *************************************************************************
+
+int
+main(int argc, char * argv[])
+{
+  Options options;
+  options.output = NULL;
+  options.filter = NULL;
+  options.scale = 1.0f;
+  options.mintime = 0.5;
+  options.threads = 0;
+  options.tmpdir = ".";
+  options.list = FALSE;
+
+  for (int i = 1; i < argc; i++) {
+    const SbBool hasarg = (i + 1 < argc);
+    if (strcmp(argv[i], "--output") == 0 && hasarg) options.output = argv[++i];
+    else if (strcmp(argv[i], "--filter") == 0 && hasarg) options.filter = argv[++i];
+    else if (strcmp(argv[i], "--scale") == 0 && hasarg) options.scale = static_cast<float>(atof(argv[++i]));
+    else if (strcmp(argv[i], "--min-time") == 0 && hasarg) options.mintime = atof(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && hasarg) options.threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--tmpdir") == 0 && hasarg) options.tmpdir = argv[++i];
+    else if (strcmp(argv[i], "--list") == 0) options.list = TRUE;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.scale <= 0.0f || options.threads < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // must be set before Coin first looks up the thread count
+  if (options.threads > 0) {
+    SbString threads;
+    threads.sprintf("%d", options.threads);
+    (void) coin_setenv("COIN_PARALLEL_THREADS", threads.getString(), TRUE);
+    (void) coin_setenv("COIN_COMPRESSION_THREADS", threads.getString(), TRUE);
+  }
+  tmpdir = options.tmpdir;
+
+  SoDB::init();
+
+  FILE * out = stdout;
+  if (options.output && !options.list) {
+    out = fopen(options.output, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Unable to open '%s' for writing.\n", options.output);
+      return 1;
+    }
+  }
+
+  if (!options.list) {
+    fprintf(out, "{\n  \"coin_version\": \"%s\",\n  \"scale\": %g,\n  \"threads\": %d,\n"
+            "  \"benchmarks\": [",
+            SoDB::getVersion(), options.scale, options.threads);
+  }
+
+  SbBool first = TRUE;
+  run_scene(options, out, first, "deep", create_deep(options));
+  run_scene(options, out, first, "wide", create_wide(options));
+  run_scene(options, out, first, "faceset", create_faceset(options));
+  run_scene(options, out, first, "text", create_text(options));
+  SoCalculator * engine = NULL;
+  SoSeparator * engines = create_engines(options, engine);
+  run_scene(options, out, first, "engines", engines, engine);
+  run_scene(options, out, first, "points", create_points(options), NULL,
+            matrixbenchmarks, sizeof(matrixbenchmarks) / sizeof(matrixbenchmarks[0]));
+  run_scene(options, out, first, "interpolators", create_interpolators(options), NULL,
+            interpolatorbenchmarks,
+            sizeof(interpolatorbenchmarks) / sizeof(interpolatorbenchmarks[0]));
+  run_scene(options, out, first, "polygons", create_polygons(options), NULL,
+            tessellatorbenchmarks,
+            sizeof(tessellatorbenchmarks) / sizeof(tessellatorbenchmarks[0]));
+  run_scene(options, out, first, "compressed", create_compressed(options), NULL,
+            compressionbenchmarks,
+            sizeof(compressionbenchmarks) / sizeof(compressionbenchmarks[0]));
+
+  if (!options.list) {
+    fprintf(out, "\n  ]\n}\n");
+  }
+  const SbBool ok = (ferror(out) == 0);
+  if (out != stdout) fclose(out);
+
+  delete renderer;
+  SoDB::finish();
+  return ok ? 0 : 1;
+}